@@ -53,7 +53,7 @@ mkdir -p ../data
 
 # Build test client
 echo "Building test client..."
-g++ -std=c++17 -O2 -o test_client ../test_client.cpp -lzmq -ljsoncpp -pthread || echo "Warning: Could not build test client (jsoncpp may not be installed)"
+g++ -std=c++17 -O2 -I../include -o test_client ../test_client.cpp -lzmq -ljsoncpp -pthread || echo "Warning: Could not build test client (jsoncpp may not be installed)"
 
 echo ""
 echo "To run TickShaper:"
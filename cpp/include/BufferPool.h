@@ -0,0 +1,58 @@
+#pragma once
+
+#include "MPSCRing.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+namespace tickshaper {
+
+// Fixed-size send buffers recycled through ZMQ's zero-copy free callback.
+// Acquire() is called by the owning publisher thread; Release() may run on
+// any ZMQ I/O thread, hence the MPSC free list.
+class BufferPool {
+public:
+    explicit BufferPool(size_t max_buffers = DEFAULT_MAX_BUFFERS)
+        : free_list_(max_buffers), max_buffers_(max_buffers) {}
+    
+    ~BufferPool() {
+        uint8_t* buffer;
+        while (free_list_.TryPop(buffer)) {
+            std::free(buffer);
+        }
+    }
+    
+    // Returns nullptr when every buffer is in flight
+    uint8_t* Acquire() {
+        uint8_t* buffer;
+        if (free_list_.TryPop(buffer)) {
+            return buffer;
+        }
+        if (allocated_.load(std::memory_order_relaxed) >= max_buffers_) {
+            return nullptr;
+        }
+        allocated_.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<uint8_t*>(std::aligned_alloc(64, BUFFER_SIZE));
+    }
+    
+    // zmq_free_fn signature: data is the buffer, hint is the owning pool
+    static void Release(void* data, void* hint) {
+        BufferPool* pool = static_cast<BufferPool*>(hint);
+        if (!pool->free_list_.TryPush(static_cast<uint8_t*>(data))) {
+            std::free(data);
+            pool->allocated_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    
+    size_t GetAllocatedCount() const { return allocated_.load(); }
+    
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+    static constexpr size_t DEFAULT_MAX_BUFFERS = 1024;
+
+private:
+    MPSCRing<uint8_t*> free_list_;
+    size_t max_buffers_;
+    std::atomic<size_t> allocated_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "WireFormat.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace tickshaper {
+namespace wire {
+
+// Delta/varint tick batches for bandwidth-bound subscribers.
+//
+// A CompactTickBatch is self-contained: deltas restart in every message, so a
+// message lost to a high water mark or a late join never corrupts the next.
+// Within a message, which holds a single symbol, each tick is coded against
+// the previous one; the first is coded against zero.
+//
+//   MessageHeader (16)  kind = kCompactTickBatch, record_size = 0 (variable)
+//   stock_locate u16 (little-endian), then per tick:
+//   tag u8              bits 0-1 side (0 'B', 1 'S', 2 ' ', 3 raw byte follows)
+//                       bit 2    message_type byte follows (else as previous)
+//                       bit 3    symbol_id varint follows (else as previous)
+//   [message_type u8] [side u8] [symbol_id varint]
+//   timestamp delta     zigzag varint
+//   price delta         zigzag varint
+//   size                varint
+//
+// Varints are LEB128: 7 bits per byte, least significant group first, high
+// bit set on every byte but the last.
+
+constexpr size_t kMaxVarintSize = 10;
+constexpr size_t kMaxCompactTickSize = 3 + 5 + 2 * kMaxVarintSize + 5;
+
+constexpr uint8_t kCompactSideMask = 0x03;
+constexpr uint8_t kCompactSideRaw = 0x03;
+constexpr uint8_t kCompactNewType = 0x04;
+constexpr uint8_t kCompactNewSymbol = 0x08;
+
+inline uint64_t ZigZag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t UnZigZag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline uint8_t* PutVarint(uint8_t* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+// Returns nullptr if the varint runs past end or is longer than 10 bytes
+inline const uint8_t* GetVarint(const uint8_t* in, const uint8_t* end, uint64_t& value) {
+    // Most deltas fit in one or two bytes
+    if (in < end && *in < 0x80) {
+        value = *in;
+        return in + 1;
+    }
+    
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && in < end; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+inline uint8_t CompactSideCode(char side) {
+    return side == 'B' ? 0 : side == 'S' ? 1 : side == ' ' ? 2 : kCompactSideRaw;
+}
+
+inline size_t MaxCompactBatchSize(size_t count) {
+    return sizeof(MessageHeader) + sizeof(uint16_t) + count * kMaxCompactTickSize;
+}
+
+// ticks must all share one stock_locate; out needs MaxCompactBatchSize(count)
+inline uint8_t* EncodeCompactTicks(uint8_t* out, const TickData* ticks, size_t count, uint64_t sequence) {
+    out = EncodeHeader(out, kCompactTickBatch, static_cast<uint16_t>(count), 0, sequence);
+    uint16_t stock_locate = htole16(ticks[0].stock_locate);
+    memcpy(out, &stock_locate, sizeof(stock_locate));
+    out += sizeof(stock_locate);
+    
+    uint64_t timestamp = 0;
+    uint64_t price = 0;
+    uint32_t symbol_id = 0;
+    uint8_t message_type = 0;
+    
+    for (size_t i = 0; i < count; ++i) {
+        const TickData& tick = ticks[i];
+        uint8_t side_code = CompactSideCode(tick.side);
+        bool new_type = (i == 0 || tick.message_type != message_type);
+        bool new_symbol = (i == 0 || tick.symbol_id != symbol_id);
+        
+        *out++ = side_code | (new_type ? kCompactNewType : 0) | (new_symbol ? kCompactNewSymbol : 0);
+        if (new_type) {
+            *out++ = tick.message_type;
+        }
+        if (side_code == kCompactSideRaw) {
+            *out++ = static_cast<uint8_t>(tick.side);
+        }
+        if (new_symbol) {
+            out = PutVarint(out, tick.symbol_id);
+        }
+        
+        out = PutVarint(out, ZigZag(static_cast<int64_t>(tick.timestamp - timestamp)));
+        out = PutVarint(out, ZigZag(static_cast<int64_t>(tick.price - price)));
+        out = PutVarint(out, tick.size);
+        
+        timestamp = tick.timestamp;
+        price = tick.price;
+        symbol_id = tick.symbol_id;
+        message_type = tick.message_type;
+    }
+    
+    return out;
+}
+
+// data/size is the whole message and header came from DecodeHeader; returns
+// false if the body is truncated or malformed
+inline bool DecodeCompactTicks(const uint8_t* data, size_t size, const MessageHeader& header,
+                               std::vector<TickRecord>& ticks) {
+    ticks.clear();
+    const uint8_t* in = data + sizeof(MessageHeader);
+    const uint8_t* end = data + size;
+    if (header.kind != kCompactTickBatch || end - in < static_cast<ptrdiff_t>(sizeof(uint16_t))) {
+        return false;
+    }
+    
+    uint16_t stock_locate;
+    memcpy(&stock_locate, in, sizeof(stock_locate));
+    in += sizeof(stock_locate);
+    
+    static const uint8_t kSides[3] = {'B', 'S', ' '};
+    TickRecord record{};
+    record.stock_locate = le16toh(stock_locate);
+    ticks.reserve(header.count);
+    
+    for (uint16_t i = 0; i < header.count; ++i) {
+        if (in >= end) {
+            return false;
+        }
+        uint8_t tag = *in++;
+        
+        if (tag & kCompactNewType) {
+            if (in >= end) {
+                return false;
+            }
+            record.message_type = *in++;
+        }
+        if ((tag & kCompactSideMask) == kCompactSideRaw) {
+            if (in >= end) {
+                return false;
+            }
+            record.side = *in++;
+        } else {
+            record.side = kSides[tag & kCompactSideMask];
+        }
+        
+        uint64_t value;
+        if (tag & kCompactNewSymbol) {
+            if (!(in = GetVarint(in, end, value))) {
+                return false;
+            }
+            record.symbol_id = static_cast<uint32_t>(value);
+        }
+        
+        if (!(in = GetVarint(in, end, value))) {
+            return false;
+        }
+        record.timestamp += static_cast<uint64_t>(UnZigZag(value));
+        if (!(in = GetVarint(in, end, value))) {
+            return false;
+        }
+        record.price += static_cast<uint64_t>(UnZigZag(value));
+        if (!(in = GetVarint(in, end, value))) {
+            return false;
+        }
+        record.size = static_cast<uint32_t>(value);
+        
+        ticks.push_back(record);
+    }
+    
+    return true;
+}
+
+} // namespace wire
+} // namespace tickshaper
\ No newline at end of file
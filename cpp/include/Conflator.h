@@ -0,0 +1,61 @@
+#pragma once
+
+#include "TickShaper.h"
+#include <vector>
+#include <cstdint>
+
+namespace tickshaper {
+
+// Latest-value conflation keyed by stock_locate and update class. Each key owns
+// one slot; a newer update overwrites the pending value in place and dirty slots
+// are drained in the order they first became dirty. Memory is bounded by the
+// number of symbols, not the number of messages. Not thread-safe: the owner
+// serializes Update() and Drain().
+class Conflator {
+public:
+    enum UpdateClass : uint8_t {
+        kQuote = 0,     // Add, cancel, delete, replace
+        kExecution = 1, // Order executed
+        kTrade = 2,     // Trade / cross trade
+        kOther = 3,
+        kNumUpdateClasses = 4
+    };
+    
+    Conflator();
+    ~Conflator();
+    
+    void Update(const TickData& tick_data);
+    size_t Drain(std::vector<TickData>& out, size_t max_count);
+    
+    size_t GetPendingCount() const { return dirty_count_; }
+    uint64_t GetUpdatesIn() const { return total_in_; }
+    uint64_t GetUpdatesOut() const { return total_out_; }
+    std::vector<ConflationStats> GetSymbolStats() const;
+    void ResetStats();
+    
+    static UpdateClass ClassifyMessage(uint8_t message_type);
+
+private:
+    struct Slot {
+        TickData pending;
+        uint32_t next_dirty;
+        bool dirty;
+        uint64_t updates_in;
+        uint64_t updates_out;
+    };
+    
+    static constexpr uint32_t NO_SLOT = 0xFFFFFFFF;
+    
+    // Slots grow lazily up to the highest stock_locate seen
+    std::vector<Slot> slots_;
+    
+    // Dirty list: intrusive FIFO through Slot::next_dirty
+    uint32_t dirty_head_;
+    uint32_t dirty_tail_;
+    size_t dirty_count_;
+    
+    uint64_t total_in_;
+    uint64_t total_out_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
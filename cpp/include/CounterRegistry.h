@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace tickshaper {
+
+// Hot-path event counters, folded into SystemMetrics by the metrics thread
+enum CounterId : uint8_t {
+    kCounterProcessed = 0,
+    kCounterThrottled = 1,
+    kCounterSuppressed = 2,   // Book events that left the inside quote unchanged
+    kCounterPruned = 3,       // Ticks dropped by a worker because nobody wanted them
+    kCounterAddOrders = 4,
+    kCounterExecutions = 5,
+    kCounterTrades = 6,
+    kCounterCancels = 7,
+    kCounterInFlight = 8,     // Messages inside MessageProcessor, raised and lowered per call
+    kNumCounters = 9
+};
+
+// One thread's counters, on cache lines of their own. Only the owning thread
+// writes, so an update is a plain load and store with no locked instruction;
+// the atomics only make the reader's loads well defined.
+struct alignas(64) ThreadCounters {
+    std::atomic<uint64_t> values[kNumCounters] = {};
+    
+    void Add(CounterId id, uint64_t n = 1) {
+        values[id].store(values[id].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    
+    // Wraps below zero; only the sum over every thread is meaningful
+    void Sub(CounterId id, uint64_t n = 1) { Add(id, 0 - n); }
+};
+
+// Hands every counting thread its own ThreadCounters and sums them on read.
+// Slots live as long as the registry, so a thread may keep its pointer.
+class CounterRegistry {
+public:
+    CounterRegistry() : id_(next_id_.fetch_add(1)) {}
+    
+    ThreadCounters* RegisterThread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadCounters>());
+        return threads_.back().get();
+    }
+    
+    // The calling thread's slot, registered on its first use. For code that is
+    // called from several threads and cannot be handed a slot
+    ThreadCounters& Local() {
+        thread_local std::vector<std::pair<uint64_t, ThreadCounters*>> slots;
+        for (const auto& slot : slots) {
+            if (slot.first == id_) {
+                return *slot.second;
+            }
+        }
+        slots.emplace_back(id_, RegisterThread());
+        return *slots.back().second;
+    }
+    
+    // Totals over every thread, indexed by CounterId
+    std::vector<uint64_t> Collect() const {
+        std::vector<uint64_t> totals(kNumCounters, 0);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& thread : threads_) {
+            for (size_t id = 0; id < kNumCounters; ++id) {
+                totals[id] += thread->values[id].load(std::memory_order_relaxed);
+            }
+        }
+        return totals;
+    }
+    
+    uint64_t Get(CounterId id) const {
+        uint64_t total = 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& thread : threads_) {
+            total += thread->values[id].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    // Keys the thread-local slot lists, which outlive any one registry
+    static inline std::atomic<uint64_t> next_id_{1};
+    
+    const uint64_t id_;
+    std::vector<std::unique_ptr<ThreadCounters>> threads_;
+    mutable std::mutex mutex_;
+};
+
+// One thread's message count per stock_locate, written like ThreadCounters.
+// 512 KB, but a thread only touches the lines of the symbols it sees
+struct alignas(64) ThreadSymbolCounts {
+    static constexpr size_t NUM_LOCATES = 65536;
+    
+    std::atomic<uint64_t> values[NUM_LOCATES] = {};
+    
+    void Add(uint16_t stock_locate) {
+        values[stock_locate].store(values[stock_locate].load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+    }
+};
+
+// Per-symbol counterpart of CounterRegistry, for the top-N symbol rates
+class SymbolCounterRegistry {
+public:
+    ThreadSymbolCounts* RegisterThread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadSymbolCounts>());
+        return threads_.back().get();
+    }
+    
+    // Totals over every thread, indexed by stock_locate
+    std::vector<uint64_t> Collect() const {
+        std::vector<uint64_t> totals(ThreadSymbolCounts::NUM_LOCATES, 0);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& thread : threads_) {
+            for (size_t locate = 0; locate < ThreadSymbolCounts::NUM_LOCATES; ++locate) {
+                totals[locate] += thread->values[locate].load(std::memory_order_relaxed);
+            }
+        }
+        return totals;
+    }
+
+private:
+    std::vector<std::unique_ptr<ThreadSymbolCounts>> threads_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tickshaper {
+
+// Pushes dashboard snapshots to browsers over WebSocket (RFC 6455, text
+// frames only). Every interval the stream thread calls the render callback
+// once and sends the result to every open connection, so the aggregation
+// cost does not grow with the number of viewers and browsers never see raw
+// ticks. Clients only ever receive; their frames are read for close and
+// ping and otherwise ignored. A client whose socket buffer is full is
+// dropped rather than buffered for.
+class DashboardStream {
+public:
+    using RenderFunction = std::function<std::string()>;
+    
+    DashboardStream();
+    ~DashboardStream();
+    
+    // Port 0 picks a free port, see GetPort
+    bool Initialize(const std::string& address, uint16_t port, uint32_t interval_ms, RenderFunction render);
+    void Stop();
+    
+    uint16_t GetPort() const { return port_; }
+    size_t GetClientCount() const { return client_count_.load(); }
+    uint64_t GetSnapshotCount() const { return snapshot_count_.load(); }
+    
+    // Sec-WebSocket-Accept for a client's Sec-WebSocket-Key
+    static std::string AcceptKey(const std::string& key);
+    static std::string EncodeTextFrame(const std::string& payload);
+    
+    static constexpr size_t MAX_CLIENTS = 64;
+    static constexpr size_t MAX_HANDSHAKE_SIZE = 8192;
+
+private:
+    struct Client {
+        int socket;
+        bool open;          // Handshake done
+        std::string input;  // Handshake bytes, then unread frame bytes
+    };
+    
+    void StreamLoop();
+    void Accept();
+    bool Receive(Client& client);
+    bool Handshake(Client& client);
+    bool ReadFrames(Client& client);
+    static bool SendAll(int socket, const std::string& data);
+    
+    int listen_socket_;
+    uint16_t port_;
+    uint32_t interval_ms_;
+    RenderFunction render_;
+    std::vector<Client> clients_;  // Stream thread only
+    
+    std::thread stream_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> client_count_{0};
+    std::atomic<uint64_t> snapshot_count_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICKSHAPER_HAVE_TSC 1
+#endif
+
+namespace tickshaper {
+
+// Process-wide monotonic clock in nanoseconds on the CLOCK_MONOTONIC timeline.
+//
+// With an invariant TSC a read is one rdtsc plus a multiply and shift, against
+// a calibration taken from CLOCK_MONOTONIC by Calibrate(). Recalibrate() re-measures
+// the tick rate and steers any drift out gradually, so the clock never steps
+// backwards. Without an invariant TSC, or before Calibrate(), it reads
+// CLOCK_MONOTONIC directly. rdtsc is not serializing; a read may move by a few
+// instructions, which is far below what the pipeline measures.
+class FastClock {
+public:
+    static uint64_t NowNanos() {
+#ifdef TICKSHAPER_HAVE_TSC
+        if (use_tsc_.load(std::memory_order_relaxed)) {
+            return TscNanos(__rdtsc());
+        }
+#endif
+        return MonotonicNanos();
+    }
+    
+    // Calibrates once per process; later calls return immediately
+    static void Calibrate();
+    
+    // Re-measures the TSC rate against CLOCK_MONOTONIC; call every second or so
+    static void Recalibrate();
+    
+    static bool UsesTsc() { return use_tsc_.load(std::memory_order_relaxed); }
+    static double GetTicksPerNano() { return ticks_per_ns_.load(std::memory_order_relaxed); }
+    
+    // CLOCK_REALTIME equivalent of a NowNanos() value, for stamps read by
+    // other processes or hosts. The offset is refreshed by Recalibrate()
+    static uint64_t ToRealtime(uint64_t now_ns) {
+        return now_ns + static_cast<uint64_t>(realtime_offset_ns_.load(std::memory_order_relaxed));
+    }
+    
+    static uint64_t MonotonicNanos() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+private:
+    // Nanoseconds per tick in 32.32 fixed point
+    static constexpr int SCALE_SHIFT = 32;
+    
+    // Ticks times scale overflows 64 bits; __extension__ keeps -Wpedantic quiet
+    __extension__ typedef unsigned __int128 uint128_t;
+    
+    // Drift is steered out over this much time, at most SLEW_LIMIT of it per window
+    static constexpr uint64_t SLEW_WINDOW_NS = 1000000000ULL;
+    static constexpr double SLEW_LIMIT = 0.01;
+    
+    // Measured rate may wander this far from the startup rate before the TSC is distrusted
+    static constexpr double MAX_RATE_DRIFT = 0.001;
+    static constexpr uint64_t CALIBRATION_NS = 20000000ULL;
+    
+    static uint64_t TscNanos(uint64_t tsc) {
+        uint64_t ns;
+        uint32_t sequence;
+        do {
+            sequence = sequence_.load(std::memory_order_acquire);
+            uint64_t base_tsc = base_tsc_.load(std::memory_order_relaxed);
+            uint64_t delta = tsc > base_tsc ? tsc - base_tsc : 0;
+            ns = base_ns_.load(std::memory_order_relaxed) + static_cast<uint64_t>(
+                (static_cast<uint128_t>(delta) * scale_.load(std::memory_order_relaxed)) >> SCALE_SHIFT);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) != 0 || sequence != sequence_.load(std::memory_order_relaxed));
+        return ns;
+    }
+    
+    static bool HasInvariantTsc();
+    
+    // A TSC reading and the CLOCK_MONOTONIC time it was taken at
+    static void ReadPair(uint64_t& tsc, uint64_t& mono_ns);
+    
+    static void Publish(uint64_t base_tsc, uint64_t base_ns, double ns_per_tick);
+    static void UpdateRealtimeOffset();
+    
+    // Conversion parameters, written under a sequence lock
+    static inline std::atomic<uint32_t> sequence_{0};
+    static inline std::atomic<uint64_t> base_tsc_{0};
+    static inline std::atomic<uint64_t> base_ns_{0};
+    static inline std::atomic<uint64_t> scale_{0};
+    
+    static inline std::atomic<bool> use_tsc_{false};
+    static inline std::atomic<double> ticks_per_ns_{0.0};
+    static inline std::atomic<int64_t> realtime_offset_ns_{0};
+    
+    // Startup calibration point, the long baseline for the rate
+    static inline uint64_t origin_tsc_ = 0;
+    static inline uint64_t origin_ns_ = 0;
+    static inline double startup_ticks_per_ns_ = 0.0;
+    static inline std::once_flag calibrated_;
+    static inline std::mutex mutex_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
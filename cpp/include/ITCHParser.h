@@ -6,6 +6,7 @@
 #include <vector>
 #include <cstdint>
 #include <mutex>
+#include "LockProfiler.h"
 
 namespace tickshaper {
 
@@ -77,7 +78,7 @@ public:
 private:
     bool ReadMessageHeader(ITCHMessageHeader& header);
     bool ReadMessageData(uint8_t message_type, uint16_t length, std::vector<uint8_t>& data);
-    uint64_t ExtractTimestamp(uint8_t message_type, const std::vector<uint8_t>& data);
+    uint64_t ExtractTimestamp(const std::vector<uint8_t>& data);
     bool LoadSymbolsFromFile(const std::string& symbols_file);
     bool CreateSampleData(const std::string& symbols_file);
     
@@ -99,7 +100,7 @@ private:
     uint32_t max_size_;
     uint64_t message_interval_ns_;
     
-    mutable std::mutex file_mutex_;
+    mutable InstrumentedMutex file_mutex_{"itch_file"};
 };
 
 } // namespace tickshaper
\ No newline at end of file
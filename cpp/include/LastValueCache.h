@@ -0,0 +1,50 @@
+#pragma once
+
+#include "TickShaper.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tickshaper {
+
+// Latest value per stock_locate for late joiners. Each slot is a seqlock: the
+// publisher shard that owns a symbol is its only writer and never waits, while
+// readers copy the slot and retry if a write overlapped. Values are stamped
+// with the sequence of the last message sent on the symbol's topic, so a
+// client applies only updates with a higher sequence after taking a snapshot.
+class LastValueCache {
+public:
+    LastValueCache();
+    
+    // Writer side, called by the owning shard after the run was encoded
+    void ApplyTicks(const TickData* ticks, size_t count, uint64_t tick_sequence);
+    void ApplySnapshot(uint64_t sample_time, const L1Snapshot& snapshot, uint64_t snapshot_sequence);
+    
+    // Any thread; false if nothing was published for the symbol yet
+    bool Read(uint16_t stock_locate, LastValue& value) const;
+    
+    // Every symbol with a value, in stock_locate order
+    void ReadAll(std::vector<LastValue>& values) const;
+    
+    uint64_t GetReadRetries() const { return read_retries_.load(); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(LastValue) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    
+    // Own cache line: neighbouring locates belong to different shards
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> version{0};  // Odd while a write is in progress, 0 if never written
+        std::atomic<uint64_t> words[WORDS];
+    };
+    
+    void Load(const Slot& slot, LastValue& value) const;
+    void Store(Slot& slot, const LastValue& value);
+    
+    static constexpr size_t NUM_LOCATES = 65536;
+    
+    std::unique_ptr<Slot[]> slots_;
+    mutable std::atomic<uint64_t> read_retries_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "TickShaper.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+namespace tickshaper {
+
+const char* LatencyStageName(LatencyStage stage);
+
+// HDR-style log-linear histogram of nanosecond latencies. Values below 64 ns
+// get exact buckets; above that every power of two is split into 32 linear
+// sub-buckets, so any value is reported within 1/32 (3.1%) of its true size.
+// Values above MAX_VALUE (~137 s) land in the last bucket.
+//
+// One thread records; any thread may read. Recording is a bucket lookup and
+// a few relaxed load/store pairs, with no read-modify-write, so it costs a few
+// nanoseconds and never bounces a cache line with other writers.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_VALUE_BITS = 37;
+    static constexpr uint64_t MAX_VALUE = (1ULL << MAX_VALUE_BITS) - 1;
+    static constexpr size_t NUM_BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKETS + SUB_BUCKETS;
+    
+    // Owning thread only
+    void Record(uint64_t value_ns) {
+        size_t index = BucketIndex(value_ns);
+        counts_[index].store(counts_[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value_ns, std::memory_order_relaxed);
+        if (value_ns > max_.load(std::memory_order_relaxed)) {
+            max_.store(value_ns, std::memory_order_relaxed);
+        }
+    }
+    
+    static size_t BucketIndex(uint64_t value) {
+        if (value < 2 * SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        if (value > MAX_VALUE) {
+            value = MAX_VALUE;
+        }
+        unsigned shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+        return static_cast<size_t>(shift * SUB_BUCKETS + (value >> shift));
+    }
+    
+    // Highest value that maps to the bucket
+    static uint64_t BucketUpperBound(size_t index) {
+        if (index < 2 * SUB_BUCKETS) {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS) - 1;
+        uint64_t sub_bucket = (index % SUB_BUCKETS) + SUB_BUCKETS;
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+private:
+    friend class HistogramSnapshot;
+    
+    std::atomic<uint64_t> counts_[NUM_BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Plain copy of one or more histograms, for merging and percentiles
+class HistogramSnapshot {
+public:
+    HistogramSnapshot() : counts_(LatencyHistogram::NUM_BUCKETS, 0), count_(0), sum_(0), max_(0) {}
+    
+    void Add(const LatencyHistogram& histogram) {
+        for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+            counts_[i] += histogram.counts_[i].load(std::memory_order_relaxed);
+        }
+        count_ += histogram.count_.load(std::memory_order_relaxed);
+        sum_ += histogram.sum_.load(std::memory_order_relaxed);
+        max_ = std::max(max_, histogram.max_.load(std::memory_order_relaxed));
+    }
+    
+    void Add(const HistogramSnapshot& other) {
+        for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+    
+    // What was recorded between earlier and this snapshot. Only the bucket of
+    // the largest value is known, so max becomes that bucket's upper bound
+    HistogramSnapshot Since(const HistogramSnapshot& earlier) const {
+        HistogramSnapshot delta;
+        for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+            delta.counts_[i] = counts_[i] - earlier.counts_[i];
+            if (delta.counts_[i] > 0) {
+                delta.max_ = std::min(LatencyHistogram::BucketUpperBound(i), max_);
+            }
+        }
+        delta.count_ = count_ - earlier.count_;
+        delta.sum_ = sum_ - earlier.sum_;
+        return delta;
+    }
+    
+    // Highest value equivalent to the percentile's bucket, never above max
+    uint64_t Percentile(double percentile) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+        target = std::max<uint64_t>(target, 1);
+        
+        uint64_t seen = 0;
+        for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(LatencyHistogram::BucketUpperBound(i), max_);
+            }
+        }
+        return max_;
+    }
+    
+    // Values in buckets that lie wholly at or below value_ns; a bucket that
+    // straddles value_ns counts towards the next bound up
+    uint64_t CountAtOrBelow(uint64_t value_ns) const {
+        uint64_t seen = 0;
+        for (size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+            if (LatencyHistogram::BucketUpperBound(i) > value_ns) {
+                break;
+            }
+            seen += counts_[i];
+        }
+        return seen;
+    }
+    
+    LatencyPercentiles Summarize() const {
+        LatencyPercentiles summary;
+        summary.count = count_;
+        summary.p50 = Percentile(50.0);
+        summary.p99 = Percentile(99.0);
+        summary.p999 = Percentile(99.9);
+        summary.p9999 = Percentile(99.99);
+        summary.max = max_;
+        summary.mean = count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0;
+        return summary;
+    }
+    
+    uint64_t GetCount() const { return count_; }
+    uint64_t GetMax() const { return max_; }
+    uint64_t GetSum() const { return sum_; }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+// One histogram per stage for one thread. Aligned so no two threads' slots
+// share a cache line
+struct alignas(64) ThreadLatency {
+    LatencyHistogram stages[kNumLatencyStages];
+    
+    void Record(LatencyStage stage, uint64_t value_ns) { stages[stage].Record(value_ns); }
+};
+
+// Hands every recording thread its own ThreadLatency and merges them on read.
+// Slots live as long as the tracker, so a thread may keep its pointer.
+class LatencyTracker {
+public:
+    ThreadLatency* RegisterThread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadLatency>());
+        return threads_.back().get();
+    }
+    
+    // One merged snapshot per stage, indexed by LatencyStage
+    std::vector<HistogramSnapshot> Collect() const {
+        std::vector<HistogramSnapshot> merged(kNumLatencyStages);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& thread : threads_) {
+            for (size_t stage = 0; stage < kNumLatencyStages; ++stage) {
+                merged[stage].Add(thread->stages[stage]);
+            }
+        }
+        return merged;
+    }
+
+private:
+    std::vector<std::unique_ptr<ThreadLatency>> threads_;
+    mutable std::mutex mutex_;
+};
+
+inline const char* LatencyStageName(LatencyStage stage) {
+    switch (stage) {
+        case kStageFraming: return "framing";
+        case kStageThrottle: return "throttle";
+        case kStageDecode: return "decode";
+        case kStageBook: return "book";
+        case kStageQueueWait: return "queue_wait";
+        case kStageSend: return "serialize_send";
+        case kStageTotal: return "total";
+        default: return "unknown";
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
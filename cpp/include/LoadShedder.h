@@ -0,0 +1,38 @@
+#pragma once
+
+#include "TickShaper.h"
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+namespace tickshaper {
+
+// Deadline-based load shedding. Messages are stamped when they enter the
+// pipeline and checked against max age at every queue hand-off; anything
+// older is discarded so a sustained overload cannot build an ever-growing
+// backlog of stale ticks.
+class LoadShedder {
+public:
+    LoadShedder();
+    ~LoadShedder();
+    
+    void Initialize(uint64_t max_age_us);
+    void SetMaxAge(uint64_t max_age_us);
+    
+    // Returns false (and counts a shed) when the message has outlived its deadline
+    bool Admit(HandoffStage stage, uint64_t ingest_time_ns);
+    bool Admit(HandoffStage stage, uint64_t ingest_time_ns, uint64_t now_ns);
+    
+    bool IsEnabled() const { return max_age_ns_.load(std::memory_order_relaxed) != 0; }
+    uint64_t GetMaxAgeUs() const { return max_age_ns_.load() / 1000; }
+    LoadSheddingStats GetStats() const;
+    void ResetCounters();
+
+private:
+    std::atomic<uint64_t> max_age_ns_{0};
+    
+    std::array<std::atomic<uint64_t>, kNumHandoffStages> checked_count_;
+    std::array<std::atomic<uint64_t>, kNumHandoffStages> shed_count_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
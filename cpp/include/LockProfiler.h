@@ -0,0 +1,123 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "LatencyHistogram.h"
+#include "FastClock.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tickshaper {
+
+// One lock instance's counts. Every field is written by whichever thread holds
+// the lock, so the lock itself orders the writers and the histograms keep
+// their single-writer load/store updates.
+struct LockStats {
+    std::string name;
+    bool in_use = true;                         // Owned by a live InstrumentedMutex
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended{0};         // try_lock failed and the thread blocked
+    LatencyHistogram wait;                      // Contended acquisitions only
+    LatencyHistogram hold;
+    
+    // Totals at the last Reset(), guarded by the profiler's mutex
+    uint64_t acquisitions_baseline = 0;
+    uint64_t contended_baseline = 0;
+    HistogramSnapshot wait_baseline;
+    HistogramSnapshot hold_baseline;
+};
+
+// Process-wide registry of named InstrumentedMutexes. Profiling is switched
+// at runtime; while it is off a lock costs one extra relaxed load. Stats of a
+// destroyed lock are handed to the next lock of the same name, so a name's
+// totals survive components being recreated and memory stays bounded.
+class LockProfiler {
+public:
+    static void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+    
+    static LockStats* Register(const char* name);
+    static void Release(LockStats* stats);
+    
+    // One entry per name, most total wait first
+    static std::vector<LockReport> GetReport();
+    
+    // Later reports count from now
+    static void Reset();
+
+private:
+    static inline std::atomic<bool> enabled_{false};
+    static inline std::vector<std::unique_ptr<LockStats>> stats_;
+    static inline std::mutex mutex_;
+};
+
+// Drop-in for std::mutex on contended paths, usable with std::lock_guard and
+// std::unique_lock. Records acquisitions, contended acquisitions and their
+// wait, and hold times while LockProfiler is enabled. Built with
+// TICKSHAPER_NO_LOCK_PROFILING it is a plain std::mutex.
+class InstrumentedMutex {
+public:
+#ifdef TICKSHAPER_NO_LOCK_PROFILING
+    explicit InstrumentedMutex(const char*) {}
+    
+    void lock() { mutex_.lock(); }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+#else
+    explicit InstrumentedMutex(const char* name) : stats_(LockProfiler::Register(name)), acquired_ns_(0) {}
+    ~InstrumentedMutex() { LockProfiler::Release(stats_); }
+    
+    void lock() {
+        if (!LockProfiler::IsEnabled()) {
+            mutex_.lock();
+            acquired_ns_ = 0;
+            return;
+        }
+        
+        if (mutex_.try_lock()) {
+            acquired_ns_ = FastClock::NowNanos();
+        } else {
+            uint64_t wait_start_ns = FastClock::NowNanos();
+            mutex_.lock();
+            acquired_ns_ = FastClock::NowNanos();
+            stats_->contended.store(stats_->contended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            stats_->wait.Record(acquired_ns_ - wait_start_ns);
+        }
+        stats_->acquisitions.store(stats_->acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        acquired_ns_ = LockProfiler::IsEnabled() ? FastClock::NowNanos() : 0;
+        if (acquired_ns_ != 0) {
+            stats_->acquisitions.store(stats_->acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    
+    void unlock() {
+        // Only set by an acquisition that was profiled
+        if (acquired_ns_ != 0) {
+            stats_->hold.Record(FastClock::NowNanos() - acquired_ns_);
+        }
+        mutex_.unlock();
+    }
+#endif
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+private:
+    std::mutex mutex_;
+#ifndef TICKSHAPER_NO_LOCK_PROFILING
+    LockStats* stats_;
+    uint64_t acquired_ns_;  // Guarded by mutex_
+#endif
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace tickshaper {
+
+// Bounded lock-free multi-producer / single-consumer ring (Vyukov-style
+// per-cell sequence numbers). Producers never block: TryPush fails when the
+// ring is full and the caller decides what to drop. Items are moved through
+// the ring, so move-only types such as zmq::message_t work too.
+template <typename T>
+class MPSCRing {
+public:
+    explicit MPSCRing(size_t capacity) {
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        
+        cells_.reset(new Cell[rounded]);
+        mask_ = rounded - 1;
+        for (size_t i = 0; i < rounded; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    bool TryPush(const T& item) { return Push(item); }
+    bool TryPush(T&& item) { return Push(std::move(item)); }
+    
+    // Single consumer only
+    bool TryPop(T& item) {
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        Cell* cell = &cells_[pos & mask_];
+        
+        if (cell->sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;  // Empty
+        }
+        
+        item = std::move(cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    size_t SizeApprox() const {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? static_cast<size_t>(tail - head) : 0;
+    }
+    
+    // Never overestimates when called by the only producer
+    size_t FreeApprox() const { return Capacity() - std::min(SizeApprox(), Capacity()); }
+    
+    size_t Capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        T data;
+    };
+    
+    template <typename U>
+    bool Push(U&& item) {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        
+        cell->data = std::forward<U>(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    alignas(64) std::atomic<uint64_t> head_{0};
+};
+
+// Spin, then yield, then sleep briefly. Keeps a consumer thread hot while
+// traffic flows without burning a core when the feed is idle.
+class AdaptiveBackoff {
+public:
+    void Idle() {
+        if (idle_count_ < SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        } else if (idle_count_ < YIELD_LIMIT) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_US));
+        }
+        idle_count_++;
+    }
+    
+    void Reset() { idle_count_ = 0; }
+
+private:
+    uint32_t idle_count_ = 0;
+    
+    static constexpr uint32_t SPIN_LIMIT = 2000;
+    static constexpr uint32_t YIELD_LIMIT = 2100;
+    static constexpr uint32_t SLEEP_US = 50;
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -3,7 +3,12 @@
 #include "TickShaper.h"
 #include "ITCHParser.h"
 #include "SharedMemoryManager.h"
+#include "CounterRegistry.h"
+#include "LockProfiler.h"
 #include <unordered_map>
+#include <map>
+#include <vector>
+#include <functional>
 #include <string>
 #include <atomic>
 #include <mutex>
@@ -17,6 +22,37 @@ struct OrderBookEntry {
     char side;
     uint64_t timestamp;
     std::string symbol;
+    uint16_t stock_locate;
+};
+
+// Aggregated price levels for one symbol
+class OrderBook {
+public:
+    void AddOrder(char side, uint32_t price, uint32_t shares);
+    void RemoveShares(char side, uint32_t price, uint32_t shares);
+    TopOfBook GetTopOfBook() const;
+    size_t GetLevelCount() const { return bids_.size() + asks_.size(); }
+    
+private:
+    std::map<uint32_t, uint64_t, std::greater<uint32_t>> bids_;
+    std::map<uint32_t, uint64_t> asks_;
+};
+
+enum class OutputMode {
+    kAllTicks,   // One tick per processed ITCH message
+    kTopOfBook,  // Only inside-quote changes and trades
+    kSampled     // Book only; output comes from the snapshot sampler
+};
+
+// Ticks produced by one ITCH message. In top-of-book mode an execution can
+// yield both a trade and an inside-quote change.
+struct ProcessorOutput {
+    static constexpr size_t MAX_TICKS = 3;  // A trade and both sides of the quote
+    
+    TickData event;              // Normalized input message
+    TickData ticks[MAX_TICKS];   // Ticks to publish
+    size_t count = 0;
+    uint64_t decoded_ns = 0;     // Clock between decode and book update, 0 when no book ran
 };
 
 class SymbolManager {
@@ -38,16 +74,39 @@ public:
     ~MessageProcessor();
     
     void Initialize(SharedMemoryManager* shm_manager, SystemMetrics* metrics);
+    void SetOutputMode(OutputMode mode);
+    
+    // Resolve symbol ids through a table shared with other processors, so ids
+    // agree across them. Call before processing; the table must outlive this
+    void ShareSymbolTable(SymbolManager* symbols) { symbols_ = symbols; }
+    
+    // Count into another registry, such as the one the workers count into.
+    // Call before processing; the registry must outlive this
+    void ShareCounters(CounterRegistry* counters) { counters_ = counters; }
     bool ProcessMessage(const RawMessage& raw_message, TickData& tick_data);
+    bool ProcessMessage(const RawMessage& raw_message, ProcessorOutput& output);
     
-    uint32_t GetQueueDepth() const { return queue_depth_.load(); }
+    uint32_t GetQueueDepth() const { return static_cast<uint32_t>(counters_->Get(kCounterInFlight)); }
+    uint64_t GetCounter(CounterId id) const { return counters_->Get(id); }
     size_t GetActiveOrderCount() const;
+    OutputMode GetOutputMode() const { return output_mode_; }
+    TopOfBook GetTopOfBook(uint16_t stock_locate) const;
+    void GetTopOfBooks(const std::vector<uint16_t>& stock_locates, std::vector<TopOfBook>& quotes) const;
+    std::vector<SuppressionStats> GetSuppressionStats() const;
+    
+    // Reads the stock locate without decoding the rest of the message
+    static uint16_t PeekStockLocate(const RawMessage& raw_message);
+    
+    // True when the message leaves no order or book state behind in this mode,
+    // so it can be dropped undecoded if nobody consumes its ticks
+    bool IsStateless(uint8_t message_type) const;
     
 private:
     bool ProcessAddOrder(const RawMessage& raw_message, TickData& tick_data);
     bool ProcessOrderExecuted(const RawMessage& raw_message, TickData& tick_data);
     bool ProcessTrade(const RawMessage& raw_message, TickData& tick_data);
     bool ProcessOrderCancel(const RawMessage& raw_message, TickData& tick_data);
+    bool ProcessOrderReplace(const RawMessage& raw_message, TickData& tick_data);
     
     uint32_t ConvertPrice(uint32_t itch_price);
     std::string ExtractSymbol(const char* symbol_data, size_t length);
@@ -55,21 +114,34 @@ private:
     uint32_t ExtractUint32(const uint8_t* data);
     uint16_t ExtractUint16(const uint8_t* data);
     
+    struct SymbolBook {
+        OrderBook book;
+        TopOfBook last_published{};
+        uint64_t events_in = 0;
+        uint64_t updates_out = 0;
+    };
+    
+    // Caller holds orders_mutex_
+    SymbolBook& GetSymbolBook(uint16_t stock_locate);
+    void ApplyToBook(uint16_t stock_locate, char side, uint32_t price, uint32_t shares, bool add);
+    
     SharedMemoryManager* shm_manager_;
     SystemMetrics* metrics_;
     SymbolManager symbol_manager_;
+    SymbolManager* symbols_;  // symbol_manager_ unless shared
     
-    std::atomic<uint32_t> queue_depth_{0};
+    // Statistics, counted per calling thread
+    CounterRegistry counter_registry_;
+    CounterRegistry* counters_;  // counter_registry_ unless shared
     
     // Order book tracking
     std::unordered_map<uint64_t, OrderBookEntry> active_orders_;
-    mutable std::mutex orders_mutex_;
+    mutable InstrumentedMutex orders_mutex_{"orders"};
     
-    // Statistics
-    std::atomic<uint64_t> processed_add_orders_{0};
-    std::atomic<uint64_t> processed_executions_{0};
-    std::atomic<uint64_t> processed_trades_{0};
-    std::atomic<uint64_t> processed_cancels_{0};
+    // Per-symbol price-level books, indexed by stock_locate (guarded by orders_mutex_)
+    OutputMode output_mode_;
+    bool book_enabled_;
+    std::vector<SymbolBook> books_;
 };
 
 } // namespace tickshaper
\ No newline at end of file
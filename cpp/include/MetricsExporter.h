@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tickshaper {
+
+class HistogramSnapshot;
+
+// Builds a page in the Prometheus text exposition format (version 0.0.4).
+// Declare each metric once, then add its samples right after it
+class PrometheusPage {
+public:
+    // type is "counter", "gauge" or "histogram"
+    void Declare(const std::string& name, const char* type, const std::string& help);
+    
+    // labels is the inside of the braces, e.g. stage="total", or empty
+    void Sample(const std::string& name, const std::string& labels, double value);
+    void Sample(const std::string& name, const std::string& labels, uint64_t value);
+    
+    // Cumulative buckets at fixed bounds from 1 us to 1 s, in seconds
+    void Histogram(const std::string& name, const std::string& labels, const HistogramSnapshot& histogram);
+    
+    const std::string& Text() const { return text_; }
+    std::string Take() { return std::move(text_); }
+
+private:
+    void Line(const std::string& name, const std::string& labels, const std::string& value);
+    
+    std::string text_;
+};
+
+// Serves GET /metrics over HTTP/1.0 from its own thread. The metrics thread
+// renders the page once per update and swaps it in with SetPage, so a scrape
+// only copies a pointer: it never waits on a lock the pipeline threads take,
+// and every sample on the page comes from the same update.
+class MetricsExporter {
+public:
+    MetricsExporter();
+    ~MetricsExporter();
+    
+    // Port 0 picks a free port, see GetPort
+    bool Initialize(const std::string& address, uint16_t port);
+    void Stop();
+    
+    void SetPage(std::string page);
+    
+    uint16_t GetPort() const { return port_; }
+    uint64_t GetScrapeCount() const { return scrape_count_.load(); }
+    
+    // Bounds the request head; anything longer is answered 431
+    static constexpr size_t MAX_REQUEST_SIZE = 8192;
+
+private:
+    void ServeLoop();
+    void HandleConnection(int connection);
+    static bool SendAll(int connection, const std::string& data);
+    
+    int listen_socket_;
+    uint16_t port_;
+    
+    std::shared_ptr<const std::string> page_;
+    std::mutex page_mutex_;  // Guards the pointer only; never held while rendering or sending
+    
+    std::thread serve_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> scrape_count_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tickshaper {
+
+// Read-only shared memory export of the process metrics, for tickshaper-stat
+// and external monitors. The metrics thread rewrites it once per interval
+// under a sequence lock, so a reader polls without any IPC round trip, the
+// hot path never sees it, and the last values stay readable if the process
+// hangs or dies. The segment lives at /dev/shm/<name> with this layout:
+//
+//   MetricsSegmentHeader  magic u32 | version u16 | reserved u16 | pid i32 |
+//                         update_interval_ms u32 | value_count u32 |
+//                         histogram_count u32 | sequence | update_time_ns |
+//                         update_count
+//   MetricsValue[MAX_VALUES]          name[48] | kind u8 | decimals u8 | value
+//   MetricsHistogram[MAX_HISTOGRAMS]  name[48] | count | sum_ns |
+//                                     p50 | p99 | p999 | p9999 | max (last interval, ns)
+//
+// Counters only ever grow, so readers can take rates from them; gauges are
+// point values. A value is value / 10^decimals. Slots below value_count and
+// histogram_count are in use, and their names never change once published.
+// Readers must check magic and version; later versions only append.
+namespace metrics_shm {
+
+constexpr uint32_t kMagic = 0x534D5354;  // "TSMS" on the wire
+constexpr uint16_t kVersion = 1;
+constexpr size_t kNameSize = 48;
+constexpr size_t MAX_VALUES = 64;
+constexpr size_t MAX_HISTOGRAMS = 16;
+
+enum ValueKind : uint8_t {
+    kCounter = 1,
+    kGauge = 2
+};
+
+struct MetricsSegmentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int32_t pid;
+    uint32_t update_interval_ms;
+    std::atomic<uint32_t> value_count;
+    std::atomic<uint32_t> histogram_count;
+    std::atomic<uint64_t> sequence;        // Odd while an update is being written
+    std::atomic<uint64_t> update_time_ns;  // CLOCK_REALTIME of the last update
+    std::atomic<uint64_t> update_count;
+};
+
+struct MetricsValue {
+    char name[kNameSize];
+    uint8_t kind;
+    uint8_t decimals;
+    uint8_t reserved[6];
+    std::atomic<uint64_t> value;
+};
+
+struct MetricsHistogram {
+    char name[kNameSize];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> p50;
+    std::atomic<uint64_t> p99;
+    std::atomic<uint64_t> p999;
+    std::atomic<uint64_t> p9999;
+    std::atomic<uint64_t> max;
+};
+
+struct MetricsSegmentLayout {
+    MetricsSegmentHeader header;
+    MetricsValue values[MAX_VALUES];
+    MetricsHistogram histograms[MAX_HISTOGRAMS];
+};
+
+static_assert(sizeof(MetricsValue) == 64, "MetricsValue layout changed");
+static_assert(sizeof(MetricsHistogram) == 104, "MetricsHistogram layout changed");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+} // namespace metrics_shm
+
+// Plain copy of the segment taken by MetricsSegmentReader
+struct MetricsSample {
+    struct Value {
+        std::string name;
+        metrics_shm::ValueKind kind;
+        uint8_t decimals;
+        uint64_t value;
+        
+        double Scaled() const;
+    };
+    struct Histogram {
+        std::string name;
+        uint64_t count;
+        uint64_t sum_ns;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t p9999;
+        uint64_t max;
+    };
+    
+    int32_t pid = 0;
+    uint32_t update_interval_ms = 0;
+    uint64_t update_time_ns = 0;
+    uint64_t update_count = 0;
+    std::vector<Value> values;
+    std::vector<Histogram> histograms;
+    
+    // nullptr when the writer does not export name
+    const Value* FindValue(const std::string& name) const;
+    const Histogram* FindHistogram(const std::string& name) const;
+};
+
+// Writer side; the owning process's metrics thread is the only writer.
+// Register every slot, then wrap each round of Set calls in BeginUpdate/EndUpdate
+class MetricsSegment {
+public:
+    MetricsSegment();
+    ~MetricsSegment();
+    
+    MetricsSegment(const MetricsSegment&) = delete;
+    MetricsSegment& operator=(const MetricsSegment&) = delete;
+    
+    // name as for shm_open, e.g. "/tickshaper-metrics". Replaces a segment left by an earlier run
+    bool Create(const std::string& name, uint32_t update_interval_ms);
+    
+    // Slot index, or -1 when the segment is full
+    int AddValue(const char* name, metrics_shm::ValueKind kind, uint8_t decimals = 0);
+    int AddHistogram(const char* name);
+    
+    void BeginUpdate();
+    void SetValue(int index, uint64_t value);
+    void SetHistogram(int index, uint64_t count, uint64_t sum_ns, uint64_t p50, uint64_t p99,
+                      uint64_t p999, uint64_t p9999, uint64_t max);
+    void EndUpdate();
+    
+    const std::string& GetName() const { return name_; }
+
+private:
+    metrics_shm::MetricsSegmentLayout* layout_;
+    std::string name_;
+    int fd_;
+};
+
+// Reader side, mapped read-only
+class MetricsSegmentReader {
+public:
+    MetricsSegmentReader();
+    ~MetricsSegmentReader();
+    
+    MetricsSegmentReader(const MetricsSegmentReader&) = delete;
+    MetricsSegmentReader& operator=(const MetricsSegmentReader&) = delete;
+    
+    // Fails if the segment is missing or has another magic or version
+    bool Open(const std::string& name, std::string& error);
+    
+    // A consistent copy; false if the writer kept it busy for every retry
+    bool Read(MetricsSample& sample) const;
+
+private:
+    static constexpr int MAX_READ_ATTEMPTS = 1000;
+    
+    const metrics_shm::MetricsSegmentLayout* layout_;
+    size_t mapped_size_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
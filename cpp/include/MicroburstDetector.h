@@ -1,70 +1,108 @@
 #pragma once
 
 #include "TickShaper.h"
-#include <chrono>
+#include "LockProfiler.h"
 #include <vector>
 #include <atomic>
+#include <array>
+#include <memory>
 #include <mutex>
 
 namespace tickshaper {
 
-struct MicroburstEvent {
-    uint64_t start_time;
-    uint64_t end_time;
-    uint32_t peak_rate;
-    uint32_t total_messages;
-    std::string severity;
-};
-
+// Detects message rate bursts on ITCH event time, the timestamp each message
+// carries, so a file replayed at any speed gives the same bursts.
+//
+// The aggregate rate is the message count over a sliding one second window of
+// 10 ms buckets. Every symbol also gets a fixed 100 ms window, and its rate is
+// the last closed window scaled to messages per second. Both are evaluated as
+// event time leaves a bucket or window behind. Recording a message is one or
+// two compare-and-swaps with no lock; the lock is taken only to close a bucket
+// (once per 10 ms of event time) and when a symbol starts or stays in a burst.
+//
+// With several workers, messages arrive slightly out of event-time order. A
+// message whose bucket has already been evaluated still counts towards later
+// windows, and one whose symbol window has closed is not counted for the symbol.
 class MicroburstDetector {
 public:
-    MicroburstDetector(uint32_t threshold = 50000, uint32_t end_threshold = 30000, uint64_t min_duration = 100);
+    MicroburstDetector(uint32_t threshold = 50000, uint32_t end_threshold = 30000, uint64_t min_duration = 100,
+                       uint32_t symbol_threshold = 5000, uint32_t symbol_end_threshold = 3000);
     ~MicroburstDetector();
     
     void Initialize(SystemMetrics* metrics);
     void CheckMessage(const TickData& tick_data);
     
+    // Finished bursts, aggregate and per symbol, oldest first
     std::vector<MicroburstEvent> GetRecentEvents() const;
+    // Symbols in a burst now, highest rate first
+    std::vector<SymbolBurst> GetBurstingSymbols() const;
+    
     bool IsCurrentlyInMicroburst() const { return in_microburst_.load(); }
+    uint32_t GetCurrentRate() const { return current_rate_.load(); }
     
+    static constexpr uint64_t BUCKET_NS = 10000000;
+    static constexpr size_t NUM_BUCKETS = 100;             // One second window
+    static constexpr uint64_t SYMBOL_WINDOW_NS = 100000000;
+    static constexpr size_t MAX_BURSTING_SYMBOLS = 256;
+    static constexpr size_t MAX_EVENTS = 100;
+
 private:
-    void UpdateRateWindow();
-    void DetectMicroburst();
-    std::string CalculateSeverity(uint32_t rate);
+    // A burst in progress, aggregate or for one symbol; guarded by events_mutex_
+    struct BurstState {
+        bool active = false;
+        uint64_t start_time_ns = 0;
+        uint32_t rate = 0;
+        uint32_t peak_rate = 0;
+        uint32_t total_messages = 0;
+    };
     
-    SystemMetrics* metrics_;
+    // A symbol's open window, (window << 32) | count, and its burst
+    struct SymbolState {
+        std::atomic<uint64_t> window{0};
+        std::atomic<bool> bursting{false};
+        BurstState burst;
+    };
     
-    // Rate calculation window
-    static constexpr size_t WINDOW_SIZE_MS = 1000;
-    static constexpr size_t BUCKET_SIZE_MS = 10;
-    static constexpr size_t NUM_BUCKETS = WINDOW_SIZE_MS / BUCKET_SIZE_MS;
+    // Counts a message into a (tag << 32) | count slot, restarting it at one
+    // when it holds an older tag. Returns the slot's previous value; nothing is
+    // counted when the slot already holds a newer tag
+    static uint64_t Count(std::atomic<uint64_t>& slot, uint64_t tag);
     
-    struct RateBucket {
-        std::atomic<uint32_t> count{0};
-        std::atomic<uint64_t> timestamp{0};
-    };
+    void CloseBuckets(uint64_t open_bucket);
+    void CloseSymbolWindow(uint16_t stock_locate, uint64_t window, uint32_t count, uint64_t next_window);
+    void SweepSymbols(uint64_t time_ns);
     
-    std::array<RateBucket, NUM_BUCKETS> rate_buckets_;
-    std::atomic<size_t> current_bucket_{0};
-    std::atomic<uint32_t> current_rate_{0};
+    // Feeds the rate of one closed interval starting at start_ns into a burst
+    // and logs the burst if that ended it. Returns true when the burst started
+    bool Advance(BurstState& burst, uint16_t stock_locate, uint32_t rate, uint32_t messages,
+                 uint64_t start_ns, uint32_t threshold, uint32_t end_threshold);
+    
+    static std::string CalculateSeverity(uint32_t rate, uint32_t threshold);
+    
+    SystemMetrics* metrics_;
     
-    // Microburst detection
+    // Aggregate buckets, (bucket << 32) | count, indexed by bucket % NUM_BUCKETS
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_;
+    std::atomic<uint64_t> open_bucket_{0};
+    std::atomic<uint32_t> current_rate_{0};
     std::atomic<bool> in_microburst_{false};
-    std::atomic<uint64_t> microburst_start_time_{0};
-    std::atomic<uint32_t> microburst_peak_rate_{0};
-    std::atomic<uint32_t> microburst_message_count_{0};
+    
+    // Indexed by stock_locate; 0 is the aggregate and has no slot of its own
+    std::unique_ptr<SymbolState[]> symbols_;
     
     // Thresholds
     uint32_t microburst_threshold_;
     uint32_t microburst_end_threshold_;
-    uint64_t min_microburst_duration_ms_;
+    uint64_t min_microburst_duration_ns_;
+    uint32_t symbol_threshold_;
+    uint32_t symbol_end_threshold_;
     
-    // Event history
-    mutable std::mutex events_mutex_;
+    // Bucket closing, burst state and the event log
+    mutable InstrumentedMutex events_mutex_{"microburst_events"};
+    uint64_t next_close_bucket_;
+    BurstState aggregate_;
+    std::vector<uint16_t> bursting_;
     std::vector<MicroburstEvent> recent_events_;
-    static constexpr size_t MAX_EVENTS = 100;
-    
-    std::chrono::steady_clock::time_point last_update_;
 };
 
 } // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "WireFormat.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <endian.h>
+
+namespace tickshaper {
+namespace mold {
+
+// MoldUDP64 framing, big-endian as on the exchange feeds.
+//
+//   Packet         Session (10 ASCII) | Sequence u64 | Count u16, then Count x
+//                  (Length u16 | message bytes)
+//   Heartbeat      Count = 0, Sequence = next sequence to be sent
+//   End of session Count = 0xFFFF
+//   Request        Session | Sequence u64 | Count u16, sent to the
+//                  retransmission server; answered with a normal packet
+//
+// Sequence numbers start at 1 and count messages, not packets. Message bodies
+// are one record each, keyed by the same topic class as the ZMQ feed:
+//
+//   'T' | TickRecord (28)                      see WireFormat.h
+//   'S' | sample_time u64 | SnapshotRecord (32)
+
+constexpr size_t kSessionSize = 10;
+constexpr size_t kHeaderSize = 20;
+constexpr uint16_t kHeartbeatCount = 0;
+constexpr uint16_t kEndOfSessionCount = 0xFFFF;
+
+// Keeps a full packet inside a standard Ethernet MTU without fragmentation
+constexpr size_t kMaxPacketSize = 1400;
+constexpr size_t kTickMessageSize = 1 + sizeof(wire::TickRecord);
+constexpr size_t kSnapshotMessageSize = 1 + sizeof(uint64_t) + sizeof(wire::SnapshotRecord);
+constexpr size_t kMaxMessageSize = kSnapshotMessageSize;
+
+struct PacketHeader {
+    char session[kSessionSize];
+    uint64_t sequence;
+    uint16_t count;
+};
+
+inline void EncodeHeader(uint8_t* out, const char* session, uint64_t sequence, uint16_t count) {
+    memcpy(out, session, kSessionSize);
+    uint64_t sequence_be = htobe64(sequence);
+    uint16_t count_be = htobe16(count);
+    memcpy(out + kSessionSize, &sequence_be, sizeof(sequence_be));
+    memcpy(out + kSessionSize + 8, &count_be, sizeof(count_be));
+}
+
+inline bool DecodeHeader(const uint8_t* data, size_t size, PacketHeader& header) {
+    if (size < kHeaderSize) {
+        return false;
+    }
+    memcpy(header.session, data, kSessionSize);
+    memcpy(&header.sequence, data + kSessionSize, sizeof(header.sequence));
+    memcpy(&header.count, data + kSessionSize + 8, sizeof(header.count));
+    header.sequence = be64toh(header.sequence);
+    header.count = be16toh(header.count);
+    return true;
+}
+
+// Session names are space-padded to 10 characters
+inline void PadSession(const std::string& name, char* session) {
+    memset(session, ' ', kSessionSize);
+    memcpy(session, name.data(), std::min(name.size(), kSessionSize));
+}
+
+inline size_t EncodeTickMessage(uint8_t* out, const TickData& tick_data) {
+    out[0] = wire::kTopicTicks;
+    wire::EncodeTick(out + 1, tick_data);
+    return kTickMessageSize;
+}
+
+inline size_t EncodeSnapshotMessage(uint8_t* out, uint64_t sample_time, const L1Snapshot& snapshot) {
+    out[0] = wire::kTopicSnapshots;
+    uint64_t sample_time_le = htole64(sample_time);
+    memcpy(out + 1, &sample_time_le, sizeof(sample_time_le));
+    wire::EncodeSnapshot(out + 1 + sizeof(sample_time_le), snapshot);
+    return kSnapshotMessageSize;
+}
+
+} // namespace mold
+} // namespace tickshaper
\ No newline at end of file
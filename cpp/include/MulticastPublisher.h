@@ -0,0 +1,109 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "MoldUDP64.h"
+#include "MPSCRing.h"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <netinet/in.h>
+
+namespace tickshaper {
+
+struct MulticastOptions {
+    std::string group = "239.192.1.1";          // Multicast group, or a unicast address
+    uint16_t port = 31001;
+    std::string interface_address = "127.0.0.1"; // Outgoing interface; loopback for local testing
+    int ttl = 1;
+    std::string session = "TICKSHAPER";
+    uint16_t retransmit_port = 31002;           // 0 picks a free port
+    size_t retransmit_capacity = 262144;        // Recent messages kept for retransmission
+    size_t ring_capacity = 65536;               // Worker -> sender hand-off slots
+    uint32_t linger_us = 50;                    // Max time a partial packet waits for more messages
+    uint32_t heartbeat_ms = 1000;
+};
+
+// MoldUDP64 over UDP multicast. Every subscriber reads the same datagram, so
+// send cost does not grow with the number of consumers. Workers hand ticks off
+// through a lock-free ring; a single sender thread packs them into MTU-sized
+// packets and sends up to MAX_BATCH_PACKETS per sendmmsg call. Recent messages
+// are kept so a unicast UDP request server can answer gap fills.
+class MulticastPublisher {
+public:
+    MulticastPublisher();
+    ~MulticastPublisher();
+    
+    bool Initialize(const MulticastOptions& options);
+    void Publish(const TickData& tick_data);
+    void PublishSnapshots(uint64_t sample_time, const std::vector<L1Snapshot>& snapshots);
+    void Stop();
+    
+    uint16_t GetRetransmitPort() const { return retransmit_port_; }
+    uint64_t GetNextSequence() const { return next_sequence_.load(); }
+    uint64_t GetPacketsSent() const { return packets_sent_.load(); }
+    uint64_t GetSendCalls() const { return send_calls_.load(); }
+    uint64_t GetDroppedCount() const { return dropped_count_.load(); }
+    uint64_t GetRetransmitRequests() const { return retransmit_requests_.load(); }
+    uint64_t GetRetransmittedMessages() const { return retransmitted_messages_.load(); }
+
+private:
+    struct StoredMessage {
+        uint64_t sequence;
+        uint8_t length;
+        uint8_t data[mold::kMaxMessageSize];
+    };
+    
+    void SendLoop();
+    void RetransmitLoop();
+    bool DrainTicks();
+    void DrainSnapshots();
+    void AppendMessage(const uint8_t* message, size_t length);
+    void ClosePacket();
+    void FlushPackets();
+    void SendControlPacket(uint16_t count);
+    void StorePacket(const uint8_t* packet, size_t size, uint64_t first_sequence, uint16_t count);
+    size_t BuildRetransmitPacket(uint64_t first_sequence, uint16_t requested, uint8_t* packet);
+    
+    MulticastOptions options_;
+    char session_[mold::kSessionSize];
+    int send_socket_;
+    int retransmit_socket_;
+    uint16_t retransmit_port_;
+    
+    // Lock-free hand-off from workers; snapshots are rare and keep a mutex
+    std::unique_ptr<MPSCRing<TickData>> tick_ring_;
+    std::vector<std::pair<uint64_t, L1Snapshot>> snapshot_queue_;
+    std::mutex snapshot_mutex_;
+    std::atomic<bool> snapshots_pending_{false};
+    
+    // Sender thread only: packets are built in place and sent in one sendmmsg
+    static constexpr size_t MAX_BATCH_PACKETS = 32;
+    uint8_t packets_[MAX_BATCH_PACKETS][mold::kMaxPacketSize];
+    size_t packet_sizes_[MAX_BATCH_PACKETS];
+    size_t closed_packets_;
+    size_t open_size_;            // 0 when no packet is open
+    uint16_t open_count_;
+    uint64_t open_first_sequence_;
+    uint64_t open_since_ns_;
+    uint64_t last_send_ns_;
+    
+    // Recent messages by sequence; the request server reads under the mutex
+    std::vector<StoredMessage> store_;
+    size_t store_mask_;
+    std::mutex store_mutex_;
+    
+    std::thread send_thread_;
+    std::thread retransmit_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> next_sequence_{1};
+    std::atomic<uint64_t> packets_sent_{0};
+    std::atomic<uint64_t> send_calls_{0};
+    std::atomic<uint64_t> dropped_count_{0};
+    std::atomic<uint64_t> retransmit_requests_{0};
+    std::atomic<uint64_t> retransmitted_messages_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tickshaper {
+
+// Hardware and scheduler events counted per thread with perf_event_open
+enum PerfEvent : uint8_t {
+    kPerfCycles = 0,
+    kPerfInstructions = 1,
+    kPerfCacheMisses = 2,       // Last-level cache misses on most CPUs
+    kPerfBranchMisses = 3,
+    kPerfContextSwitches = 4,
+    kNumPerfEvents = 5
+};
+
+// Where the counts are charged. Decode and book run inside one
+// MessageProcessor call, so they share a stage here
+enum PerfStage : uint8_t {
+    kPerfFraming = 0,    // Reading a message off the feed
+    kPerfThrottle = 1,   // Rate limiter check
+    kPerfProcess = 2,    // Decode, order tracking and book
+    kPerfHandoff = 3,    // Queuing ticks for the publisher, multicast and sessions
+    kPerfSend = 4,       // Publisher thread: encoding a batch and queuing it on the sinks
+    kNumPerfStages = 5
+};
+
+struct PerfStageStats {
+    std::string stage;
+    uint64_t messages;                 // Sampled messages; ticks for the send stage
+    uint64_t counts[kNumPerfEvents];
+    
+    double PerMessage(PerfEvent event) const {
+        return messages > 0 ? static_cast<double>(counts[event]) / messages : 0.0;
+    }
+};
+
+// One thread's counter group and its per-stage totals. The group is read with
+// one read() of a few hundred nanoseconds to a few microseconds, so only one
+// pass through the stages in every sample interval is measured; the rest pay
+// one increment. Only the owning thread writes the totals.
+class alignas(64) ThreadPerf {
+public:
+    ThreadPerf(uint32_t sample_interval, bool open);
+    ~ThreadPerf();
+    
+    ThreadPerf(const ThreadPerf&) = delete;
+    ThreadPerf& operator=(const ThreadPerf&) = delete;
+    
+    // True once per sample interval while the group is open
+    bool Sample() {
+        if (leader_fd_ < 0 || ++calls_ < sample_interval_) {
+            return false;
+        }
+        calls_ = 0;
+        return true;
+    }
+    
+    // Starts a sampled pass; also drops whatever ran since the last End
+    void Begin() { Read(last_); }
+    
+    // Charges everything counted since Begin or the previous End to stage
+    void End(PerfStage stage, uint64_t messages = 1);
+    
+    bool IsOpen() const { return leader_fd_ >= 0; }
+    
+    // Bit per PerfEvent that this thread counts
+    uint32_t GetOpenEvents() const { return open_events_; }
+
+private:
+    friend class PerfCounters;
+    
+    bool Read(uint64_t* values);
+    
+    int leader_fd_;
+    int fds_[kNumPerfEvents];
+    int group_index_[kNumPerfEvents];  // Position in the group read, -1 if not open
+    size_t group_size_;
+    uint32_t open_events_;
+    uint32_t sample_interval_;
+    uint32_t calls_;
+    uint64_t last_[kNumPerfEvents];
+    
+    std::atomic<uint64_t> totals_[kNumPerfStages][kNumPerfEvents] = {};
+    std::atomic<uint64_t> messages_[kNumPerfStages] = {};
+};
+
+// Opens a counter group for every thread that registers and sums the
+// per-stage totals on read. Counters are off unless enabled; events the CPU,
+// hypervisor or perf_event_paranoid do not allow are left out, and with none
+// left a thread gets a closed ThreadPerf whose Sample() is always false.
+// Slots live as long as the registry, so a thread may keep its pointer.
+class PerfCounters {
+public:
+    static constexpr uint32_t DEFAULT_SAMPLE_INTERVAL = 1000;
+    
+    PerfCounters() : enabled_(false), sample_interval_(DEFAULT_SAMPLE_INTERVAL), warned_(false) {}
+    
+    // Apply to threads registered afterwards
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    void SetSampleInterval(uint32_t sample_interval) { sample_interval_ = sample_interval > 0 ? sample_interval : 1; }
+    bool IsEnabled() const { return enabled_; }
+    
+    // Call from the thread to be counted
+    ThreadPerf* RegisterThread();
+    
+    // One entry per PerfStage, summed over every thread
+    std::vector<PerfStageStats> Collect() const;
+    
+    // Bit per PerfEvent that at least one thread counts
+    uint32_t GetOpenEvents() const;
+    
+    static const char* StageName(PerfStage stage);
+    static const char* EventName(PerfEvent event);
+
+private:
+    bool enabled_;
+    uint32_t sample_interval_;
+    bool warned_;
+    
+    std::vector<std::unique_ptr<ThreadPerf>> threads_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "PublisherSink.h"
+#include "MPSCRing.h"
+#include <zmq.hpp>
+#include <string>
+#include <thread>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace tickshaper {
+
+class LoadShedder;
+class LastValueCache;
+class LatencyTracker;
+struct ThreadLatency;
+class TraceRecorder;
+class ThreadTrace;
+class PerfCounters;
+class ThreadPerf;
+
+struct PublisherOptions {
+    std::string endpoint = "tcp://*:5555";
+    bool enable_conflation = false;
+    WireFormat format = WireFormat::kBinary;
+    std::vector<SinkOptions> extra_sinks;  // Bound alongside endpoint, e.g. ipc:// or inproc://
+    size_t ring_capacity = 65536;   // Worker -> publisher hand-off slots
+    size_t batch_size = 64;         // Max ticks packed into one frame
+    uint32_t linger_us = 50;        // Max time a partial batch waits for more ticks
+    int send_hwm = 10000;
+    bool prune_unsubscribed = true; // Skip serializing symbols no subscriber wants
+    bool egress_stamp = false;      // Tick batches carry a wire::EgressStamp
+    size_t num_shards = 1;          // Symbols are split by stock_locate % num_shards
+    std::vector<int> shard_cores;   // Core per shard; empty or -1 leaves a shard unpinned
+};
+
+// One shard of the publisher: owns the symbols with stock_locate % num_shards
+// == index. Batches their ticks and fans them out to the shard's sinks. Each
+// distinct wire format is encoded once per batch; every sink of that format
+// gets a reference to the same frames and sends them from its own thread.
+// Shards share nothing, including the ZMQ context and its I/O thread.
+class PublisherShard {
+public:
+    PublisherShard();
+    ~PublisherShard();
+    
+    // options carries this shard's endpoints; cpu_core < 0 leaves it unpinned
+    bool Initialize(const PublisherOptions& options, size_t shard_index, int cpu_core);
+    void SetLoadShedder(LoadShedder* load_shedder) { load_shedder_ = load_shedder; }
+    void SetLastValueCache(LastValueCache* last_values) { last_values_ = last_values; }
+    void SetLatencyTracker(LatencyTracker* latency_tracker) { latency_tracker_ = latency_tracker; }
+    void SetTraceRecorder(TraceRecorder* trace_recorder) { trace_recorder_ = trace_recorder; }
+    void SetPerfCounters(PerfCounters* perf_counters) { perf_counters_ = perf_counters; }
+    void Publish(const TickData& tick_data);
+    void PublishSnapshots(uint64_t sample_time, std::vector<L1Snapshot>&& snapshots);
+    void Stop();
+    
+    // inproc:// sinks are only reachable through this context
+    zmq::context_t& GetContext() { return context_; }
+    
+    uint64_t GetPublishedCount() const { return published_count_.load(); }
+    uint64_t GetBatchCount() const { return batch_count_.load(); }
+    uint64_t GetDroppedCount() const { return dropped_count_.load(); }
+    uint64_t GetPrunedCount() const { return pruned_count_.load(); }
+    size_t GetQueueDepth() const { return tick_ring_ ? tick_ring_->SizeApprox() : 0; }
+    bool IsConflationEnabled() const;
+    std::vector<ConflationStats> GetConflationStats() const;
+    uint64_t GetConflatedIn() const;
+    uint64_t GetConflatedOut() const;
+    std::vector<PublisherSinkStats> GetSinkStats() const;
+    std::vector<EncoderStats> GetEncoderStats() const;
+    
+    // Lock-free; lets workers drop ticks for symbols no sink has a subscriber for
+    bool IsSubscribed(wire::TopicClass topic_class, uint16_t stock_locate) const;
+
+private:
+    // Sinks sharing one encoded stream; conflated sinks only take its snapshots
+    struct EncodedStream {
+        FrameEncoder* encoder;
+        std::vector<PublisherSink*> tick_sinks;
+        std::vector<PublisherSink*> snapshot_sinks;
+    };
+    
+    void PublishingLoop();
+    bool DrainTicks();
+    void DrainSnapshots();
+    void FlushBatch();
+    FrameEncoder* AddEncoder(WireFormat format);
+    
+    // Declared before the context so buffers still owned by ZMQ are returned
+    // before the encoders' pools are destroyed
+    std::vector<std::unique_ptr<FrameEncoder>> encoders_;
+    
+    zmq::context_t context_;
+    std::vector<std::unique_ptr<PublisherSink>> sinks_;
+    std::vector<EncodedStream> streams_;
+    std::vector<PublisherSink*> conflated_sinks_;
+    
+    // Lock-free hand-off from workers; snapshots are rare and keep a mutex
+    std::unique_ptr<MPSCRing<TickData>> tick_ring_;
+    std::queue<std::pair<uint64_t, std::vector<L1Snapshot>>> snapshot_queue_;
+    std::mutex snapshot_mutex_;
+    std::atomic<bool> snapshots_pending_{false};
+    
+    LoadShedder* load_shedder_;
+    LastValueCache* last_values_;  // Stamped with the primary stream's sequences
+    LatencyTracker* latency_tracker_;
+    TraceRecorder* trace_recorder_;
+    PerfCounters* perf_counters_;
+    bool prune_unsubscribed_;
+    bool egress_stamp_;
+    size_t shard_index_;
+    int cpu_core_;
+    
+    // Publishing thread only
+    size_t batch_size_;
+    uint64_t linger_ns_;
+    std::vector<TickData> pending_;
+    uint64_t pending_since_ns_;
+    std::vector<SinkFrame> frames_;
+    ThreadLatency* latency_;  // Registered by the publishing thread
+    ThreadTrace* trace_;      // Likewise
+    ThreadPerf* perf_;        // Likewise
+    
+    std::thread publishing_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> published_count_{0};
+    std::atomic<uint64_t> batch_count_{0};
+    std::atomic<uint64_t> dropped_count_{0};
+    std::atomic<uint64_t> pruned_count_{0};
+    
+    static constexpr size_t MAX_SNAPSHOT_BATCHES = 64;
+};
+
+} // namespace tickshaper
\ No newline at end of file
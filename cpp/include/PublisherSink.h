@@ -0,0 +1,169 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "Conflator.h"
+#include "MPSCRing.h"
+#include "BufferPool.h"
+#include "SubscriptionTracker.h"
+#include "LockProfiler.h"
+#include <zmq.hpp>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace tickshaper {
+
+class LoadShedder;
+
+// Pins the calling thread; a negative core is a no-op. Returns false on failure
+bool PinThreadToCore(int cpu_core);
+
+enum class WireFormat {
+    kBinary,   // Fixed-layout little-endian records, see WireFormat.h
+    kJson,     // Human-readable, for debugging
+    kCompact   // Delta/varint tick batches for WAN links, see CompactFormat.h
+};
+
+const char* WireFormatName(WireFormat format);
+bool ParseWireFormat(const std::string& name, WireFormat& format);
+
+// Adds stats into the entry for the same format, or appends it
+void MergeEncoderStats(std::vector<EncoderStats>& merged, const EncoderStats& stats);
+
+struct SinkOptions {
+    std::string endpoint;
+    WireFormat format = WireFormat::kBinary;
+    bool conflated = false;         // Latest value per symbol, drained at this sink's pace
+    int send_hwm = 10000;
+    size_t queue_capacity = 8192;   // Frames waiting for this sink's send thread
+};
+
+struct SinkFrame {
+    zmq::message_t message;
+    bool more = false;        // Further parts of the same multipart message follow
+    uint16_t tick_count = 0;  // Ticks carried by this frame
+};
+
+// Turns ticks and snapshots into a topic frame plus payload frame(s) in one
+// wire format. Sinks of the same format share the frames through
+// zmq::message_t::copy, which only adds a reference. Sequence numbers run per
+// message class and stock_locate within this stream. Single thread only.
+class FrameEncoder {
+public:
+    explicit FrameEncoder(WireFormat format);
+    
+    // ticks must all share one stock_locate
+    void EncodeTicks(const TickData* ticks, size_t count, std::vector<SinkFrame>& frames);
+    void EncodeSnapshot(uint64_t sample_time, const L1Snapshot& snapshot, std::vector<SinkFrame>& frames);
+    
+    WireFormat GetFormat() const { return format_; }
+    static size_t MaxTicksPerFrame();
+    
+    // Tick batches carry an EgressStamp (ingest_ns/egress_ns fields in JSON)
+    void SetEgressStamp(bool enabled) { egress_stamp_ = enabled; }
+    
+    // Summed over every tick batch this encoder produced
+    EncoderStats GetStats() const;
+    
+    // Sequence of the last message encoded for the symbol, 0 if none
+    uint64_t GetTickSequence(uint16_t stock_locate) const { return tick_sequence_[stock_locate]; }
+    uint64_t GetSnapshotSequence(uint16_t stock_locate) const { return snapshot_sequence_[stock_locate]; }
+    
+    // ZMQ keeps payloads of up to 33 bytes inside the message itself. Anything
+    // larger it would copy to the heap, so every binary batch, 44 bytes for a
+    // single tick, is sent from the pool
+    static constexpr size_t ZERO_COPY_MIN_BYTES = 34;
+
+private:
+    void AppendTopic(wire::TopicClass topic_class, uint16_t stock_locate, std::vector<SinkFrame>& frames);
+    void EncodeTickPayload(const TickData* ticks, size_t count, std::vector<SinkFrame>& frames);
+    void SerializeTickData(const TickData& tick_data, uint64_t sequence, uint64_t egress_ns, std::string& out);
+    
+    // Realtime stamps of the oldest pipeline entry among ticks and of now
+    static void StampEgress(const TickData* ticks, size_t count, uint64_t& ingest_ns, uint64_t& egress_ns);
+    
+    WireFormat format_;
+    bool egress_stamp_;
+    BufferPool buffer_pool_;
+    std::vector<uint64_t> tick_sequence_;      // Per stock_locate
+    std::vector<uint64_t> snapshot_sequence_;  // Per stock_locate
+    std::string scratch_;
+    
+    // Written by the encoding thread only
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<uint64_t> raw_bytes_{0};
+    std::atomic<uint64_t> encoded_bytes_{0};
+    std::atomic<uint64_t> encode_ns_{0};
+    std::atomic<uint64_t> pooled_frames_{0};
+    std::atomic<uint64_t> copied_frames_{0};
+};
+
+// One bound XPUB socket with its own send thread, queue, high water mark and
+// subscriptions. A conflated sink keeps a latest-value slot per symbol instead
+// and encodes at its own pace, so a slow consumer sees fewer, fresher ticks.
+class PublisherSink {
+public:
+    PublisherSink(zmq::context_t& context, const SinkOptions& options);
+    ~PublisherSink();
+    
+    // encoder is used by conflated sinks only, from the sink's own thread
+    bool Initialize(FrameEncoder* encoder, size_t batch_size, LoadShedder* load_shedder);
+    void Start(int cpu_core = -1);
+    void Stop();
+    
+    // Publisher thread only. Queues all frames of a message or none of them;
+    // the frames stay valid for the next sink
+    bool Enqueue(std::vector<SinkFrame>& frames);
+    void Conflate(const TickData* ticks, size_t count);
+    
+    bool IsSubscribed(wire::TopicClass topic_class, uint16_t stock_locate) const {
+        return subscriptions_.IsSubscribed(topic_class, stock_locate);
+    }
+    bool IsConflated() const { return options_.conflated; }
+    WireFormat GetFormat() const { return options_.format; }
+    
+    PublisherSinkStats GetStats() const;
+    std::vector<ConflationStats> GetConflationStats() const;
+    uint64_t GetConflatedIn() const;
+    uint64_t GetConflatedOut() const;
+
+private:
+    void SendLoop();
+    bool PollSubscriptions();
+    bool SendQueued();
+    bool SendConflated();
+    bool SendFrame(SinkFrame& frame);
+    
+    SinkOptions options_;
+    zmq::socket_t socket_;
+    SubscriptionTracker subscriptions_;
+    MPSCRing<SinkFrame> queue_;
+    
+    // Conflated sinks only
+    FrameEncoder* encoder_;
+    Conflator conflator_;
+    mutable InstrumentedMutex conflator_mutex_{"conflator"};
+    std::vector<TickData> batch_;
+    std::vector<SinkFrame> frames_;
+    size_t batch_size_;
+    LoadShedder* load_shedder_;
+    
+    // Send thread only: set after a refused first part until the message ends
+    bool discarding_;
+    bool in_message_;
+    
+    std::thread send_thread_;
+    int cpu_core_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> messages_sent_{0};
+    std::atomic<uint64_t> ticks_sent_{0};
+    std::atomic<uint64_t> queue_drops_{0};
+    std::atomic<uint64_t> hwm_drops_{0};
+    std::atomic<uint64_t> pruned_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
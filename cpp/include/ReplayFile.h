@@ -0,0 +1,77 @@
+#pragma once
+
+#include "MessageProcessor.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace tickshaper {
+
+// One ITCH message inside the mapping; body excludes the length and type bytes
+struct MappedMessage {
+    uint8_t message_type;
+    const uint8_t* body;
+    uint16_t body_size;
+    uint64_t timestamp;
+    uint64_t next_offset;
+};
+
+// A read-only mapping of an ITCH file, indexed once and shared by every replay
+// cursor. The index keeps one checkpoint every INDEX_STRIDE messages, so it
+// stays a few MB for a full day; cursors step between checkpoints by the
+// length framing. The symbol table is filled from the stock directory in file
+// order, so symbol ids are the same for every replay. Immutable after Open(),
+// so cursors read it without locks.
+class ReplayFile {
+public:
+    ReplayFile();
+    ~ReplayFile();
+    
+    bool Open(const std::string& filename);
+    
+    // False at the end of the file or on a truncated message
+    bool ReadAt(uint64_t offset, MappedMessage& message) const;
+    
+    // Offset of the first message at or after itch_time, and its index
+    uint64_t Seek(uint64_t itch_time, uint64_t& message_index) const;
+    
+    const std::string& GetFilename() const { return filename_; }
+    size_t GetSize() const { return size_; }
+    uint64_t GetMessageCount() const { return message_count_; }
+    uint64_t GetFirstTime() const { return first_time_; }
+    uint64_t GetLastTime() const { return last_time_; }
+    SymbolManager* GetSymbolTable() { return &symbols_; }
+    
+    static constexpr uint64_t INDEX_STRIDE = 1024;
+
+private:
+    struct Checkpoint {
+        uint64_t offset;
+        uint64_t timestamp;
+    };
+    
+    void BuildIndex();
+    static uint64_t ReadTimestamp(const uint8_t* body);
+    static std::string ReadStock(const uint8_t* data);
+    
+    // ITCH 5.0: every body starts with stock locate, tracking number and a
+    // 6-byte big-endian timestamp in nanoseconds since midnight
+    static constexpr size_t TIMESTAMP_OFFSET = 4;
+    static constexpr size_t COMMON_HEADER_SIZE = 10;
+    static constexpr size_t DIRECTORY_STOCK_OFFSET = 10;  // Stock Directory 'R'
+    static constexpr size_t ADD_ORDER_STOCK_OFFSET = 23;  // Add Order 'A' / 'F'
+    
+    std::string filename_;
+    int fd_;
+    const uint8_t* data_;
+    size_t size_;
+    
+    std::vector<Checkpoint> checkpoints_;
+    SymbolManager symbols_;
+    uint64_t message_count_;
+    uint64_t first_time_;
+    uint64_t last_time_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "ReplayFile.h"
+#include "SessionManager.h"
+#include "MessageProcessor.h"
+#include <zmq.hpp>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace tickshaper {
+
+class SharedMemoryManager;
+
+struct ReplayOptions {
+    std::string name;
+    std::string endpoint;
+    WireFormat format = WireFormat::kBinary;
+    double speed = 1.0;        // Multiple of ITCH time; 0 = as fast as possible
+    uint64_t start_time = 0;   // ITCH ns since midnight; output starts here
+    uint32_t rate = 0;         // Ticks per second; 0 = unlimited
+    bool top_of_book = false;  // bbo output instead of every tick
+    bool warmup = true;        // Build book state from the open; off seeks straight to start_time
+};
+
+// "<name> <endpoint> [binary|json|compact] [speed=X|speed=max] [start=HH:MM:SS[.fraction]]
+//  [rate=N] [bbo] [cold]"
+bool ParseReplaySpec(const std::string& spec, ReplayOptions& options, std::string& error);
+
+// One replay of the shared file: its own position, order book, pacer and
+// output session. Reads the mapping directly, so a cursor costs its book and
+// its buffers, not another copy of the file.
+class ReplayCursor {
+public:
+    ReplayCursor(const ReplayOptions& options, ReplayFile* file, SharedMemoryManager* shm_manager);
+    ~ReplayCursor();
+    
+    bool Start(zmq::context_t& context);
+    void Stop();
+    
+    const ReplayOptions& GetOptions() const { return options_; }
+    ReplayStats GetStats() const;
+
+private:
+    void ReplayLoop();
+    void Pace(uint64_t itch_time);
+    void Publish(ProcessorOutput& output);
+    
+    ReplayOptions options_;
+    ReplayFile* file_;
+    SystemMetrics metrics_;
+    MessageProcessor processor_;
+    std::unique_ptr<ShapingSession> output_;
+    
+    // Replay thread only
+    RawMessage raw_;
+    uint64_t anchor_wall_ns_;
+    uint64_t anchor_itch_ns_;
+    bool anchored_;
+    
+    std::thread replay_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> finished_{false};
+    std::atomic<uint64_t> position_{0};
+    std::atomic<uint64_t> itch_time_{0};
+    std::atomic<uint64_t> ticks_out_{0};
+    
+    static constexpr uint64_t MAX_SLEEP_NS = 10000000;  // Stop() latency bound
+    static constexpr uint64_t SPIN_NS = 100000;         // Last stretch yields instead of sleeping
+};
+
+// Hosts any number of concurrent replays of one ITCH file. The file is mapped
+// and indexed on the first replay; later ones share the mapping, index and
+// symbol table and start without reading the file again.
+class ReplayManager {
+public:
+    ReplayManager();
+    ~ReplayManager();
+    
+    void Initialize(const std::string& filename, SharedMemoryManager* shm_manager);
+    
+    // Control path; false with a reason in error
+    bool CreateReplay(const ReplayOptions& options, std::string& error);
+    bool RemoveReplay(const std::string& name);
+    void StopAll();
+    
+    std::vector<ReplayStats> GetReplayStats() const;
+    
+    static constexpr size_t MAX_REPLAYS = 64;
+
+private:
+    zmq::context_t context_;
+    std::string filename_;
+    SharedMemoryManager* shm_manager_;
+    std::unique_ptr<ReplayFile> file_;  // Outlives the cursors reading it
+    std::vector<std::unique_ptr<ReplayCursor>> cursors_;
+    mutable std::mutex mutex_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
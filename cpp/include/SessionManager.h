@@ -0,0 +1,152 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "PublisherSink.h"
+#include "ThrottleController.h"
+#include "Conflator.h"
+#include "MPSCRing.h"
+#include <zmq.hpp>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace tickshaper {
+
+struct SessionOptions {
+    std::string name;
+    std::string endpoint;
+    WireFormat format = WireFormat::kBinary;
+    std::vector<uint16_t> stock_locates;  // Symbol universe; empty means every symbol
+    uint32_t rate = 0;                    // Ticks per second; 0 = unlimited
+    bool conflate = false;                // Over the rate, keep the latest per symbol instead of dropping
+    size_t ring_capacity = 16384;
+    size_t batch_size = 64;
+    int send_hwm = 10000;
+};
+
+// "<name> <endpoint> [binary|json|compact] [rate=N] [symbols=L1,L2,...] [conflate]",
+// symbols given as stock_locates
+bool ParseSessionSpec(const std::string& spec, SessionOptions& options, std::string& error);
+
+// One desk's view of the shared feed: its own symbol filter, token bucket,
+// optional conflation, encoder and XPUB sink. Workers offer ticks through a
+// lock-free ring; the session's thread shapes, encodes and queues them for
+// the sink's send thread.
+class ShapingSession {
+public:
+    explicit ShapingSession(const SessionOptions& options);
+    ~ShapingSession();
+    
+    bool Start(zmq::context_t& context);
+    void Stop();
+    
+    // Worker threads; never blocks
+    void Offer(const TickData& tick_data);
+    
+    // For producers that would rather wait than drop; false when the ring is full
+    bool TryOffer(const TickData& tick_data) { return ring_->TryPush(tick_data); }
+    bool Wants(uint16_t stock_locate) const {
+        return all_symbols_ || (filter_[stock_locate >> 6] >> (stock_locate & 63)) & 1;
+    }
+    
+    const SessionOptions& GetOptions() const { return options_; }
+    SessionStats GetStats() const;
+
+private:
+    void ShapeLoop();
+    bool Shape();
+    void SendRuns();
+    bool Admit();
+    
+    SessionOptions options_;
+    bool all_symbols_;
+    std::vector<uint64_t> filter_;  // One bit per stock_locate, fixed at creation
+    
+    std::unique_ptr<MPSCRing<TickData>> ring_;
+    std::unique_ptr<FrameEncoder> encoder_;
+    std::unique_ptr<PublisherSink> sink_;
+    
+    // Session thread only
+    ThrottleController throttle_;
+    Conflator conflator_;
+    std::vector<TickData> pending_;
+    std::vector<SinkFrame> frames_;
+    
+    std::thread shape_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> ticks_in_{0};
+    std::atomic<uint64_t> ring_drops_{0};
+    std::atomic<uint64_t> pruned_{0};
+    std::atomic<uint64_t> throttled_{0};
+    std::atomic<uint64_t> conflated_in_{0};
+    std::atomic<uint64_t> conflated_out_{0};
+};
+
+// Fans the processed feed out to any number of shaping sessions, created and
+// removed at runtime. Each stock_locate keeps a bit mask of the session slots
+// that want it, so a worker only touches the sessions that take a tick and the
+// cost grows with sessions times their filtered volume, not with the feed.
+//
+// Workers count themselves in on a slot while they use its session. Removing a
+// session clears its slot, then waits for that count to drain before freeing
+// it, because a worker may still be offering it a tick it looked up just before.
+class SessionManager {
+public:
+    SessionManager();
+    ~SessionManager();
+    
+    // Control path; false with a reason in error
+    bool CreateSession(const SessionOptions& options, std::string& error);
+    bool RemoveSession(const std::string& name);
+    void StopAll();
+    
+    // Worker threads; lock-free
+    void Publish(const TickData& tick_data) {
+        uint64_t mask = symbol_masks_[tick_data.stock_locate].load(std::memory_order_relaxed) |
+                        all_symbols_mask_.load(std::memory_order_relaxed);
+        while (mask) {
+            // Counted in before the slot is read: RemoveSession either sees the
+            // count or this worker sees the cleared slot
+            size_t slot = __builtin_ctzll(mask);
+            users_[slot].count.fetch_add(1);
+            ShapingSession* session = slots_[slot].load();
+            if (session && session->Wants(tick_data.stock_locate)) {
+                session->Offer(tick_data);
+            }
+            users_[slot].count.fetch_sub(1, std::memory_order_release);
+            mask &= mask - 1;
+        }
+    }
+    bool IsWanted(uint16_t stock_locate) const {
+        return (symbol_masks_[stock_locate].load(std::memory_order_relaxed) |
+                all_symbols_mask_.load(std::memory_order_relaxed)) != 0;
+    }
+    bool HasSessions() const { return active_mask_.load(std::memory_order_relaxed) != 0; }
+    
+    std::vector<SessionStats> GetSessionStats() const;
+    
+    static constexpr size_t MAX_SESSIONS = 64;
+
+private:
+    // Workers inside a slot's session; one cache line per slot
+    struct alignas(64) SlotUsers {
+        std::atomic<uint32_t> count{0};
+    };
+    
+    static constexpr size_t NUM_LOCATES = 65536;
+    
+    zmq::context_t context_;
+    std::unique_ptr<std::atomic<uint64_t>[]> symbol_masks_;
+    std::atomic<uint64_t> all_symbols_mask_{0};
+    std::atomic<uint64_t> active_mask_{0};
+    std::atomic<ShapingSession*> slots_[MAX_SESSIONS];
+    SlotUsers users_[MAX_SESSIONS];
+    
+    std::unique_ptr<ShapingSession> owned_[MAX_SESSIONS];
+    mutable std::mutex control_mutex_;
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "TickShaper.h"
+#include "LockProfiler.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tickshaper {
+
+class MessageProcessor;
+class ZMQPublisher;
+class MulticastPublisher;
+
+enum class SampleClock {
+    kEventTime,  // Grid follows ITCH timestamps, identical at any replay speed
+    kWallTime    // Grid follows the local steady clock
+};
+
+// Time-grid L1 sampling. Symbols touched since the last grid point are marked
+// dirty; at every grid point one consistent cut of their top of book is taken
+// and published as a single batch. A single grid clock drives all symbols, so
+// output cost depends on symbol count and sample rate, not on market activity.
+class SnapshotSampler {
+public:
+    SnapshotSampler();
+    ~SnapshotSampler();
+    
+    void Initialize(MessageProcessor* processor, ZMQPublisher* publisher,
+                    uint64_t interval_ms, SampleClock clock);
+    void SetMulticastPublisher(MulticastPublisher* multicast_publisher) { multicast_publisher_ = multicast_publisher; }
+    void Start();
+    void Stop();
+    
+    // Event-time grid: called with each message's ITCH timestamp before it is
+    // applied to the book, so the cut reflects state strictly before the boundary
+    void AdvanceTo(uint64_t event_time_ns);
+    void MarkDirty(uint16_t stock_locate, uint32_t symbol_id);
+    
+    uint64_t GetSampleCount() const { return sample_count_.load(); }
+    uint64_t GetSnapshotCount() const { return snapshot_count_.load(); }
+    SampleClock GetClock() const { return clock_; }
+
+private:
+    void TakeSample(uint64_t sample_time);
+    void WallClockLoop();
+    
+    MessageProcessor* processor_;
+    ZMQPublisher* publisher_;
+    MulticastPublisher* multicast_publisher_;
+    uint64_t interval_ns_;
+    SampleClock clock_;
+    
+    // One flag per stock_locate; a symbol joins the dirty list once per interval
+    std::unique_ptr<std::atomic<uint8_t>[]> dirty_flags_;
+    std::unique_ptr<std::atomic<uint32_t>[]> symbol_ids_;
+    std::vector<uint16_t> dirty_list_;
+    InstrumentedMutex dirty_mutex_{"sampler_dirty"};
+    
+    std::atomic<uint64_t> next_boundary_ns_{0};
+    std::mutex sample_mutex_;
+    
+    std::thread sampling_thread_;
+    std::atomic<bool> running_{false};
+    
+    std::atomic<uint64_t> sample_count_{0};
+    std::atomic<uint64_t> snapshot_count_{0};
+    
+    static constexpr size_t MAX_STOCK_LOCATE = 65536;
+};
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "LastValueCache.h"
+#include <zmq.hpp>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+namespace tickshaper {
+
+// Late-joiner snapshots from the last-value cache, served on a ROUTER socket
+// so REQ and DEALER clients both work. A request body is a list of big-endian
+// u16 stock_locates; an empty body asks for every symbol with a value. The
+// reply is one or more LastValueBatch messages (see WireFormat.h), the last
+// part without ZMQ_SNDMORE. A client subscribes first, then requests, and
+// applies only feed messages with a higher sequence than each record's.
+class SnapshotService {
+public:
+    SnapshotService();
+    ~SnapshotService();
+    
+    bool Initialize(const std::string& endpoint, const LastValueCache* cache);
+    void Stop();
+    
+    // Reply payloads for one request body; false if the body is malformed
+    bool BuildReply(const uint8_t* request, size_t size, std::vector<zmq::message_t>& parts);
+    
+    uint64_t GetRequestCount() const { return request_count_.load(); }
+    uint64_t GetRecordsServed() const { return records_served_.load(); }
+    
+    // Keeps each reply part well under a megabyte
+    static constexpr size_t MAX_RECORDS_PER_PART = 8192;
+
+private:
+    void ServeLoop();
+    
+    const LastValueCache* cache_;
+    std::string endpoint_;
+    zmq::context_t context_;
+    zmq::socket_t socket_;
+    std::vector<LastValue> values_;
+    
+    std::thread serve_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> request_count_{0};
+    std::atomic<uint64_t> records_served_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
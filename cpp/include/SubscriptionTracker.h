@@ -0,0 +1,53 @@
+#pragma once
+
+#include "WireFormat.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tickshaper {
+
+// Mirrors the prefix subscriptions an XPUB socket reports. Apply() is called
+// only by the thread that owns the socket; IsSubscribed() is lock-free and may
+// be called from any worker to skip symbols nobody wants.
+//
+// A prefix selects everything (""), one topic class ("T"), a block of 256
+// locates (class + high byte) or a single symbol (class + locate). XPUB passes
+// on the first subscribe and the last unsubscribe of each distinct prefix, so
+// every prefix is reference counted once.
+class SubscriptionTracker {
+public:
+    SubscriptionTracker();
+    ~SubscriptionTracker();
+    
+    // data/size is a raw XPUB subscription message; returns false if malformed
+    bool Apply(const uint8_t* data, size_t size);
+    
+    bool IsSubscribed(wire::TopicClass topic_class, uint16_t stock_locate) const {
+        const ClassState& state = classes_[ClassIndex(topic_class)];
+        return state.wildcard.load(std::memory_order_relaxed) > 0 ||
+               (state.bits[stock_locate >> 6].load(std::memory_order_relaxed) >> (stock_locate & 63)) & 1;
+    }
+    
+    size_t GetSubscribedSymbolCount(wire::TopicClass topic_class) const;
+    uint64_t GetSubscriptionEvents() const { return events_.load(); }
+
+private:
+    struct ClassState {
+        std::atomic<uint32_t> wildcard{0};
+        std::unique_ptr<std::atomic<uint64_t>[]> bits;  // One bit per stock_locate
+        std::vector<uint32_t> refcounts;                // Owner thread only
+    };
+    
+    static size_t ClassIndex(uint8_t topic_class) { return topic_class == wire::kTopicSnapshots ? 1 : 0; }
+    void AdjustRange(ClassState& state, uint32_t first, uint32_t last, bool subscribe);
+    
+    static constexpr size_t NUM_LOCATES = 65536;
+    static constexpr size_t NUM_CLASSES = 2;
+    
+    ClassState classes_[NUM_CLASSES];
+    std::atomic<uint64_t> events_{0};
+};
+
+} // namespace tickshaper
\ No newline at end of file
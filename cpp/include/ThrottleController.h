@@ -1,8 +1,9 @@
 #pragma once
 
 #include <atomic>
-#include <chrono>
-#include <thread>
+#include <cstdint>
+#include <mutex>
+#include "LockProfiler.h"
 
 namespace tickshaper {
 
@@ -20,15 +21,16 @@ public:
     uint64_t GetThrottledCount() const { return throttled_count_.load(); }
     
 private:
-    void ResetCounters();
+    void ResetCounters(uint64_t now_ns);
     
     std::atomic<uint32_t> target_rate_{100000};
     std::atomic<uint32_t> current_count_{0};
     std::atomic<uint64_t> processed_count_{0};
     std::atomic<uint64_t> throttled_count_{0};
     
-    std::chrono::steady_clock::time_point last_reset_;
-    std::chrono::steady_clock::time_point last_process_time_;
+    // FastClock nanoseconds
+    uint64_t last_reset_ns_;
+    uint64_t last_process_time_ns_;
     
     // Token bucket algorithm parameters
     std::atomic<double> tokens_{0.0};
@@ -36,7 +38,7 @@ private:
     static constexpr double MAX_TOKENS = 200000.0;
     static constexpr double TOKENS_PER_MESSAGE = 1.0;
     
-    mutable std::mutex mutex_;
+    mutable InstrumentedMutex mutex_{"throttle"};
 };
 
 } // namespace tickshaper
\ No newline at end of file
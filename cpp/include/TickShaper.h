@@ -7,15 +7,34 @@
 #include <chrono>
 #include <functional>
 #include <string>
+#include <mutex>
+#include <utility>
 
 namespace tickshaper {
 
 class MessageProcessor;
 class ITCHParser;
 class ZMQPublisher;
+class MulticastPublisher;
 class SharedMemoryManager;
 class MicroburstDetector;
 class ThrottleController;
+class LoadShedder;
+class SnapshotSampler;
+class LastValueCache;
+class SnapshotService;
+class SessionManager;
+class ReplayManager;
+class LatencyTracker;
+class CounterRegistry;
+class TraceRecorder;
+class PerfCounters;
+class MetricsSegment;
+class MetricsExporter;
+class DashboardStream;
+class SymbolCounterRegistry;
+class HistogramSnapshot;
+struct PerfStageStats;
 
 struct TickData {
     uint64_t timestamp;
@@ -24,16 +43,62 @@ struct TickData {
     uint32_t size;
     char side;
     uint8_t message_type;
+    uint16_t stock_locate;
+    uint64_t ingest_time_ns;  // Pipeline entry stamp used for deadline checks
     
     TickData() = default;
-    TickData(uint64_t ts, uint32_t sym, uint64_t p, uint32_t sz, char s, uint8_t mt)
-        : timestamp(ts), symbol_id(sym), price(p), size(sz), side(s), message_type(mt) {}
+    TickData(uint64_t ts, uint32_t sym, uint64_t p, uint32_t sz, char s, uint8_t mt, uint16_t locate = 0)
+        : timestamp(ts), symbol_id(sym), price(p), size(sz), side(s), message_type(mt), stock_locate(locate),
+          ingest_time_ns(0) {}
 };
 
+// Synthetic message type for top-of-book output: side tells which side of the
+// inside quote changed, price/size carry the new best level (0 when empty)
+constexpr uint8_t kMsgTypeQuoteUpdate = 'q';
+
+struct TopOfBook {
+    uint64_t bid_price;
+    uint32_t bid_size;
+    uint64_t ask_price;
+    uint32_t ask_size;
+    
+    bool BidEquals(const TopOfBook& other) const {
+        return bid_price == other.bid_price && bid_size == other.bid_size;
+    }
+    bool AskEquals(const TopOfBook& other) const {
+        return ask_price == other.ask_price && ask_size == other.ask_size;
+    }
+};
+
+struct L1Snapshot {
+    uint16_t stock_locate;
+    uint32_t symbol_id;
+    TopOfBook quote;
+};
+
+// Latest state of one symbol, consistent with the publish sequences it carries
+struct LastValue {
+    static constexpr uint8_t kHasTick = 1;
+    static constexpr uint8_t kHasQuote = 2;
+    
+    uint64_t tick_sequence;      // Last tick message sent on the symbol's topic
+    uint64_t snapshot_sequence;  // Last snapshot message sent on the symbol's topic
+    TickData last_tick;          // Latest tick other than a quote update
+    TopOfBook quote;
+    uint64_t quote_time;         // ITCH time of the quote, or its sample time
+    uint32_t symbol_id;
+    uint16_t stock_locate;
+    uint8_t flags;
+};
+
+// Counters are folded in from per-thread slots by the metrics thread, so they
+// trail the workers by up to a metrics interval
 struct SystemMetrics {
     std::atomic<uint64_t> messages_processed{0};
     std::atomic<uint64_t> messages_throttled{0};
-    std::atomic<uint64_t> total_latency_ns{0};
+    std::atomic<uint64_t> messages_shed{0};
+    std::atomic<uint64_t> messages_suppressed{0};
+    std::atomic<uint64_t> messages_pruned{0};
     std::atomic<uint32_t> current_throughput{0};
     std::atomic<uint32_t> queue_depth{0};
     std::atomic<bool> microburst_detected{false};
@@ -42,6 +107,175 @@ struct SystemMetrics {
     std::atomic<uint64_t> uptime_seconds{0};
 };
 
+struct ConflationStats {
+    uint16_t stock_locate;
+    uint64_t updates_in;
+    uint64_t updates_out;
+    
+    double GetRatio() const {
+        return updates_out > 0 ? static_cast<double>(updates_in) / updates_out : 0.0;
+    }
+};
+
+struct SuppressionStats {
+    uint16_t stock_locate;
+    uint64_t events_in;
+    uint64_t updates_out;
+    
+    double GetSuppressedFraction() const {
+        return events_in > 0 ? 1.0 - static_cast<double>(updates_out) / events_in : 0.0;
+    }
+};
+
+struct PublisherSinkStats {
+    std::string endpoint;
+    std::string format;
+    uint64_t messages_sent;   // Complete multipart messages
+    uint64_t ticks_sent;
+    uint64_t queue_drops;     // Sink's send queue was full
+    uint64_t hwm_drops;       // Socket was at its send high water mark
+    uint64_t pruned;          // Ticks no subscriber of this sink wanted
+    size_t queue_depth;
+};
+
+// Tick batches of one wire format, summed over every encoder of that format
+struct EncoderStats {
+    std::string format;
+    uint64_t batches;
+    uint64_t ticks;
+    uint64_t raw_bytes;      // Same ticks in the fixed binary layout
+    uint64_t encoded_bytes;
+    uint64_t encode_ns;
+    uint64_t pooled_frames;  // Payloads handed to ZMQ zero-copy from the buffer pool
+    uint64_t copied_frames;  // Payloads ZMQ copied
+    
+    double GetCompressionRatio() const {
+        return encoded_bytes > 0 ? static_cast<double>(raw_bytes) / encoded_bytes : 0.0;
+    }
+    double GetNanosPerBatch() const {
+        return batches > 0 ? static_cast<double>(encode_ns) / batches : 0.0;
+    }
+};
+
+struct SessionStats {
+    std::string name;
+    std::string endpoint;
+    std::string format;
+    size_t symbol_count;      // 0 = every symbol
+    uint32_t rate;            // Ticks per second, 0 = unlimited
+    bool conflated;
+    uint64_t ticks_in;        // Passed the session's symbol filter
+    uint64_t ring_drops;      // Session fell behind the workers
+    uint64_t pruned;          // No subscriber on the session's endpoint
+    uint64_t throttled;       // Over the rate and dropped
+    uint64_t conflated_away;  // Over the rate and overwritten by a newer update
+    uint64_t ticks_sent;
+    uint64_t queue_drops;
+    uint64_t hwm_drops;
+};
+
+struct ReplayStats {
+    std::string name;
+    std::string endpoint;
+    double speed;             // Multiple of ITCH time, 0 = as fast as possible
+    uint64_t start_time;      // ITCH ns since midnight
+    uint64_t position;        // Messages into the file, including any warm-up or seek
+    uint64_t total_messages;
+    uint64_t itch_time;       // Time of the last message replayed
+    uint64_t ticks_out;
+    uint64_t ticks_sent;
+    uint64_t throttled;
+    bool finished;
+};
+
+// Queue hand-offs at which message deadlines are checked
+enum HandoffStage : uint8_t {
+    kHandoffProcessing = 0,
+    kHandoffConflation = 1,
+    kHandoffPublish = 2,
+    kNumHandoffStages = 3
+};
+
+// Pipeline stages timed by the latency histograms, see LatencyHistogram.h
+enum LatencyStage : uint8_t {
+    kStageFraming = 0,    // Reading the next message off the feed
+    kStageThrottle = 1,   // Rate limiter check
+    kStageDecode = 2,     // Parsing and order tracking
+    kStageBook = 3,       // Price-level book and inside-quote check (bbo mode)
+    kStageQueueWait = 4,  // Worker hand-off until the publisher batches the tick
+    kStageSend = 5,       // Encoding a batch and queuing it on the sinks
+    kStageTotal = 6,      // Pipeline entry until queued on the sinks
+    kNumLatencyStages = 7
+};
+
+struct LatencyPercentiles {
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t p9999;
+    uint64_t max;
+    double mean;
+};
+
+// All values in nanoseconds
+struct LatencySummary {
+    std::string stage;
+    LatencyPercentiles interval;    // Last metrics interval
+    LatencyPercentiles cumulative;  // Since start or the last reset
+};
+
+// Per processed message (per tick for serialize_send), from sampled passes
+// through the stage; -1 where the event could not be counted
+struct PerfSummary {
+    std::string stage;
+    uint64_t samples;
+    double cycles;
+    double instructions_per_cycle;
+    double cache_misses;
+    double branch_misses;
+    double context_switches;
+};
+
+// "cycles=... IPC=... cache_misses=... branch_misses=... context_switches=...", n/a where not counted
+std::string FormatPerfSummary(const PerfSummary& summary);
+
+// All instances of one named lock since start or the last reset, in
+// nanoseconds; see LockProfiler.h
+struct LockReport {
+    std::string name;
+    size_t instances;         // Live ones
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t total_wait_ns;
+    LatencyPercentiles wait;  // Contended acquisitions only
+    LatencyPercentiles hold;
+};
+
+// One finished microburst, aggregate (stock_locate 0) or for one symbol.
+// Times are ITCH event time, nanoseconds since midnight; see MicroburstDetector.h
+struct MicroburstEvent {
+    uint16_t stock_locate;
+    uint64_t start_time_ns;
+    uint64_t end_time_ns;
+    uint32_t peak_rate;
+    uint32_t total_messages;
+    std::string severity;
+};
+
+// A symbol whose burst is still in progress
+struct SymbolBurst {
+    uint16_t stock_locate;
+    uint64_t start_time_ns;
+    uint32_t rate;       // Last closed window, msg/s
+    uint32_t peak_rate;
+};
+
+struct LoadSheddingStats {
+    uint64_t checked[kNumHandoffStages];
+    uint64_t shed[kNumHandoffStages];
+};
+
 class TickShaper {
 public:
     TickShaper();
@@ -53,26 +287,116 @@ public:
     
     void SetReplaySpeed(double speed);
     void SetThrottleRate(uint32_t messages_per_second);
+    void SetMaxMessageAge(uint64_t max_age_us);
     void ResetCounters();
     
     const SystemMetrics& GetMetrics() const { return metrics_; }
-    bool IsRunning() const { return running_.load(); }
+    std::vector<ConflationStats> GetConflationStats() const;
+    LoadSheddingStats GetLoadSheddingStats() const;
+    std::vector<SuppressionStats> GetSuppressionStats() const;
+    std::vector<PublisherSinkStats> GetSinkStats() const;
+    std::vector<EncoderStats> GetEncoderStats() const;
     
+    // Per-subscriber shaping sessions, see SessionManager.h
+    bool AddSession(const std::string& spec);
+    bool RemoveSession(const std::string& name);
+    std::vector<SessionStats> GetSessionStats() const;
+    
+    // Independent replays of input_file_ sharing one mapping, see ReplayManager.h
+    bool AddReplay(const std::string& spec);
+    bool RemoveReplay(const std::string& name);
+    std::vector<ReplayStats> GetReplayStats() const;
+    
+    // Per-stage latency percentiles, refreshed by the metrics thread every second
+    std::vector<LatencySummary> GetLatencyReport() const;
+    
+    // Event tracing, see TraceRecorder.h
+    void SetTracing(bool enabled);
+    bool DumpTrace(const std::string& path) const;
+    
+    // Hardware counters per stage since start or the last reset, see
+    // PerfCounters.h. Empty unless perf_counters=true
+    std::vector<PerfSummary> GetPerfReport() const;
+    
+    // Lock contention, see LockProfiler.h. Most total wait first
+    void SetLockProfiling(bool enabled);
+    std::vector<LockReport> GetLockReport() const;
+    
+    // Finished bursts, oldest first, and the symbols bursting now, busiest first
+    std::vector<MicroburstEvent> GetRecentBursts() const;
+    std::vector<SymbolBurst> GetBurstingSymbols() const;
+    
+    bool IsRunning() const { return running_.load(); }
+
 private:
     void ProcessingLoop();
     void MetricsUpdateLoop();
     bool LoadConfiguration(const std::string& config_file);
     void UpdateSystemMetrics();
+    void UpdateLatencyReport();
+    void FoldCounters();
+    void PublishMetricsSegment();
+    void PublishPrometheus(uint64_t elapsed_seconds);
+    std::string RenderDashboard();
+    
+    // (messages, stock_locate) of the top symbols by messages since previous, busiest first
+    static std::vector<std::pair<uint64_t, uint16_t>> BusiestSymbols(const std::vector<uint64_t>& current,
+                                                                     const std::vector<uint64_t>& previous, 
+                                                                     size_t top);
     void SetupCPUAffinity(int thread_id);
     
+    std::unique_ptr<CounterRegistry> counter_registry_;  // Outlives every thread counting into it
+    std::unique_ptr<SymbolCounterRegistry> symbol_counters_;  // Likewise
     std::unique_ptr<MessageProcessor> processor_;
     std::unique_ptr<ITCHParser> itch_parser_;
+    std::unique_ptr<LatencyTracker> latency_tracker_;   // Outlives every thread recording into it
+    std::unique_ptr<TraceRecorder> trace_recorder_;     // Likewise
+    std::unique_ptr<PerfCounters> perf_counters_;       // Likewise
+    std::unique_ptr<LastValueCache> last_value_cache_;  // Outlives the shards writing it
     std::unique_ptr<ZMQPublisher> publisher_;
+    std::unique_ptr<MulticastPublisher> multicast_publisher_;
     std::unique_ptr<SharedMemoryManager> shm_manager_;
     std::unique_ptr<MicroburstDetector> microburst_detector_;
     std::unique_ptr<ThrottleController> throttle_controller_;
+    std::unique_ptr<LoadShedder> load_shedder_;
+    std::unique_ptr<SnapshotSampler> snapshot_sampler_;
+    std::unique_ptr<SnapshotService> snapshot_service_;
+    std::unique_ptr<SessionManager> session_manager_;
+    std::unique_ptr<ReplayManager> replay_manager_;
+    std::unique_ptr<MetricsSegment> metrics_segment_;  // Only touched by the metrics thread once started
+    std::unique_ptr<MetricsExporter> metrics_exporter_;
+    std::unique_ptr<DashboardStream> dashboard_stream_;
     
     SystemMetrics metrics_;
+    
+    // Counter totals at the last reset, indexed by CounterId
+    std::vector<uint64_t> counter_baseline_;
+    std::mutex counters_mutex_;
+    
+    // Merged histograms at the last reset and at the last report
+    std::vector<HistogramSnapshot> latency_baseline_;
+    std::vector<HistogramSnapshot> latency_previous_;
+    std::vector<LatencySummary> latency_report_;
+    mutable std::mutex latency_mutex_;
+    
+    // Per-symbol message totals at the last Prometheus page, indexed by stock_locate
+    std::vector<uint64_t> symbol_previous_;
+    
+    // Totals at the last dashboard snapshot, for its rates; stream thread only
+    struct DashboardTotals {
+        uint64_t time_ns = 0;
+        uint64_t published = 0;
+        uint64_t shed = 0;
+        std::vector<uint64_t> counters;
+        std::vector<uint64_t> symbols;
+        std::vector<HistogramSnapshot> latency;
+    };
+    DashboardTotals dashboard_previous_;
+    static constexpr size_t DASHBOARD_BURSTS = 5;  // Most recent bursts per snapshot
+    
+    // Perf counter totals at the last reset, indexed by PerfStage
+    std::vector<PerfStageStats> perf_baseline_;
+    mutable std::mutex perf_mutex_;
     std::atomic<bool> running_{false};
     std::atomic<double> replay_speed_{1.0};
     std::atomic<uint32_t> throttle_rate_{100000};
@@ -84,10 +408,55 @@ private:
     std::string input_file_;
     std::string symbols_file_;
     std::string zmq_endpoint_;
+    bool enable_conflation_;
+    std::string publish_format_;
+    size_t publish_batch_size_;
+    uint32_t publish_linger_us_;
+    size_t publish_ring_capacity_;
+    bool prune_unsubscribed_;
+    bool publish_egress_stamp_;
+    std::vector<std::string> publish_sinks_;
+    size_t publish_shards_;
+    std::vector<int> publish_shard_cores_;
+    bool multicast_enabled_;
+    std::string multicast_group_;
+    uint16_t multicast_port_;
+    std::string multicast_interface_;
+    int multicast_ttl_;
+    std::string mold_session_;
+    uint16_t retransmit_port_;
+    size_t retransmit_buffer_;
+    std::string snapshot_endpoint_;
+    bool publish_all_symbols_;      // Some consumer needs every symbol, so workers never prune
+    std::vector<std::string> shaping_sessions_;
+    std::vector<std::string> replays_;
+    uint64_t max_message_age_us_;
+    std::string output_mode_;
+    bool trace_enabled_;
+    size_t trace_buffer_events_;
+    uint64_t trace_trigger_us_;
+    std::string trace_dir_;
+    bool perf_counters_enabled_;
+    bool lock_profiling_;
+    uint32_t perf_sample_interval_;
+    std::string metrics_shm_name_;
+    std::string metrics_http_address_;
+    uint16_t metrics_http_port_;
+    size_t metrics_top_symbols_;
+    std::string dashboard_address_;
+    uint16_t dashboard_port_;
+    uint32_t dashboard_interval_ms_;
+    bool sampling_enabled_;
+    uint64_t sample_interval_ms_;
+    std::string sample_clock_;
     size_t shared_memory_size_;
     int worker_thread_count_;
     bool enable_cpu_affinity_;
     uint32_t microburst_threshold_;
+    uint32_t microburst_end_threshold_;
+    uint64_t min_microburst_duration_ms_;
+    uint32_t symbol_microburst_threshold_;
+    uint32_t symbol_microburst_end_threshold_;
     std::string log_level_;
     bool enable_monitoring_;
     int monitoring_interval_;
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tickshaper {
+
+class TraceRecorder;
+
+// What a trace record describes; the argument's meaning is given per event
+enum TraceEventId : uint8_t {
+    kTraceFraming = 0,     // Span: reading a message off the feed
+    kTraceThrottle = 1,    // Span: rate limiter check, arg 1 = admitted, 0 = throttled
+    kTraceDecode = 2,      // Span: parsing and order tracking, arg = ITCH message type
+    kTraceBook = 3,        // Span: book and inside-quote check (bbo mode), arg = ticks out
+    kTracePruned = 4,      // Instant: ticks nobody wanted, arg = ticks
+    kTraceShed = 5,        // Instant: ticks past their deadline, arg = ticks
+    kTraceFlush = 6,       // Span: one publisher batch, arg = ticks
+    kTraceSend = 7,        // Span: one symbol's run encoded and queued, arg = stock_locate
+    kTraceQueueDepth = 8,  // Counter: publisher ring depth at a flush
+    kTraceTrigger = 9,     // Instant: the latency trigger fired, arg = latency in ns
+    kNumTraceEvents = 10
+};
+
+struct TraceEvent {
+    uint64_t start_ns;     // FastClock time
+    uint64_t duration_ns;  // 0 for instants and counters
+    uint64_t arg;
+    TraceEventId id;
+};
+
+// One thread's trace ring. Only the owning thread writes; a record is three
+// relaxed stores and a release, and nothing at all while tracing is off. The
+// oldest records are overwritten, so the ring always holds the latest history.
+class alignas(64) ThreadTrace {
+public:
+    ThreadTrace(TraceRecorder& recorder, const std::string& name, uint32_t thread_id, size_t capacity);
+    
+    inline bool IsEnabled() const;
+    
+    void Span(TraceEventId id, uint64_t start_ns, uint64_t end_ns, uint64_t arg = 0) {
+        if (IsEnabled()) {
+            Write(id, start_ns, end_ns - start_ns, arg);
+        }
+    }
+    
+    // Instants and counters
+    void Mark(TraceEventId id, uint64_t time_ns, uint64_t arg = 0) {
+        if (IsEnabled()) {
+            Write(id, time_ns, 0, arg);
+        }
+    }
+    
+    // Fires the recorder's trigger when latency_ns is over its threshold
+    inline void CheckLatency(uint64_t latency_ns, uint64_t now_ns);
+    
+    // Copies out up to capacity - 1 of the newest records, oldest first. Safe
+    // while the owner keeps writing; records it overwrote during the copy are left out
+    void Snapshot(std::vector<TraceEvent>& events) const;
+    
+    const std::string& GetName() const { return name_; }
+    uint32_t GetThreadId() const { return thread_id_; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> duration_ns{0};
+        std::atomic<uint64_t> tagged_arg{0};  // arg << 8 | TraceEventId
+    };
+    
+    void Write(TraceEventId id, uint64_t start_ns, uint64_t duration_ns, uint64_t arg) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        
+        // Orders the last head store before this overwrite, so Snapshot can tell
+        std::atomic_thread_fence(std::memory_order_release);
+        
+        Slot& slot = slots_[head & mask_];
+        slot.start_ns.store(start_ns, std::memory_order_relaxed);
+        slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+        slot.tagged_arg.store((arg << 8) | id, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+    
+    TraceRecorder& recorder_;
+    std::string name_;
+    uint32_t thread_id_;
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> head_{0};  // Records ever written
+};
+
+// Hands every traced thread its own ring and exports them all as Chrome trace
+// JSON, which chrome://tracing and ui.perfetto.dev both load. Tracing is
+// always compiled in and switched at runtime. With a latency trigger set, the
+// first tick over it stops recording, so the rings keep the moments that led
+// up to it, until the metrics thread dumps them and recording resumes.
+class TraceRecorder {
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 65536;
+    
+    // Fewer triggered dumps than this apart are suppressed
+    static constexpr uint64_t MIN_TRIGGER_INTERVAL_NS = 10000000000ULL;
+    
+    TraceRecorder();
+    
+    // Rings registered afterwards get this many records, rounded up to a power of two
+    void SetCapacity(size_t events_per_thread) { events_per_thread_ = events_per_thread; }
+    ThreadTrace* RegisterThread(const std::string& name);
+    
+    void SetEnabled(bool enabled) { enabled_.store(enabled); }
+    bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+    
+    // 0 disables the trigger; dumps are written to directory
+    void SetTrigger(uint64_t latency_ns, const std::string& directory);
+    
+    // Writes every ring as Chrome trace JSON
+    bool WriteChromeTrace(const std::string& path) const;
+    
+    // Writes the dump a trigger left behind, if any, and resumes recording.
+    // Returns the file written, or an empty string
+    std::string FlushTriggered();
+    
+    uint64_t GetTriggerNanos() const { return trigger_ns_.load(std::memory_order_relaxed); }
+
+private:
+    friend class ThreadTrace;
+    
+    void Trigger(ThreadTrace& trace, uint64_t latency_ns, uint64_t now_ns);
+    
+    static const char* EventName(TraceEventId id);
+    static const char* ArgName(TraceEventId id);
+    
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint64_t> trigger_ns_{0};
+    std::atomic<bool> triggered_{false};
+    std::atomic<uint64_t> last_trigger_ns_{0};
+    std::string trigger_directory_;
+    size_t events_per_thread_;
+    
+    std::vector<std::unique_ptr<ThreadTrace>> threads_;
+    mutable std::mutex mutex_;
+};
+
+inline bool ThreadTrace::IsEnabled() const {
+    return recorder_.enabled_.load(std::memory_order_relaxed);
+}
+
+inline void ThreadTrace::CheckLatency(uint64_t latency_ns, uint64_t now_ns) {
+    uint64_t trigger_ns = recorder_.trigger_ns_.load(std::memory_order_relaxed);
+    if (trigger_ns != 0 && latency_ns > trigger_ns && IsEnabled()) {
+        recorder_.Trigger(*this, latency_ns, now_ns);
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
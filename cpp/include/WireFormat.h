@@ -0,0 +1,285 @@
+#pragma once
+
+#include "TickShaper.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+
+namespace tickshaper {
+namespace wire {
+
+// Fixed-layout, little-endian binary encoding for published messages.
+//
+// Each published message is multipart: a 3-byte topic frame, then the payload.
+// The topic is the message class followed by the big-endian stock_locate, so
+// ZMQ prefix subscriptions select a class ("T"), a symbol ("T" + locate) or
+// everything (""). A payload only ever carries records for its topic's symbol.
+//
+//   Topic          (3)  class u8 | stock_locate u16 (big-endian)
+//
+// Every payload starts with a 16-byte MessageHeader followed by `count`
+// records of `record_size` bytes. Consumers must check magic and version and
+// should use record_size to step over records, so fields can be appended in
+// later versions without breaking older decoders. The sequence is kept per
+// stock_locate, so a subscriber can detect gaps on the symbols it receives.
+//
+//   MessageHeader (16)  magic u16 | version u8 | kind u8 | count u16 |
+//                       record_size u16 | sequence u64
+//   TickRecord    (28)  timestamp u64 | price u64 | symbol_id u32 | size u32 |
+//                       stock_locate u16 | side u8 | message_type u8
+//   SnapshotBatch       sample_time u64, then SnapshotRecord[count]
+//   SnapshotRecord (32) stock_locate u16 | reserved u16 | symbol_id u32 |
+//                       bid_price u64 | bid_size u32 | ask_price u64 | ask_size u32
+//   CompactTickBatch    variable-size delta/varint ticks, see CompactFormat.h
+//   LastValueBatch      LastValueRecord[count], the snapshot service's reply
+//   LastValueRecord (84) stock_locate u16 | flags u8 | reserved u8 | symbol_id u32 |
+//                       tick_sequence u64 | snapshot_sequence u64 | last_tick TickRecord |
+//                       bid_price u64 | bid_size u32 | ask_price u64 | ask_size u32 |
+//                       quote_time u64
+//
+// With publish_egress_stamp=true, tick batches end in a trailer and their kind
+// has kEgressStamped set. Decoders that do not know the flag see an unknown
+// kind and skip the message; TakeEgressStamp strips the trailer and the flag.
+//
+//   EgressStamp   (16)  ingest_ns u64 | egress_ns u64, CLOCK_REALTIME ns since
+//                       the epoch: the batch's oldest pipeline entry, and when
+//                       the publisher encoded it for its sinks
+
+constexpr uint16_t kMagic = 0x5354;  // "TS" on the wire
+constexpr uint8_t kSchemaVersion = 2;
+constexpr size_t kTopicSize = 3;
+
+enum TopicClass : uint8_t {
+    kTopicTicks = 'T',
+    kTopicSnapshots = 'S'
+};
+
+enum MessageKind : uint8_t {
+    kTickBatch = 1,
+    kSnapshotBatch = 2,
+    kLastValueBatch = 3,
+    kCompactTickBatch = 4   // Delta/varint coded, see CompactFormat.h
+};
+
+// Flag on MessageHeader::kind: an EgressStamp trailer follows the body
+constexpr uint8_t kEgressStamped = 0x80;
+
+#pragma pack(push, 1)
+struct MessageHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t kind;
+    uint16_t count;
+    uint16_t record_size;
+    uint64_t sequence;
+};
+
+struct TickRecord {
+    uint64_t timestamp;
+    uint64_t price;
+    uint32_t symbol_id;
+    uint32_t size;
+    uint16_t stock_locate;
+    uint8_t side;
+    uint8_t message_type;
+};
+
+struct SnapshotRecord {
+    uint16_t stock_locate;
+    uint16_t reserved;
+    uint32_t symbol_id;
+    uint64_t bid_price;
+    uint32_t bid_size;
+    uint64_t ask_price;
+    uint32_t ask_size;
+};
+
+struct LastValueRecord {
+    uint16_t stock_locate;
+    uint8_t flags;          // LastValue::kHasTick | LastValue::kHasQuote
+    uint8_t reserved;
+    uint32_t symbol_id;
+    uint64_t tick_sequence;
+    uint64_t snapshot_sequence;
+    TickRecord last_tick;
+    uint64_t bid_price;
+    uint32_t bid_size;
+    uint64_t ask_price;
+    uint32_t ask_size;
+    uint64_t quote_time;
+};
+
+struct EgressStamp {
+    uint64_t ingest_ns;
+    uint64_t egress_ns;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(MessageHeader) == 16, "MessageHeader layout changed");
+static_assert(sizeof(TickRecord) == 28, "TickRecord layout changed");
+static_assert(sizeof(SnapshotRecord) == 32, "SnapshotRecord layout changed");
+static_assert(sizeof(LastValueRecord) == 84, "LastValueRecord layout changed");
+static_assert(sizeof(EgressStamp) == 16, "EgressStamp layout changed");
+
+inline uint8_t* EncodeTopic(uint8_t* out, TopicClass topic_class, uint16_t stock_locate) {
+    out[0] = topic_class;
+    out[1] = static_cast<uint8_t>(stock_locate >> 8);
+    out[2] = static_cast<uint8_t>(stock_locate);
+    return out + kTopicSize;
+}
+
+inline uint8_t* EncodeHeader(uint8_t* out, MessageKind kind, uint16_t count, 
+                             uint16_t record_size, uint64_t sequence) {
+    MessageHeader header;
+    header.magic = htole16(kMagic);
+    header.version = kSchemaVersion;
+    header.kind = kind;
+    header.count = htole16(count);
+    header.record_size = htole16(record_size);
+    header.sequence = htole64(sequence);
+    memcpy(out, &header, sizeof(header));
+    return out + sizeof(header);
+}
+
+inline uint8_t* EncodeTick(uint8_t* out, const TickData& tick_data) {
+    TickRecord record;
+    record.timestamp = htole64(tick_data.timestamp);
+    record.price = htole64(tick_data.price);
+    record.symbol_id = htole32(tick_data.symbol_id);
+    record.size = htole32(tick_data.size);
+    record.stock_locate = htole16(tick_data.stock_locate);
+    record.side = static_cast<uint8_t>(tick_data.side);
+    record.message_type = tick_data.message_type;
+    memcpy(out, &record, sizeof(record));
+    return out + sizeof(record);
+}
+
+inline uint8_t* EncodeSnapshot(uint8_t* out, const L1Snapshot& snapshot) {
+    SnapshotRecord record;
+    record.stock_locate = htole16(snapshot.stock_locate);
+    record.reserved = 0;
+    record.symbol_id = htole32(snapshot.symbol_id);
+    record.bid_price = htole64(snapshot.quote.bid_price);
+    record.bid_size = htole32(snapshot.quote.bid_size);
+    record.ask_price = htole64(snapshot.quote.ask_price);
+    record.ask_size = htole32(snapshot.quote.ask_size);
+    memcpy(out, &record, sizeof(record));
+    return out + sizeof(record);
+}
+
+inline uint8_t* EncodeLastValue(uint8_t* out, const LastValue& value) {
+    LastValueRecord record;
+    record.stock_locate = htole16(value.stock_locate);
+    record.flags = value.flags;
+    record.reserved = 0;
+    record.symbol_id = htole32(value.symbol_id);
+    record.tick_sequence = htole64(value.tick_sequence);
+    record.snapshot_sequence = htole64(value.snapshot_sequence);
+    EncodeTick(reinterpret_cast<uint8_t*>(&record.last_tick), value.last_tick);
+    record.bid_price = htole64(value.quote.bid_price);
+    record.bid_size = htole32(value.quote.bid_size);
+    record.ask_price = htole64(value.quote.ask_price);
+    record.ask_size = htole32(value.quote.ask_size);
+    record.quote_time = htole64(value.quote_time);
+    memcpy(out, &record, sizeof(record));
+    return out + sizeof(record);
+}
+
+// message..end is a complete encoded message; flags it and appends the trailer
+inline uint8_t* AppendEgressStamp(uint8_t* message, uint8_t* end, uint64_t ingest_ns, uint64_t egress_ns) {
+    message[offsetof(MessageHeader, kind)] |= kEgressStamped;
+    EgressStamp stamp;
+    stamp.ingest_ns = htole64(ingest_ns);
+    stamp.egress_ns = htole64(egress_ns);
+    memcpy(end, &stamp, sizeof(stamp));
+    return end + sizeof(stamp);
+}
+
+// Returns false if the frame is not a topic frame
+inline bool DecodeTopic(const uint8_t* data, size_t size, uint8_t& topic_class, uint16_t& stock_locate) {
+    if (size != kTopicSize || (data[0] != kTopicTicks && data[0] != kTopicSnapshots)) {
+        return false;
+    }
+    topic_class = data[0];
+    stock_locate = static_cast<uint16_t>((data[1] << 8) | data[2]);
+    return true;
+}
+
+// Returns false if the buffer is not a supported binary message
+inline bool DecodeHeader(const uint8_t* data, size_t size, MessageHeader& header) {
+    if (size < sizeof(MessageHeader)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    header.magic = le16toh(header.magic);
+    header.count = le16toh(header.count);
+    header.record_size = le16toh(header.record_size);
+    header.sequence = le64toh(header.sequence);
+    
+    if (header.magic != kMagic || header.version != kSchemaVersion) {
+        return false;
+    }
+    
+    size_t body = (header.kind == kSnapshotBatch) ? sizeof(uint64_t) : 0;
+    if (header.kind & kEgressStamped) {
+        body += sizeof(EgressStamp);
+    }
+    return size >= sizeof(MessageHeader) + body + static_cast<size_t>(header.count) * header.record_size;
+}
+
+// For a header from DecodeHeader: reads the trailer, if any, then clears the
+// flag and drops the trailer from size so the body decodes as usual
+inline bool TakeEgressStamp(const uint8_t* data, size_t& size, MessageHeader& header, EgressStamp& stamp) {
+    if (!(header.kind & kEgressStamped)) {
+        return false;
+    }
+    size -= sizeof(EgressStamp);
+    memcpy(&stamp, data + size, sizeof(stamp));
+    stamp.ingest_ns = le64toh(stamp.ingest_ns);
+    stamp.egress_ns = le64toh(stamp.egress_ns);
+    header.kind &= static_cast<uint8_t>(~kEgressStamped);
+    return true;
+}
+
+inline TickRecord DecodeTick(const uint8_t* data) {
+    TickRecord record;
+    memcpy(&record, data, sizeof(record));
+    record.timestamp = le64toh(record.timestamp);
+    record.price = le64toh(record.price);
+    record.symbol_id = le32toh(record.symbol_id);
+    record.size = le32toh(record.size);
+    record.stock_locate = le16toh(record.stock_locate);
+    return record;
+}
+
+inline SnapshotRecord DecodeSnapshot(const uint8_t* data) {
+    SnapshotRecord record;
+    memcpy(&record, data, sizeof(record));
+    record.stock_locate = le16toh(record.stock_locate);
+    record.symbol_id = le32toh(record.symbol_id);
+    record.bid_price = le64toh(record.bid_price);
+    record.bid_size = le32toh(record.bid_size);
+    record.ask_price = le64toh(record.ask_price);
+    record.ask_size = le32toh(record.ask_size);
+    return record;
+}
+
+inline LastValueRecord DecodeLastValue(const uint8_t* data) {
+    LastValueRecord record;
+    memcpy(&record, data, sizeof(record));
+    record.stock_locate = le16toh(record.stock_locate);
+    record.symbol_id = le32toh(record.symbol_id);
+    record.tick_sequence = le64toh(record.tick_sequence);
+    record.snapshot_sequence = le64toh(record.snapshot_sequence);
+    record.last_tick = DecodeTick(data + offsetof(LastValueRecord, last_tick));
+    record.bid_price = le64toh(record.bid_price);
+    record.bid_size = le32toh(record.bid_size);
+    record.ask_price = le64toh(record.ask_price);
+    record.ask_size = le32toh(record.ask_size);
+    record.quote_time = le64toh(record.quote_time);
+    return record;
+}
+
+} // namespace wire
+} // namespace tickshaper
\ No newline at end of file
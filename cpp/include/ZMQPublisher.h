@@ -1,43 +1,74 @@
 #pragma once
 
 #include "TickShaper.h"
-#include <zmq.hpp>
+#include "PublisherShard.h"
 #include <string>
-#include <thread>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
-#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace tickshaper {
 
+class LoadShedder;
+class LastValueCache;
+class LatencyTracker;
+class TraceRecorder;
+class PerfCounters;
+
+// Egress front end. Symbols are split across independent shards, each with its
+// own hand-off ring, batching thread, ZMQ context and sockets, so egress scales
+// with cores. A symbol always maps to the same shard, which keeps its order:
+//
+//   shard = stock_locate % num_shards
+//
+// Shard i binds every configured endpoint with ShardEndpoint(endpoint, i):
+// tcp ports are offset by i, ipc and inproc names get a ".i" suffix. A wildcard
+// tcp port ("*") is kept, since each shard's bind picks its own port. With one
+// shard the endpoints are used as configured.
 class ZMQPublisher {
 public:
     ZMQPublisher();
     ~ZMQPublisher();
     
-    bool Initialize(const std::string& endpoint);
+    bool Initialize(const PublisherOptions& options);
+    void SetLoadShedder(LoadShedder* load_shedder) { load_shedder_ = load_shedder; }
+    void SetLastValueCache(LastValueCache* last_values) { last_values_ = last_values; }
+    void SetLatencyTracker(LatencyTracker* latency_tracker) { latency_tracker_ = latency_tracker; }
+    void SetTraceRecorder(TraceRecorder* trace_recorder) { trace_recorder_ = trace_recorder; }
+    void SetPerfCounters(PerfCounters* perf_counters) { perf_counters_ = perf_counters; }
     void Publish(const TickData& tick_data);
+    void PublishSnapshots(uint64_t sample_time, std::vector<L1Snapshot>&& snapshots);
     void Stop();
     
-    uint64_t GetPublishedCount() const { return published_count_.load(); }
-    
-private:
-    void PublishingLoop();
-    std::string SerializeTickData(const TickData& tick_data);
-    
-    zmq::context_t context_;
-    zmq::socket_t publisher_;
+    size_t GetShardCount() const { return shards_.size(); }
+    size_t GetShardForLocate(uint16_t stock_locate) const { return stock_locate % shards_.size(); }
+    static std::string ShardEndpoint(const std::string& endpoint, size_t shard_index);
     
-    std::queue<TickData> message_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
+    // inproc:// sinks are only reachable through their shard's context
+    zmq::context_t& GetContext(size_t shard_index = 0) { return shards_[shard_index]->GetContext(); }
     
-    std::thread publishing_thread_;
-    std::atomic<bool> running_{false};
-    std::atomic<uint64_t> published_count_{0};
+    uint64_t GetPublishedCount() const;
+    uint64_t GetBatchCount() const;
+    uint64_t GetDroppedCount() const;
+    uint64_t GetPrunedCount() const;
+    size_t GetQueueDepth() const;
+    bool IsConflationEnabled() const;
+    std::vector<ConflationStats> GetConflationStats() const;
+    double GetConflationRatio() const;
+    std::vector<PublisherSinkStats> GetSinkStats() const;
+    std::vector<EncoderStats> GetEncoderStats() const;
     
-    static constexpr size_t MAX_QUEUE_SIZE = 100000;
+    // Lock-free; lets workers drop ticks for symbols no sink has a subscriber for
+    bool IsSubscribed(wire::TopicClass topic_class, uint16_t stock_locate) const {
+        return !shards_.empty() && shards_[GetShardForLocate(stock_locate)]->IsSubscribed(topic_class, stock_locate);
+    }
+
+private:
+    std::vector<std::unique_ptr<PublisherShard>> shards_;
+    LoadShedder* load_shedder_;
+    LastValueCache* last_values_;  // Shared; every locate has a single writing shard
+    LatencyTracker* latency_tracker_;
+    TraceRecorder* trace_recorder_;
+    PerfCounters* perf_counters_;
 };
 
 } // namespace tickshaper
\ No newline at end of file
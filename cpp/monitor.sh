@@ -6,6 +6,9 @@
 echo "TickShaper System Monitor"
 echo "========================="
 
+# tickshaper-stat reads the live metrics even if the process stops responding
+STAT=$(command -v tickshaper-stat || ls "$(dirname "$0")"/build/tickshaper-stat "$(dirname "$0")"/bin/tickshaper-stat 2>/dev/null | head -1)
+
 # Function to monitor system resources
 monitor_resources() {
     while true; do
@@ -22,10 +25,14 @@ monitor_resources() {
         echo "Memory Usage:"
         free -h
         
-        # TickShaper process info
+        # TickShaper metrics, read from its shared memory segment
         echo ""
-        echo "TickShaper Processes:"
-        ps aux | grep tickshaper | grep -v grep || echo "No TickShaper processes found"
+        echo "TickShaper Metrics:"
+        if [ -n "$STAT" ]; then
+            "$STAT" -l || echo "No TickShaper metrics segment found"
+        else
+            ps aux | grep tickshaper | grep -v grep || echo "No TickShaper processes found"
+        fi
         
         # Network connections
         echo ""
@@ -0,0 +1,111 @@
+#include "Conflator.h"
+
+namespace tickshaper {
+
+Conflator::Conflator()
+    : dirty_head_(NO_SLOT), dirty_tail_(NO_SLOT), dirty_count_(0),
+      total_in_(0), total_out_(0) {
+}
+
+Conflator::~Conflator() = default;
+
+Conflator::UpdateClass Conflator::ClassifyMessage(uint8_t message_type) {
+    switch (message_type) {
+        case 'A':
+        case 'F':
+        case 'X':
+        case 'D':
+        case 'U':
+            return kQuote;
+        case 'E':
+        case 'C':
+            return kExecution;
+        case 'P':
+        case 'Q':
+            return kTrade;
+        default:
+            return kOther;
+    }
+}
+
+void Conflator::Update(const TickData& tick_data) {
+    size_t index = static_cast<size_t>(tick_data.stock_locate) * kNumUpdateClasses +
+                   ClassifyMessage(tick_data.message_type);
+    
+    if (index >= slots_.size()) {
+        slots_.resize((static_cast<size_t>(tick_data.stock_locate) + 1) * kNumUpdateClasses,
+                      Slot{TickData(), NO_SLOT, false, 0, 0});
+    }
+    
+    Slot& slot = slots_[index];
+    slot.pending = tick_data;
+    slot.updates_in++;
+    total_in_++;
+    
+    if (slot.dirty) {
+        // Overwritten in place, keeps its original position in the dirty list
+        return;
+    }
+    
+    slot.dirty = true;
+    slot.next_dirty = NO_SLOT;
+    if (dirty_tail_ == NO_SLOT) {
+        dirty_head_ = static_cast<uint32_t>(index);
+    } else {
+        slots_[dirty_tail_].next_dirty = static_cast<uint32_t>(index);
+    }
+    dirty_tail_ = static_cast<uint32_t>(index);
+    dirty_count_++;
+}
+
+size_t Conflator::Drain(std::vector<TickData>& out, size_t max_count) {
+    size_t drained = 0;
+    
+    while (dirty_head_ != NO_SLOT && drained < max_count) {
+        Slot& slot = slots_[dirty_head_];
+        out.push_back(slot.pending);
+        
+        slot.dirty = false;
+        slot.updates_out++;
+        
+        dirty_head_ = slot.next_dirty;
+        slot.next_dirty = NO_SLOT;
+        drained++;
+    }
+    
+    if (dirty_head_ == NO_SLOT) {
+        dirty_tail_ = NO_SLOT;
+    }
+    
+    dirty_count_ -= drained;
+    total_out_ += drained;
+    return drained;
+}
+
+std::vector<ConflationStats> Conflator::GetSymbolStats() const {
+    std::vector<ConflationStats> stats;
+    
+    for (size_t base = 0; base < slots_.size(); base += kNumUpdateClasses) {
+        ConflationStats symbol_stats{static_cast<uint16_t>(base / kNumUpdateClasses), 0, 0};
+        for (size_t c = 0; c < kNumUpdateClasses; ++c) {
+            symbol_stats.updates_in += slots_[base + c].updates_in;
+            symbol_stats.updates_out += slots_[base + c].updates_out;
+        }
+        if (symbol_stats.updates_in > 0) {
+            stats.push_back(symbol_stats);
+        }
+    }
+    
+    return stats;
+}
+
+void Conflator::ResetStats() {
+    for (auto& slot : slots_) {
+        slot.updates_in = 0;
+        slot.updates_out = 0;
+    }
+    total_in_ = 0;
+    total_out_ = 0;
+}
+
+} // namespace tickshaper
\ No newline at end of file
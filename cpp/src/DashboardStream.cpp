@@ -0,0 +1,368 @@
+#include "DashboardStream.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace tickshaper {
+
+static const char* kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// SHA-1 (FIPS 180-4), only for the handshake
+static void Sha1(const std::string& input, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    
+    std::string message = input;
+    uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56) {
+        message.push_back('\0');
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message.push_back(static_cast<char>((bit_length >> shift) & 0xFF));
+    }
+    
+    auto rotate = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(message.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotate(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotate(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+}
+
+static std::string Base64(const uint8_t* data, size_t size) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t group = uint32_t(data[i]) << 16;
+        if (i + 1 < size) {
+            group |= uint32_t(data[i + 1]) << 8;
+        }
+        if (i + 2 < size) {
+            group |= data[i + 2];
+        }
+        out.push_back(alphabet[(group >> 18) & 0x3F]);
+        out.push_back(alphabet[(group >> 12) & 0x3F]);
+        out.push_back(i + 1 < size ? alphabet[(group >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < size ? alphabet[group & 0x3F] : '=');
+    }
+    return out;
+}
+
+// Value of a request header, matched case-insensitively; empty if absent
+static std::string HeaderValue(const std::string& request, const std::string& name) {
+    std::string lower = request;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    std::string key = "\n" + name + ":";
+    size_t pos = lower.find(key);
+    if (pos == std::string::npos) {
+        return "";
+    }
+    size_t start = request.find_first_not_of(" \t", pos + key.size());
+    size_t end = request.find_first_of("\r\n", start);
+    return start == std::string::npos ? "" : request.substr(start, end - start);
+}
+
+std::string DashboardStream::AcceptKey(const std::string& key) {
+    uint8_t digest[20];
+    Sha1(key + kWebSocketGuid, digest);
+    return Base64(digest, sizeof(digest));
+}
+
+std::string DashboardStream::EncodeTextFrame(const std::string& payload) {
+    // FIN + text; server frames are never masked
+    std::string frame(1, static_cast<char>(0x81));
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        frame.push_back(static_cast<char>(126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size() & 0xFF));
+    } else {
+        frame.push_back(static_cast<char>(127));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF));
+        }
+    }
+    frame += payload;
+    return frame;
+}
+
+DashboardStream::DashboardStream() : listen_socket_(-1), port_(0), interval_ms_(500) {
+}
+
+DashboardStream::~DashboardStream() {
+    Stop();
+}
+
+bool DashboardStream::Initialize(const std::string& address, uint16_t port, uint32_t interval_ms, 
+                                 RenderFunction render) {
+    sockaddr_in listen_address{};
+    listen_address.sin_family = AF_INET;
+    listen_address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &listen_address.sin_addr) != 1) {
+        std::cerr << "Invalid dashboard address: " << address << std::endl;
+        return false;
+    }
+    
+    listen_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_socket_ < 0) {
+        std::cerr << "Dashboard socket failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listen_socket_, reinterpret_cast<sockaddr*>(&listen_address), sizeof(listen_address)) < 0 ||
+        listen(listen_socket_, 16) < 0) {
+        std::cerr << "Dashboard bind to " << address << ":" << port << " failed: " << strerror(errno) << std::endl;
+        close(listen_socket_);
+        listen_socket_ = -1;
+        return false;
+    }
+    
+    socklen_t length = sizeof(listen_address);
+    getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&listen_address), &length);
+    port_ = ntohs(listen_address.sin_port);
+    interval_ms_ = std::max<uint32_t>(interval_ms, 10);
+    render_ = std::move(render);
+    
+    running_.store(true);
+    stream_thread_ = std::thread([this]() {
+        StreamLoop();
+    });
+    
+    std::cout << "Dashboard stream on ws://" << address << ":" << port_ << " every " << interval_ms_ << " ms" << std::endl;
+    return true;
+}
+
+void DashboardStream::Stop() {
+    running_.store(false);
+    if (stream_thread_.joinable()) {
+        stream_thread_.join();
+    }
+    for (Client& client : clients_) {
+        close(client.socket);
+    }
+    clients_.clear();
+    client_count_.store(0);
+    if (listen_socket_ >= 0) {
+        close(listen_socket_);
+        listen_socket_ = -1;
+    }
+}
+
+void DashboardStream::StreamLoop() {
+    auto next_push = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval_ms_);
+    
+    while (running_.load()) {
+        std::vector<pollfd> fds;
+        fds.push_back({listen_socket_, POLLIN, 0});
+        for (const Client& client : clients_) {
+            fds.push_back({client.socket, POLLIN, 0});
+        }
+        
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_push - std::chrono::steady_clock::now());
+        int timeout_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(wait.count(), 200)));
+        if (poll(fds.data(), fds.size(), timeout_ms) > 0) {
+            if (fds[0].revents & POLLIN) {
+                Accept();
+            }
+            
+            // Clients accepted just now have no entry in fds yet
+            for (size_t i = 1; i < fds.size(); ++i) {
+                if (fds[i].revents && !Receive(clients_[i - 1])) {
+                    close(clients_[i - 1].socket);
+                    clients_[i - 1].socket = -1;
+                }
+            }
+        }
+        
+        if (std::chrono::steady_clock::now() >= next_push) {
+            next_push += std::chrono::milliseconds(interval_ms_);
+            if (std::any_of(clients_.begin(), clients_.end(), [](const Client& c) { return c.socket >= 0 && c.open; })) {
+                std::string frame = EncodeTextFrame(render_());
+                for (Client& client : clients_) {
+                    if (client.socket >= 0 && client.open && !SendAll(client.socket, frame)) {
+                        close(client.socket);
+                        client.socket = -1;
+                    }
+                }
+                snapshot_count_.fetch_add(1);
+            }
+            
+            // Catch up without a burst of pushes after a stall
+            next_push = std::max(next_push, std::chrono::steady_clock::now());
+        }
+        
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(), [](const Client& c) { return c.socket < 0; }),
+                       clients_.end());
+        client_count_.store(clients_.size());
+    }
+}
+
+void DashboardStream::Accept() {
+    int socket = accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (socket < 0) {
+        return;
+    }
+    if (clients_.size() >= MAX_CLIENTS) {
+        close(socket);
+        return;
+    }
+    clients_.push_back({socket, false, std::string()});
+}
+
+// False when the client should be dropped
+bool DashboardStream::Receive(Client& client) {
+    char buffer[2048];
+    ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return false;
+    }
+    if (received > 0) {
+        client.input.append(buffer, static_cast<size_t>(received));
+    }
+    return client.open ? ReadFrames(client) : Handshake(client);
+}
+
+bool DashboardStream::Handshake(Client& client) {
+    size_t end = client.input.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        return client.input.size() < MAX_HANDSHAKE_SIZE;
+    }
+    std::string request = client.input.substr(0, end + 2);
+    client.input.erase(0, end + 4);
+    
+    std::string key = HeaderValue(request, "sec-websocket-key");
+    if (request.compare(0, 4, "GET ") != 0 || key.empty()) {
+        SendAll(client.socket, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return false;
+    }
+    
+    client.open = SendAll(client.socket,
+                          "HTTP/1.1 101 Switching Protocols\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: " + AcceptKey(key) + "\r\n\r\n");
+    return client.open;
+}
+
+// Handles close and ping; everything else a client sends is discarded
+bool DashboardStream::ReadFrames(Client& client) {
+    std::string& input = client.input;
+    while (input.size() >= 2) {
+        uint8_t opcode = static_cast<uint8_t>(input[0]) & 0x0F;
+        bool masked = static_cast<uint8_t>(input[1]) & 0x80;
+        uint64_t length = static_cast<uint8_t>(input[1]) & 0x7F;
+        size_t offset = 2;
+        if (length == 126) {
+            if (input.size() < 4) {
+                return true;
+            }
+            length = (uint64_t(uint8_t(input[2])) << 8) | uint8_t(input[3]);
+            offset = 4;
+        } else if (length == 127) {
+            if (input.size() < 10) {
+                return true;
+            }
+            length = 0;
+            for (int i = 0; i < 8; ++i) {
+                length = (length << 8) | uint8_t(input[2 + i]);
+            }
+            offset = 10;
+        }
+        
+        // Nothing a dashboard sends needs more than a handshake's worth
+        if (length > MAX_HANDSHAKE_SIZE) {
+            return false;
+        }
+        size_t mask_offset = offset;
+        offset += masked ? 4 : 0;
+        if (input.size() < offset + length) {
+            return true;
+        }
+        
+        std::string payload = input.substr(offset, length);
+        if (masked) {
+            for (size_t i = 0; i < payload.size(); ++i) {
+                payload[i] ^= input[mask_offset + (i % 4)];
+            }
+        }
+        input.erase(0, offset + length);
+        
+        if (opcode == 0x8) {
+            SendAll(client.socket, std::string("\x88\x00", 2));
+            return false;
+        }
+        if (opcode == 0x9 && payload.size() < 126) {
+            std::string pong(1, static_cast<char>(0x8A));
+            pong.push_back(static_cast<char>(payload.size()));
+            SendAll(client.socket, pong + payload);
+        }
+    }
+    return true;
+}
+
+bool DashboardStream::SendAll(int socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t result = send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+} // namespace tickshaper
\ No newline at end of file
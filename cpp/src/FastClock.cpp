@@ -0,0 +1,144 @@
+#include "FastClock.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#ifdef TICKSHAPER_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+namespace tickshaper {
+
+void FastClock::Calibrate() {
+    std::call_once(calibrated_, []() {
+        UpdateRealtimeOffset();
+#ifdef TICKSHAPER_HAVE_TSC
+        if (!HasInvariantTsc()) {
+            std::cout << "FastClock: TSC is not invariant, using CLOCK_MONOTONIC" << std::endl;
+            return;
+        }
+        
+        uint64_t start_tsc, start_ns, end_tsc, end_ns;
+        ReadPair(start_tsc, start_ns);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(CALIBRATION_NS));
+        ReadPair(end_tsc, end_ns);
+        
+        if (end_tsc <= start_tsc || end_ns <= start_ns) {
+            std::cout << "FastClock: TSC did not advance, using CLOCK_MONOTONIC" << std::endl;
+            return;
+        }
+        
+        double ticks_per_ns = static_cast<double>(end_tsc - start_tsc) / (end_ns - start_ns);
+        if (ticks_per_ns < 0.1 || ticks_per_ns > 10.0) {
+            std::cout << "FastClock: implausible TSC rate " << ticks_per_ns
+                      << " GHz, using CLOCK_MONOTONIC" << std::endl;
+            return;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        origin_tsc_ = start_tsc;
+        origin_ns_ = start_ns;
+        startup_ticks_per_ns_ = ticks_per_ns;
+        Publish(end_tsc, end_ns, 1.0 / ticks_per_ns);
+        ticks_per_ns_.store(ticks_per_ns);
+        use_tsc_.store(true);
+        UpdateRealtimeOffset();
+        
+        std::cout << "FastClock: using TSC at " << ticks_per_ns << " GHz" << std::endl;
+#else
+        std::cout << "FastClock: no TSC on this architecture, using CLOCK_MONOTONIC" << std::endl;
+#endif
+    });
+}
+
+void FastClock::Recalibrate() {
+    UpdateRealtimeOffset();
+#ifdef TICKSHAPER_HAVE_TSC
+    if (!use_tsc_.load()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t tsc, mono_ns;
+    ReadPair(tsc, mono_ns);
+    if (tsc <= origin_tsc_ || mono_ns <= origin_ns_) {
+        return;
+    }
+    
+    // Rate over everything since startup, so read jitter averages out
+    double ticks_per_ns = static_cast<double>(tsc - origin_tsc_) / (mono_ns - origin_ns_);
+    if (std::fabs(ticks_per_ns - startup_ticks_per_ns_) > startup_ticks_per_ns_ * MAX_RATE_DRIFT) {
+        // The TSC changed rate under us (a VM migration, a broken BIOS): stop trusting it
+        use_tsc_.store(false);
+        std::cout << "FastClock: TSC rate moved from " << startup_ticks_per_ns_ << " to "
+                  << ticks_per_ns << " GHz, using CLOCK_MONOTONIC" << std::endl;
+        return;
+    }
+    
+    // Continue from what the clock reads now, and steer the remaining offset
+    // out over the next window by running slightly fast or slow
+    uint64_t now_ns = TscNanos(tsc);
+    double offset_ns = static_cast<double>(static_cast<int64_t>(mono_ns - now_ns));
+    double limit_ns = SLEW_WINDOW_NS * SLEW_LIMIT;
+    offset_ns = std::max(-limit_ns, std::min(limit_ns, offset_ns));
+    
+    Publish(tsc, now_ns, (1.0 + offset_ns / SLEW_WINDOW_NS) / ticks_per_ns);
+    ticks_per_ns_.store(ticks_per_ns);
+#endif
+}
+
+void FastClock::UpdateRealtimeOffset() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t realtime_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    realtime_offset_ns_.store(static_cast<int64_t>(realtime_ns - NowNanos()));
+}
+
+bool FastClock::HasInvariantTsc() {
+#ifdef TICKSHAPER_HAVE_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+void FastClock::ReadPair(uint64_t& tsc, uint64_t& mono_ns) {
+#ifdef TICKSHAPER_HAVE_TSC
+    // Keep the pair whose clock_gettime was bracketed most tightly
+    uint64_t best_gap = UINT64_MAX;
+    for (int attempt = 0; attempt < 5; ++attempt) {
+        uint64_t before = __rdtsc();
+        uint64_t ns = MonotonicNanos();
+        uint64_t after = __rdtsc();
+        if (after - before < best_gap) {
+            best_gap = after - before;
+            tsc = before + (after - before) / 2;
+            mono_ns = ns;
+        }
+    }
+#else
+    tsc = 0;
+    mono_ns = MonotonicNanos();
+#endif
+}
+
+void FastClock::Publish(uint64_t base_tsc, uint64_t base_ns, double ns_per_tick) {
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    base_tsc_.store(base_tsc, std::memory_order_relaxed);
+    base_ns_.store(base_ns, std::memory_order_relaxed);
+    scale_.store(static_cast<uint64_t>(std::ldexp(ns_per_tick, SCALE_SHIFT)), std::memory_order_relaxed);
+    
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <cstring>
 #include <random>
+#include <sstream>
+#include <chrono>
 #include <arpa/inet.h>
 
 namespace tickshaper {
@@ -55,7 +57,7 @@ std::unique_ptr<RawMessage> ITCHParser::GetNextMessage() {
         return nullptr;
     }
     
-    std::lock_guard<std::mutex> lock(file_mutex_);
+    std::lock_guard<InstrumentedMutex> lock(file_mutex_);
     
     if (using_sample_data_) {
         // Generate synthetic ITCH message
@@ -71,8 +73,9 @@ std::unique_ptr<RawMessage> ITCHParser::GetNextMessage() {
         std::vector<uint8_t> message_data(36);
         uint8_t* data = message_data.data();
         
-        // Stock locate and tracking number
-        *reinterpret_cast<uint16_t*>(data) = htons(1);
+        // Stock locate (1-based index into the symbol list) and tracking number
+        size_t symbol_index = symbol_dist(gen);
+        *reinterpret_cast<uint16_t*>(data) = htons(static_cast<uint16_t>(symbol_index + 1));
         *reinterpret_cast<uint16_t*>(data + 2) = htons(current_position_ & 0xFFFF);
         
         // Timestamp (6 bytes, nanoseconds since midnight)
@@ -95,7 +98,7 @@ std::unique_ptr<RawMessage> ITCHParser::GetNextMessage() {
         *reinterpret_cast<uint32_t*>(data + 19) = htonl(size_dist(gen));
         
         // Stock symbol (8 bytes, space padded)
-        const std::string& symbol = symbols_[symbol_dist(gen)];
+        const std::string& symbol = symbols_[symbol_index];
         memset(data + 23, ' ', 8);
         memcpy(data + 23, symbol.c_str(), std::min(symbol.length(), size_t(8)));
         
@@ -123,7 +126,7 @@ std::unique_ptr<RawMessage> ITCHParser::GetNextMessage() {
         return nullptr;
     }
     
-    uint64_t timestamp = ExtractTimestamp(header.message_type, message_data);
+    uint64_t timestamp = ExtractTimestamp(message_data);
     current_position_++;
     
     return std::make_unique<RawMessage>(header.message_type, timestamp, 
@@ -131,7 +134,7 @@ std::unique_ptr<RawMessage> ITCHParser::GetNextMessage() {
 }
 
 void ITCHParser::Reset() {
-    std::lock_guard<std::mutex> lock(file_mutex_);
+    std::lock_guard<InstrumentedMutex> lock(file_mutex_);
     
     if (using_sample_data_) {
         current_position_ = 0;
@@ -176,47 +179,20 @@ bool ITCHParser::ReadMessageData(uint8_t message_type, uint16_t length, std::vec
     return true;
 }
 
-uint64_t ITCHParser::ExtractTimestamp(uint8_t message_type, const std::vector<uint8_t>& data) {
-    // ITCH timestamp is typically at offset 4 (after stock_locate and tracking_number)
-    // and is 6 bytes in nanoseconds since midnight
-    
+uint64_t ITCHParser::ExtractTimestamp(const std::vector<uint8_t>& data) {
+    // Every ITCH 5.0 message carries a 6-byte timestamp in nanoseconds since
+    // midnight at offset 4, after stock_locate and tracking_number
     if (data.size() < 10) {
-        return std::chrono::duration_cast<std::chrono::nanoseconds>(
-            std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-    }
-    
-    uint64_t timestamp = 0;
-    
-    switch (message_type) {
-        case 'A': // Add Order
-        case 'F': // Add Order with MPID
-        case 'E': // Order Executed
-        case 'C': // Order Executed with Price
-        case 'X': // Order Cancel
-        case 'D': // Order Delete
-        case 'U': // Order Replace
-        case 'P': // Trade Message
-        case 'Q': // Cross Trade Message
-        case 'B': // Broken Trade Message
-        {
-            // Extract 6-byte timestamp at offset 4
-            const uint8_t* ts_ptr = data.data() + 4;
-            timestamp = (static_cast<uint64_t>(ts_ptr[0]) << 40) |
-                       (static_cast<uint64_t>(ts_ptr[1]) << 32) |
-                       (static_cast<uint64_t>(ts_ptr[2]) << 24) |
-                       (static_cast<uint64_t>(ts_ptr[3]) << 16) |
-                       (static_cast<uint64_t>(ts_ptr[4]) << 8) |
-                       static_cast<uint64_t>(ts_ptr[5]);
-            break;
-        }
-        default:
-            // Use current system time for unknown message types
-            timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-            break;
+        return 0;
     }
     
-    return timestamp;
+    const uint8_t* ts_ptr = data.data() + 4;
+    return (static_cast<uint64_t>(ts_ptr[0]) << 40) |
+           (static_cast<uint64_t>(ts_ptr[1]) << 32) |
+           (static_cast<uint64_t>(ts_ptr[2]) << 24) |
+           (static_cast<uint64_t>(ts_ptr[3]) << 16) |
+           (static_cast<uint64_t>(ts_ptr[4]) << 8) |
+           static_cast<uint64_t>(ts_ptr[5]);
 }
 
 bool ITCHParser::LoadSymbolsFromFile(const std::string& symbols_file) {
@@ -255,10 +231,9 @@ bool ITCHParser::CreateSampleData(const std::string& symbols_file) {
     }
     
     // Initialize sample data generation
-    auto now = std::chrono::high_resolution_clock::now();
-    auto midnight = std::chrono::time_point_cast<std::chrono::days>(now);
+    auto now = std::chrono::system_clock::now();
     sample_timestamp_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        now - midnight).count();
+        now.time_since_epoch() % std::chrono::hours(24)).count();
     
     total_messages_ = 1000000; // Simulate 1M messages
     current_position_ = 0;
@@ -0,0 +1,127 @@
+#include "LastValueCache.h"
+#include "MPSCRing.h"
+#include <cstring>
+#include <type_traits>
+
+namespace tickshaper {
+
+static_assert(std::is_trivially_copyable<LastValue>::value, "LastValue is copied word by word");
+
+LastValueCache::LastValueCache() : slots_(new Slot[NUM_LOCATES]) {
+    for (size_t i = 0; i < NUM_LOCATES; ++i) {
+        for (size_t w = 0; w < WORDS; ++w) {
+            slots_[i].words[w].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void LastValueCache::ApplyTicks(const TickData* ticks, size_t count, uint64_t tick_sequence) {
+    if (count == 0) {
+        return;
+    }
+    
+    Slot& slot = slots_[ticks[0].stock_locate];
+    LastValue value;
+    Load(slot, value);
+    
+    for (size_t i = 0; i < count; ++i) {
+        const TickData& tick = ticks[i];
+        if (tick.message_type == kMsgTypeQuoteUpdate) {
+            // Top-of-book output: each update carries one side of the inside quote
+            if (tick.side == 'B') {
+                value.quote.bid_price = tick.price;
+                value.quote.bid_size = tick.size;
+            } else {
+                value.quote.ask_price = tick.price;
+                value.quote.ask_size = tick.size;
+            }
+            value.quote_time = tick.timestamp;
+            value.flags |= LastValue::kHasQuote;
+        } else {
+            value.last_tick = tick;
+            value.flags |= LastValue::kHasTick;
+        }
+        value.symbol_id = tick.symbol_id;
+    }
+    
+    value.stock_locate = ticks[0].stock_locate;
+    value.tick_sequence = tick_sequence;
+    Store(slot, value);
+}
+
+void LastValueCache::ApplySnapshot(uint64_t sample_time, const L1Snapshot& snapshot, uint64_t snapshot_sequence) {
+    Slot& slot = slots_[snapshot.stock_locate];
+    LastValue value;
+    Load(slot, value);
+    
+    value.quote = snapshot.quote;
+    value.quote_time = sample_time;
+    value.symbol_id = snapshot.symbol_id;
+    value.stock_locate = snapshot.stock_locate;
+    value.snapshot_sequence = snapshot_sequence;
+    value.flags |= LastValue::kHasQuote;
+    Store(slot, value);
+}
+
+bool LastValueCache::Read(uint16_t stock_locate, LastValue& value) const {
+    const Slot& slot = slots_[stock_locate];
+    if (slot.version.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    
+    Load(slot, value);
+    return true;
+}
+
+void LastValueCache::ReadAll(std::vector<LastValue>& values) const {
+    values.clear();
+    LastValue value;
+    for (size_t i = 0; i < NUM_LOCATES; ++i) {
+        if (Read(static_cast<uint16_t>(i), value)) {
+            values.push_back(value);
+        }
+    }
+}
+
+void LastValueCache::Load(const Slot& slot, LastValue& value) const {
+    uint64_t words[WORDS];
+    AdaptiveBackoff backoff;
+    
+    while (true) {
+        uint64_t before = slot.version.load(std::memory_order_acquire);
+        if (before & 1) {
+            read_retries_.fetch_add(1, std::memory_order_relaxed);
+            backoff.Idle();
+            continue;
+        }
+        
+        for (size_t w = 0; w < WORDS; ++w) {
+            words[w] = slot.words[w].load(std::memory_order_relaxed);
+        }
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+        read_retries_.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    memcpy(&value, words, sizeof(value));
+}
+
+void LastValueCache::Store(Slot& slot, const LastValue& value) {
+    uint64_t words[WORDS] = {};
+    memcpy(words, &value, sizeof(value));
+    
+    uint64_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    for (size_t w = 0; w < WORDS; ++w) {
+        slot.words[w].store(words[w], std::memory_order_relaxed);
+    }
+    
+    slot.version.store(version + 2, std::memory_order_release);
+}
+
+} // namespace tickshaper
\ No newline at end of file
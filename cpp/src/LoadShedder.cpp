@@ -0,0 +1,60 @@
+#include "LoadShedder.h"
+#include "FastClock.h"
+
+namespace tickshaper {
+
+LoadShedder::LoadShedder() {
+    ResetCounters();
+}
+
+LoadShedder::~LoadShedder() = default;
+
+void LoadShedder::Initialize(uint64_t max_age_us) {
+    SetMaxAge(max_age_us);
+}
+
+void LoadShedder::SetMaxAge(uint64_t max_age_us) {
+    max_age_ns_.store(max_age_us * 1000);
+}
+
+bool LoadShedder::Admit(HandoffStage stage, uint64_t ingest_time_ns) {
+    if (!IsEnabled()) {
+        return true;
+    }
+    return Admit(stage, ingest_time_ns, FastClock::NowNanos());
+}
+
+bool LoadShedder::Admit(HandoffStage stage, uint64_t ingest_time_ns, uint64_t now_ns) {
+    uint64_t max_age_ns = max_age_ns_.load(std::memory_order_relaxed);
+    if (max_age_ns == 0) {
+        return true;
+    }
+    
+    checked_count_[stage].fetch_add(1, std::memory_order_relaxed);
+    
+    // Unstamped messages (ingest time 0) are never considered stale
+    if (ingest_time_ns != 0 && now_ns > ingest_time_ns && now_ns - ingest_time_ns > max_age_ns) {
+        shed_count_[stage].fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    return true;
+}
+
+LoadSheddingStats LoadShedder::GetStats() const {
+    LoadSheddingStats stats;
+    for (size_t i = 0; i < kNumHandoffStages; ++i) {
+        stats.checked[i] = checked_count_[i].load();
+        stats.shed[i] = shed_count_[i].load();
+    }
+    return stats;
+}
+
+void LoadShedder::ResetCounters() {
+    for (size_t i = 0; i < kNumHandoffStages; ++i) {
+        checked_count_[i].store(0);
+        shed_count_[i].store(0);
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "LockProfiler.h"
+#include <algorithm>
+
+namespace tickshaper {
+
+LockStats* LockProfiler::Register(const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& stats : stats_) {
+        if (!stats->in_use && stats->name == name) {
+            stats->in_use = true;
+            return stats.get();
+        }
+    }
+    stats_.push_back(std::make_unique<LockStats>());
+    stats_.back()->name = name;
+    return stats_.back().get();
+}
+
+void LockProfiler::Release(LockStats* stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats->in_use = false;
+}
+
+std::vector<LockReport> LockProfiler::GetReport() {
+    std::vector<LockReport> report;
+    std::vector<HistogramSnapshot> waits;
+    std::vector<HistogramSnapshot> holds;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& stats : stats_) {
+        size_t index = 0;
+        while (index < report.size() && report[index].name != stats->name) {
+            ++index;
+        }
+        if (index == report.size()) {
+            LockReport entry{};
+            entry.name = stats->name;
+            report.push_back(entry);
+            waits.emplace_back();
+            holds.emplace_back();
+        }
+        
+        HistogramSnapshot wait;
+        HistogramSnapshot hold;
+        wait.Add(stats->wait);
+        hold.Add(stats->hold);
+        waits[index].Add(wait.Since(stats->wait_baseline));
+        holds[index].Add(hold.Since(stats->hold_baseline));
+        
+        report[index].instances += stats->in_use ? 1 : 0;
+        report[index].acquisitions += stats->acquisitions.load(std::memory_order_relaxed) - stats->acquisitions_baseline;
+        report[index].contended += stats->contended.load(std::memory_order_relaxed) - stats->contended_baseline;
+    }
+    
+    for (size_t index = 0; index < report.size(); ++index) {
+        report[index].total_wait_ns = waits[index].GetSum();
+        report[index].wait = waits[index].Summarize();
+        report[index].hold = holds[index].Summarize();
+    }
+    std::sort(report.begin(), report.end(), [](const LockReport& a, const LockReport& b) {
+        return a.total_wait_ns > b.total_wait_ns;
+    });
+    return report;
+}
+
+void LockProfiler::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& stats : stats_) {
+        stats->acquisitions_baseline = stats->acquisitions.load(std::memory_order_relaxed);
+        stats->contended_baseline = stats->contended.load(std::memory_order_relaxed);
+        stats->wait_baseline = HistogramSnapshot();
+        stats->wait_baseline.Add(stats->wait);
+        stats->hold_baseline = HistogramSnapshot();
+        stats->hold_baseline.Add(stats->hold);
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
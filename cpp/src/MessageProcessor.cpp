@@ -1,4 +1,5 @@
 #include "MessageProcessor.h"
+#include "FastClock.h"
 #include <iostream>
 #include <cstring>
 #include <algorithm>
@@ -37,8 +38,51 @@ size_t SymbolManager::GetSymbolCount() const {
     return symbol_to_id_.size();
 }
 
+void OrderBook::AddOrder(char side, uint32_t price, uint32_t shares) {
+    if (side == 'B') {
+        bids_[price] += shares;
+    } else {
+        asks_[price] += shares;
+    }
+}
+
+void OrderBook::RemoveShares(char side, uint32_t price, uint32_t shares) {
+    auto remove = [&](auto& levels) {
+        auto it = levels.find(price);
+        if (it == levels.end()) {
+            return;
+        }
+        if (it->second <= shares) {
+            levels.erase(it);
+        } else {
+            it->second -= shares;
+        }
+    };
+    
+    if (side == 'B') {
+        remove(bids_);
+    } else {
+        remove(asks_);
+    }
+}
+
+TopOfBook OrderBook::GetTopOfBook() const {
+    TopOfBook tob{};
+    if (!bids_.empty()) {
+        tob.bid_price = bids_.begin()->first;
+        tob.bid_size = static_cast<uint32_t>(std::min<uint64_t>(bids_.begin()->second, UINT32_MAX));
+    }
+    if (!asks_.empty()) {
+        tob.ask_price = asks_.begin()->first;
+        tob.ask_size = static_cast<uint32_t>(std::min<uint64_t>(asks_.begin()->second, UINT32_MAX));
+    }
+    return tob;
+}
+
 MessageProcessor::MessageProcessor() 
-    : shm_manager_(nullptr), metrics_(nullptr) {
+    : shm_manager_(nullptr), metrics_(nullptr), symbols_(&symbol_manager_),
+      counters_(&counter_registry_),
+      output_mode_(OutputMode::kAllTicks), book_enabled_(false) {
 }
 
 MessageProcessor::~MessageProcessor() = default;
@@ -50,38 +94,167 @@ void MessageProcessor::Initialize(SharedMemoryManager* shm_manager, SystemMetric
     std::cout << "Message processor initialized" << std::endl;
 }
 
+void MessageProcessor::SetOutputMode(OutputMode mode) {
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
+    output_mode_ = mode;
+    book_enabled_ = (mode != OutputMode::kAllTicks);
+}
+
+bool MessageProcessor::ProcessMessage(const RawMessage& raw_message, ProcessorOutput& output) {
+    output.count = 0;
+    output.decoded_ns = 0;
+    
+    if (!ProcessMessage(raw_message, output.event)) {
+        return false;
+    }
+    
+    const TickData& event = output.event;
+    if (output_mode_ == OutputMode::kAllTicks) {
+        output.ticks[output.count++] = event;
+        return true;
+    }
+    if (output_mode_ == OutputMode::kSampled) {
+        return true;
+    }
+    
+    output.decoded_ns = FastClock::NowNanos();
+    
+    bool is_trade = (event.message_type == 'E' || event.message_type == 'C' ||
+                     event.message_type == 'P' || event.message_type == 'Q');
+    if (is_trade) {
+        output.ticks[output.count++] = event;
+    }
+    
+    {
+        std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
+        SymbolBook& symbol_book = GetSymbolBook(event.stock_locate);
+        symbol_book.events_in++;
+        
+        // Another worker may have moved the book since this event was applied,
+        // so either side can differ from what was last published
+        TopOfBook tob = symbol_book.book.GetTopOfBook();
+        bool bid_changed = !tob.BidEquals(symbol_book.last_published);
+        bool ask_changed = !tob.AskEquals(symbol_book.last_published);
+        for (char side : {'B', 'S'}) {
+            if (side == 'B' ? !bid_changed : !ask_changed) {
+                continue;
+            }
+            
+            TickData& quote = output.ticks[output.count++];
+            quote.timestamp = event.timestamp;
+            quote.symbol_id = event.symbol_id;
+            quote.price = side == 'B' ? tob.bid_price : tob.ask_price;
+            quote.size = side == 'B' ? tob.bid_size : tob.ask_size;
+            quote.side = side;
+            quote.message_type = kMsgTypeQuoteUpdate;
+            quote.stock_locate = event.stock_locate;
+            quote.ingest_time_ns = event.ingest_time_ns;
+        }
+        symbol_book.last_published = tob;
+        
+        symbol_book.updates_out += output.count;
+    }
+    
+    if (output.count == 0) {
+        counters_->Local().Add(kCounterSuppressed);
+    }
+    
+    return true;
+}
+
+TopOfBook MessageProcessor::GetTopOfBook(uint16_t stock_locate) const {
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
+    if (stock_locate >= books_.size()) {
+        return TopOfBook{};
+    }
+    return books_[stock_locate].book.GetTopOfBook();
+}
+
+void MessageProcessor::GetTopOfBooks(const std::vector<uint16_t>& stock_locates, 
+                                     std::vector<TopOfBook>& quotes) const {
+    // Single lock so every quote belongs to the same cut of the book
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
+    
+    quotes.clear();
+    quotes.reserve(stock_locates.size());
+    for (uint16_t locate : stock_locates) {
+        quotes.push_back(locate < books_.size() ? books_[locate].book.GetTopOfBook() : TopOfBook{});
+    }
+}
+
+std::vector<SuppressionStats> MessageProcessor::GetSuppressionStats() const {
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
+    
+    std::vector<SuppressionStats> stats;
+    for (size_t i = 0; i < books_.size(); ++i) {
+        if (books_[i].events_in > 0) {
+            stats.push_back({static_cast<uint16_t>(i), books_[i].events_in, books_[i].updates_out});
+        }
+    }
+    return stats;
+}
+
+MessageProcessor::SymbolBook& MessageProcessor::GetSymbolBook(uint16_t stock_locate) {
+    if (stock_locate >= books_.size()) {
+        books_.resize(static_cast<size_t>(stock_locate) + 1);
+    }
+    return books_[stock_locate];
+}
+
+void MessageProcessor::ApplyToBook(uint16_t stock_locate, char side, uint32_t price, uint32_t shares, bool add) {
+    if (!book_enabled_) {
+        return;
+    }
+    
+    OrderBook& book = GetSymbolBook(stock_locate).book;
+    if (add) {
+        book.AddOrder(side, price, shares);
+    } else {
+        book.RemoveShares(side, price, shares);
+    }
+}
+
 bool MessageProcessor::ProcessMessage(const RawMessage& raw_message, TickData& tick_data) {
     if (!shm_manager_ || !metrics_) {
         return false;
     }
     
-    queue_depth_.fetch_add(1);
+    ThreadCounters& counters = counters_->Local();
+    counters.Add(kCounterInFlight);
     
     bool processed = false;
     
+    // Every ITCH message body starts with the stock locate code
+    tick_data.stock_locate = raw_message.data.size() >= 2 ? ExtractUint16(raw_message.data.data()) : 0;
+    
     try {
         switch (raw_message.message_type) {
             case 'A': // Add Order - No MPID Attribution
             case 'F': // Add Order - MPID Attribution
                 processed = ProcessAddOrder(raw_message, tick_data);
-                if (processed) processed_add_orders_.fetch_add(1);
+                if (processed) counters.Add(kCounterAddOrders);
                 break;
                 
             case 'E': // Order Executed
+            case 'C': // Order Executed With Price
                 processed = ProcessOrderExecuted(raw_message, tick_data);
-                if (processed) processed_executions_.fetch_add(1);
+                if (processed) counters.Add(kCounterExecutions);
                 break;
                 
             case 'P': // Trade Message (Non-Cross)
             case 'Q': // Cross Trade Message
                 processed = ProcessTrade(raw_message, tick_data);
-                if (processed) processed_trades_.fetch_add(1);
+                if (processed) counters.Add(kCounterTrades);
                 break;
                 
             case 'X': // Order Cancel
             case 'D': // Order Delete
                 processed = ProcessOrderCancel(raw_message, tick_data);
-                if (processed) processed_cancels_.fetch_add(1);
+                if (processed) counters.Add(kCounterCancels);
+                break;
+                
+            case 'U': // Order Replace
+                processed = ProcessOrderReplace(raw_message, tick_data);
                 break;
                 
             default:
@@ -101,17 +274,45 @@ bool MessageProcessor::ProcessMessage(const RawMessage& raw_message, TickData& t
         processed = false;
     }
     
-    queue_depth_.fetch_sub(1);
+    counters.Sub(kCounterInFlight);
     return processed;
 }
 
+uint16_t MessageProcessor::PeekStockLocate(const RawMessage& raw_message) {
+    if (raw_message.data.size() < 2) {
+        return 0;
+    }
+    return static_cast<uint16_t>((raw_message.data[0] << 8) | raw_message.data[1]);
+}
+
+bool MessageProcessor::IsStateless(uint8_t message_type) const {
+    if (output_mode_ != OutputMode::kAllTicks) {
+        // Every event may move the book
+        return false;
+    }
+    
+    switch (message_type) {
+        case 'A':
+        case 'F':
+        case 'E':
+        case 'C':
+        case 'X':
+        case 'D':
+        case 'U':
+            // Tracked in active_orders_ for later executions and cancels
+            return false;
+        default:
+            return true;
+    }
+}
+
 size_t MessageProcessor::GetActiveOrderCount() const {
-    std::lock_guard<std::mutex> lock(orders_mutex_);
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
     return active_orders_.size();
 }
 
 bool MessageProcessor::ProcessAddOrder(const RawMessage& raw_message, TickData& tick_data) {
-    if (raw_message.data.size() < 36) {
+    if (raw_message.data.size() < 35) {
         return false;
     }
     
@@ -129,19 +330,21 @@ bool MessageProcessor::ProcessAddOrder(const RawMessage& raw_message, TickData&
     
     // Clean up symbol (remove padding)
     std::string symbol = ExtractSymbol(stock_symbol, 8);
-    uint32_t symbol_id = symbol_manager_.GetSymbolId(symbol);
+    uint32_t symbol_id = symbols_->GetSymbolId(symbol);
     
     // Store order in order book
     {
-        std::lock_guard<std::mutex> lock(orders_mutex_);
+        std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
         active_orders_[order_reference] = {
             order_reference,
             ConvertPrice(price),
             shares,
             buy_sell_indicator,
             raw_message.timestamp,
-            symbol
+            symbol,
+            stock_locate
         };
+        ApplyToBook(stock_locate, buy_sell_indicator, ConvertPrice(price), shares, true);
     }
     
     // Create tick data
@@ -156,7 +359,8 @@ bool MessageProcessor::ProcessAddOrder(const RawMessage& raw_message, TickData&
 }
 
 bool MessageProcessor::ProcessOrderExecuted(const RawMessage& raw_message, TickData& tick_data) {
-    if (raw_message.data.size() < 30) {
+    bool with_price = (raw_message.message_type == 'C');
+    if (raw_message.data.size() < (with_price ? 35u : 30u)) {
         return false;
     }
     
@@ -167,13 +371,13 @@ bool MessageProcessor::ProcessOrderExecuted(const RawMessage& raw_message, TickD
     uint64_t match_number = ExtractUint64(data + 22);
     
     // Find the original order
-    std::lock_guard<std::mutex> lock(orders_mutex_);
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
     auto it = active_orders_.find(order_reference);
     if (it == active_orders_.end()) {
         // Order not found, create basic tick data
         tick_data.timestamp = raw_message.timestamp;
         tick_data.symbol_id = 0;
-        tick_data.price = 0;
+        tick_data.price = with_price ? ConvertPrice(ExtractUint32(data + 31)) : 0;
         tick_data.size = executed_shares;
         tick_data.side = 'U';
         tick_data.message_type = raw_message.message_type;
@@ -182,15 +386,17 @@ bool MessageProcessor::ProcessOrderExecuted(const RawMessage& raw_message, TickD
     
     const OrderBookEntry& order = it->second;
     
-    // Create tick data for execution
+    // Create tick data for execution; 'C' trades away from the order's limit price
     tick_data.timestamp = raw_message.timestamp;
-    tick_data.symbol_id = symbol_manager_.GetSymbolId(order.symbol);
-    tick_data.price = order.price;
+    tick_data.symbol_id = symbols_->GetSymbolId(order.symbol);
+    tick_data.price = with_price ? ConvertPrice(ExtractUint32(data + 31)) : order.price;
     tick_data.size = executed_shares;
     tick_data.side = order.side;
     tick_data.message_type = raw_message.message_type;
     
     // Update order size
+    executed_shares = std::min(executed_shares, it->second.size);
+    ApplyToBook(order.stock_locate, order.side, order.price, executed_shares, false);
     it->second.size -= executed_shares;
     if (it->second.size == 0) {
         active_orders_.erase(it);
@@ -215,7 +421,7 @@ bool MessageProcessor::ProcessTrade(const RawMessage& raw_message, TickData& tic
     uint64_t match_number = ExtractUint64(data + 35);
     
     std::string symbol = ExtractSymbol(stock_symbol, 8);
-    uint32_t symbol_id = symbol_manager_.GetSymbolId(symbol);
+    uint32_t symbol_id = symbols_->GetSymbolId(symbol);
     
     // Create tick data for trade
     tick_data.timestamp = raw_message.timestamp;
@@ -229,7 +435,7 @@ bool MessageProcessor::ProcessTrade(const RawMessage& raw_message, TickData& tic
 }
 
 bool MessageProcessor::ProcessOrderCancel(const RawMessage& raw_message, TickData& tick_data) {
-    if (raw_message.data.size() < 22) {
+    if (raw_message.data.size() < 18) {
         return false;
     }
     
@@ -240,7 +446,7 @@ bool MessageProcessor::ProcessOrderCancel(const RawMessage& raw_message, TickDat
                                ExtractUint32(data + 18) : 0;
     
     // Find and update the order
-    std::lock_guard<std::mutex> lock(orders_mutex_);
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
     auto it = active_orders_.find(order_reference);
     if (it == active_orders_.end()) {
         // Order not found, create basic tick data
@@ -257,7 +463,7 @@ bool MessageProcessor::ProcessOrderCancel(const RawMessage& raw_message, TickDat
     
     // Create tick data for cancellation
     tick_data.timestamp = raw_message.timestamp;
-    tick_data.symbol_id = symbol_manager_.GetSymbolId(order.symbol);
+    tick_data.symbol_id = symbols_->GetSymbolId(order.symbol);
     tick_data.price = order.price;
     tick_data.size = (raw_message.message_type == 'D') ? order.size : cancelled_shares;
     tick_data.side = order.side;
@@ -266,9 +472,12 @@ bool MessageProcessor::ProcessOrderCancel(const RawMessage& raw_message, TickDat
     // Update or remove order
     if (raw_message.message_type == 'D') {
         // Delete entire order
+        ApplyToBook(order.stock_locate, order.side, order.price, order.size, false);
         active_orders_.erase(it);
     } else {
         // Cancel partial shares
+        cancelled_shares = std::min(cancelled_shares, it->second.size);
+        ApplyToBook(order.stock_locate, order.side, order.price, cancelled_shares, false);
         it->second.size -= cancelled_shares;
         if (it->second.size == 0) {
             active_orders_.erase(it);
@@ -278,6 +487,51 @@ bool MessageProcessor::ProcessOrderCancel(const RawMessage& raw_message, TickDat
     return true;
 }
 
+bool MessageProcessor::ProcessOrderReplace(const RawMessage& raw_message, TickData& tick_data) {
+    if (raw_message.data.size() < 34) {
+        return false;
+    }
+    
+    const uint8_t* data = raw_message.data.data();
+    
+    uint64_t original_reference = ExtractUint64(data + 10);
+    uint64_t new_reference = ExtractUint64(data + 18);
+    uint32_t shares = ExtractUint32(data + 26);
+    uint32_t price = ConvertPrice(ExtractUint32(data + 30));
+    
+    tick_data.timestamp = raw_message.timestamp;
+    tick_data.price = price;
+    tick_data.size = shares;
+    tick_data.message_type = raw_message.message_type;
+    
+    // A replace is a cancel of what is left of the original plus a new order
+    // on the same side and symbol
+    std::lock_guard<InstrumentedMutex> lock(orders_mutex_);
+    auto it = active_orders_.find(original_reference);
+    if (it == active_orders_.end()) {
+        // Order not found, create basic tick data
+        tick_data.symbol_id = 0;
+        tick_data.side = 'U';
+        return true;
+    }
+    
+    OrderBookEntry order = it->second;
+    ApplyToBook(order.stock_locate, order.side, order.price, order.size, false);
+    active_orders_.erase(it);
+    
+    order.order_id = new_reference;
+    order.price = price;
+    order.size = shares;
+    order.timestamp = raw_message.timestamp;
+    active_orders_[new_reference] = order;
+    ApplyToBook(order.stock_locate, order.side, price, shares, true);
+    
+    tick_data.symbol_id = symbols_->GetSymbolId(order.symbol);
+    tick_data.side = order.side;
+    
+    return true;
+}
+
 uint32_t MessageProcessor::ConvertPrice(uint32_t itch_price) {
     // ITCH prices are in 1/10000 of a dollar
     // Convert to cents (1/100 of a dollar)
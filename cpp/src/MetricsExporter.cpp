@@ -0,0 +1,212 @@
+#include "MetricsExporter.h"
+#include "LatencyHistogram.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace tickshaper {
+
+// Histogram bucket bounds in nanoseconds; exported as seconds
+static const uint64_t kBucketBoundsNs[] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+    500000, 1000000, 2500000, 5000000, 10000000, 100000000, 1000000000
+};
+
+static std::string FormatDouble(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    std::ostringstream out;
+    out.precision(12);
+    out << value;
+    return out.str();
+}
+
+void PrometheusPage::Declare(const std::string& name, const char* type, const std::string& help) {
+    text_ += "# HELP " + name + " " + help + "\n";
+    text_ += "# TYPE " + name + " " + type + "\n";
+}
+
+void PrometheusPage::Sample(const std::string& name, const std::string& labels, double value) {
+    Line(name, labels, FormatDouble(value));
+}
+
+void PrometheusPage::Sample(const std::string& name, const std::string& labels, uint64_t value) {
+    Line(name, labels, std::to_string(value));
+}
+
+void PrometheusPage::Histogram(const std::string& name, const std::string& labels, const HistogramSnapshot& histogram) {
+    std::string prefix = labels.empty() ? std::string() : labels + ",";
+    for (uint64_t bound_ns : kBucketBoundsNs) {
+        Line(name + "_bucket", prefix + "le=\"" + FormatDouble(bound_ns / 1e9) + "\"",
+             std::to_string(histogram.CountAtOrBelow(bound_ns)));
+    }
+    Line(name + "_bucket", prefix + "le=\"+Inf\"", std::to_string(histogram.GetCount()));
+    Line(name + "_sum", labels, FormatDouble(histogram.GetSum() / 1e9));
+    Line(name + "_count", labels, std::to_string(histogram.GetCount()));
+}
+
+void PrometheusPage::Line(const std::string& name, const std::string& labels, const std::string& value) {
+    text_ += name;
+    if (!labels.empty()) {
+        text_ += "{" + labels + "}";
+    }
+    text_ += " " + value + "\n";
+}
+
+MetricsExporter::MetricsExporter() : listen_socket_(-1), port_(0), page_(std::make_shared<const std::string>()) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    Stop();
+}
+
+bool MetricsExporter::Initialize(const std::string& address, uint16_t port) {
+    sockaddr_in listen_address{};
+    listen_address.sin_family = AF_INET;
+    listen_address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &listen_address.sin_addr) != 1) {
+        std::cerr << "Invalid metrics HTTP address: " << address << std::endl;
+        return false;
+    }
+    
+    listen_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_socket_ < 0) {
+        std::cerr << "Metrics HTTP socket failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listen_socket_, reinterpret_cast<sockaddr*>(&listen_address), sizeof(listen_address)) < 0 ||
+        listen(listen_socket_, 16) < 0) {
+        std::cerr << "Metrics HTTP bind to " << address << ":" << port << " failed: " << strerror(errno) << std::endl;
+        close(listen_socket_);
+        listen_socket_ = -1;
+        return false;
+    }
+    
+    socklen_t length = sizeof(listen_address);
+    getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&listen_address), &length);
+    port_ = ntohs(listen_address.sin_port);
+    
+    running_.store(true);
+    serve_thread_ = std::thread([this]() {
+        ServeLoop();
+    });
+    
+    std::cout << "Metrics exporter serving http://" << address << ":" << port_ << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsExporter::Stop() {
+    running_.store(false);
+    if (serve_thread_.joinable()) {
+        serve_thread_.join();
+    }
+    if (listen_socket_ >= 0) {
+        close(listen_socket_);
+        listen_socket_ = -1;
+    }
+}
+
+void MetricsExporter::SetPage(std::string page) {
+    auto rendered = std::make_shared<const std::string>(std::move(page));
+    std::lock_guard<std::mutex> lock(page_mutex_);
+    page_ = std::move(rendered);
+}
+
+void MetricsExporter::ServeLoop() {
+    pollfd listener{listen_socket_, POLLIN, 0};
+    while (running_.load()) {
+        // Wakes up to notice Stop
+        if (poll(&listener, 1, 200) <= 0) {
+            continue;
+        }
+        int connection = accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            continue;
+        }
+        
+        // A slow or silent client only delays the next scrape
+        timeval timeout{1, 0};
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        HandleConnection(connection);
+        close(connection);
+    }
+}
+
+void MetricsExporter::HandleConnection(int connection) {
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos) {
+        if (request.size() >= MAX_REQUEST_SIZE) {
+            SendAll(connection, "HTTP/1.0 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n");
+            return;
+        }
+        ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+    
+    std::istringstream request_line(request.substr(0, request.find_first_of("\r\n")));
+    std::string method;
+    std::string target;
+    request_line >> method >> target;
+    std::string path = target.substr(0, target.find('?'));
+    
+    std::string status = "200 OK";
+    std::string content_type = "text/plain; version=0.0.4; charset=utf-8";
+    std::shared_ptr<const std::string> page;
+    std::string body;
+    if (method != "GET" && method != "HEAD") {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+        content_type = "text/plain; charset=utf-8";
+    } else if (path == "/metrics") {
+        std::lock_guard<std::mutex> lock(page_mutex_);
+        page = page_;
+    } else {
+        status = "404 Not Found";
+        body = "Metrics are served on /metrics\n";
+        content_type = "text/plain; charset=utf-8";
+    }
+    
+    const std::string& content = page ? *page : body;
+    std::string head = "HTTP/1.0 " + status + "\r\n"
+                       "Content-Type: " + content_type + "\r\n"
+                       "Content-Length: " + std::to_string(content.size()) + "\r\n"
+                       "Connection: close\r\n\r\n";
+    if (SendAll(connection, head) && method != "HEAD") {
+        SendAll(connection, content);
+    }
+    if (page) {
+        scrape_count_.fetch_add(1);
+    }
+}
+
+bool MetricsExporter::SendAll(int connection, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t result = send(connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "MetricsSegment.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace tickshaper {
+
+double MetricsSample::Value::Scaled() const {
+    return static_cast<double>(value) / std::pow(10.0, decimals);
+}
+
+const MetricsSample::Value* MetricsSample::FindValue(const std::string& name) const {
+    for (const Value& entry : values) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const MetricsSample::Histogram* MetricsSample::FindHistogram(const std::string& name) const {
+    for (const Histogram& entry : histograms) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+MetricsSegment::MetricsSegment() : layout_(nullptr), fd_(-1) {
+}
+
+MetricsSegment::~MetricsSegment() {
+    if (layout_) {
+        munmap(layout_, sizeof(*layout_));
+    }
+    if (fd_ != -1) {
+        close(fd_);
+        shm_unlink(name_.c_str());
+    }
+}
+
+bool MetricsSegment::Create(const std::string& name, uint32_t update_interval_ms) {
+    // A fresh object, so readers of a previous run's segment keep their copy
+    shm_unlink(name.c_str());
+    fd_ = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd_ == -1) {
+        std::cerr << "Failed to create metrics segment " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    name_ = name;
+    
+    if (ftruncate(fd_, sizeof(metrics_shm::MetricsSegmentLayout)) == -1) {
+        std::cerr << "Failed to size metrics segment " << name << std::endl;
+        return false;
+    }
+    void* memory = mmap(nullptr, sizeof(metrics_shm::MetricsSegmentLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Failed to map metrics segment " << name << std::endl;
+        return false;
+    }
+    
+    // ftruncate zero-fills, which is a valid initial state for every atomic
+    layout_ = static_cast<metrics_shm::MetricsSegmentLayout*>(memory);
+    layout_->header.version = metrics_shm::kVersion;
+    layout_->header.pid = static_cast<int32_t>(getpid());
+    layout_->header.update_interval_ms = update_interval_ms;
+    
+    // Readers accept the segment once the magic is visible
+    std::atomic_thread_fence(std::memory_order_release);
+    layout_->header.magic = metrics_shm::kMagic;
+    return true;
+}
+
+int MetricsSegment::AddValue(const char* name, metrics_shm::ValueKind kind, uint8_t decimals) {
+    uint32_t index = layout_->header.value_count.load(std::memory_order_relaxed);
+    if (index >= metrics_shm::MAX_VALUES) {
+        return -1;
+    }
+    metrics_shm::MetricsValue& slot = layout_->values[index];
+    strncpy(slot.name, name, metrics_shm::kNameSize - 1);
+    slot.kind = kind;
+    slot.decimals = decimals;
+    layout_->header.value_count.store(index + 1, std::memory_order_release);
+    return static_cast<int>(index);
+}
+
+int MetricsSegment::AddHistogram(const char* name) {
+    uint32_t index = layout_->header.histogram_count.load(std::memory_order_relaxed);
+    if (index >= metrics_shm::MAX_HISTOGRAMS) {
+        return -1;
+    }
+    strncpy(layout_->histograms[index].name, name, metrics_shm::kNameSize - 1);
+    layout_->header.histogram_count.store(index + 1, std::memory_order_release);
+    return static_cast<int>(index);
+}
+
+void MetricsSegment::BeginUpdate() {
+    uint64_t sequence = layout_->header.sequence.load(std::memory_order_relaxed);
+    layout_->header.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void MetricsSegment::SetValue(int index, uint64_t value) {
+    if (index >= 0) {
+        layout_->values[index].value.store(value, std::memory_order_relaxed);
+    }
+}
+
+void MetricsSegment::SetHistogram(int index, uint64_t count, uint64_t sum_ns, uint64_t p50, uint64_t p99,
+                                  uint64_t p999, uint64_t p9999, uint64_t max) {
+    if (index < 0) {
+        return;
+    }
+    metrics_shm::MetricsHistogram& slot = layout_->histograms[index];
+    slot.count.store(count, std::memory_order_relaxed);
+    slot.sum_ns.store(sum_ns, std::memory_order_relaxed);
+    slot.p50.store(p50, std::memory_order_relaxed);
+    slot.p99.store(p99, std::memory_order_relaxed);
+    slot.p999.store(p999, std::memory_order_relaxed);
+    slot.p9999.store(p9999, std::memory_order_relaxed);
+    slot.max.store(max, std::memory_order_relaxed);
+}
+
+void MetricsSegment::EndUpdate() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    layout_->header.update_time_ns.store(static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec,
+                                         std::memory_order_relaxed);
+    layout_->header.update_count.store(layout_->header.update_count.load(std::memory_order_relaxed) + 1,
+                                       std::memory_order_relaxed);
+    layout_->header.sequence.store(layout_->header.sequence.load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_release);
+}
+
+MetricsSegmentReader::MetricsSegmentReader() : layout_(nullptr), mapped_size_(0) {
+}
+
+MetricsSegmentReader::~MetricsSegmentReader() {
+    if (layout_) {
+        munmap(const_cast<metrics_shm::MetricsSegmentLayout*>(layout_), mapped_size_);
+    }
+}
+
+bool MetricsSegmentReader::Open(const std::string& name, std::string& error) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        error = "cannot open " + name + ": " + strerror(errno);
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) == -1 || static_cast<size_t>(info.st_size) < sizeof(metrics_shm::MetricsSegmentHeader)) {
+        close(fd);
+        error = name + " is not a metrics segment";
+        return false;
+    }
+    mapped_size_ = static_cast<size_t>(info.st_size);
+    void* memory = mmap(nullptr, mapped_size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        error = "cannot map " + name;
+        return false;
+    }
+    layout_ = static_cast<const metrics_shm::MetricsSegmentLayout*>(memory);
+    
+    // Appended fields only; an older, smaller layout is not readable as this one
+    if (layout_->header.magic != metrics_shm::kMagic || layout_->header.version < metrics_shm::kVersion ||
+        mapped_size_ < sizeof(metrics_shm::MetricsSegmentLayout)) {
+        error = name + " has an unsupported layout (version " + std::to_string(layout_->header.version) + ")";
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+bool MetricsSegmentReader::Read(MetricsSample& sample) const {
+    const metrics_shm::MetricsSegmentHeader& header = layout_->header;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        uint64_t sequence = header.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        
+        sample.pid = header.pid;
+        sample.update_interval_ms = header.update_interval_ms;
+        sample.update_time_ns = header.update_time_ns.load(std::memory_order_relaxed);
+        sample.update_count = header.update_count.load(std::memory_order_relaxed);
+        
+        size_t value_count = std::min<size_t>(header.value_count.load(std::memory_order_acquire), metrics_shm::MAX_VALUES);
+        sample.values.resize(value_count);
+        for (size_t i = 0; i < value_count; ++i) {
+            const metrics_shm::MetricsValue& slot = layout_->values[i];
+            sample.values[i].name.assign(slot.name, strnlen(slot.name, metrics_shm::kNameSize));
+            sample.values[i].kind = static_cast<metrics_shm::ValueKind>(slot.kind);
+            sample.values[i].decimals = slot.decimals;
+            sample.values[i].value = slot.value.load(std::memory_order_relaxed);
+        }
+        
+        size_t histogram_count = std::min<size_t>(header.histogram_count.load(std::memory_order_acquire),
+                                                  metrics_shm::MAX_HISTOGRAMS);
+        sample.histograms.resize(histogram_count);
+        for (size_t i = 0; i < histogram_count; ++i) {
+            const metrics_shm::MetricsHistogram& slot = layout_->histograms[i];
+            MetricsSample::Histogram& entry = sample.histograms[i];
+            entry.name.assign(slot.name, strnlen(slot.name, metrics_shm::kNameSize));
+            entry.count = slot.count.load(std::memory_order_relaxed);
+            entry.sum_ns = slot.sum_ns.load(std::memory_order_relaxed);
+            entry.p50 = slot.p50.load(std::memory_order_relaxed);
+            entry.p99 = slot.p99.load(std::memory_order_relaxed);
+            entry.p999 = slot.p999.load(std::memory_order_relaxed);
+            entry.p9999 = slot.p9999.load(std::memory_order_relaxed);
+            entry.max = slot.max.load(std::memory_order_relaxed);
+        }
+        
+        // Retry if an update started while copying
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header.sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace tickshaper
\ No newline at end of file
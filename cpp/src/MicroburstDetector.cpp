@@ -4,28 +4,28 @@
 
 namespace tickshaper {
 
-MicroburstDetector::MicroburstDetector(uint32_t threshold, uint32_t end_threshold, uint64_t min_duration) 
-    : metrics_(nullptr), last_update_(std::chrono::steady_clock::now()),
+namespace {
+
+constexpr size_t NUM_LOCATES = 65536;
+constexpr uint32_t SYMBOL_WINDOWS_PER_SECOND = 1000000000 / MicroburstDetector::SYMBOL_WINDOW_NS;
+
+} // namespace
+
+MicroburstDetector::MicroburstDetector(uint32_t threshold, uint32_t end_threshold, uint64_t min_duration,
+                                       uint32_t symbol_threshold, uint32_t symbol_end_threshold)
+    : metrics_(nullptr), symbols_(std::make_unique<SymbolState[]>(NUM_LOCATES)),
       microburst_threshold_(threshold), microburst_end_threshold_(end_threshold),
-      min_microburst_duration_ms_(min_duration) {
+      min_microburst_duration_ns_(min_duration * 1000000), symbol_threshold_(symbol_threshold),
+      symbol_end_threshold_(symbol_end_threshold), next_close_bucket_(0) {
+    for (auto& bucket : buckets_) {
+        bucket.store(0);
+    }
 }
 
 MicroburstDetector::~MicroburstDetector() = default;
 
 void MicroburstDetector::Initialize(SystemMetrics* metrics) {
     metrics_ = metrics;
-    
-    // Initialize rate buckets
-    auto now = std::chrono::steady_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()).count();
-    
-    for (auto& bucket : rate_buckets_) {
-        bucket.count.store(0);
-        bucket.timestamp.store(timestamp);
-    }
-    
-    last_update_ = now;
 }
 
 void MicroburstDetector::CheckMessage(const TickData& tick_data) {
@@ -33,128 +33,179 @@ void MicroburstDetector::CheckMessage(const TickData& tick_data) {
         return;
     }
     
-    auto now = std::chrono::steady_clock::now();
-    auto current_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()).count();
+    // Messages older than the window no longer count towards any rate
+    uint64_t bucket = tick_data.timestamp / BUCKET_NS;
+    uint64_t open = open_bucket_.load(std::memory_order_relaxed);
+    if (bucket + NUM_BUCKETS > open) {
+        Count(buckets_[bucket % NUM_BUCKETS], bucket);
+    }
     
-    // Update rate window
-    UpdateRateWindow();
+    // Only the thread that moves the open bucket on closes the ones behind it
+    if (bucket > open && open_bucket_.compare_exchange_strong(open, bucket)) {
+        std::lock_guard<InstrumentedMutex> lock(events_mutex_);
+        CloseBuckets(bucket);
+    }
     
-    // Add message to current bucket
-    size_t bucket_index = (current_time_ms / BUCKET_SIZE_MS) % NUM_BUCKETS;
-    auto& bucket = rate_buckets_[bucket_index];
+    if (tick_data.stock_locate == 0) {
+        return;
+    }
     
-    // Check if we need to reset this bucket (new time window)
-    uint64_t bucket_time = (current_time_ms / BUCKET_SIZE_MS) * BUCKET_SIZE_MS;
-    uint64_t expected_time = bucket.timestamp.load();
+    // The message that opens a symbol's window closes the one before it. Quiet
+    // windows of a symbol not in a burst need no lock
+    SymbolState& symbol = symbols_[tick_data.stock_locate];
+    uint64_t window = tick_data.timestamp / SYMBOL_WINDOW_NS;
+    uint64_t previous = Count(symbol.window, window);
+    uint64_t previous_window = previous >> 32;
+    uint32_t previous_count = static_cast<uint32_t>(previous);
+    if (previous_window < window &&
+        (previous_count * SYMBOL_WINDOWS_PER_SECOND > symbol_threshold_ || symbol.bursting.load(std::memory_order_relaxed))) {
+        std::lock_guard<InstrumentedMutex> lock(events_mutex_);
+        CloseSymbolWindow(tick_data.stock_locate, previous_window, previous_count, window);
+    }
+}
+
+uint64_t MicroburstDetector::Count(std::atomic<uint64_t>& slot, uint64_t tag) {
+    uint64_t packed = slot.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        uint64_t held = packed >> 32;
+        if (held > tag) {
+            return packed;
+        }
+        next = held == tag ? packed + 1 : (tag << 32) | 1;
+    } while (!slot.compare_exchange_weak(packed, next, std::memory_order_relaxed));
+    return packed;
+}
+
+void MicroburstDetector::CloseBuckets(uint64_t open_bucket) {
+    // A full window after the last message the rate is zero and stays there
+    uint64_t last = std::min(open_bucket, next_close_bucket_ + NUM_BUCKETS + 1);
     
-    if (bucket_time != expected_time) {
-        // Reset bucket for new time window
-        bucket.count.store(0);
-        bucket.timestamp.store(bucket_time);
+    for (uint64_t bucket = next_close_bucket_; bucket < last; ++bucket) {
+        uint32_t rate = 0;
+        uint32_t messages = 0;
+        for (const auto& slot : buckets_) {
+            uint64_t packed = slot.load(std::memory_order_relaxed);
+            uint64_t tag = packed >> 32;
+            if (tag <= bucket && tag + NUM_BUCKETS > bucket) {
+                rate += static_cast<uint32_t>(packed);
+                if (tag == bucket) {
+                    messages = static_cast<uint32_t>(packed);
+                }
+            }
+        }
+        
+        current_rate_.store(rate);
+        if (Advance(aggregate_, 0, rate, messages, bucket * BUCKET_NS, microburst_threshold_,
+                    microburst_end_threshold_)) {
+            std::cout << "Microburst detected! Rate: " << rate << " msg/s" << std::endl;
+        }
     }
+    next_close_bucket_ = open_bucket;
     
-    bucket.count.fetch_add(1);
-    current_bucket_.store(bucket_index);
+    in_microburst_.store(aggregate_.active);
+    metrics_->microburst_detected.store(aggregate_.active);
     
-    // Calculate current rate and detect microbursts
-    if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update_).count() >= 10) {
-        DetectMicroburst();
-        last_update_ = now;
-    }
+    SweepSymbols(open_bucket * BUCKET_NS);
 }
 
-void MicroburstDetector::UpdateRateWindow() {
-    auto now = std::chrono::steady_clock::now();
-    auto current_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()).count();
+void MicroburstDetector::CloseSymbolWindow(uint16_t stock_locate, uint64_t window, uint32_t count,
+                                           uint64_t next_window) {
+    SymbolState& symbol = symbols_[stock_locate];
+    BurstState& burst = symbol.burst;
+    if (!burst.active && bursting_.size() >= MAX_BURSTING_SYMBOLS) {
+        return;
+    }
     
-    // Calculate total messages in the last second
-    uint32_t total_messages = 0;
-    uint64_t window_start = current_time_ms - WINDOW_SIZE_MS;
+    if (Advance(burst, stock_locate, count * SYMBOL_WINDOWS_PER_SECOND, count, window * SYMBOL_WINDOW_NS,
+                symbol_threshold_, symbol_end_threshold_)) {
+        bursting_.push_back(stock_locate);
+    }
     
-    for (const auto& bucket : rate_buckets_) {
-        uint64_t bucket_time = bucket.timestamp.load();
-        if (bucket_time >= window_start) {
-            total_messages += bucket.count.load();
-        }
+    // A window with no messages in between ends the burst where it starts
+    if (burst.active && next_window > window + 1) {
+        Advance(burst, stock_locate, 0, 0, (window + 1) * SYMBOL_WINDOW_NS, symbol_threshold_, symbol_end_threshold_);
     }
     
-    current_rate_.store(total_messages);
+    if (!burst.active) {
+        bursting_.erase(std::remove(bursting_.begin(), bursting_.end(), stock_locate), bursting_.end());
+    }
+    symbol.bursting.store(burst.active, std::memory_order_relaxed);
 }
 
-void MicroburstDetector::DetectMicroburst() {
-    uint32_t current_rate = current_rate_.load();
-    auto now = std::chrono::steady_clock::now();
-    auto current_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()).count();
+void MicroburstDetector::SweepSymbols(uint64_t time_ns) {
+    // A bursting symbol that went quiet has no message left to close its window
+    uint64_t open_window = time_ns / SYMBOL_WINDOW_NS;
+    std::vector<uint16_t> bursting = bursting_;
     
-    bool was_in_microburst = in_microburst_.load();
-    
-    if (!was_in_microburst && current_rate > microburst_threshold_) {
-        // Start of microburst
-        in_microburst_.store(true);
-        microburst_start_time_.store(current_time_ms);
-        microburst_peak_rate_.store(current_rate);
-        microburst_message_count_.store(current_rate);
-        
-        if (metrics_) {
-            metrics_->microburst_detected.store(true);
+    for (uint16_t stock_locate : bursting) {
+        std::atomic<uint64_t>& slot = symbols_[stock_locate].window;
+        uint64_t packed = slot.load(std::memory_order_relaxed);
+        if ((packed >> 32) >= open_window) {
+            continue;
         }
         
-        std::cout << "Microburst detected! Rate: " << current_rate << " msg/s" << std::endl;
-        
-    } else if (was_in_microburst) {
-        // Update peak rate
-        uint32_t current_peak = microburst_peak_rate_.load();
-        if (current_rate > current_peak) {
-            microburst_peak_rate_.store(current_rate);
+        // A message that rolls the window first closes it itself
+        if (slot.compare_exchange_strong(packed, open_window << 32, std::memory_order_relaxed)) {
+            CloseSymbolWindow(stock_locate, packed >> 32, static_cast<uint32_t>(packed), open_window);
         }
-        
-        // Accumulate message count
-        microburst_message_count_.fetch_add(current_rate / 100); // Approximate
-        
-        // Check for end of microburst
-        if (current_rate < microburst_end_threshold_) {
-            uint64_t start_time = microburst_start_time_.load();
-            uint64_t duration = current_time_ms - start_time;
-            
-            if (duration >= min_microburst_duration_ms_) {
-                // End of microburst - record event
-                MicroburstEvent event;
-                event.start_time = start_time;
-                event.end_time = current_time_ms;
-                event.peak_rate = microburst_peak_rate_.load();
-                event.total_messages = microburst_message_count_.load();
-                event.severity = CalculateSeverity(event.peak_rate);
-                
-                {
-                    std::lock_guard<std::mutex> lock(events_mutex_);
-                    recent_events_.push_back(event);
-                    
-                    // Keep only recent events
-                    if (recent_events_.size() > MAX_EVENTS) {
-                        recent_events_.erase(recent_events_.begin());
-                    }
-                }
-                
-                std::cout << "Microburst ended. Duration: " << duration << "ms, "
-                          << "Peak: " << event.peak_rate << " msg/s, "
-                          << "Severity: " << event.severity << std::endl;
-            }
-            
-            in_microburst_.store(false);
-            if (metrics_) {
-                metrics_->microburst_detected.store(false);
-            }
+    }
+}
+
+bool MicroburstDetector::Advance(BurstState& burst, uint16_t stock_locate, uint32_t rate, uint32_t messages,
+                                 uint64_t start_ns, uint32_t threshold, uint32_t end_threshold) {
+    burst.rate = rate;
+    
+    if (!burst.active) {
+        if (rate <= threshold) {
+            return false;
         }
+        burst.active = true;
+        burst.start_time_ns = start_ns;
+        burst.peak_rate = rate;
+        burst.total_messages = messages;
+        return true;
     }
+    
+    if (rate >= end_threshold) {
+        burst.peak_rate = std::max(burst.peak_rate, rate);
+        burst.total_messages += messages;
+        return false;
+    }
+    
+    // End of the burst - record it if it lasted long enough
+    burst.active = false;
+    uint64_t duration = start_ns - burst.start_time_ns;
+    if (duration < min_microburst_duration_ns_) {
+        return false;
+    }
+    
+    MicroburstEvent event;
+    event.stock_locate = stock_locate;
+    event.start_time_ns = burst.start_time_ns;
+    event.end_time_ns = start_ns;
+    event.peak_rate = burst.peak_rate;
+    event.total_messages = burst.total_messages;
+    event.severity = CalculateSeverity(burst.peak_rate, threshold);
+    
+    recent_events_.push_back(event);
+    if (recent_events_.size() > MAX_EVENTS) {
+        recent_events_.erase(recent_events_.begin());
+    }
+    
+    // Symbol bursts are too many for the console; see GetRecentEvents
+    if (stock_locate == 0) {
+        std::cout << "Microburst ended. Duration: " << duration / 1000000 << "ms, "
+                  << "Peak: " << event.peak_rate << " msg/s, "
+                  << "Severity: " << event.severity << std::endl;
+    }
+    return false;
 }
 
-std::string MicroburstDetector::CalculateSeverity(uint32_t rate) {
-    if (rate > 200000) {
+std::string MicroburstDetector::CalculateSeverity(uint32_t rate, uint32_t threshold) {
+    if (rate > 4 * static_cast<uint64_t>(threshold)) {
         return "high";
-    } else if (rate > 100000) {
+    } else if (rate > 2 * static_cast<uint64_t>(threshold)) {
         return "medium";
     } else {
         return "low";
@@ -162,8 +213,23 @@ std::string MicroburstDetector::CalculateSeverity(uint32_t rate) {
 }
 
 std::vector<MicroburstEvent> MicroburstDetector::GetRecentEvents() const {
-    std::lock_guard<std::mutex> lock(events_mutex_);
+    std::lock_guard<InstrumentedMutex> lock(events_mutex_);
     return recent_events_;
 }
 
+std::vector<SymbolBurst> MicroburstDetector::GetBurstingSymbols() const {
+    std::vector<SymbolBurst> bursts;
+    {
+        std::lock_guard<InstrumentedMutex> lock(events_mutex_);
+        for (uint16_t stock_locate : bursting_) {
+            const BurstState& burst = symbols_[stock_locate].burst;
+            bursts.push_back({stock_locate, burst.start_time_ns, burst.rate, burst.peak_rate});
+        }
+    }
+    std::sort(bursts.begin(), bursts.end(), [](const SymbolBurst& a, const SymbolBurst& b) {
+        return a.rate > b.rate;
+    });
+    return bursts;
+}
+
 } // namespace tickshaper
\ No newline at end of file
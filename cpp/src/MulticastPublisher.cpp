@@ -0,0 +1,399 @@
+#include "MulticastPublisher.h"
+#include "FastClock.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace tickshaper {
+
+MulticastPublisher::MulticastPublisher()
+    : send_socket_(-1), retransmit_socket_(-1), retransmit_port_(0), closed_packets_(0), open_size_(0),
+      open_count_(0), open_first_sequence_(0), open_since_ns_(0), last_send_ns_(0), store_mask_(0) {
+    memset(session_, ' ', sizeof(session_));
+}
+
+MulticastPublisher::~MulticastPublisher() {
+    Stop();
+    if (send_socket_ >= 0) {
+        close(send_socket_);
+    }
+    if (retransmit_socket_ >= 0) {
+        close(retransmit_socket_);
+    }
+}
+
+bool MulticastPublisher::Initialize(const MulticastOptions& options) {
+    options_ = options;
+    mold::PadSession(options_.session, session_);
+    
+    size_t capacity = 1;
+    while (capacity < options_.retransmit_capacity) {
+        capacity <<= 1;
+    }
+    // Sequence 0 is never sent, so it marks an empty slot
+    store_.assign(capacity, StoredMessage{0, 0, {}});
+    store_mask_ = capacity - 1;
+    
+    tick_ring_ = std::make_unique<MPSCRing<TickData>>(options_.ring_capacity);
+    
+    sockaddr_in destination{};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(options_.port);
+    if (inet_pton(AF_INET, options_.group.c_str(), &destination.sin_addr) != 1) {
+        std::cerr << "Invalid multicast group: " << options_.group << std::endl;
+        return false;
+    }
+    
+    send_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (send_socket_ < 0) {
+        std::cerr << "Multicast socket failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    if (IN_MULTICAST(ntohl(destination.sin_addr.s_addr))) {
+        in_addr interface_address{};
+        if (inet_pton(AF_INET, options_.interface_address.c_str(), &interface_address) != 1) {
+            std::cerr << "Invalid multicast interface: " << options_.interface_address << std::endl;
+            return false;
+        }
+        
+        // Loop back so consumers on this host, including over lo, see the feed
+        unsigned char ttl = static_cast<unsigned char>(options_.ttl);
+        unsigned char loop = 1;
+        if (setsockopt(send_socket_, IPPROTO_IP, IP_MULTICAST_IF, &interface_address, sizeof(interface_address)) < 0 ||
+            setsockopt(send_socket_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+            setsockopt(send_socket_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+            std::cerr << "Multicast socket options failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    
+    int send_buffer = 4 * 1024 * 1024;
+    setsockopt(send_socket_, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+    
+    if (connect(send_socket_, reinterpret_cast<sockaddr*>(&destination), sizeof(destination)) < 0) {
+        std::cerr << "Multicast connect failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // Retransmission requests arrive as unicast UDP on their own port
+    retransmit_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in request_address{};
+    request_address.sin_family = AF_INET;
+    request_address.sin_addr.s_addr = htonl(INADDR_ANY);
+    request_address.sin_port = htons(options_.retransmit_port);
+    
+    socklen_t address_length = sizeof(request_address);
+    if (retransmit_socket_ < 0 ||
+        bind(retransmit_socket_, reinterpret_cast<sockaddr*>(&request_address), sizeof(request_address)) < 0 ||
+        getsockname(retransmit_socket_, reinterpret_cast<sockaddr*>(&request_address), &address_length) < 0) {
+        std::cerr << "Retransmit server bind failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    retransmit_port_ = ntohs(request_address.sin_port);
+    
+    // Lets the request loop notice Stop()
+    timeval timeout{0, 100000};
+    setsockopt(retransmit_socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    last_send_ns_ = FastClock::NowNanos();
+    running_.store(true);
+    send_thread_ = std::thread([this]() { SendLoop(); });
+    retransmit_thread_ = std::thread([this]() { RetransmitLoop(); });
+    
+    std::cout << "Multicast publisher initialized on " << options_.group << ":" << options_.port
+              << " via " << options_.interface_address << " (MoldUDP64 session "
+              << std::string(session_, sizeof(session_)) << "), retransmit on port " << retransmit_port_
+              << ", " << capacity << " messages kept" << std::endl;
+    return true;
+}
+
+void MulticastPublisher::Publish(const TickData& tick_data) {
+    if (!running_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    
+    if (!tick_ring_->TryPush(tick_data)) {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MulticastPublisher::PublishSnapshots(uint64_t sample_time, const std::vector<L1Snapshot>& snapshots) {
+    if (!running_.load()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    for (const L1Snapshot& snapshot : snapshots) {
+        snapshot_queue_.emplace_back(sample_time, snapshot);
+    }
+    snapshots_pending_.store(true, std::memory_order_release);
+}
+
+void MulticastPublisher::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    
+    running_.store(false);
+    
+    if (send_thread_.joinable()) {
+        send_thread_.join();
+    }
+    if (retransmit_thread_.joinable()) {
+        retransmit_thread_.join();
+    }
+    
+    std::cout << "Multicast publisher stopped. Sent " << (next_sequence_.load() - 1) << " messages in "
+              << packets_sent_.load() << " packets (" << send_calls_.load() << " sendmmsg calls), "
+              << retransmitted_messages_.load() << " retransmitted" << std::endl;
+}
+
+void MulticastPublisher::SendLoop() {
+    AdaptiveBackoff backoff;
+    uint64_t linger_ns = static_cast<uint64_t>(options_.linger_us) * 1000;
+    uint64_t heartbeat_ns = static_cast<uint64_t>(options_.heartbeat_ms) * 1000000;
+    uint64_t batch_since_ns = 0;
+    
+    while (running_.load(std::memory_order_relaxed)) {
+        bool progressed = DrainTicks();
+        
+        if (snapshots_pending_.load(std::memory_order_acquire)) {
+            DrainSnapshots();
+            progressed = true;
+        }
+        
+        uint64_t now_ns = FastClock::NowNanos();
+        if (open_size_ > 0 && now_ns - open_since_ns_ >= linger_ns) {
+            ClosePacket();
+        }
+        
+        // Closed packets wait for company, but never longer than the linger time
+        if (closed_packets_ > 0) {
+            if (batch_since_ns == 0) {
+                batch_since_ns = now_ns;
+            }
+            if (open_size_ == 0 || now_ns - batch_since_ns >= linger_ns) {
+                FlushPackets();
+                batch_since_ns = 0;
+                progressed = true;
+            }
+        }
+        
+        // Lets receivers detect loss at the tail of a burst
+        if (!progressed && open_size_ == 0 && now_ns - last_send_ns_ >= heartbeat_ns) {
+            SendControlPacket(mold::kHeartbeatCount);
+        }
+        
+        if (progressed) {
+            backoff.Reset();
+        } else {
+            backoff.Idle();
+        }
+    }
+    
+    while (DrainTicks()) {
+    }
+    DrainSnapshots();
+    ClosePacket();
+    FlushPackets();
+    SendControlPacket(mold::kEndOfSessionCount);
+}
+
+bool MulticastPublisher::DrainTicks() {
+    uint8_t message[mold::kMaxMessageSize];
+    TickData tick_data;
+    size_t drained = 0;
+    
+    while (drained < MAX_BATCH_PACKETS * 8 && tick_ring_->TryPop(tick_data)) {
+        AppendMessage(message, mold::EncodeTickMessage(message, tick_data));
+        drained++;
+    }
+    
+    return drained > 0;
+}
+
+void MulticastPublisher::DrainSnapshots() {
+    std::vector<std::pair<uint64_t, L1Snapshot>> snapshots;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        snapshots.swap(snapshot_queue_);
+        snapshots_pending_.store(false, std::memory_order_relaxed);
+    }
+    
+    uint8_t message[mold::kMaxMessageSize];
+    for (const auto& snapshot : snapshots) {
+        AppendMessage(message, mold::EncodeSnapshotMessage(message, snapshot.first, snapshot.second));
+    }
+}
+
+void MulticastPublisher::AppendMessage(const uint8_t* message, size_t length) {
+    if (open_size_ > 0 && open_size_ + sizeof(uint16_t) + length > mold::kMaxPacketSize) {
+        ClosePacket();
+    }
+    
+    if (open_size_ == 0) {
+        if (closed_packets_ == MAX_BATCH_PACKETS) {
+            FlushPackets();
+        }
+        open_size_ = mold::kHeaderSize;
+        open_count_ = 0;
+        open_first_sequence_ = next_sequence_.load(std::memory_order_relaxed);
+        open_since_ns_ = FastClock::NowNanos();
+    }
+    
+    uint8_t* out = packets_[closed_packets_] + open_size_;
+    uint16_t length_be = htobe16(static_cast<uint16_t>(length));
+    memcpy(out, &length_be, sizeof(length_be));
+    memcpy(out + sizeof(length_be), message, length);
+    
+    open_size_ += sizeof(length_be) + length;
+    open_count_++;
+    next_sequence_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MulticastPublisher::ClosePacket() {
+    if (open_size_ == 0) {
+        return;
+    }
+    
+    uint8_t* packet = packets_[closed_packets_];
+    mold::EncodeHeader(packet, session_, open_first_sequence_, open_count_);
+    packet_sizes_[closed_packets_] = open_size_;
+    StorePacket(packet, open_size_, open_first_sequence_, open_count_);
+    
+    closed_packets_++;
+    open_size_ = 0;
+}
+
+void MulticastPublisher::FlushPackets() {
+    if (closed_packets_ == 0) {
+        return;
+    }
+    
+    mmsghdr messages[MAX_BATCH_PACKETS];
+    iovec vectors[MAX_BATCH_PACKETS];
+    memset(messages, 0, sizeof(mmsghdr) * closed_packets_);
+    
+    for (size_t i = 0; i < closed_packets_; ++i) {
+        vectors[i].iov_base = packets_[i];
+        vectors[i].iov_len = packet_sizes_[i];
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    // sendmmsg may stop early; resume from where it left off
+    size_t sent = 0;
+    while (sent < closed_packets_) {
+        int result = sendmmsg(send_socket_, messages + sent, static_cast<unsigned int>(closed_packets_ - sent), 0);
+        send_calls_.fetch_add(1, std::memory_order_relaxed);
+        
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The packets stay in the store, so receivers can still recover them
+            std::cerr << "Multicast send error: " << strerror(errno) << std::endl;
+            dropped_count_.fetch_add(closed_packets_ - sent, std::memory_order_relaxed);
+            break;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    
+    packets_sent_.fetch_add(sent, std::memory_order_relaxed);
+    closed_packets_ = 0;
+    last_send_ns_ = FastClock::NowNanos();
+}
+
+void MulticastPublisher::SendControlPacket(uint16_t count) {
+    // Must not overtake data packets still waiting in the batch
+    FlushPackets();
+    
+    uint8_t packet[mold::kHeaderSize];
+    mold::EncodeHeader(packet, session_, next_sequence_.load(std::memory_order_relaxed), count);
+    if (send(send_socket_, packet, sizeof(packet), 0) == static_cast<ssize_t>(sizeof(packet))) {
+        packets_sent_.fetch_add(1, std::memory_order_relaxed);
+    }
+    last_send_ns_ = FastClock::NowNanos();
+}
+
+void MulticastPublisher::StorePacket(const uint8_t* packet, size_t size, uint64_t first_sequence, uint16_t count) {
+    std::lock_guard<std::mutex> lock(store_mutex_);
+    
+    size_t offset = mold::kHeaderSize;
+    for (uint16_t i = 0; i < count && offset + sizeof(uint16_t) <= size; ++i) {
+        uint16_t length_be;
+        memcpy(&length_be, packet + offset, sizeof(length_be));
+        uint16_t length = be16toh(length_be);
+        offset += sizeof(length_be);
+        
+        StoredMessage& slot = store_[(first_sequence + i) & store_mask_];
+        slot.sequence = first_sequence + i;
+        slot.length = static_cast<uint8_t>(length);
+        memcpy(slot.data, packet + offset, length);
+        offset += length;
+    }
+}
+
+size_t MulticastPublisher::BuildRetransmitPacket(uint64_t first_sequence, uint16_t requested, uint8_t* packet) {
+    size_t size = mold::kHeaderSize;
+    uint16_t count = 0;
+    
+    {
+        std::lock_guard<std::mutex> lock(store_mutex_);
+        
+        // One packet per request, as on the exchange servers; the client asks again for the rest
+        for (uint64_t sequence = first_sequence; count < requested; ++sequence, ++count) {
+            const StoredMessage& slot = store_[sequence & store_mask_];
+            if (slot.sequence != sequence || size + sizeof(uint16_t) + slot.length > mold::kMaxPacketSize) {
+                break;
+            }
+            
+            uint16_t length_be = htobe16(slot.length);
+            memcpy(packet + size, &length_be, sizeof(length_be));
+            memcpy(packet + size + sizeof(length_be), slot.data, slot.length);
+            size += sizeof(length_be) + slot.length;
+        }
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    mold::EncodeHeader(packet, session_, first_sequence, count);
+    retransmitted_messages_.fetch_add(count, std::memory_order_relaxed);
+    return size;
+}
+
+void MulticastPublisher::RetransmitLoop() {
+    uint8_t request[64];
+    uint8_t response[mold::kMaxPacketSize];
+    
+    while (running_.load()) {
+        sockaddr_in requester{};
+        socklen_t requester_length = sizeof(requester);
+        ssize_t received = recvfrom(retransmit_socket_, request, sizeof(request), 0,
+                                    reinterpret_cast<sockaddr*>(&requester), &requester_length);
+        if (received < 0) {
+            continue;  // Timeout, checks running_ again
+        }
+        
+        mold::PacketHeader header;
+        if (!mold::DecodeHeader(request, static_cast<size_t>(received), header) ||
+            memcmp(header.session, session_, sizeof(session_)) != 0 || header.count == 0) {
+            continue;
+        }
+        retransmit_requests_.fetch_add(1, std::memory_order_relaxed);
+        
+        // Requests for messages already overwritten in the store go unanswered
+        size_t size = BuildRetransmitPacket(header.sequence, header.count, response);
+        if (size > 0) {
+            sendto(retransmit_socket_, response, size, 0, reinterpret_cast<sockaddr*>(&requester), requester_length);
+        }
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
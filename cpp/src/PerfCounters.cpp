@@ -0,0 +1,169 @@
+#include "PerfCounters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace tickshaper {
+
+ThreadPerf::ThreadPerf(uint32_t sample_interval, bool open)
+    : leader_fd_(-1), group_size_(0), open_events_(0), sample_interval_(sample_interval), calls_(0), last_() {
+    for (size_t event = 0; event < kNumPerfEvents; ++event) {
+        fds_[event] = -1;
+        group_index_[event] = -1;
+    }
+    if (!open) {
+        return;
+    }
+    
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } kEvents[kNumPerfEvents] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    };
+    
+    // The first event that opens leads the group; the kernel schedules a
+    // group as a unit, so the ratios between its counts stay consistent
+    for (size_t event = 0; event < kNumPerfEvents; ++event) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = kEvents[event].type;
+        attr.config = kEvents[event].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (leader_fd_ < 0);
+        attr.exclude_hv = 1;
+        
+        // Context switches happen in the kernel; everything else is counted in our own code
+        attr.exclude_kernel = (event != kPerfContextSwitches);
+        
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_fd_, 0));
+        if (fd < 0) {
+            continue;
+        }
+        if (leader_fd_ < 0) {
+            leader_fd_ = fd;
+        }
+        fds_[event] = fd;
+        group_index_[event] = static_cast<int>(group_size_++);
+        open_events_ |= 1u << event;
+    }
+    
+    if (leader_fd_ >= 0) {
+        ioctl(leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+ThreadPerf::~ThreadPerf() {
+    for (size_t event = 0; event < kNumPerfEvents; ++event) {
+        if (fds_[event] >= 0) {
+            close(fds_[event]);
+        }
+    }
+}
+
+bool ThreadPerf::Read(uint64_t* values) {
+    // PERF_FORMAT_GROUP: the member count, then one value per member in open order
+    uint64_t buffer[1 + kNumPerfEvents];
+    ssize_t expected = static_cast<ssize_t>((1 + group_size_) * sizeof(uint64_t));
+    if (leader_fd_ < 0 || read(leader_fd_, buffer, sizeof(buffer)) != expected) {
+        return false;
+    }
+    for (size_t event = 0; event < kNumPerfEvents; ++event) {
+        values[event] = group_index_[event] >= 0 ? buffer[1 + group_index_[event]] : 0;
+    }
+    return true;
+}
+
+void ThreadPerf::End(PerfStage stage, uint64_t messages) {
+    uint64_t now[kNumPerfEvents];
+    if (!Read(now)) {
+        return;
+    }
+    for (size_t event = 0; event < kNumPerfEvents; ++event) {
+        std::atomic<uint64_t>& total = totals_[stage][event];
+        total.store(total.load(std::memory_order_relaxed) + (now[event] - last_[event]), std::memory_order_relaxed);
+        last_[event] = now[event];
+    }
+    messages_[stage].store(messages_[stage].load(std::memory_order_relaxed) + messages, std::memory_order_relaxed);
+}
+
+ThreadPerf* PerfCounters::RegisterThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(std::make_unique<ThreadPerf>(sample_interval_, enabled_));
+    ThreadPerf* thread = threads_.back().get();
+    
+    if (enabled_ && !warned_ && thread->GetOpenEvents() != (1u << kNumPerfEvents) - 1) {
+        // Once is enough; every thread gets the same answer
+        warned_ = true;
+        std::cerr << "Perf counters: cannot count";
+        for (size_t event = 0; event < kNumPerfEvents; ++event) {
+            if (!(thread->GetOpenEvents() & (1u << event))) {
+                std::cerr << " " << EventName(static_cast<PerfEvent>(event));
+            }
+        }
+        std::cerr << " (" << strerror(errno) << "; context switches need kernel.perf_event_paranoid <= 1)" << std::endl;
+    }
+    return thread;
+}
+
+std::vector<PerfStageStats> PerfCounters::Collect() const {
+    std::vector<PerfStageStats> merged(kNumPerfStages);
+    for (size_t stage = 0; stage < kNumPerfStages; ++stage) {
+        merged[stage].stage = StageName(static_cast<PerfStage>(stage));
+        merged[stage].messages = 0;
+        memset(merged[stage].counts, 0, sizeof(merged[stage].counts));
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& thread : threads_) {
+        for (size_t stage = 0; stage < kNumPerfStages; ++stage) {
+            merged[stage].messages += thread->messages_[stage].load(std::memory_order_relaxed);
+            for (size_t event = 0; event < kNumPerfEvents; ++event) {
+                merged[stage].counts[event] += thread->totals_[stage][event].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return merged;
+}
+
+uint32_t PerfCounters::GetOpenEvents() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t open_events = 0;
+    for (const auto& thread : threads_) {
+        open_events |= thread->GetOpenEvents();
+    }
+    return open_events;
+}
+
+const char* PerfCounters::StageName(PerfStage stage) {
+    switch (stage) {
+        case kPerfFraming: return "framing";
+        case kPerfThrottle: return "throttle";
+        case kPerfProcess: return "decode_book";
+        case kPerfHandoff: return "handoff";
+        case kPerfSend: return "serialize_send";
+        default: return "unknown";
+    }
+}
+
+const char* PerfCounters::EventName(PerfEvent event) {
+    switch (event) {
+        case kPerfCycles: return "cycles";
+        case kPerfInstructions: return "instructions";
+        case kPerfCacheMisses: return "cache_misses";
+        case kPerfBranchMisses: return "branch_misses";
+        case kPerfContextSwitches: return "context_switches";
+        default: return "unknown";
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "PublisherShard.h"
+#include "LoadShedder.h"
+#include "FastClock.h"
+#include "LastValueCache.h"
+#include "LatencyHistogram.h"
+#include "TraceRecorder.h"
+#include "PerfCounters.h"
+#include "WireFormat.h"
+#include <iostream>
+#include <algorithm>
+
+namespace tickshaper {
+
+PublisherShard::PublisherShard()
+    : context_(1),
+      load_shedder_(nullptr),
+      last_values_(nullptr),
+      latency_tracker_(nullptr),
+      trace_recorder_(nullptr),
+      perf_counters_(nullptr),
+      prune_unsubscribed_(true),
+      egress_stamp_(false),
+      shard_index_(0),
+      cpu_core_(-1),
+      batch_size_(1),
+      linger_ns_(0),
+      pending_since_ns_(0),
+      latency_(nullptr),
+      trace_(nullptr),
+      perf_(nullptr) {
+}
+
+PublisherShard::~PublisherShard() {
+    Stop();
+}
+
+bool PublisherShard::Initialize(const PublisherOptions& options, size_t shard_index, int cpu_core) {
+    shard_index_ = shard_index;
+    cpu_core_ = cpu_core;
+    prune_unsubscribed_ = options.prune_unsubscribed;
+    egress_stamp_ = options.egress_stamp;
+    linger_ns_ = static_cast<uint64_t>(options.linger_us) * 1000;
+    batch_size_ = std::max<size_t>(1, std::min(options.batch_size, FrameEncoder::MaxTicksPerFrame()));
+    pending_.reserve(batch_size_);
+    
+    tick_ring_ = std::make_unique<MPSCRing<TickData>>(options.ring_capacity);
+    
+    // The primary endpoint keeps the historical zmq_endpoint/publish_format keys
+    std::vector<SinkOptions> sink_options;
+    SinkOptions primary;
+    primary.endpoint = options.endpoint;
+    primary.format = options.format;
+    primary.conflated = options.enable_conflation;
+    primary.send_hwm = options.send_hwm;
+    sink_options.push_back(primary);
+    sink_options.insert(sink_options.end(), options.extra_sinks.begin(), options.extra_sinks.end());
+    
+    for (const SinkOptions& sink_option : sink_options) {
+        auto sink = std::make_unique<PublisherSink>(context_, sink_option);
+        
+        // Conflated sinks encode on their own thread, so they get a private encoder
+        FrameEncoder* sink_encoder = sink_option.conflated ? AddEncoder(sink_option.format) : nullptr;
+        if (!sink->Initialize(sink_encoder, batch_size_, load_shedder_)) {
+            std::cerr << "Publisher shard " << shard_index_ << " initialization failed" << std::endl;
+            return false;
+        }
+        
+        auto stream = std::find_if(streams_.begin(), streams_.end(), [&](const EncodedStream& s) {
+            return s.encoder->GetFormat() == sink_option.format;
+        });
+        if (stream == streams_.end()) {
+            streams_.push_back({AddEncoder(sink_option.format), {}, {}});
+            stream = streams_.end() - 1;
+        }
+        
+        stream->snapshot_sinks.push_back(sink.get());
+        if (sink_option.conflated) {
+            conflated_sinks_.push_back(sink.get());
+        } else {
+            stream->tick_sinks.push_back(sink.get());
+        }
+        
+        std::cout << "Publisher shard " << shard_index_ << " sink on " << sink_option.endpoint
+                  << " (" << WireFormatName(sink_option.format)
+                  << (sink_option.format != WireFormat::kJson ? " v" + std::to_string(wire::kSchemaVersion) : "") << ")"
+                  << (sink_option.conflated ? " (conflated)" : "")
+                  << " hwm " << sink_option.send_hwm << std::endl;
+        sinks_.push_back(std::move(sink));
+    }
+    
+    // A shard's batching and send threads form one pipeline and share its core
+    for (auto& sink : sinks_) {
+        sink->Start(cpu_core_);
+    }
+    
+    running_.store(true);
+    publishing_thread_ = std::thread([this]() { PublishingLoop(); });
+    
+    std::cout << "Publisher shard " << shard_index_ << " initialized with " << sinks_.size() << " sink(s), "
+              << streams_.size() << " encoded stream(s)"
+              << (prune_unsubscribed_ ? " (pruned to subscriptions)" : "")
+              << " batch " << batch_size_ << "/" << options.linger_us << "us"
+              << (cpu_core_ >= 0 ? " on CPU " + std::to_string(cpu_core_) : "") << std::endl;
+    return true;
+}
+
+FrameEncoder* PublisherShard::AddEncoder(WireFormat format) {
+    encoders_.push_back(std::make_unique<FrameEncoder>(format));
+    encoders_.back()->SetEgressStamp(egress_stamp_);
+    return encoders_.back().get();
+}
+
+void PublisherShard::Publish(const TickData& tick_data) {
+    if (!running_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    
+    // Never blocks the worker; a full ring means the publisher is behind
+    if (!tick_ring_->TryPush(tick_data)) {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PublisherShard::PublishSnapshots(uint64_t sample_time, std::vector<L1Snapshot>&& snapshots) {
+    if (!running_.load()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    
+    // A newer grid point supersedes the oldest unsent one
+    if (snapshot_queue_.size() >= MAX_SNAPSHOT_BATCHES) {
+        snapshot_queue_.pop();
+        dropped_count_.fetch_add(1);
+    }
+    
+    snapshot_queue_.emplace(sample_time, std::move(snapshots));
+    snapshots_pending_.store(true, std::memory_order_release);
+}
+
+void PublisherShard::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    
+    running_.store(false);
+    
+    if (publishing_thread_.joinable()) {
+        publishing_thread_.join();
+    }
+    
+    // Sinks drain what the final flush queued before closing their sockets
+    for (auto& sink : sinks_) {
+        sink->Stop();
+    }
+    
+    std::cout << "Publisher shard " << shard_index_ << " stopped. Published " << published_count_.load()
+              << " messages in " << batch_count_.load() << " batches, pruned " << pruned_count_.load() << std::endl;
+}
+
+bool PublisherShard::IsSubscribed(wire::TopicClass topic_class, uint16_t stock_locate) const {
+    if (!prune_unsubscribed_) {
+        return true;
+    }
+    
+    for (const auto& sink : sinks_) {
+        if (sink->IsSubscribed(topic_class, stock_locate)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PublisherShard::IsConflationEnabled() const {
+    return !conflated_sinks_.empty();
+}
+
+std::vector<ConflationStats> PublisherShard::GetConflationStats() const {
+    if (conflated_sinks_.size() == 1) {
+        return conflated_sinks_[0]->GetConflationStats();
+    }
+    
+    // Several conflated sinks: sum per symbol
+    std::vector<ConflationStats> merged;
+    for (const PublisherSink* sink : conflated_sinks_) {
+        for (const ConflationStats& stats : sink->GetConflationStats()) {
+            auto it = std::find_if(merged.begin(), merged.end(), [&](const ConflationStats& m) {
+                return m.stock_locate == stats.stock_locate;
+            });
+            if (it == merged.end()) {
+                merged.push_back(stats);
+            } else {
+                it->updates_in += stats.updates_in;
+                it->updates_out += stats.updates_out;
+            }
+        }
+    }
+    return merged;
+}
+
+uint64_t PublisherShard::GetConflatedIn() const {
+    uint64_t updates_in = 0;
+    for (const PublisherSink* sink : conflated_sinks_) {
+        updates_in += sink->GetConflatedIn();
+    }
+    return updates_in;
+}
+
+uint64_t PublisherShard::GetConflatedOut() const {
+    uint64_t updates_out = 0;
+    for (const PublisherSink* sink : conflated_sinks_) {
+        updates_out += sink->GetConflatedOut();
+    }
+    return updates_out;
+}
+
+std::vector<EncoderStats> PublisherShard::GetEncoderStats() const {
+    std::vector<EncoderStats> stats;
+    for (const auto& encoder : encoders_) {
+        MergeEncoderStats(stats, encoder->GetStats());
+    }
+    return stats;
+}
+
+std::vector<PublisherSinkStats> PublisherShard::GetSinkStats() const {
+    std::vector<PublisherSinkStats> stats;
+    for (const auto& sink : sinks_) {
+        stats.push_back(sink->GetStats());
+    }
+    return stats;
+}
+
+void PublisherShard::PublishingLoop() {
+    PinThreadToCore(cpu_core_);
+    if (latency_tracker_) {
+        latency_ = latency_tracker_->RegisterThread();
+    }
+    if (trace_recorder_) {
+        trace_ = trace_recorder_->RegisterThread("publisher-" + std::to_string(shard_index_));
+    }
+    if (perf_counters_) {
+        perf_ = perf_counters_->RegisterThread();
+    }
+    AdaptiveBackoff backoff;
+    
+    while (running_.load(std::memory_order_relaxed)) {
+        bool progressed = DrainTicks();
+        
+        if (snapshots_pending_.load(std::memory_order_acquire)) {
+            DrainSnapshots();
+            progressed = true;
+        }
+        
+        // Ship a full batch at once; a partial one waits at most linger_ns_
+        if (!pending_.empty() &&
+            (pending_.size() >= batch_size_ || FastClock::NowNanos() - pending_since_ns_ >= linger_ns_)) {
+            FlushBatch();
+            progressed = true;
+        }
+        
+        if (progressed) {
+            backoff.Reset();
+        } else {
+            backoff.Idle();
+        }
+    }
+    
+    // Whatever workers handed off before the stop still goes out
+    do {
+        FlushBatch();
+    } while (DrainTicks());
+    DrainSnapshots();
+}
+
+bool PublisherShard::DrainTicks() {
+    size_t drained = 0;
+    TickData tick_data;
+    
+    while (pending_.size() < batch_size_ && tick_ring_->TryPop(tick_data)) {
+        if (pending_.empty()) {
+            pending_since_ns_ = FastClock::NowNanos();
+        }
+        pending_.push_back(tick_data);
+        drained++;
+    }
+    
+    return drained > 0;
+}
+
+void PublisherShard::DrainSnapshots() {
+    std::vector<std::pair<uint64_t, std::vector<L1Snapshot>>> snapshot_batches;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        while (!snapshot_queue_.empty()) {
+            snapshot_batches.push_back(std::move(snapshot_queue_.front()));
+            snapshot_queue_.pop();
+        }
+        snapshots_pending_.store(false, std::memory_order_relaxed);
+    }
+    
+    // One message per symbol so subscribers can filter a grid point by topic
+    for (const auto& snapshot_batch : snapshot_batches) {
+        for (const L1Snapshot& snapshot : snapshot_batch.second) {
+            bool wanted = false;
+            
+            for (EncodedStream& stream : streams_) {
+                frames_.clear();
+                for (PublisherSink* sink : stream.snapshot_sinks) {
+                    if (prune_unsubscribed_ && !sink->IsSubscribed(wire::kTopicSnapshots, snapshot.stock_locate)) {
+                        continue;
+                    }
+                    if (frames_.empty()) {
+                        stream.encoder->EncodeSnapshot(snapshot_batch.first, snapshot, frames_);
+                    }
+                    sink->Enqueue(frames_);
+                    wanted = true;
+                }
+            }
+            
+            if (!wanted) {
+                pruned_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+            
+            if (last_values_) {
+                last_values_->ApplySnapshot(snapshot_batch.first, snapshot,
+                                            streams_[0].encoder->GetSnapshotSequence(snapshot.stock_locate));
+            }
+        }
+    }
+}
+
+void PublisherShard::FlushBatch() {
+    if (pending_.empty()) {
+        return;
+    }
+    
+    size_t count = pending_.size();
+    bool perf_sample = perf_ && perf_->Sample();
+    if (perf_sample) {
+        perf_->Begin();
+    }
+    uint64_t flush_start_ns = FastClock::NowNanos();
+    bool tracing = trace_ && trace_->IsEnabled();
+    if (tracing) {
+        trace_->Mark(kTraceQueueDepth, flush_start_ns, tick_ring_->SizeApprox());
+    }
+    
+    if (latency_) {
+        // Ticks without an ingest stamp did not come through a worker
+        for (const TickData& tick : pending_) {
+            if (tick.ingest_time_ns != 0) {
+                latency_->Record(kStageQueueWait, flush_start_ns - tick.ingest_time_ns);
+            }
+        }
+    }
+    
+    if (load_shedder_ && load_shedder_->IsEnabled()) {
+        uint64_t now_ns = flush_start_ns;
+        auto live_end = std::remove_if(pending_.begin(), pending_.end(), [&](const TickData& tick) {
+            return !load_shedder_->Admit(kHandoffPublish, tick.ingest_time_ns, now_ns);
+        });
+        count = static_cast<size_t>(live_end - pending_.begin());
+        if (tracing && count < pending_.size()) {
+            trace_->Mark(kTraceShed, flush_start_ns, pending_.size() - count);
+        }
+    }
+    
+    // Group by symbol, keeping each symbol's ticks in arrival order, so every
+    // message carries a single topic
+    std::stable_sort(pending_.begin(), pending_.begin() + count, [](const TickData& a, const TickData& b) {
+        return a.stock_locate < b.stock_locate;
+    });
+    
+    size_t run_start = 0;
+    while (run_start < count) {
+        uint16_t stock_locate = pending_[run_start].stock_locate;
+        size_t run_end = run_start + 1;
+        while (run_end < count && pending_[run_end].stock_locate == stock_locate) {
+            run_end++;
+        }
+        
+        const TickData* run = &pending_[run_start];
+        size_t run_length = run_end - run_start;
+        bool wanted = false;
+        uint64_t send_start_ns = (latency_ || tracing) ? FastClock::NowNanos() : 0;
+        
+        for (PublisherSink* sink : conflated_sinks_) {
+            if (!prune_unsubscribed_ || sink->IsSubscribed(wire::kTopicTicks, stock_locate)) {
+                sink->Conflate(run, run_length);
+                wanted = true;
+            }
+        }
+        
+        // Encode once per format, only if some sink of that format wants the symbol
+        for (EncodedStream& stream : streams_) {
+            frames_.clear();
+            for (PublisherSink* sink : stream.tick_sinks) {
+                if (prune_unsubscribed_ && !sink->IsSubscribed(wire::kTopicTicks, stock_locate)) {
+                    continue;
+                }
+                if (frames_.empty()) {
+                    stream.encoder->EncodeTicks(run, run_length, frames_);
+                }
+                // A full sink queue is counted as that sink's drop
+                sink->Enqueue(frames_);
+                wanted = true;
+            }
+        }
+        
+        if (wanted) {
+            published_count_.fetch_add(run_length, std::memory_order_relaxed);
+            if (latency_ || tracing) {
+                uint64_t sent_ns = FastClock::NowNanos();
+                uint64_t oldest_ingest_ns = sent_ns;
+                for (size_t i = 0; i < run_length; ++i) {
+                    if (run[i].ingest_time_ns != 0) {
+                        oldest_ingest_ns = std::min(oldest_ingest_ns, run[i].ingest_time_ns);
+                        if (latency_) {
+                            latency_->Record(kStageTotal, sent_ns - run[i].ingest_time_ns);
+                        }
+                    }
+                }
+                if (latency_) {
+                    latency_->Record(kStageSend, sent_ns - send_start_ns);
+                }
+                if (tracing) {
+                    trace_->Span(kTraceSend, send_start_ns, sent_ns, stock_locate);
+                    trace_->CheckLatency(sent_ns - oldest_ingest_ns, sent_ns);
+                }
+            }
+        } else {
+            pruned_count_.fetch_add(run_length, std::memory_order_relaxed);
+        }
+        
+        // Pruned runs still update the cache; the sequence stays at the last
+        // message sent, and anything sent later is newer than the cached value
+        if (last_values_) {
+            last_values_->ApplyTicks(run, run_length, streams_[0].encoder->GetTickSequence(stock_locate));
+        }
+        
+        run_start = run_end;
+    }
+    
+    batch_count_.fetch_add(1, std::memory_order_relaxed);
+    pending_.clear();
+    
+    if (perf_sample) {
+        perf_->End(kPerfSend, count);
+    }
+    if (tracing) {
+        trace_->Span(kTraceFlush, flush_start_ns, FastClock::NowNanos(), count);
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,508 @@
+#include "PublisherSink.h"
+#include "LoadShedder.h"
+#include "FastClock.h"
+#include "WireFormat.h"
+#include "CompactFormat.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+namespace tickshaper {
+
+bool PinThreadToCore(int cpu_core) {
+    if (cpu_core < 0) {
+        return true;
+    }
+    
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu_core, &cpuset);
+    
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0) {
+        std::cerr << "Failed to bind publisher thread to CPU " << cpu_core << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const char* WireFormatName(WireFormat format) {
+    switch (format) {
+        case WireFormat::kJson: return "json";
+        case WireFormat::kCompact: return "compact";
+        default: return "binary";
+    }
+}
+
+bool ParseWireFormat(const std::string& name, WireFormat& format) {
+    if (name == "binary") {
+        format = WireFormat::kBinary;
+    } else if (name == "json") {
+        format = WireFormat::kJson;
+    } else if (name == "compact") {
+        format = WireFormat::kCompact;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void MergeEncoderStats(std::vector<EncoderStats>& merged, const EncoderStats& stats) {
+    auto it = std::find_if(merged.begin(), merged.end(), [&](const EncoderStats& m) {
+        return m.format == stats.format;
+    });
+    if (it == merged.end()) {
+        merged.push_back(stats);
+        return;
+    }
+    it->batches += stats.batches;
+    it->ticks += stats.ticks;
+    it->raw_bytes += stats.raw_bytes;
+    it->encoded_bytes += stats.encoded_bytes;
+    it->encode_ns += stats.encode_ns;
+    it->pooled_frames += stats.pooled_frames;
+    it->copied_frames += stats.copied_frames;
+}
+
+FrameEncoder::FrameEncoder(WireFormat format)
+    : format_(format), egress_stamp_(false), tick_sequence_(65536, 0), snapshot_sequence_(65536, 0) {
+}
+
+size_t FrameEncoder::MaxTicksPerFrame() {
+    // A binary batch must fit in one pooled buffer, stamped or not, and in the u16 record count
+    return std::min<size_t>((BufferPool::BUFFER_SIZE - sizeof(wire::MessageHeader) - sizeof(wire::EgressStamp)) /
+                            sizeof(wire::TickRecord), UINT16_MAX);
+}
+
+void FrameEncoder::AppendTopic(wire::TopicClass topic_class, uint16_t stock_locate, std::vector<SinkFrame>& frames) {
+    uint8_t topic[wire::kTopicSize];
+    wire::EncodeTopic(topic, topic_class, stock_locate);
+    
+    frames.emplace_back();
+    frames.back().message.rebuild(topic, sizeof(topic));
+    frames.back().more = true;
+}
+
+void FrameEncoder::EncodeTicks(const TickData* ticks, size_t count, std::vector<SinkFrame>& frames) {
+    uint64_t start_ns = FastClock::NowNanos();
+    uint16_t stock_locate = ticks[0].stock_locate;
+    size_t first_frame = frames.size();
+    AppendTopic(wire::kTopicTicks, stock_locate, frames);
+    
+    EncodeTickPayload(ticks, count, frames);
+    
+    // Topic frames are the same in every format, so only payloads are counted
+    size_t encoded_bytes = 0;
+    for (size_t i = first_frame + 1; i < frames.size(); ++i) {
+        encoded_bytes += frames[i].message.size();
+    }
+    
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    ticks_.fetch_add(count, std::memory_order_relaxed);
+    raw_bytes_.fetch_add(sizeof(wire::MessageHeader) + count * sizeof(wire::TickRecord), std::memory_order_relaxed);
+    encoded_bytes_.fetch_add(encoded_bytes, std::memory_order_relaxed);
+    encode_ns_.fetch_add(FastClock::NowNanos() - start_ns, std::memory_order_relaxed);
+}
+
+void FrameEncoder::EncodeTickPayload(const TickData* ticks, size_t count, std::vector<SinkFrame>& frames) {
+    uint16_t stock_locate = ticks[0].stock_locate;
+    
+    if (format_ == WireFormat::kCompact) {
+        // Variable size and usually a few hundred bytes: encode in place, then copy
+        scratch_.resize(wire::MaxCompactBatchSize(count) + sizeof(wire::EgressStamp));
+        uint8_t* begin = reinterpret_cast<uint8_t*>(&scratch_[0]);
+        uint8_t* end = wire::EncodeCompactTicks(begin, ticks, count, ++tick_sequence_[stock_locate]);
+        if (egress_stamp_) {
+            uint64_t ingest_ns, egress_ns;
+            StampEgress(ticks, count, ingest_ns, egress_ns);
+            end = wire::AppendEgressStamp(begin, end, ingest_ns, egress_ns);
+        }
+        
+        frames.emplace_back();
+        frames.back().message.rebuild(begin, static_cast<size_t>(end - begin));
+        frames.back().tick_count = static_cast<uint16_t>(count);
+        copied_frames_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    if (format_ == WireFormat::kJson) {
+        // One tick per part; ZMQ delivers the parts atomically
+        uint64_t egress_ns = egress_stamp_ ? FastClock::ToRealtime(FastClock::NowNanos()) : 0;
+        for (size_t i = 0; i < count; ++i) {
+            SerializeTickData(ticks[i], ++tick_sequence_[stock_locate], egress_ns, scratch_);
+            frames.emplace_back();
+            frames.back().message.rebuild(scratch_.data(), scratch_.size());
+            frames.back().more = (i + 1 < count);
+            frames.back().tick_count = 1;
+        }
+        copied_frames_.fetch_add(count, std::memory_order_relaxed);
+        return;
+    }
+    
+    size_t length = sizeof(wire::MessageHeader) + count * sizeof(wire::TickRecord) +
+                    (egress_stamp_ ? sizeof(wire::EgressStamp) : 0);
+    uint8_t* buffer = (length >= ZERO_COPY_MIN_BYTES) ? buffer_pool_.Acquire() : nullptr;
+    
+    // Small payload, or every pooled buffer is still queued inside ZMQ: copy
+    if (!buffer) {
+        scratch_.resize(length);
+    }
+    
+    uint8_t* begin = buffer ? buffer : reinterpret_cast<uint8_t*>(&scratch_[0]);
+    uint8_t* cursor = wire::EncodeHeader(begin, wire::kTickBatch, static_cast<uint16_t>(count),
+                                         sizeof(wire::TickRecord), ++tick_sequence_[stock_locate]);
+    for (size_t i = 0; i < count; ++i) {
+        cursor = wire::EncodeTick(cursor, ticks[i]);
+    }
+    if (egress_stamp_) {
+        uint64_t ingest_ns, egress_ns;
+        StampEgress(ticks, count, ingest_ns, egress_ns);
+        wire::AppendEgressStamp(begin, cursor, ingest_ns, egress_ns);
+    }
+    
+    frames.emplace_back();
+    if (buffer) {
+        // ZMQ owns the buffer until the last sink has sent it, then hands it back
+        zmq::message_t message(buffer, length, &BufferPool::Release, &buffer_pool_);
+        frames.back().message = std::move(message);
+        pooled_frames_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        frames.back().message.rebuild(scratch_.data(), length);
+        copied_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+    frames.back().tick_count = static_cast<uint16_t>(count);
+}
+
+void FrameEncoder::EncodeSnapshot(uint64_t sample_time, const L1Snapshot& snapshot, std::vector<SinkFrame>& frames) {
+    AppendTopic(wire::kTopicSnapshots, snapshot.stock_locate, frames);
+    uint64_t sequence = ++snapshot_sequence_[snapshot.stock_locate];
+    
+    // Snapshots are already one small record; compact streams send them as binary
+    if (format_ != WireFormat::kJson) {
+        scratch_.resize(sizeof(wire::MessageHeader) + sizeof(uint64_t) + sizeof(wire::SnapshotRecord));
+        uint8_t* cursor = reinterpret_cast<uint8_t*>(&scratch_[0]);
+        cursor = wire::EncodeHeader(cursor, wire::kSnapshotBatch, 1, sizeof(wire::SnapshotRecord), sequence);
+        
+        uint64_t sample_time_le = htole64(sample_time);
+        memcpy(cursor, &sample_time_le, sizeof(sample_time_le));
+        cursor += sizeof(sample_time_le);
+        
+        wire::EncodeSnapshot(cursor, snapshot);
+    } else {
+        std::ostringstream oss;
+        oss << "{"
+            << "\"sequence\":" << sequence << ","
+            << "\"sample_time\":" << sample_time << ","
+            << "\"snapshots\":[{"
+            << "\"stock_locate\":" << snapshot.stock_locate << ","
+            << "\"symbol_id\":" << snapshot.symbol_id << ","
+            << "\"bid_price\":" << snapshot.quote.bid_price << ","
+            << "\"bid_size\":" << snapshot.quote.bid_size << ","
+            << "\"ask_price\":" << snapshot.quote.ask_price << ","
+            << "\"ask_size\":" << snapshot.quote.ask_size
+            << "}]}";
+        scratch_ = oss.str();
+    }
+    
+    frames.emplace_back();
+    frames.back().message.rebuild(scratch_.data(), scratch_.size());
+}
+
+EncoderStats FrameEncoder::GetStats() const {
+    EncoderStats stats;
+    stats.format = WireFormatName(format_);
+    stats.batches = batches_.load();
+    stats.ticks = ticks_.load();
+    stats.raw_bytes = raw_bytes_.load();
+    stats.encoded_bytes = encoded_bytes_.load();
+    stats.encode_ns = encode_ns_.load();
+    stats.pooled_frames = pooled_frames_.load();
+    stats.copied_frames = copied_frames_.load();
+    return stats;
+}
+
+void FrameEncoder::StampEgress(const TickData* ticks, size_t count, uint64_t& ingest_ns, uint64_t& egress_ns) {
+    uint64_t oldest_ns = UINT64_MAX;
+    for (size_t i = 0; i < count; ++i) {
+        if (ticks[i].ingest_time_ns != 0) {
+            oldest_ns = std::min(oldest_ns, ticks[i].ingest_time_ns);
+        }
+    }
+    
+    // Ticks that never went through a worker have no ingest time; report 0
+    ingest_ns = oldest_ns != UINT64_MAX ? FastClock::ToRealtime(oldest_ns) : 0;
+    egress_ns = FastClock::ToRealtime(FastClock::NowNanos());
+}
+
+void FrameEncoder::SerializeTickData(const TickData& tick_data, uint64_t sequence, uint64_t egress_ns,
+                                     std::string& out) {
+    // Simple JSON serialization
+    std::ostringstream oss;
+    oss << "{"
+        << "\"sequence\":" << sequence << ","
+        << "\"timestamp\":" << tick_data.timestamp << ","
+        << "\"symbol_id\":" << tick_data.symbol_id << ","
+        << "\"price\":" << tick_data.price << ","
+        << "\"size\":" << tick_data.size << ","
+        << "\"side\":\"" << tick_data.side << "\","
+        << "\"message_type\":\"" << static_cast<char>(tick_data.message_type) << "\","
+        << "\"stock_locate\":" << tick_data.stock_locate;
+    if (egress_ns != 0) {
+        oss << ",\"ingest_ns\":" << (tick_data.ingest_time_ns ? FastClock::ToRealtime(tick_data.ingest_time_ns) : 0)
+            << ",\"egress_ns\":" << egress_ns;
+    }
+    oss << "}";
+    
+    out = oss.str();
+}
+
+PublisherSink::PublisherSink(zmq::context_t& context, const SinkOptions& options)
+    : options_(options), socket_(context, ZMQ_XPUB), queue_(options.queue_capacity),
+      encoder_(nullptr), batch_size_(1), load_shedder_(nullptr), discarding_(false), in_message_(false),
+      cpu_core_(-1) {
+}
+
+PublisherSink::~PublisherSink() {
+    Stop();
+}
+
+bool PublisherSink::Initialize(FrameEncoder* encoder, size_t batch_size, LoadShedder* load_shedder) {
+    encoder_ = encoder;
+    batch_size_ = batch_size;
+    load_shedder_ = load_shedder;
+    batch_.reserve(batch_size_);
+    
+    try {
+        int hwm = options_.send_hwm;
+        socket_.setsockopt(ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        
+        // Refuse instead of silently dropping at the HWM, so drops are counted
+        int nodrop = 1;
+        socket_.setsockopt(ZMQ_XPUB_NODROP, &nodrop, sizeof(nodrop));
+        
+        socket_.bind(options_.endpoint);
+        return true;
+        
+    } catch (const zmq::error_t& e) {
+        std::cerr << "ZMQ sink " << options_.endpoint << " failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void PublisherSink::Start(int cpu_core) {
+    cpu_core_ = cpu_core;
+    running_.store(true);
+    send_thread_ = std::thread([this]() { SendLoop(); });
+}
+
+void PublisherSink::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    
+    running_.store(false);
+    
+    if (send_thread_.joinable()) {
+        send_thread_.join();
+    }
+    
+    socket_.close();
+}
+
+bool PublisherSink::Enqueue(std::vector<SinkFrame>& frames) {
+    // Only producer, so the free estimate is a lower bound
+    if (queue_.FreeApprox() < frames.size()) {
+        queue_drops_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    for (SinkFrame& frame : frames) {
+        SinkFrame shared;
+        shared.message.copy(frame.message);
+        shared.more = frame.more;
+        shared.tick_count = frame.tick_count;
+        queue_.TryPush(std::move(shared));
+    }
+    return true;
+}
+
+void PublisherSink::Conflate(const TickData* ticks, size_t count) {
+    std::lock_guard<InstrumentedMutex> lock(conflator_mutex_);
+    for (size_t i = 0; i < count; ++i) {
+        conflator_.Update(ticks[i]);
+    }
+}
+
+PublisherSinkStats PublisherSink::GetStats() const {
+    PublisherSinkStats stats;
+    stats.endpoint = options_.endpoint;
+    stats.format = WireFormatName(options_.format);
+    if (options_.conflated) {
+        stats.format += "/conflated";
+    }
+    stats.messages_sent = messages_sent_.load();
+    stats.ticks_sent = ticks_sent_.load();
+    stats.queue_drops = queue_drops_.load();
+    stats.hwm_drops = hwm_drops_.load();
+    stats.pruned = pruned_.load();
+    stats.queue_depth = queue_.SizeApprox();
+    return stats;
+}
+
+std::vector<ConflationStats> PublisherSink::GetConflationStats() const {
+    std::lock_guard<InstrumentedMutex> lock(conflator_mutex_);
+    return conflator_.GetSymbolStats();
+}
+
+uint64_t PublisherSink::GetConflatedIn() const {
+    std::lock_guard<InstrumentedMutex> lock(conflator_mutex_);
+    return conflator_.GetUpdatesIn();
+}
+
+uint64_t PublisherSink::GetConflatedOut() const {
+    std::lock_guard<InstrumentedMutex> lock(conflator_mutex_);
+    return conflator_.GetUpdatesOut();
+}
+
+void PublisherSink::SendLoop() {
+    PinThreadToCore(cpu_core_);
+    AdaptiveBackoff backoff;
+    
+    while (running_.load(std::memory_order_relaxed)) {
+        bool progressed = PollSubscriptions();
+        progressed |= SendQueued();
+        if (options_.conflated) {
+            progressed |= SendConflated();
+        }
+        
+        if (progressed) {
+            backoff.Reset();
+        } else {
+            backoff.Idle();
+        }
+    }
+    
+    // The publisher has stopped feeding us; send what is already queued
+    while (SendQueued()) {
+    }
+    while (options_.conflated && SendConflated()) {
+    }
+}
+
+bool PublisherSink::PollSubscriptions() {
+    bool changed = false;
+    zmq::message_t message;
+    
+    // XPUB reports (un)subscriptions as inbound messages on the publishing socket
+    try {
+        while (socket_.recv(message, zmq::recv_flags::dontwait)) {
+            subscriptions_.Apply(static_cast<const uint8_t*>(message.data()), message.size());
+            changed = true;
+        }
+    } catch (const zmq::error_t& e) {
+        if (e.num() != EAGAIN) {
+            std::cerr << "ZMQ subscription error on " << options_.endpoint << ": " << e.what() << std::endl;
+        }
+    }
+    
+    return changed;
+}
+
+bool PublisherSink::SendQueued() {
+    size_t sent = 0;
+    SinkFrame frame;
+    
+    // Bounded so subscriptions and conflated output still get a turn
+    while (sent < batch_size_ && queue_.TryPop(frame)) {
+        SendFrame(frame);
+        sent++;
+    }
+    
+    return sent > 0;
+}
+
+bool PublisherSink::SendConflated() {
+    {
+        std::lock_guard<InstrumentedMutex> lock(conflator_mutex_);
+        if (conflator_.GetPendingCount() == 0) {
+            return false;
+        }
+        batch_.clear();
+        conflator_.Drain(batch_, batch_size_);
+    }
+    
+    // The slot holds the symbol's latest value; if even that is stale, drop it
+    if (load_shedder_ && load_shedder_->IsEnabled()) {
+        uint64_t now_ns = FastClock::NowNanos();
+        batch_.erase(std::remove_if(batch_.begin(), batch_.end(), [&](const TickData& tick) {
+            return !load_shedder_->Admit(kHandoffConflation, tick.ingest_time_ns, now_ns);
+        }), batch_.end());
+    }
+    
+    std::stable_sort(batch_.begin(), batch_.end(), [](const TickData& a, const TickData& b) {
+        return a.stock_locate < b.stock_locate;
+    });
+    
+    size_t run_start = 0;
+    while (run_start < batch_.size()) {
+        uint16_t stock_locate = batch_[run_start].stock_locate;
+        size_t run_end = run_start + 1;
+        while (run_end < batch_.size() && batch_[run_end].stock_locate == stock_locate) {
+            run_end++;
+        }
+        
+        if (!subscriptions_.IsSubscribed(wire::kTopicTicks, stock_locate)) {
+            pruned_.fetch_add(run_end - run_start, std::memory_order_relaxed);
+        } else {
+            frames_.clear();
+            encoder_->EncodeTicks(&batch_[run_start], run_end - run_start, frames_);
+            for (SinkFrame& frame : frames_) {
+                SendFrame(frame);
+            }
+        }
+        
+        run_start = run_end;
+    }
+    
+    return true;
+}
+
+bool PublisherSink::SendFrame(SinkFrame& frame) {
+    bool first = !in_message_;
+    in_message_ = frame.more;
+    
+    // The rest of a message whose first part was refused
+    if (discarding_) {
+        discarding_ = frame.more;
+        return false;
+    }
+    
+    try {
+        zmq::send_flags flags = zmq::send_flags::dontwait;
+        if (frame.more) {
+            flags = flags | zmq::send_flags::sndmore;
+        }
+        
+        if (!socket_.send(frame.message, flags)) {
+            // Only the first part can be refused; drop the whole message
+            hwm_drops_.fetch_add(first ? 1 : 0, std::memory_order_relaxed);
+            discarding_ = frame.more;
+            return false;
+        }
+        
+        ticks_sent_.fetch_add(frame.tick_count, std::memory_order_relaxed);
+        if (!frame.more) {
+            messages_sent_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+        
+    } catch (const zmq::error_t& e) {
+        std::cerr << "ZMQ send error on " << options_.endpoint << ": " << e.what() << std::endl;
+        discarding_ = frame.more;
+        return false;
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "ReplayFile.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace tickshaper {
+
+ReplayFile::ReplayFile() 
+    : fd_(-1), data_(nullptr), size_(0), message_count_(0), first_time_(0), last_time_(0) {
+}
+
+ReplayFile::~ReplayFile() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool ReplayFile::Open(const std::string& filename) {
+    filename_ = filename;
+    fd_ = open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Replay file not found: " << filename << std::endl;
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+        std::cerr << "Replay file is empty: " << filename << std::endl;
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    
+    // Read-only and shared: every cursor, and every process replaying the
+    // same file, is served from the same page cache pages
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map replay file: " << filename << std::endl;
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+    
+    auto start = std::chrono::steady_clock::now();
+    madvise(mapping, size_, MADV_SEQUENTIAL);
+    BuildIndex();
+    
+    // Cursors run at different positions, so drop the read-ahead hint
+    madvise(mapping, size_, MADV_NORMAL);
+    
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Replay file " << filename << " mapped: " << size_ << " bytes, " << message_count_
+              << " messages, " << symbols_.GetSymbolCount() << " symbols, " << checkpoints_.size()
+              << " checkpoints, indexed in " << elapsed_ms << " ms" << std::endl;
+    return true;
+}
+
+void ReplayFile::BuildIndex() {
+    std::vector<bool> named(65536, false);
+    uint64_t offset = 0;
+    MappedMessage message;
+    
+    while (ReadAt(offset, message)) {
+        if (message_count_ % INDEX_STRIDE == 0) {
+            checkpoints_.push_back({offset, message.timestamp});
+        }
+        if (message_count_ == 0) {
+            first_time_ = message.timestamp;
+        }
+        last_time_ = std::max(last_time_, message.timestamp);
+        
+        // Directory first; files without one are named by their first add order
+        uint16_t stock_locate = static_cast<uint16_t>((message.body[0] << 8) | message.body[1]);
+        if (!named[stock_locate]) {
+            if (message.message_type == 'R' && message.body_size >= DIRECTORY_STOCK_OFFSET + 8) {
+                symbols_.GetSymbolId(ReadStock(message.body + DIRECTORY_STOCK_OFFSET));
+                named[stock_locate] = true;
+            } else if ((message.message_type == 'A' || message.message_type == 'F') &&
+                       message.body_size >= ADD_ORDER_STOCK_OFFSET + 8) {
+                symbols_.GetSymbolId(ReadStock(message.body + ADD_ORDER_STOCK_OFFSET));
+                named[stock_locate] = true;
+            }
+        }
+        
+        message_count_++;
+        offset = message.next_offset;
+    }
+    
+    if (offset != size_) {
+        std::cerr << "Replay file " << filename_ << " ends in a truncated message at byte " << offset << std::endl;
+    }
+}
+
+bool ReplayFile::ReadAt(uint64_t offset, MappedMessage& message) const {
+    // Length (u16, big-endian, counts the type byte) | type | body
+    if (offset + 3 > size_) {
+        return false;
+    }
+    
+    uint16_t length = static_cast<uint16_t>((data_[offset] << 8) | data_[offset + 1]);
+    if (length == 0 || offset + 2 + length > size_) {
+        return false;
+    }
+    
+    message.message_type = data_[offset + 2];
+    message.body = data_ + offset + 3;
+    message.body_size = static_cast<uint16_t>(length - 1);
+    message.timestamp = message.body_size >= COMMON_HEADER_SIZE ? ReadTimestamp(message.body) : 0;
+    message.next_offset = offset + 2 + length;
+    return message.body_size >= 2;  // Every ITCH message carries a stock locate
+}
+
+uint64_t ReplayFile::Seek(uint64_t itch_time, uint64_t& message_index) const {
+    if (checkpoints_.empty()) {
+        message_index = 0;
+        return 0;
+    }
+    
+    // Last checkpoint before itch_time, then walk the framing to the message
+    auto it = std::lower_bound(checkpoints_.begin(), checkpoints_.end(), itch_time,
+                               [](const Checkpoint& checkpoint, uint64_t time) {
+        return checkpoint.timestamp < time;
+    });
+    if (it != checkpoints_.begin()) {
+        --it;
+    }
+    
+    message_index = static_cast<uint64_t>(it - checkpoints_.begin()) * INDEX_STRIDE;
+    uint64_t offset = it->offset;
+    MappedMessage message;
+    while (ReadAt(offset, message) && message.timestamp < itch_time) {
+        offset = message.next_offset;
+        message_index++;
+    }
+    return offset;
+}
+
+uint64_t ReplayFile::ReadTimestamp(const uint8_t* body) {
+    const uint8_t* ts = body + TIMESTAMP_OFFSET;
+    return (static_cast<uint64_t>(ts[0]) << 40) | (static_cast<uint64_t>(ts[1]) << 32) |
+           (static_cast<uint64_t>(ts[2]) << 24) | (static_cast<uint64_t>(ts[3]) << 16) |
+           (static_cast<uint64_t>(ts[4]) << 8) | static_cast<uint64_t>(ts[5]);
+}
+
+std::string ReplayFile::ReadStock(const uint8_t* data) {
+    std::string stock(reinterpret_cast<const char*>(data), 8);
+    stock.erase(stock.find_last_not_of(' ') + 1);
+    return stock;
+}
+
+} // namespace tickshaper
\ No newline at end of file
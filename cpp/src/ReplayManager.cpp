@@ -0,0 +1,300 @@
+#include "ReplayManager.h"
+#include "FastClock.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+namespace tickshaper {
+
+bool ParseReplaySpec(const std::string& spec, ReplayOptions& options, std::string& error) {
+    std::istringstream in(spec);
+    in >> options.name >> options.endpoint;
+    if (options.name.empty() || options.endpoint.empty()) {
+        error = "expected <name> <endpoint> [options]";
+        return false;
+    }
+    
+    std::string option;
+    try {
+        while (in >> option) {
+            if (option == "bbo") {
+                options.top_of_book = true;
+            } else if (option == "cold") {
+                options.warmup = false;
+            } else if (option == "speed=max") {
+                options.speed = 0.0;
+            } else if (option.compare(0, 6, "speed=") == 0) {
+                options.speed = std::stod(option.substr(6));
+                if (options.speed <= 0.0) {
+                    error = "speed must be positive or max";
+                    return false;
+                }
+            } else if (option.compare(0, 5, "rate=") == 0) {
+                options.rate = static_cast<uint32_t>(std::stoul(option.substr(5)));
+            } else if (option.compare(0, 6, "start=") == 0) {
+                // HH:MM:SS with an optional decimal fraction of a second
+                int hours = 0;
+                int minutes = 0;
+                double seconds = 0.0;
+                char colon1 = 0;
+                char colon2 = 0;
+                std::istringstream time(option.substr(6));
+                if (!(time >> hours >> colon1 >> minutes >> colon2 >> seconds) || colon1 != ':' || colon2 != ':') {
+                    error = "start must be HH:MM:SS";
+                    return false;
+                }
+                options.start_time = (static_cast<uint64_t>(hours) * 3600 + static_cast<uint64_t>(minutes) * 60) *
+                                     1000000000ULL + static_cast<uint64_t>(seconds * 1e9);
+            } else if (!ParseWireFormat(option, options.format)) {
+                error = "unknown replay option: " + option;
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        error = "invalid number in: " + option;
+        return false;
+    }
+    return true;
+}
+
+ReplayCursor::ReplayCursor(const ReplayOptions& options, ReplayFile* file, SharedMemoryManager* shm_manager)
+    : options_(options), file_(file), raw_(0, 0, nullptr, 0),
+      anchor_wall_ns_(0), anchor_itch_ns_(0), anchored_(false) {
+    processor_.Initialize(shm_manager, &metrics_);
+    processor_.ShareSymbolTable(file_->GetSymbolTable());
+    if (options_.top_of_book) {
+        processor_.SetOutputMode(OutputMode::kTopOfBook);
+    }
+}
+
+ReplayCursor::~ReplayCursor() {
+    Stop();
+}
+
+bool ReplayCursor::Start(zmq::context_t& context) {
+    // The output is a shaping session over every symbol, so the replay's
+    // throttle, wire format and sink work like any other session's
+    SessionOptions session_options;
+    session_options.name = options_.name;
+    session_options.endpoint = options_.endpoint;
+    session_options.format = options_.format;
+    session_options.rate = options_.rate;
+    
+    output_ = std::make_unique<ShapingSession>(session_options);
+    if (!output_->Start(context)) {
+        return false;
+    }
+    
+    running_.store(true);
+    replay_thread_ = std::thread([this]() { ReplayLoop(); });
+    return true;
+}
+
+void ReplayCursor::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    
+    running_.store(false);
+    
+    if (replay_thread_.joinable()) {
+        replay_thread_.join();
+    }
+    
+    output_->Stop();
+}
+
+void ReplayCursor::ReplayLoop() {
+    uint64_t offset = 0;
+    uint64_t position = 0;
+    
+    // Without a warm-up the book starts empty at start_time, which suits
+    // trade-only consumers; the index makes the jump immediate
+    if (!options_.warmup && options_.start_time > 0) {
+        offset = file_->Seek(options_.start_time, position);
+    }
+    
+    ProcessorOutput output;
+    MappedMessage message;
+    
+    while (running_.load(std::memory_order_relaxed) && file_->ReadAt(offset, message)) {
+        offset = message.next_offset;
+        position_.store(++position, std::memory_order_relaxed);
+        
+        // Reuses the buffer's capacity: no allocation per message
+        raw_.message_type = message.message_type;
+        raw_.timestamp = message.timestamp;
+        raw_.data.assign(message.body, message.body + message.body_size);
+        
+        // Before start_time the book is built but nothing is published or paced
+        if (message.timestamp < options_.start_time) {
+            processor_.ProcessMessage(raw_, output);
+            continue;
+        }
+        
+        Pace(message.timestamp);
+        itch_time_.store(message.timestamp, std::memory_order_relaxed);
+        
+        if (processor_.ProcessMessage(raw_, output)) {
+            Publish(output);
+        }
+    }
+    
+    if (running_.load()) {
+        finished_.store(true);
+        std::cout << "Replay " << options_.name << " finished after " << position << " messages" << std::endl;
+    }
+}
+
+void ReplayCursor::Pace(uint64_t itch_time) {
+    if (options_.speed <= 0.0) {
+        return;
+    }
+    
+    if (!anchored_) {
+        anchor_wall_ns_ = FastClock::NowNanos();
+        anchor_itch_ns_ = itch_time;
+        anchored_ = true;
+        return;
+    }
+    
+    uint64_t itch_elapsed = itch_time > anchor_itch_ns_ ? itch_time - anchor_itch_ns_ : 0;
+    uint64_t due_ns = anchor_wall_ns_ + static_cast<uint64_t>(itch_elapsed / options_.speed);
+    
+    // Sleep in short slices so Stop() is never held up by a quiet stretch of the day
+    while (running_.load(std::memory_order_relaxed)) {
+        uint64_t now_ns = FastClock::NowNanos();
+        if (now_ns >= due_ns) {
+            break;
+        }
+        uint64_t wait_ns = std::min<uint64_t>(due_ns - now_ns, MAX_SLEEP_NS);
+        if (wait_ns > SPIN_NS) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns - SPIN_NS));
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ReplayCursor::Publish(ProcessorOutput& output) {
+    uint64_t ingest_time_ns = FastClock::NowNanos();
+    
+    for (size_t i = 0; i < output.count; ++i) {
+        output.ticks[i].ingest_time_ns = ingest_time_ns;
+        
+        // A replay is never live: wait for the session rather than drop
+        AdaptiveBackoff backoff;
+        while (!output_->TryOffer(output.ticks[i])) {
+            if (!running_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            backoff.Idle();
+        }
+    }
+    ticks_out_.fetch_add(output.count, std::memory_order_relaxed);
+}
+
+ReplayStats ReplayCursor::GetStats() const {
+    ReplayStats stats;
+    stats.name = options_.name;
+    stats.endpoint = options_.endpoint;
+    stats.speed = options_.speed;
+    stats.start_time = options_.start_time;
+    stats.position = position_.load();
+    stats.total_messages = file_->GetMessageCount();
+    stats.itch_time = itch_time_.load();
+    stats.ticks_out = ticks_out_.load();
+    stats.finished = finished_.load();
+    
+    SessionStats output_stats = output_ ? output_->GetStats() : SessionStats{};
+    stats.ticks_sent = output_stats.ticks_sent;
+    stats.throttled = output_stats.throttled;
+    return stats;
+}
+
+ReplayManager::ReplayManager() : context_(1), shm_manager_(nullptr) {
+}
+
+ReplayManager::~ReplayManager() {
+    StopAll();
+}
+
+void ReplayManager::Initialize(const std::string& filename, SharedMemoryManager* shm_manager) {
+    filename_ = filename;
+    shm_manager_ = shm_manager;
+}
+
+bool ReplayManager::CreateReplay(const ReplayOptions& options, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    for (const auto& cursor : cursors_) {
+        if (cursor->GetOptions().name == options.name) {
+            error = "replay " + options.name + " already exists";
+            return false;
+        }
+    }
+    if (cursors_.size() >= MAX_REPLAYS) {
+        error = "at most " + std::to_string(MAX_REPLAYS) + " replays";
+        return false;
+    }
+    
+    // Mapped and indexed once; every later replay starts from the same index
+    if (!file_) {
+        auto file = std::make_unique<ReplayFile>();
+        if (!file->Open(filename_)) {
+            error = "cannot map " + filename_;
+            return false;
+        }
+        file_ = std::move(file);
+    }
+    
+    auto cursor = std::make_unique<ReplayCursor>(options, file_.get(), shm_manager_);
+    if (!cursor->Start(context_)) {
+        error = "cannot bind " + options.endpoint;
+        return false;
+    }
+    
+    std::cout << "Replay " << options.name << " on " << options.endpoint
+              << " (" << WireFormatName(options.format) << (options.top_of_book ? "/bbo" : "") << ")"
+              << " speed " << (options.speed > 0.0 ? std::to_string(options.speed) + "x" : std::string("max"))
+              << " from " << options.start_time << " ns"
+              << (options.warmup ? "" : " (cold)")
+              << " rate " << (options.rate ? std::to_string(options.rate) + "/s" : std::string("unlimited")) << std::endl;
+    cursors_.push_back(std::move(cursor));
+    return true;
+}
+
+bool ReplayManager::RemoveReplay(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = std::find_if(cursors_.begin(), cursors_.end(), [&](const std::unique_ptr<ReplayCursor>& cursor) {
+        return cursor->GetOptions().name == name;
+    });
+    if (it == cursors_.end()) {
+        return false;
+    }
+    
+    // Only the cursor's own threads touch it, so it can go right away
+    cursors_.erase(it);
+    std::cout << "Replay " << name << " removed" << std::endl;
+    return true;
+}
+
+void ReplayManager::StopAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& cursor : cursors_) {
+        cursor->Stop();
+    }
+}
+
+std::vector<ReplayStats> ReplayManager::GetReplayStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::vector<ReplayStats> stats;
+    for (const auto& cursor : cursors_) {
+        stats.push_back(cursor->GetStats());
+    }
+    return stats;
+}
+
+} // namespace tickshaper
\ No newline at end of file
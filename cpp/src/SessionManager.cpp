@@ -0,0 +1,331 @@
+#include "SessionManager.h"
+#include "WireFormat.h"
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+
+namespace tickshaper {
+
+bool ParseSessionSpec(const std::string& spec, SessionOptions& options, std::string& error) {
+    std::istringstream in(spec);
+    in >> options.name >> options.endpoint;
+    if (options.name.empty() || options.endpoint.empty()) {
+        error = "expected <name> <endpoint> [options]";
+        return false;
+    }
+    
+    std::string option;
+    try {
+        while (in >> option) {
+            if (option == "conflate") {
+                options.conflate = true;
+            } else if (option.compare(0, 5, "rate=") == 0) {
+                options.rate = static_cast<uint32_t>(std::stoul(option.substr(5)));
+            } else if (option.compare(0, 8, "symbols=") == 0) {
+                std::istringstream locates(option.substr(8));
+                std::string locate;
+                while (std::getline(locates, locate, ',')) {
+                    unsigned long value = std::stoul(locate);
+                    if (value > 0xFFFF) {
+                        error = "stock_locate out of range: " + locate;
+                        return false;
+                    }
+                    options.stock_locates.push_back(static_cast<uint16_t>(value));
+                }
+            } else if (!ParseWireFormat(option, options.format)) {
+                error = "unknown session option: " + option;
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        error = "invalid number in: " + option;
+        return false;
+    }
+    
+    std::sort(options.stock_locates.begin(), options.stock_locates.end());
+    options.stock_locates.erase(std::unique(options.stock_locates.begin(), options.stock_locates.end()),
+                                options.stock_locates.end());
+    return true;
+}
+
+ShapingSession::ShapingSession(const SessionOptions& options)
+    : options_(options), all_symbols_(options.stock_locates.empty()), filter_(65536 / 64, 0) {
+    for (uint16_t stock_locate : options_.stock_locates) {
+        filter_[stock_locate >> 6] |= 1ULL << (stock_locate & 63);
+    }
+    options_.batch_size = std::max<size_t>(1, std::min(options_.batch_size, FrameEncoder::MaxTicksPerFrame()));
+    pending_.reserve(options_.batch_size);
+}
+
+ShapingSession::~ShapingSession() {
+    Stop();
+}
+
+bool ShapingSession::Start(zmq::context_t& context) {
+    ring_ = std::make_unique<MPSCRing<TickData>>(options_.ring_capacity);
+    encoder_ = std::make_unique<FrameEncoder>(options_.format);
+    
+    SinkOptions sink_options;
+    sink_options.endpoint = options_.endpoint;
+    sink_options.format = options_.format;
+    sink_options.send_hwm = options_.send_hwm;
+    
+    sink_ = std::make_unique<PublisherSink>(context, sink_options);
+    if (!sink_->Initialize(nullptr, options_.batch_size, nullptr)) {
+        sink_.reset();
+        return false;
+    }
+    
+    if (options_.rate > 0) {
+        throttle_.Initialize(options_.rate);
+    }
+    
+    sink_->Start();
+    running_.store(true);
+    shape_thread_ = std::thread([this]() { ShapeLoop(); });
+    return true;
+}
+
+void ShapingSession::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    
+    running_.store(false);
+    
+    if (shape_thread_.joinable()) {
+        shape_thread_.join();
+    }
+    
+    sink_->Stop();
+}
+
+void ShapingSession::Offer(const TickData& tick_data) {
+    if (!ring_->TryPush(tick_data)) {
+        ring_drops_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ShapingSession::ShapeLoop() {
+    AdaptiveBackoff backoff;
+    
+    while (running_.load(std::memory_order_relaxed)) {
+        if (Shape()) {
+            backoff.Reset();
+        } else {
+            backoff.Idle();
+        }
+    }
+    
+    // Ticks already handed over still go out, within the rate
+    while (Shape()) {
+    }
+}
+
+bool ShapingSession::Admit() {
+    return options_.rate == 0 || throttle_.ShouldProcess();
+}
+
+bool ShapingSession::Shape() {
+    size_t popped = 0;
+    TickData tick_data;
+    
+    while (popped < options_.batch_size && ring_->TryPop(tick_data)) {
+        popped++;
+        
+        // Symbols nobody on this endpoint subscribes to cost no tokens
+        if (!sink_->IsSubscribed(wire::kTopicTicks, tick_data.stock_locate)) {
+            pruned_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        
+        if (options_.conflate) {
+            conflator_.Update(tick_data);
+            conflated_in_.fetch_add(1, std::memory_order_relaxed);
+        } else if (Admit()) {
+            pending_.push_back(tick_data);
+        } else {
+            throttled_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    ticks_in_.fetch_add(popped, std::memory_order_relaxed);
+    
+    // Conflated sessions release the freshest value per key as tokens allow
+    size_t released = 0;
+    while (pending_.size() < options_.batch_size && conflator_.GetPendingCount() > 0 && Admit()) {
+        released += conflator_.Drain(pending_, 1);
+    }
+    conflated_out_.fetch_add(released, std::memory_order_relaxed);
+    
+    bool progressed = !pending_.empty();
+    SendRuns();
+    return popped > 0 || progressed;
+}
+
+void ShapingSession::SendRuns() {
+    if (pending_.empty()) {
+        return;
+    }
+    
+    // One topic per message, as on the shared publisher
+    std::stable_sort(pending_.begin(), pending_.end(), [](const TickData& a, const TickData& b) {
+        return a.stock_locate < b.stock_locate;
+    });
+    
+    size_t run_start = 0;
+    while (run_start < pending_.size()) {
+        size_t run_end = run_start + 1;
+        while (run_end < pending_.size() && pending_[run_end].stock_locate == pending_[run_start].stock_locate) {
+            run_end++;
+        }
+        
+        frames_.clear();
+        encoder_->EncodeTicks(&pending_[run_start], run_end - run_start, frames_);
+        sink_->Enqueue(frames_);
+        run_start = run_end;
+    }
+    
+    pending_.clear();
+}
+
+SessionStats ShapingSession::GetStats() const {
+    SessionStats stats;
+    stats.name = options_.name;
+    stats.endpoint = options_.endpoint;
+    stats.format = WireFormatName(options_.format);
+    stats.symbol_count = options_.stock_locates.size();
+    stats.rate = options_.rate;
+    stats.conflated = options_.conflate;
+    stats.ticks_in = ticks_in_.load();
+    stats.ring_drops = ring_drops_.load();
+    stats.pruned = pruned_.load();
+    stats.throttled = throttled_.load();
+    
+    // Updates still pending in the conflator are not counted as lost yet
+    uint64_t conflated_in = conflated_in_.load();
+    uint64_t conflated_out = conflated_out_.load();
+    stats.conflated_away = conflated_in > conflated_out ? conflated_in - conflated_out : 0;
+    
+    PublisherSinkStats sink_stats = sink_ ? sink_->GetStats() : PublisherSinkStats{};
+    stats.ticks_sent = sink_stats.ticks_sent;
+    stats.queue_drops = sink_stats.queue_drops;
+    stats.hwm_drops = sink_stats.hwm_drops;
+    return stats;
+}
+
+SessionManager::SessionManager() 
+    : context_(1), symbol_masks_(new std::atomic<uint64_t>[NUM_LOCATES]) {
+    for (size_t i = 0; i < NUM_LOCATES; ++i) {
+        symbol_masks_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+        slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+SessionManager::~SessionManager() {
+    StopAll();
+}
+
+bool SessionManager::CreateSession(const SessionOptions& options, std::string& error) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    
+    if (options.name.empty() || options.endpoint.empty()) {
+        error = "session needs a name and an endpoint";
+        return false;
+    }
+    
+    size_t free_slot = MAX_SESSIONS;
+    for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+        if (!owned_[i]) {
+            free_slot = std::min(free_slot, i);
+        } else if (owned_[i]->GetOptions().name == options.name) {
+            error = "session " + options.name + " already exists";
+            return false;
+        }
+    }
+    if (free_slot == MAX_SESSIONS) {
+        error = "at most " + std::to_string(MAX_SESSIONS) + " sessions";
+        return false;
+    }
+    
+    auto session = std::make_unique<ShapingSession>(options);
+    if (!session->Start(context_)) {
+        error = "cannot bind " + options.endpoint;
+        return false;
+    }
+    
+    // Publish the session before the masks point workers at it
+    uint64_t bit = 1ULL << free_slot;
+    slots_[free_slot].store(session.get(), std::memory_order_release);
+    if (options.stock_locates.empty()) {
+        all_symbols_mask_.fetch_or(bit);
+    } else {
+        for (uint16_t stock_locate : options.stock_locates) {
+            symbol_masks_[stock_locate].fetch_or(bit);
+        }
+    }
+    active_mask_.fetch_or(bit);
+    owned_[free_slot] = std::move(session);
+    
+    std::cout << "Session " << options.name << " on " << options.endpoint
+              << " (" << WireFormatName(options.format) << ")"
+              << " symbols " << (options.stock_locates.empty() ? std::string("all") : std::to_string(options.stock_locates.size()))
+              << " rate " << (options.rate ? std::to_string(options.rate) + "/s" : std::string("unlimited"))
+              << (options.conflate ? " (conflated)" : "") << std::endl;
+    return true;
+}
+
+bool SessionManager::RemoveSession(const std::string& name) {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    
+    for (size_t i = 0; i < MAX_SESSIONS; ++i) {
+        if (!owned_[i] || owned_[i]->GetOptions().name != name) {
+            continue;
+        }
+        
+        uint64_t bit = 1ULL << i;
+        active_mask_.fetch_and(~bit);
+        all_symbols_mask_.fetch_and(~bit);
+        for (uint16_t stock_locate : owned_[i]->GetOptions().stock_locates) {
+            symbol_masks_[stock_locate].fetch_and(~bit);
+        }
+        slots_[i].store(nullptr);
+        
+        // A worker that counted itself in before the slot was cleared may still
+        // hold the pointer; later ones see the empty slot
+        AdaptiveBackoff backoff;
+        while (users_[i].count.load(std::memory_order_acquire) != 0) {
+            backoff.Idle();
+        }
+        owned_[i]->Stop();
+        owned_[i].reset();
+        
+        std::cout << "Session " << name << " removed" << std::endl;
+        return true;
+    }
+    return false;
+}
+
+void SessionManager::StopAll() {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    for (auto& session : owned_) {
+        if (session) {
+            session->Stop();
+        }
+    }
+}
+
+std::vector<SessionStats> SessionManager::GetSessionStats() const {
+    std::lock_guard<std::mutex> lock(control_mutex_);
+    
+    std::vector<SessionStats> stats;
+    for (const auto& session : owned_) {
+        if (session) {
+            stats.push_back(session->GetStats());
+        }
+    }
+    return stats;
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "SnapshotSampler.h"
+#include "MessageProcessor.h"
+#include "ZMQPublisher.h"
+#include "MulticastPublisher.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace tickshaper {
+
+SnapshotSampler::SnapshotSampler() 
+    : processor_(nullptr), publisher_(nullptr), multicast_publisher_(nullptr), interval_ns_(0), clock_(SampleClock::kEventTime),
+      dirty_flags_(new std::atomic<uint8_t>[MAX_STOCK_LOCATE]),
+      symbol_ids_(new std::atomic<uint32_t>[MAX_STOCK_LOCATE]) {
+    for (size_t i = 0; i < MAX_STOCK_LOCATE; ++i) {
+        dirty_flags_[i].store(0, std::memory_order_relaxed);
+        symbol_ids_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+SnapshotSampler::~SnapshotSampler() {
+    Stop();
+}
+
+void SnapshotSampler::Initialize(MessageProcessor* processor, ZMQPublisher* publisher,
+                                 uint64_t interval_ms, SampleClock clock) {
+    processor_ = processor;
+    publisher_ = publisher;
+    interval_ns_ = std::max<uint64_t>(interval_ms, 1) * 1000000ULL;
+    clock_ = clock;
+    
+    std::cout << "Snapshot sampler initialized: every " << interval_ms << " ms ("
+              << (clock_ == SampleClock::kEventTime ? "event" : "wall") << " time)" << std::endl;
+}
+
+void SnapshotSampler::Start() {
+    if (running_.load() || clock_ != SampleClock::kWallTime) {
+        return;
+    }
+    
+    running_.store(true);
+    sampling_thread_ = std::thread([this]() { WallClockLoop(); });
+}
+
+void SnapshotSampler::Stop() {
+    running_.store(false);
+    if (sampling_thread_.joinable()) {
+        sampling_thread_.join();
+    }
+}
+
+void SnapshotSampler::AdvanceTo(uint64_t event_time_ns) {
+    if (clock_ != SampleClock::kEventTime) {
+        return;
+    }
+    
+    uint64_t boundary = next_boundary_ns_.load(std::memory_order_relaxed);
+    
+    if (boundary == 0) {
+        // First event anchors the grid on the next interval boundary
+        uint64_t first = (event_time_ns / interval_ns_ + 1) * interval_ns_;
+        next_boundary_ns_.compare_exchange_strong(boundary, first);
+        return;
+    }
+    
+    if (event_time_ns < boundary) {
+        return;
+    }
+    
+    // Only the thread that advances the grid takes the sample
+    uint64_t next = (event_time_ns / interval_ns_ + 1) * interval_ns_;
+    if (next_boundary_ns_.compare_exchange_strong(boundary, next)) {
+        TakeSample(boundary);
+    }
+}
+
+void SnapshotSampler::MarkDirty(uint16_t stock_locate, uint32_t symbol_id) {
+    symbol_ids_[stock_locate].store(symbol_id, std::memory_order_relaxed);
+    
+    if (dirty_flags_[stock_locate].exchange(1, std::memory_order_acq_rel) == 0) {
+        std::lock_guard<InstrumentedMutex> lock(dirty_mutex_);
+        dirty_list_.push_back(stock_locate);
+    }
+}
+
+void SnapshotSampler::TakeSample(uint64_t sample_time) {
+    std::lock_guard<std::mutex> sample_lock(sample_mutex_);
+    
+    std::vector<uint16_t> locates;
+    {
+        std::lock_guard<InstrumentedMutex> lock(dirty_mutex_);
+        locates.swap(dirty_list_);
+    }
+    
+    if (locates.empty()) {
+        return;
+    }
+    
+    for (uint16_t locate : locates) {
+        dirty_flags_[locate].store(0, std::memory_order_release);
+    }
+    
+    // One consistent cut across every dirty symbol
+    std::vector<TopOfBook> quotes;
+    processor_->GetTopOfBooks(locates, quotes);
+    
+    std::vector<L1Snapshot> snapshots;
+    snapshots.reserve(locates.size());
+    for (size_t i = 0; i < locates.size(); ++i) {
+        snapshots.push_back({locates[i], symbol_ids_[locates[i]].load(std::memory_order_relaxed), quotes[i]});
+    }
+    
+    snapshot_count_.fetch_add(snapshots.size());
+    sample_count_.fetch_add(1);
+    
+    if (multicast_publisher_) {
+        multicast_publisher_->PublishSnapshots(sample_time, snapshots);
+    }
+    publisher_->PublishSnapshots(sample_time, std::move(snapshots));
+}
+
+void SnapshotSampler::WallClockLoop() {
+    auto next_sample = std::chrono::steady_clock::now() + std::chrono::nanoseconds(interval_ns_);
+    
+    while (running_.load()) {
+        std::this_thread::sleep_until(next_sample);
+        
+        uint64_t sample_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        TakeSample(sample_time);
+        
+        // Stay on the grid; skip missed points instead of bunching samples
+        auto now = std::chrono::steady_clock::now();
+        do {
+            next_sample += std::chrono::nanoseconds(interval_ns_);
+        } while (next_sample <= now);
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
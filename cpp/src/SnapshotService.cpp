@@ -0,0 +1,145 @@
+#include "SnapshotService.h"
+#include "WireFormat.h"
+#include <iostream>
+#include <algorithm>
+
+namespace tickshaper {
+
+SnapshotService::SnapshotService() : cache_(nullptr), context_(1) {
+}
+
+SnapshotService::~SnapshotService() {
+    Stop();
+}
+
+bool SnapshotService::Initialize(const std::string& endpoint, const LastValueCache* cache) {
+    endpoint_ = endpoint;
+    cache_ = cache;
+    
+    try {
+        socket_ = zmq::socket_t(context_, ZMQ_ROUTER);
+        
+        // Lets the serve loop notice Stop()
+        int timeout = 100;
+        socket_.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+        int linger = 0;
+        socket_.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        socket_.bind(endpoint_);
+    } catch (const zmq::error_t& e) {
+        std::cerr << "Snapshot service bind failed on " << endpoint_ << ": " << e.what() << std::endl;
+        return false;
+    }
+    
+    running_.store(true);
+    serve_thread_ = std::thread([this]() { ServeLoop(); });
+    
+    std::cout << "Snapshot service listening on " << endpoint_ << std::endl;
+    return true;
+}
+
+void SnapshotService::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+    
+    running_.store(false);
+    if (serve_thread_.joinable()) {
+        serve_thread_.join();
+    }
+    socket_.close();
+    
+    std::cout << "Snapshot service stopped. Served " << records_served_.load() << " records for "
+              << request_count_.load() << " requests" << std::endl;
+}
+
+bool SnapshotService::BuildReply(const uint8_t* request, size_t size, std::vector<zmq::message_t>& parts) {
+    parts.clear();
+    if (size % sizeof(uint16_t) != 0) {
+        return false;
+    }
+    
+    // Each slot is read independently; the shards keep publishing meanwhile
+    if (size == 0) {
+        cache_->ReadAll(values_);
+    } else {
+        values_.resize(size / sizeof(uint16_t));
+        for (size_t i = 0; i < values_.size(); ++i) {
+            uint16_t stock_locate = static_cast<uint16_t>((request[2 * i] << 8) | request[2 * i + 1]);
+            if (!cache_->Read(stock_locate, values_[i])) {
+                // Nothing sent yet: every feed message for it is newer than this
+                values_[i] = LastValue{};
+                values_[i].stock_locate = stock_locate;
+            }
+        }
+    }
+    
+    uint64_t reply_sequence = request_count_.fetch_add(1) + 1;
+    size_t offset = 0;
+    do {
+        size_t count = std::min(values_.size() - offset, MAX_RECORDS_PER_PART);
+        zmq::message_t part(sizeof(wire::MessageHeader) + count * sizeof(wire::LastValueRecord));
+        
+        uint8_t* cursor = static_cast<uint8_t*>(part.data());
+        cursor = wire::EncodeHeader(cursor, wire::kLastValueBatch, static_cast<uint16_t>(count),
+                                    sizeof(wire::LastValueRecord), reply_sequence);
+        for (size_t i = 0; i < count; ++i) {
+            cursor = wire::EncodeLastValue(cursor, values_[offset + i]);
+        }
+        
+        parts.push_back(std::move(part));
+        offset += count;
+    } while (offset < values_.size());
+    
+    records_served_.fetch_add(values_.size());
+    return true;
+}
+
+void SnapshotService::ServeLoop() {
+    std::vector<zmq::message_t> envelope;
+    std::vector<zmq::message_t> parts;
+    
+    while (running_.load()) {
+        zmq::message_t frame;
+        try {
+            if (!socket_.recv(frame, zmq::recv_flags::none)) {
+                continue;  // Timeout, checks running_ again
+            }
+            
+            // Routing id, then an empty delimiter for REQ clients, then the body
+            envelope.clear();
+            bool more = frame.more();
+            envelope.push_back(std::move(frame));
+            while (more) {
+                zmq::message_t next;
+                socket_.recv(next, zmq::recv_flags::none);
+                more = next.more();
+                envelope.push_back(std::move(next));
+            }
+            if (envelope.size() < 2) {
+                continue;
+            }
+            
+            zmq::message_t request = std::move(envelope.back());
+            envelope.pop_back();
+            
+            if (!BuildReply(static_cast<const uint8_t*>(request.data()), request.size(), parts)) {
+                std::cerr << "Snapshot service: malformed request of " << request.size() << " bytes" << std::endl;
+                parts.clear();
+                parts.emplace_back();
+            }
+            
+            for (zmq::message_t& part : envelope) {
+                socket_.send(part, zmq::send_flags::sndmore);
+            }
+            for (size_t i = 0; i < parts.size(); ++i) {
+                socket_.send(parts[i], i + 1 < parts.size() ? zmq::send_flags::sndmore : zmq::send_flags::none);
+            }
+        } catch (const zmq::error_t& e) {
+            if (running_.load()) {
+                std::cerr << "Snapshot service error: " << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
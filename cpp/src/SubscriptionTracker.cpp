@@ -0,0 +1,92 @@
+#include "SubscriptionTracker.h"
+
+namespace tickshaper {
+
+SubscriptionTracker::SubscriptionTracker() {
+    for (auto& state : classes_) {
+        state.bits.reset(new std::atomic<uint64_t>[NUM_LOCATES / 64]);
+        for (size_t i = 0; i < NUM_LOCATES / 64; ++i) {
+            state.bits[i].store(0, std::memory_order_relaxed);
+        }
+        state.refcounts.assign(NUM_LOCATES, 0);
+    }
+}
+
+SubscriptionTracker::~SubscriptionTracker() = default;
+
+bool SubscriptionTracker::Apply(const uint8_t* data, size_t size) {
+    // First byte is 1 for subscribe, 0 for unsubscribe; the rest is the prefix
+    if (size < 1 || data[0] > 1) {
+        return false;
+    }
+    
+    bool subscribe = (data[0] == 1);
+    const uint8_t* prefix = data + 1;
+    size_t prefix_size = size - 1;
+    events_.fetch_add(1, std::memory_order_relaxed);
+    
+    if (prefix_size == 0) {
+        for (auto& state : classes_) {
+            if (subscribe) {
+                state.wildcard.fetch_add(1, std::memory_order_relaxed);
+            } else if (state.wildcard.load(std::memory_order_relaxed) > 0) {
+                state.wildcard.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        return true;
+    }
+    
+    if (prefix[0] != wire::kTopicTicks && prefix[0] != wire::kTopicSnapshots) {
+        // Matches nothing we publish
+        return true;
+    }
+    
+    ClassState& state = classes_[ClassIndex(prefix[0])];
+    
+    if (prefix_size == 1) {
+        if (subscribe) {
+            state.wildcard.fetch_add(1, std::memory_order_relaxed);
+        } else if (state.wildcard.load(std::memory_order_relaxed) > 0) {
+            state.wildcard.fetch_sub(1, std::memory_order_relaxed);
+        }
+    } else if (prefix_size == 2) {
+        uint32_t first = static_cast<uint32_t>(prefix[1]) << 8;
+        AdjustRange(state, first, first + 255, subscribe);
+    } else {
+        // Anything past the locate cannot narrow the match further
+        uint32_t locate = (static_cast<uint32_t>(prefix[1]) << 8) | prefix[2];
+        AdjustRange(state, locate, locate, subscribe);
+    }
+    
+    return true;
+}
+
+size_t SubscriptionTracker::GetSubscribedSymbolCount(wire::TopicClass topic_class) const {
+    const ClassState& state = classes_[ClassIndex(topic_class)];
+    if (state.wildcard.load() > 0) {
+        return NUM_LOCATES;
+    }
+    
+    size_t count = 0;
+    for (size_t i = 0; i < NUM_LOCATES / 64; ++i) {
+        count += __builtin_popcountll(state.bits[i].load(std::memory_order_relaxed));
+    }
+    return count;
+}
+
+void SubscriptionTracker::AdjustRange(ClassState& state, uint32_t first, uint32_t last, bool subscribe) {
+    for (uint32_t locate = first; locate <= last; ++locate) {
+        uint32_t& refcount = state.refcounts[locate];
+        uint64_t mask = 1ULL << (locate & 63);
+        
+        if (subscribe) {
+            if (refcount++ == 0) {
+                state.bits[locate >> 6].fetch_or(mask, std::memory_order_relaxed);
+            }
+        } else if (refcount > 0 && --refcount == 0) {
+            state.bits[locate >> 6].fetch_and(~mask, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include "ThrottleController.h"
+#include "FastClock.h"
 #include <algorithm>
 
 namespace tickshaper {
 
 ThrottleController::ThrottleController() 
-    : last_reset_(std::chrono::steady_clock::now()),
-      last_process_time_(std::chrono::steady_clock::now()) {
+    : last_reset_ns_(FastClock::NowNanos()),
+      last_process_time_ns_(last_reset_ns_) {
 }
 
 ThrottleController::~ThrottleController() = default;
@@ -16,7 +17,7 @@ void ThrottleController::Initialize(uint32_t messages_per_second) {
 }
 
 void ThrottleController::SetRate(uint32_t messages_per_second) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<InstrumentedMutex> lock(mutex_);
     
     target_rate_.store(messages_per_second);
     token_rate_.store(static_cast<double>(messages_per_second));
@@ -26,20 +27,17 @@ void ThrottleController::SetRate(uint32_t messages_per_second) {
 }
 
 bool ThrottleController::ShouldProcess() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<InstrumentedMutex> lock(mutex_);
     
-    auto now = std::chrono::steady_clock::now();
+    uint64_t now_ns = FastClock::NowNanos();
     
     // Add tokens based on elapsed time
-    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-        now - last_process_time_).count();
-    
-    if (elapsed > 0) {
-        double tokens_to_add = (token_rate_.load() * elapsed) / 1000000.0;
+    if (now_ns > last_process_time_ns_) {
+        double tokens_to_add = (token_rate_.load() * (now_ns - last_process_time_ns_)) / 1000000000.0;
         double current_tokens = tokens_.load();
         tokens_.store(std::min(current_tokens + tokens_to_add, MAX_TOKENS));
         
-        last_process_time_ = now;
+        last_process_time_ns_ = now_ns;
     }
     
     // Check if we have enough tokens
@@ -50,10 +48,8 @@ bool ThrottleController::ShouldProcess() {
         current_count_.fetch_add(1);
         
         // Reset counters every second
-        auto reset_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            now - last_reset_).count();
-        if (reset_elapsed >= 1) {
-            ResetCounters();
+        if (now_ns - last_reset_ns_ >= 1000000000ULL) {
+            ResetCounters(now_ns);
         }
         
         return true;
@@ -63,9 +59,9 @@ bool ThrottleController::ShouldProcess() {
     }
 }
 
-void ThrottleController::ResetCounters() {
+void ThrottleController::ResetCounters(uint64_t now_ns) {
     current_count_.store(0);
-    last_reset_ = std::chrono::steady_clock::now();
+    last_reset_ns_ = now_ns;
 }
 
 } // namespace tickshaper
\ No newline at end of file
@@ -2,33 +2,128 @@
 #include "MessageProcessor.h"
 #include "ITCHParser.h"
 #include "ZMQPublisher.h"
+#include "MulticastPublisher.h"
 #include "SharedMemoryManager.h"
 #include "MicroburstDetector.h"
 #include "ThrottleController.h"
+#include "LoadShedder.h"
+#include "FastClock.h"
+#include "SnapshotSampler.h"
+#include "LastValueCache.h"
+#include "SnapshotService.h"
+#include "SessionManager.h"
+#include "ReplayManager.h"
+#include "LatencyHistogram.h"
+#include "CounterRegistry.h"
+#include "TraceRecorder.h"
+#include "PerfCounters.h"
+#include "LockProfiler.h"
+#include "MetricsSegment.h"
+#include "MetricsExporter.h"
+#include "DashboardStream.h"
 #include <fstream>
 #include <iostream>
 #include <sched.h>
 #include <sys/resource.h>
 #include <unistd.h>
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
 
 namespace tickshaper {
 
+// Values in the metrics segment, registered in this order so the enum is the slot index
+enum SegmentValue : uint8_t {
+    kSegmentProcessed = 0,
+    kSegmentThrottled,
+    kSegmentSuppressed,
+    kSegmentPruned,
+    kSegmentAddOrders,
+    kSegmentExecutions,
+    kSegmentTrades,
+    kSegmentCancels,
+    kSegmentShedProcessing,
+    kSegmentShedConflation,
+    kSegmentShedPublish,
+    kSegmentPublished,
+    kSegmentBatches,
+    kSegmentDropped,
+    kSegmentPublishPruned,
+    kSegmentThroughput,
+    kSegmentQueueDepth,
+    kSegmentThrottleRate,
+    kSegmentMicroburst,
+    kSegmentCpuUsage,
+    kSegmentMemoryUsage,
+    kSegmentUptime,
+    kNumSegmentValues
+};
+
+struct SegmentValueSpec {
+    const char* name;
+    metrics_shm::ValueKind kind;
+    uint8_t decimals;
+};
+
+static const SegmentValueSpec kSegmentValues[kNumSegmentValues] = {
+    {"messages_processed", metrics_shm::kCounter, 0},
+    {"messages_throttled", metrics_shm::kCounter, 0},
+    {"messages_suppressed", metrics_shm::kCounter, 0},
+    {"messages_pruned", metrics_shm::kCounter, 0},
+    {"add_orders", metrics_shm::kCounter, 0},
+    {"executions", metrics_shm::kCounter, 0},
+    {"trades", metrics_shm::kCounter, 0},
+    {"cancels", metrics_shm::kCounter, 0},
+    {"shed_processing", metrics_shm::kCounter, 0},
+    {"shed_conflation", metrics_shm::kCounter, 0},
+    {"shed_publish", metrics_shm::kCounter, 0},
+    {"published", metrics_shm::kCounter, 0},
+    {"publish_batches", metrics_shm::kCounter, 0},
+    {"publish_dropped", metrics_shm::kCounter, 0},
+    {"publish_pruned", metrics_shm::kCounter, 0},
+    {"throughput", metrics_shm::kGauge, 0},
+    {"queue_depth", metrics_shm::kGauge, 0},
+    {"throttle_rate", metrics_shm::kGauge, 0},
+    {"microburst", metrics_shm::kGauge, 0},
+    {"cpu_usage", metrics_shm::kGauge, 2},
+    {"memory_usage", metrics_shm::kGauge, 0},
+    {"uptime_seconds", metrics_shm::kGauge, 0}
+};
+
 TickShaper::TickShaper() {
+    latency_tracker_ = std::make_unique<LatencyTracker>();
+    trace_recorder_ = std::make_unique<TraceRecorder>();
+    perf_counters_ = std::make_unique<PerfCounters>();
+    counter_registry_ = std::make_unique<CounterRegistry>();
+    symbol_counters_ = std::make_unique<SymbolCounterRegistry>();
     processor_ = std::make_unique<MessageProcessor>();
+    processor_->ShareCounters(counter_registry_.get());
     itch_parser_ = std::make_unique<ITCHParser>();
     publisher_ = std::make_unique<ZMQPublisher>();
+    multicast_publisher_ = std::make_unique<MulticastPublisher>();
     shm_manager_ = std::make_unique<SharedMemoryManager>();
-    microburst_detector_ = std::make_unique<MicroburstDetector>();
     throttle_controller_ = std::make_unique<ThrottleController>();
+    load_shedder_ = std::make_unique<LoadShedder>();
+    snapshot_sampler_ = std::make_unique<SnapshotSampler>();
+    snapshot_service_ = std::make_unique<SnapshotService>();
+    session_manager_ = std::make_unique<SessionManager>();
+    replay_manager_ = std::make_unique<ReplayManager>();
 }
 
 TickShaper::~TickShaper() {
     Stop();
+    
+    // Renders from the other components, so it goes before any of them
+    if (dashboard_stream_) {
+        dashboard_stream_->Stop();
+    }
 }
 
 bool TickShaper::Initialize(const std::string& config_file) {
     try {
+        // Pipeline timestamps, deadlines and pacing all read this clock
+        FastClock::Calibrate();
+        
         if (!LoadConfiguration(config_file)) {
             std::cerr << "Failed to load configuration" << std::endl;
             return false;
@@ -40,23 +135,169 @@ bool TickShaper::Initialize(const std::string& config_file) {
             return false;
         }
         
+        // Initialize load shedder before the publisher starts draining
+        load_shedder_->Initialize(max_message_age_us_);
+        publisher_->SetLoadShedder(load_shedder_.get());
+        publisher_->SetLatencyTracker(latency_tracker_.get());
+        
+        // Rings are sized before any thread registers one
+        trace_recorder_->SetCapacity(trace_buffer_events_);
+        trace_recorder_->SetTrigger(trace_trigger_us_ * 1000, trace_dir_);
+        trace_recorder_->SetEnabled(trace_enabled_);
+        publisher_->SetTraceRecorder(trace_recorder_.get());
+        perf_counters_->SetSampleInterval(perf_sample_interval_);
+        perf_counters_->SetEnabled(perf_counters_enabled_);
+        publisher_->SetPerfCounters(perf_counters_.get());
+        LockProfiler::SetEnabled(lock_profiling_);
+        
+        // Metrics export for tickshaper-stat; the pipeline runs without it
+        if (!metrics_shm_name_.empty()) {
+            metrics_segment_ = std::make_unique<MetricsSegment>();
+            if (metrics_segment_->Create(metrics_shm_name_, 1000)) {
+                for (const SegmentValueSpec& spec : kSegmentValues) {
+                    metrics_segment_->AddValue(spec.name, spec.kind, spec.decimals);
+                }
+                for (size_t stage = 0; stage < kNumLatencyStages; ++stage) {
+                    std::string name = std::string("latency_") + LatencyStageName(static_cast<LatencyStage>(stage));
+                    metrics_segment_->AddHistogram(name.c_str());
+                }
+            } else {
+                metrics_segment_.reset();
+            }
+        }
+        
+        // The last-value cache is filled by the publisher shards as they send
+        if (!snapshot_endpoint_.empty()) {
+            last_value_cache_ = std::make_unique<LastValueCache>();
+            publisher_->SetLastValueCache(last_value_cache_.get());
+        }
+        
+        // The multicast feed and the last-value cache both need every symbol
+        publish_all_symbols_ = multicast_enabled_ || !snapshot_endpoint_.empty();
+        
         // Initialize ZeroMQ publisher
-        if (!publisher_->Initialize(zmq_endpoint_)) {
+        PublisherOptions publisher_options;
+        publisher_options.endpoint = zmq_endpoint_;
+        publisher_options.enable_conflation = enable_conflation_;
+        if (!ParseWireFormat(publish_format_, publisher_options.format)) {
+            std::cerr << "Unknown publish_format '" << publish_format_ << "', using binary" << std::endl;
+            publish_format_ = "binary";
+        }
+        publisher_options.ring_capacity = publish_ring_capacity_;
+        publisher_options.batch_size = publish_batch_size_;
+        publisher_options.linger_us = publish_linger_us_;
+        publisher_options.prune_unsubscribed = prune_unsubscribed_;
+        publisher_options.egress_stamp = publish_egress_stamp_;
+        publisher_options.num_shards = publish_shards_;
+        publisher_options.shard_cores = publish_shard_cores_;
+        
+        // Additional sinks: "<endpoint> <binary|json|compact|conflated> [send_hwm]"
+        for (const std::string& sink_spec : publish_sinks_) {
+            std::istringstream spec(sink_spec);
+            SinkOptions sink;
+            std::string format = "binary";
+            spec >> sink.endpoint >> format;
+            if (!(spec >> sink.send_hwm)) {
+                sink.send_hwm = 10000;
+            }
+            
+            sink.conflated = (format == "conflated");
+            if (sink.endpoint.empty() || (!sink.conflated && !ParseWireFormat(format, sink.format))) {
+                std::cerr << "Invalid publish_sink: " << sink_spec << std::endl;
+                return false;
+            }
+            publisher_options.extra_sinks.push_back(sink);
+        }
+        
+        if (!publisher_->Initialize(publisher_options)) {
             std::cerr << "Failed to initialize ZMQ publisher" << std::endl;
             return false;
         }
         
+        // Burst detection runs on feed event time, aggregate and per symbol
+        microburst_detector_ = std::make_unique<MicroburstDetector>(microburst_threshold_, microburst_end_threshold_,
+                                                                    min_microburst_duration_ms_,
+                                                                    symbol_microburst_threshold_,
+                                                                    symbol_microburst_end_threshold_);
+        microburst_detector_->Initialize(&metrics_);
+        
+        // Prometheus scrape endpoint; scrapes read the page the metrics thread last rendered
+        if (metrics_http_port_ != 0) {
+            metrics_exporter_ = std::make_unique<MetricsExporter>();
+            if (!metrics_exporter_->Initialize(metrics_http_address_, metrics_http_port_)) {
+                std::cerr << "Failed to initialize metrics exporter" << std::endl;
+                return false;
+            }
+        }
+        
+        // Dashboard WebSocket stream; snapshots are aggregated here, once for every viewer
+        if (dashboard_port_ != 0) {
+            dashboard_stream_ = std::make_unique<DashboardStream>();
+            if (!dashboard_stream_->Initialize(dashboard_address_, dashboard_port_, dashboard_interval_ms_, 
+                                               [this]() { return RenderDashboard(); })) {
+                std::cerr << "Failed to initialize dashboard stream" << std::endl;
+                return false;
+            }
+        }
+        
+        // Initialize late-joiner snapshot service
+        if (last_value_cache_ && !snapshot_service_->Initialize(snapshot_endpoint_, last_value_cache_.get())) {
+            std::cerr << "Failed to initialize snapshot service" << std::endl;
+            return false;
+        }
+        
+        // Initialize shaping sessions configured up front; more can be added at runtime
+        for (const std::string& session_spec : shaping_sessions_) {
+            if (!AddSession(session_spec)) {
+                return false;
+            }
+        }
+        
+        // Initialize MoldUDP64 multicast publisher
+        if (multicast_enabled_) {
+            MulticastOptions multicast_options;
+            multicast_options.group = multicast_group_;
+            multicast_options.port = multicast_port_;
+            multicast_options.interface_address = multicast_interface_;
+            multicast_options.ttl = multicast_ttl_;
+            multicast_options.session = mold_session_;
+            multicast_options.retransmit_port = retransmit_port_;
+            multicast_options.retransmit_capacity = retransmit_buffer_;
+            multicast_options.ring_capacity = publish_ring_capacity_;
+            multicast_options.linger_us = publish_linger_us_;
+            
+            if (!multicast_publisher_->Initialize(multicast_options)) {
+                std::cerr << "Failed to initialize multicast publisher" << std::endl;
+                return false;
+            }
+        }
+        
         // Initialize ITCH parser
         if (!itch_parser_->Initialize(input_file_, symbols_file_)) {
             std::cerr << "Failed to initialize ITCH parser" << std::endl;
             return false;
         }
         
+        // Replays map the input file themselves, on the first one started
+        replay_manager_->Initialize(input_file_, shm_manager_.get());
+        
         // Initialize message processor
         processor_->Initialize(shm_manager_.get(), &metrics_);
-        
-        // Initialize microburst detector
-        microburst_detector_->Initialize(&metrics_);
+        sampling_enabled_ = (output_mode_ == "sampled");
+        if (output_mode_ == "bbo") {
+            processor_->SetOutputMode(OutputMode::kTopOfBook);
+        } else if (sampling_enabled_) {
+            processor_->SetOutputMode(OutputMode::kSampled);
+            snapshot_sampler_->Initialize(processor_.get(), publisher_.get(), sample_interval_ms_,
+                                          sample_clock_ == "wall" ? SampleClock::kWallTime 
+                                                                  : SampleClock::kEventTime);
+            if (multicast_enabled_) {
+                snapshot_sampler_->SetMulticastPublisher(multicast_publisher_.get());
+            }
+        } else if (output_mode_ != "ticks") {
+            std::cerr << "Unknown output_mode '" << output_mode_ << "', using ticks" << std::endl;
+            output_mode_ = "ticks";
+        }
         
         // Initialize throttle controller
         throttle_controller_->Initialize(throttle_rate_.load());
@@ -65,14 +306,44 @@ bool TickShaper::Initialize(const std::string& config_file) {
         std::cout << "Configuration:" << std::endl;
         std::cout << "  Input file: " << input_file_ << std::endl;
         std::cout << "  ZMQ endpoint: " << zmq_endpoint_ << std::endl;
+        std::cout << "  Output mode: " << output_mode_ << std::endl;
+        std::cout << "  Publish format: " << publish_format_ << std::endl;
+        std::cout << "  Publisher shards: " << publish_shards_ << std::endl;
+        std::cout << "  Snapshot service: " << (snapshot_endpoint_.empty() ? "disabled" : snapshot_endpoint_) << std::endl;
+        std::cout << "  Shaping sessions: " << shaping_sessions_.size() << std::endl;
+        std::cout << "  Replays: " << replays_.size() << std::endl;
+        std::cout << "  Multicast: " << (multicast_enabled_ ? multicast_group_ + ":" + std::to_string(multicast_port_) 
+                                                            : std::string("disabled")) << std::endl;
+        std::cout << "  Publish batching: " << publish_batch_size_ << " ticks / " << publish_linger_us_ << "us" << std::endl;
+        std::cout << "  Conflation: " << (enable_conflation_ ? "enabled" : "disabled") << std::endl;
+        std::cout << "  Max message age: " 
+                  << (max_message_age_us_ ? std::to_string(max_message_age_us_) + " μs" : "unlimited") << std::endl;
+        std::cout << "  Tracing: " << (trace_enabled_ ? "enabled" : "disabled");
+        if (trace_trigger_us_ > 0) {
+            std::cout << ", dump to " << trace_dir_ << " over " << trace_trigger_us_ << " μs";
+        }
+        std::cout << std::endl;
+        std::cout << "  Perf counters: " 
+                  << (perf_counters_enabled_ ? "1 in " + std::to_string(perf_sample_interval_) + " messages" : "disabled") 
+                  << std::endl;
+        std::cout << "  Lock profiling: " << (lock_profiling_ ? "enabled" : "disabled") << std::endl;
+        std::cout << "  Metrics segment: " << (metrics_segment_ ? metrics_shm_name_ : std::string("disabled")) << std::endl;
+        std::cout << "  Metrics HTTP: " 
+                  << (metrics_exporter_ ? metrics_http_address_ + ":" + std::to_string(metrics_exporter_->GetPort()) 
+                                        : std::string("disabled")) << std::endl;
+        std::cout << "  Dashboard stream: " 
+                  << (dashboard_stream_ ? dashboard_address_ + ":" + std::to_string(dashboard_stream_->GetPort()) + 
+                                          " every " + std::to_string(dashboard_interval_ms_) + " ms"
+                                        : std::string("disabled")) << std::endl;
         std::cout << "  Shared memory: " << (shared_memory_size_ / 1024 / 1024) << " MB" << std::endl;
         std::cout << "  Worker threads: " << worker_thread_count_ << std::endl;
         std::cout << "  CPU affinity: " << (enable_cpu_affinity_ ? "enabled" : "disabled") << std::endl;
         std::cout << "  Symbols file: " << (symbols_file_.empty() ? "none (using defaults)" : symbols_file_) << std::endl;
-        std::cout << "  Microburst threshold: " << microburst_threshold_ << " msg/s" << std::endl;
+        std::cout << "  Microburst threshold: " << microburst_threshold_ << " msg/s, per symbol "
+                  << symbol_microburst_threshold_ << " msg/s" << std::endl;
         
         return true;
-        
+    
     } catch (const std::exception& e) {
         std::cerr << "Initialization failed: " << e.what() << std::endl;
         return false;
@@ -97,6 +368,15 @@ void TickShaper::Start() {
         });
     }
     
+    if (sampling_enabled_) {
+        snapshot_sampler_->Start();
+    }
+    
+    // Configured replays start with the live pipeline; a bad spec only loses that replay
+    for (const std::string& replay_spec : replays_) {
+        AddReplay(replay_spec);
+    }
+    
     // Start metrics update thread
     metrics_thread_ = std::thread([this]() {
         MetricsUpdateLoop();
@@ -125,24 +405,154 @@ void TickShaper::Stop() {
     if (metrics_thread_.joinable()) {
         metrics_thread_.join();
     }
+    if (metrics_exporter_) {
+        metrics_exporter_->Stop();
+    }
     
     // Stop components
+    snapshot_sampler_->Stop();
     publisher_->Stop();
+    multicast_publisher_->Stop();
+    snapshot_service_->Stop();
+    session_manager_->StopAll();
+    replay_manager_->StopAll();
     
     std::cout << "TickShaper stopped" << std::endl;
     
     // Print final statistics
+    FoldCounters();
     const auto& metrics = GetMetrics();
     std::cout << "\nFinal Statistics:" << std::endl;
     std::cout << "  Messages processed: " << metrics.messages_processed.load() << std::endl;
     std::cout << "  Messages throttled: " << metrics.messages_throttled.load() << std::endl;
+    
+    LoadSheddingStats shed_stats = load_shedder_->GetStats();
+    std::cout << "  Messages shed: " << shed_stats.shed[kHandoffProcessing] << " processing, "
+              << shed_stats.shed[kHandoffConflation] << " conflation, "
+              << shed_stats.shed[kHandoffPublish] << " publish" << std::endl;
+    if (processor_->GetOutputMode() != OutputMode::kAllTicks) {
+        std::cout << "  Messages suppressed: " << metrics.messages_suppressed.load() << std::endl;
+    }
+    if (prune_unsubscribed_) {
+        std::cout << "  Messages pruned: " << metrics.messages_pruned.load() << " before publish, "
+                  << publisher_->GetPrunedCount() << " at publish" << std::endl;
+    }
     std::cout << "  Uptime: " << metrics.uptime_seconds.load() << " seconds" << std::endl;
     
-    if (metrics.messages_processed.load() > 0) {
-        double avg_latency_us = static_cast<double>(metrics.total_latency_ns.load()) / 
-                               metrics.messages_processed.load() / 1000.0;
-        std::cout << "  Average latency: " << avg_latency_us << " μs" << std::endl;
+    UpdateLatencyReport();
+    for (const auto& stage : GetLatencyReport()) {
+        if (stage.cumulative.count > 0) {
+            std::cout << "  Latency " << stage.stage << ": p50 " << stage.cumulative.p50 << " ns, p99 "
+                      << stage.cumulative.p99 << " ns, p99.9 " << stage.cumulative.p999 << " ns, p99.99 "
+                      << stage.cumulative.p9999 << " ns, max " << stage.cumulative.max << " ns" << std::endl;
+        }
+    }
+    for (const auto& stage : GetPerfReport()) {
+        if (stage.samples > 0) {
+            std::cout << "  Perf " << stage.stage << " per message: " << FormatPerfSummary(stage) 
+                      << " (" << stage.samples << " sampled)" << std::endl;
+        }
+    }
+    if (LockProfiler::IsEnabled()) {
+        for (const auto& lock : LockProfiler::GetReport()) {
+            if (lock.acquisitions > 0) {
+                std::cout << "  Lock " << lock.name << ": " << lock.total_wait_ns / 1000 << " μs waited, "
+                          << lock.contended << " of " << lock.acquisitions << " acquisitions contended" << std::endl;
+            }
+        }
+    }
+    
+    if (publisher_->IsConflationEnabled()) {
+        std::cout << "  Conflation ratio: " << publisher_->GetConflationRatio() << std::endl;
+    }
+    
+    for (const auto& sink : publisher_->GetSinkStats()) {
+        std::cout << "  Sink " << sink.endpoint << " (" << sink.format << "): " << sink.ticks_sent << " ticks, "
+                  << sink.queue_drops << " queue drops, " << sink.hwm_drops << " HWM drops" << std::endl;
+    }
+    for (const auto& encoder : publisher_->GetEncoderStats()) {
+        if (encoder.batches > 0) {
+            std::cout << "  Encoder " << encoder.format << ": " << encoder.GetCompressionRatio() << "x vs binary, "
+                      << encoder.GetNanosPerBatch() << " ns/batch, " << encoder.pooled_frames << " pooled / "
+                      << encoder.copied_frames << " copied frames" << std::endl;
+        }
+    }
+    for (const auto& session : session_manager_->GetSessionStats()) {
+        std::cout << "  Session " << session.name << ": " << session.ticks_sent << " of " << session.ticks_in
+                  << " ticks sent, " << session.throttled + session.conflated_away << " over rate, "
+                  << session.ring_drops + session.queue_drops + session.hwm_drops << " dropped" << std::endl;
     }
+    for (const auto& replay : replay_manager_->GetReplayStats()) {
+        std::cout << "  Replay " << replay.name << ": " << replay.position << " of " << replay.total_messages
+                  << " messages, " << replay.ticks_sent << " ticks sent" << std::endl;
+    }
+}
+
+std::vector<ConflationStats> TickShaper::GetConflationStats() const {
+    return publisher_->GetConflationStats();
+}
+
+LoadSheddingStats TickShaper::GetLoadSheddingStats() const {
+    return load_shedder_->GetStats();
+}
+
+std::vector<SuppressionStats> TickShaper::GetSuppressionStats() const {
+    return processor_->GetSuppressionStats();
+}
+
+std::vector<PublisherSinkStats> TickShaper::GetSinkStats() const {
+    return publisher_->GetSinkStats();
+}
+
+std::vector<EncoderStats> TickShaper::GetEncoderStats() const {
+    return publisher_->GetEncoderStats();
+}
+
+bool TickShaper::AddSession(const std::string& spec) {
+    SessionOptions options;
+    options.ring_capacity = std::min<size_t>(publish_ring_capacity_, 16384);
+    options.batch_size = publish_batch_size_;
+    
+    std::string error;
+    if (!ParseSessionSpec(spec, options, error) || !session_manager_->CreateSession(options, error)) {
+        std::cerr << "Invalid shaping session '" << spec << "': " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TickShaper::RemoveSession(const std::string& name) {
+    if (!session_manager_->RemoveSession(name)) {
+        std::cerr << "No shaping session named " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<SessionStats> TickShaper::GetSessionStats() const {
+    return session_manager_->GetSessionStats();
+}
+
+bool TickShaper::AddReplay(const std::string& spec) {
+    ReplayOptions options;
+    std::string error;
+    if (!ParseReplaySpec(spec, options, error) || !replay_manager_->CreateReplay(options, error)) {
+        std::cerr << "Invalid replay '" << spec << "': " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TickShaper::RemoveReplay(const std::string& name) {
+    if (!replay_manager_->RemoveReplay(name)) {
+        std::cerr << "No replay named " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<ReplayStats> TickShaper::GetReplayStats() const {
+    return replay_manager_->GetReplayStats();
 }
 
 void TickShaper::SetReplaySpeed(double speed) {
@@ -166,10 +576,39 @@ void TickShaper::SetThrottleRate(uint32_t messages_per_second) {
     std::cout << "Throttle rate set to " << messages_per_second << " msg/s" << std::endl;
 }
 
+void TickShaper::SetMaxMessageAge(uint64_t max_age_us) {
+    max_message_age_us_ = max_age_us;
+    load_shedder_->SetMaxAge(max_age_us);
+    if (max_age_us == 0) {
+        std::cout << "Deadline shedding disabled" << std::endl;
+    } else {
+        std::cout << "Max message age set to " << max_age_us << " μs" << std::endl;
+    }
+}
+
 void TickShaper::ResetCounters() {
-    metrics_.messages_processed.store(0);
-    metrics_.messages_throttled.store(0);
-    metrics_.total_latency_ns.store(0);
+    {
+        // Counter slots have a single writer each too, so their baseline moves
+        std::lock_guard<std::mutex> lock(counters_mutex_);
+        counter_baseline_ = counter_registry_->Collect();
+        metrics_.messages_processed.store(0);
+        metrics_.messages_throttled.store(0);
+        metrics_.messages_suppressed.store(0);
+        metrics_.messages_pruned.store(0);
+    }
+    metrics_.messages_shed.store(0);
+    load_shedder_->ResetCounters();
+    {
+        // Histograms have a single writer each, so a reset moves the baseline instead
+        std::lock_guard<std::mutex> lock(latency_mutex_);
+        latency_baseline_ = latency_tracker_->Collect();
+        latency_previous_ = latency_baseline_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(perf_mutex_);
+        perf_baseline_ = perf_counters_->Collect();
+    }
+    LockProfiler::Reset();
     metrics_.current_throughput.store(0);
     metrics_.queue_depth.store(0);
     metrics_.microburst_detected.store(false);
@@ -180,58 +619,147 @@ void TickShaper::ResetCounters() {
 }
 
 void TickShaper::ProcessingLoop() {
-    auto last_time = std::chrono::high_resolution_clock::now();
+    uint64_t last_time_ns = FastClock::NowNanos();
     uint64_t message_count = 0;
+    ThreadLatency* latency = latency_tracker_->RegisterThread();
+    ThreadCounters* counters = counter_registry_->RegisterThread();
+    ThreadTrace* trace = trace_recorder_->RegisterThread("worker");
+    ThreadPerf* perf = perf_counters_->RegisterThread();
+    ThreadSymbolCounts* symbol_counts = (metrics_exporter_ || dashboard_stream_) ? symbol_counters_->RegisterThread() 
+                                                                                  : nullptr;
     
     while (running_.load()) {
         try {
+            // One pass in perf_sample_interval_ reads the counters at every stage boundary
+            bool perf_sample = perf->Sample();
+            if (perf_sample) {
+                perf->Begin();
+            }
+            
             // Parse next ITCH message
+            uint64_t framing_start_ns = FastClock::NowNanos();
             auto message_data = itch_parser_->GetNextMessage();
             if (!message_data) {
                 std::this_thread::sleep_for(std::chrono::microseconds(100));
                 continue;
             }
+            uint64_t framed_ns = FastClock::NowNanos();
+            latency->Record(kStageFraming, framed_ns - framing_start_ns);
+            trace->Span(kTraceFraming, framing_start_ns, framed_ns);
+            if (perf_sample) {
+                perf->End(kPerfFraming);
+            }
             
-            auto start_time = std::chrono::high_resolution_clock::now();
-            
-            // Apply replay speed control
-            auto current_time = std::chrono::high_resolution_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-                current_time - last_time).count();
-            
-            double target_delay = 1000.0 / replay_speed_.load(); // microseconds
-            if (elapsed < target_delay) {
+            // Stamp pipeline entry; deadlines are measured from here, after replay pacing.
+            // Unpaced messages reuse the framing read
+            uint64_t ingest_time_ns = framed_ns;
+            double target_delay_ns = 1000000.0 / replay_speed_.load();
+            if (framed_ns - last_time_ns < target_delay_ns) {
                 std::this_thread::sleep_for(
-                    std::chrono::microseconds(static_cast<int>(target_delay - elapsed)));
+                    std::chrono::nanoseconds(static_cast<int64_t>(target_delay_ns - (framed_ns - last_time_ns))));
+                ingest_time_ns = FastClock::NowNanos();
+                if (perf_sample) {
+                    perf->Begin();
+                }
             }
-            last_time = std::chrono::high_resolution_clock::now();
+            last_time_ns = ingest_time_ns;
             
             // Check throttle
-            if (!throttle_controller_->ShouldProcess()) {
-                metrics_.messages_throttled.fetch_add(1);
+            bool admitted = throttle_controller_->ShouldProcess();
+            uint64_t throttled_ns = FastClock::NowNanos();
+            latency->Record(kStageThrottle, throttled_ns - ingest_time_ns);
+            trace->Span(kTraceThrottle, ingest_time_ns, throttled_ns, admitted);
+            if (perf_sample) {
+                perf->End(kPerfThrottle);
+            }
+            if (!admitted) {
+                counters->Add(kCounterThrottled);
+                continue;
+            }
+            
+            // Close the previous grid interval before this event touches the book.
+            // A body too short for an ITCH timestamp has no event time to give
+            if (sampling_enabled_ && message_data->timestamp != 0) {
+                snapshot_sampler_->AdvanceTo(message_data->timestamp);
+            }
+            
+            // Nobody subscribes to this symbol and the message leaves no order state
+            // behind: skip decoding it, only the burst detector still sees it.
+            // The multicast feed and the last-value cache keep every symbol wanted
+            uint16_t stock_locate = MessageProcessor::PeekStockLocate(*message_data);
+            if (symbol_counts) {
+                symbol_counts->Add(stock_locate);
+            }
+            if (!publish_all_symbols_ && !publisher_->IsSubscribed(wire::kTopicTicks, stock_locate) &&
+                !session_manager_->IsWanted(stock_locate) && processor_->IsStateless(message_data->message_type)) {
+                counters->Add(kCounterPruned);
+                trace->Mark(kTracePruned, throttled_ns, 1);
+                microburst_detector_->CheckMessage(TickData(message_data->timestamp, 0, 0, 0, 'U',
+                                                            message_data->message_type, stock_locate));
                 continue;
             }
             
             // Process message
-            TickData tick_data;
-            if (processor_->ProcessMessage(*message_data, tick_data)) {
-                // Publish to ZeroMQ
-                publisher_->Publish(tick_data);
+            ProcessorOutput output;
+            if (processor_->ProcessMessage(*message_data, output)) {
+                uint64_t processed_ns = FastClock::NowNanos();
+                if (perf_sample) {
+                    perf->End(kPerfProcess);
+                }
+                if (output.decoded_ns != 0) {
+                    latency->Record(kStageDecode, output.decoded_ns - throttled_ns);
+                    latency->Record(kStageBook, processed_ns - output.decoded_ns);
+                    trace->Span(kTraceDecode, throttled_ns, output.decoded_ns, message_data->message_type);
+                    trace->Span(kTraceBook, output.decoded_ns, processed_ns, output.count);
+                } else {
+                    latency->Record(kStageDecode, processed_ns - throttled_ns);
+                    trace->Span(kTraceDecode, throttled_ns, processed_ns, message_data->message_type);
+                }
                 
-                // Update metrics
-                auto end_time = std::chrono::high_resolution_clock::now();
-                auto latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-                    end_time - start_time).count();
+                if (sampling_enabled_) {
+                    snapshot_sampler_->MarkDirty(output.event.stock_locate, output.event.symbol_id);
+                }
+                
+                // The book is already updated; stale ticks are only kept from going downstream
+                bool to_publisher = publish_all_symbols_ ||
+                                    publisher_->IsSubscribed(wire::kTopicTicks, output.event.stock_locate);
+                bool to_sessions = session_manager_->IsWanted(output.event.stock_locate);
+                if (output.count > 0 && !to_publisher && !to_sessions) {
+                    counters->Add(kCounterPruned, output.count);
+                    trace->Mark(kTracePruned, processed_ns, output.count);
+                } else if (output.count > 0 && load_shedder_->Admit(kHandoffProcessing, ingest_time_ns)) {
+                    for (size_t i = 0; i < output.count; ++i) {
+                        output.ticks[i].ingest_time_ns = ingest_time_ns;
+                        
+                        // Publish to ZeroMQ, and to multicast when enabled
+                        if (to_publisher) {
+                            publisher_->Publish(output.ticks[i]);
+                            if (multicast_enabled_) {
+                                multicast_publisher_->Publish(output.ticks[i]);
+                            }
+                        }
+                        
+                        // Each session filters, throttles and encodes on its own thread
+                        if (to_sessions) {
+                            session_manager_->Publish(output.ticks[i]);
+                        }
+                    }
+                } else if (output.count > 0) {
+                    trace->Mark(kTraceShed, processed_ns, output.count);
+                }
+                if (perf_sample) {
+                    perf->End(kPerfHandoff);
+                }
                 
-                metrics_.messages_processed.fetch_add(1);
-                metrics_.total_latency_ns.fetch_add(latency_ns);
+                // Update metrics
+                counters->Add(kCounterProcessed);
                 
                 // Check for microburst
-                microburst_detector_->CheckMessage(tick_data);
+                microburst_detector_->CheckMessage(output.event);
                 
                 message_count++;
             }
-            
+        
         } catch (const std::exception& e) {
             std::cerr << "Processing error: " << e.what() << std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
@@ -252,6 +780,7 @@ void TickShaper::MetricsUpdateLoop() {
         auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_update).count();
         
         if (elapsed >= 1) {
+            FoldCounters();
             uint64_t current_messages = metrics_.messages_processed.load();
             uint32_t throughput = static_cast<uint32_t>(
                 (current_messages - last_message_count) / elapsed);
@@ -259,6 +788,11 @@ void TickShaper::MetricsUpdateLoop() {
             metrics_.current_throughput.store(throughput);
             metrics_.queue_depth.store(processor_->GetQueueDepth());
             
+            LoadSheddingStats shed_stats = load_shedder_->GetStats();
+            metrics_.messages_shed.store(shed_stats.shed[kHandoffProcessing] + 
+                                         shed_stats.shed[kHandoffConflation] + 
+                                         shed_stats.shed[kHandoffPublish]);
+            
             // Update uptime
             auto uptime = std::chrono::duration_cast<std::chrono::seconds>(
                 now - start_time_).count();
@@ -266,6 +800,15 @@ void TickShaper::MetricsUpdateLoop() {
             
             // Update CPU and memory usage
             UpdateSystemMetrics();
+            UpdateLatencyReport();
+            PublishMetricsSegment();
+            PublishPrometheus(static_cast<uint64_t>(elapsed));
+            FastClock::Recalibrate();
+            
+            std::string trace_file = trace_recorder_->FlushTriggered();
+            if (!trace_file.empty()) {
+                std::cout << "Latency over " << trace_trigger_us_ << " μs, trace written to " << trace_file << std::endl;
+            }
             
             last_message_count = current_messages;
             last_update = now;
@@ -273,15 +816,422 @@ void TickShaper::MetricsUpdateLoop() {
     }
 }
 
+void TickShaper::FoldCounters() {
+    std::vector<uint64_t> totals = counter_registry_->Collect();
+    
+    std::lock_guard<std::mutex> lock(counters_mutex_);
+    if (counter_baseline_.empty()) {
+        counter_baseline_.resize(kNumCounters, 0);
+    }
+    metrics_.messages_processed.store(totals[kCounterProcessed] - counter_baseline_[kCounterProcessed]);
+    metrics_.messages_throttled.store(totals[kCounterThrottled] - counter_baseline_[kCounterThrottled]);
+    metrics_.messages_suppressed.store(totals[kCounterSuppressed] - counter_baseline_[kCounterSuppressed]);
+    metrics_.messages_pruned.store(totals[kCounterPruned] - counter_baseline_[kCounterPruned]);
+}
+
+// Counters go out as raw totals, which never move backwards on a reset, so
+// readers can difference them across updates
+void TickShaper::PublishMetricsSegment() {
+    if (!metrics_segment_) {
+        return;
+    }
+    std::vector<uint64_t> totals = counter_registry_->Collect();
+    LoadSheddingStats shed_stats = load_shedder_->GetStats();
+    
+    metrics_segment_->BeginUpdate();
+    metrics_segment_->SetValue(kSegmentProcessed, totals[kCounterProcessed]);
+    metrics_segment_->SetValue(kSegmentThrottled, totals[kCounterThrottled]);
+    metrics_segment_->SetValue(kSegmentSuppressed, totals[kCounterSuppressed]);
+    metrics_segment_->SetValue(kSegmentPruned, totals[kCounterPruned]);
+    metrics_segment_->SetValue(kSegmentAddOrders, totals[kCounterAddOrders]);
+    metrics_segment_->SetValue(kSegmentExecutions, totals[kCounterExecutions]);
+    metrics_segment_->SetValue(kSegmentTrades, totals[kCounterTrades]);
+    metrics_segment_->SetValue(kSegmentCancels, totals[kCounterCancels]);
+    metrics_segment_->SetValue(kSegmentShedProcessing, shed_stats.shed[kHandoffProcessing]);
+    metrics_segment_->SetValue(kSegmentShedConflation, shed_stats.shed[kHandoffConflation]);
+    metrics_segment_->SetValue(kSegmentShedPublish, shed_stats.shed[kHandoffPublish]);
+    metrics_segment_->SetValue(kSegmentPublished, publisher_->GetPublishedCount());
+    metrics_segment_->SetValue(kSegmentBatches, publisher_->GetBatchCount());
+    metrics_segment_->SetValue(kSegmentDropped, publisher_->GetDroppedCount());
+    metrics_segment_->SetValue(kSegmentPublishPruned, publisher_->GetPrunedCount());
+    metrics_segment_->SetValue(kSegmentThroughput, metrics_.current_throughput.load());
+    metrics_segment_->SetValue(kSegmentQueueDepth, metrics_.queue_depth.load());
+    metrics_segment_->SetValue(kSegmentThrottleRate, throttle_rate_.load());
+    metrics_segment_->SetValue(kSegmentMicroburst, metrics_.microburst_detected.load() ? 1 : 0);
+    metrics_segment_->SetValue(kSegmentCpuUsage, static_cast<uint64_t>(metrics_.cpu_usage.load() * 100.0));
+    metrics_segment_->SetValue(kSegmentMemoryUsage, metrics_.memory_usage.load());
+    metrics_segment_->SetValue(kSegmentUptime, metrics_.uptime_seconds.load());
+    
+    {
+        std::lock_guard<std::mutex> lock(latency_mutex_);
+        for (size_t stage = 0; stage < latency_report_.size(); ++stage) {
+            const LatencyPercentiles& interval = latency_report_[stage].interval;
+            metrics_segment_->SetHistogram(static_cast<int>(stage), latency_previous_[stage].GetCount(),
+                                           latency_previous_[stage].GetSum(), interval.p50, interval.p99,
+                                           interval.p999, interval.p9999, interval.max);
+        }
+    }
+    metrics_segment_->EndUpdate();
+}
+
+// Renders the whole scrape page at once, so a scrape never waits on a
+// pipeline lock. Counters are raw totals for the same reason as above
+void TickShaper::PublishPrometheus(uint64_t elapsed_seconds) {
+    if (!metrics_exporter_) {
+        return;
+    }
+    std::vector<uint64_t> totals = counter_registry_->Collect();
+    LoadSheddingStats shed_stats = load_shedder_->GetStats();
+    PrometheusPage page;
+    
+    page.Declare("tickshaper_messages_processed_total", "counter", "Feed messages decoded by the workers");
+    page.Sample("tickshaper_messages_processed_total", "", totals[kCounterProcessed]);
+    page.Declare("tickshaper_messages_throttled_total", "counter", "Feed messages rejected by the rate limiter");
+    page.Sample("tickshaper_messages_throttled_total", "", totals[kCounterThrottled]);
+    page.Declare("tickshaper_messages_suppressed_total", "counter", "Book events that left the inside quote unchanged");
+    page.Sample("tickshaper_messages_suppressed_total", "", totals[kCounterSuppressed]);
+    page.Declare("tickshaper_messages_pruned_total", "counter", "Ticks dropped by a worker because nobody subscribed");
+    page.Sample("tickshaper_messages_pruned_total", "", totals[kCounterPruned]);
+    
+    page.Declare("tickshaper_itch_messages_total", "counter", "Decoded feed messages by type");
+    page.Sample("tickshaper_itch_messages_total", "type=\"add_order\"", totals[kCounterAddOrders]);
+    page.Sample("tickshaper_itch_messages_total", "type=\"execution\"", totals[kCounterExecutions]);
+    page.Sample("tickshaper_itch_messages_total", "type=\"trade\"", totals[kCounterTrades]);
+    page.Sample("tickshaper_itch_messages_total", "type=\"cancel\"", totals[kCounterCancels]);
+    
+    page.Declare("tickshaper_messages_shed_total", "counter", "Messages past their deadline at a queue hand-off");
+    page.Sample("tickshaper_messages_shed_total", "handoff=\"processing\"", shed_stats.shed[kHandoffProcessing]);
+    page.Sample("tickshaper_messages_shed_total", "handoff=\"conflation\"", shed_stats.shed[kHandoffConflation]);
+    page.Sample("tickshaper_messages_shed_total", "handoff=\"publish\"", shed_stats.shed[kHandoffPublish]);
+    
+    page.Declare("tickshaper_published_ticks_total", "counter", "Ticks sent by the publisher");
+    page.Sample("tickshaper_published_ticks_total", "", publisher_->GetPublishedCount());
+    page.Declare("tickshaper_publish_batches_total", "counter", "Batches sent by the publisher");
+    page.Sample("tickshaper_publish_batches_total", "", publisher_->GetBatchCount());
+    page.Declare("tickshaper_publish_dropped_total", "counter", "Ticks the publisher could not queue");
+    page.Sample("tickshaper_publish_dropped_total", "", publisher_->GetDroppedCount());
+    page.Declare("tickshaper_publish_pruned_total", "counter", "Ticks the publisher dropped for lack of subscribers");
+    page.Sample("tickshaper_publish_pruned_total", "", publisher_->GetPrunedCount());
+    
+    page.Declare("tickshaper_throughput_messages_per_second", "gauge", "Messages processed over the last second");
+    page.Sample("tickshaper_throughput_messages_per_second", "", static_cast<uint64_t>(metrics_.current_throughput.load()));
+    page.Declare("tickshaper_queue_depth", "gauge", "Messages waiting in the processor");
+    page.Sample("tickshaper_queue_depth", "", static_cast<uint64_t>(metrics_.queue_depth.load()));
+    page.Declare("tickshaper_throttle_rate_limit", "gauge", "Configured rate limit in messages per second");
+    page.Sample("tickshaper_throttle_rate_limit", "", static_cast<uint64_t>(throttle_rate_.load()));
+    page.Declare("tickshaper_microburst_active", "gauge", "1 while a microburst is in progress");
+    page.Sample("tickshaper_microburst_active", "", static_cast<uint64_t>(metrics_.microburst_detected.load() ? 1 : 0));
+    page.Declare("tickshaper_microburst_symbols", "gauge", "Symbols in a microburst");
+    page.Sample("tickshaper_microburst_symbols", "", static_cast<uint64_t>(microburst_detector_->GetBurstingSymbols().size()));
+    page.Declare("tickshaper_cpu_usage_percent", "gauge", "Process CPU usage");
+    page.Sample("tickshaper_cpu_usage_percent", "", metrics_.cpu_usage.load());
+    page.Declare("tickshaper_resident_memory_bytes", "gauge", "Current resident set size");
+    page.Sample("tickshaper_resident_memory_bytes", "", metrics_.memory_usage.load());
+    page.Declare("tickshaper_uptime_seconds", "gauge", "Seconds since start");
+    page.Sample("tickshaper_uptime_seconds", "", metrics_.uptime_seconds.load());
+    
+    if (enable_conflation_) {
+        uint64_t updates_in = 0;
+        uint64_t updates_out = 0;
+        for (const ConflationStats& stats : publisher_->GetConflationStats()) {
+            updates_in += stats.updates_in;
+            updates_out += stats.updates_out;
+        }
+        page.Declare("tickshaper_conflation_updates_in_total", "counter", "Updates entering the conflator");
+        page.Sample("tickshaper_conflation_updates_in_total", "", updates_in);
+        page.Declare("tickshaper_conflation_updates_out_total", "counter", "Updates leaving the conflator");
+        page.Sample("tickshaper_conflation_updates_out_total", "", updates_out);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(latency_mutex_);
+        page.Declare("tickshaper_latency_seconds", "histogram", "Pipeline stage latency since start");
+        for (size_t stage = 0; stage < latency_previous_.size(); ++stage) {
+            std::string labels = std::string("stage=\"") + LatencyStageName(static_cast<LatencyStage>(stage)) + "\"";
+            page.Histogram("tickshaper_latency_seconds", labels, latency_previous_[stage]);
+        }
+    }
+    
+    // Busiest symbols by feed messages over the last interval
+    std::vector<uint64_t> symbol_totals = symbol_counters_->Collect();
+    page.Declare("tickshaper_symbol_messages_per_second", "gauge", "Feed message rate of the busiest symbols");
+    for (const auto& symbol : BusiestSymbols(symbol_totals, symbol_previous_, metrics_top_symbols_)) {
+        page.Sample("tickshaper_symbol_messages_per_second", "stock_locate=\"" + std::to_string(symbol.second) + "\"",
+                    static_cast<double>(symbol.first) / std::max<uint64_t>(elapsed_seconds, 1));
+    }
+    symbol_previous_ = std::move(symbol_totals);
+    
+    metrics_exporter_->SetPage(page.Take());
+}
+
+std::vector<std::pair<uint64_t, uint16_t>> TickShaper::BusiestSymbols(const std::vector<uint64_t>& current,
+                                                                     const std::vector<uint64_t>& previous, 
+                                                                     size_t top) {
+    std::vector<std::pair<uint64_t, uint16_t>> busiest;
+    for (size_t locate = 0; locate < current.size(); ++locate) {
+        uint64_t delta = current[locate] - (locate < previous.size() ? previous[locate] : 0);
+        if (delta > 0) {
+            busiest.emplace_back(delta, static_cast<uint16_t>(locate));
+        }
+    }
+    top = std::min(busiest.size(), top);
+    std::partial_sort(busiest.begin(), busiest.begin() + top, busiest.end(), 
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+    busiest.resize(top);
+    return busiest;
+}
+
+// One dashboard snapshot as JSON: rates and total latency over the last
+// stream interval, the burst state, recent bursts and the busiest symbols.
+// Nothing is rendered while nobody watches, so the first snapshot after a
+// gap starts a new interval and reports zero rates
+std::string TickShaper::RenderDashboard() {
+    DashboardTotals current;
+    current.time_ns = FastClock::NowNanos();
+    current.published = publisher_->GetPublishedCount();
+    LoadSheddingStats shed_stats = load_shedder_->GetStats();
+    current.shed = shed_stats.shed[kHandoffProcessing] + shed_stats.shed[kHandoffConflation] + 
+                   shed_stats.shed[kHandoffPublish];
+    current.counters = counter_registry_->Collect();
+    current.symbols = symbol_counters_->Collect();
+    current.latency = latency_tracker_->Collect();
+    
+    DashboardTotals& previous = dashboard_previous_;
+    if (current.time_ns - previous.time_ns > 2ULL * dashboard_interval_ms_ * 1000000) {
+        previous = current;
+    }
+    double seconds = std::max(current.time_ns - previous.time_ns, uint64_t{1}) / 1e9;
+    auto rate = [&](uint64_t now, uint64_t before) {
+        return static_cast<uint64_t>((now - before) / seconds + 0.5);
+    };
+    LatencyPercentiles latency = current.latency[kStageTotal].Since(previous.latency[kStageTotal]).Summarize();
+    
+    std::ostringstream oss;
+    oss << "{"
+        << "\"type\":\"snapshot\","
+        << "\"time_ms\":" << FastClock::ToRealtime(current.time_ns) / 1000000 << ","
+        << "\"interval_ms\":" << (current.time_ns - previous.time_ns) / 1000000 << ","
+        << "\"throughput\":" << rate(current.counters[kCounterProcessed], previous.counters[kCounterProcessed]) << ","
+        << "\"throttled\":" << rate(current.counters[kCounterThrottled], previous.counters[kCounterThrottled]) << ","
+        << "\"pruned\":" << rate(current.counters[kCounterPruned], previous.counters[kCounterPruned]) << ","
+        << "\"published\":" << rate(current.published, previous.published) << ","
+        << "\"shed\":" << rate(current.shed, previous.shed) << ","
+        << "\"queue_depth\":" << processor_->GetQueueDepth() << ","
+        << "\"throttle_rate\":" << throttle_rate_.load() << ","
+        << "\"cpu\":" << std::fixed << std::setprecision(1) << metrics_.cpu_usage.load() << ","
+        << "\"memory_bytes\":" << metrics_.memory_usage.load() << ","
+        << "\"uptime_s\":" << metrics_.uptime_seconds.load() << ","
+        << "\"latency_ns\":{"
+        << "\"count\":" << latency.count << ","
+        << "\"p50\":" << latency.p50 << ","
+        << "\"p99\":" << latency.p99 << ","
+        << "\"p999\":" << latency.p999 << ","
+        << "\"max\":" << latency.max << "},"
+        << "\"microburst\":{"
+        << "\"active\":" << (microburst_detector_->IsCurrentlyInMicroburst() ? "true" : "false") << ","
+        << "\"rate\":" << microburst_detector_->GetCurrentRate() << ","
+        << "\"symbols\":[";
+    std::vector<SymbolBurst> bursting = microburst_detector_->GetBurstingSymbols();
+    for (size_t i = 0; i < bursting.size() && i < metrics_top_symbols_; ++i) {
+        oss << (i > 0 ? "," : "") << "{"
+            << "\"stock_locate\":" << bursting[i].stock_locate << ","
+            << "\"start_ms\":" << bursting[i].start_time_ns / 1000000 << ","
+            << "\"rate\":" << bursting[i].rate << ","
+            << "\"peak_rate\":" << bursting[i].peak_rate << "}";
+    }
+    oss << "]},";
+    
+    // Newest first; burst times are feed event time, milliseconds since midnight
+    std::vector<MicroburstEvent> bursts = microburst_detector_->GetRecentEvents();
+    size_t first_burst = bursts.size() > DASHBOARD_BURSTS ? bursts.size() - DASHBOARD_BURSTS : 0;
+    oss << "\"bursts\":[";
+    for (size_t i = bursts.size(); i > first_burst; --i) {
+        const MicroburstEvent& burst = bursts[i - 1];
+        oss << (i < bursts.size() ? "," : "") << "{"
+            << "\"stock_locate\":" << burst.stock_locate << ","
+            << "\"start_ms\":" << burst.start_time_ns / 1000000 << ","
+            << "\"duration_ms\":" << (burst.end_time_ns - burst.start_time_ns) / 1000000 << ","
+            << "\"peak_rate\":" << burst.peak_rate << ","
+            << "\"messages\":" << burst.total_messages << ","
+            << "\"severity\":\"" << burst.severity << "\"}";
+    }
+    oss << "],\"symbols\":[";
+    std::vector<std::pair<uint64_t, uint16_t>> busiest = BusiestSymbols(current.symbols, previous.symbols, 
+                                                                        metrics_top_symbols_);
+    for (size_t i = 0; i < busiest.size(); ++i) {
+        oss << (i > 0 ? "," : "") << "{"
+            << "\"stock_locate\":" << busiest[i].second << ","
+            << "\"rate\":" << rate(busiest[i].first, 0) << "}";
+    }
+    oss << "]}";
+    
+    dashboard_previous_ = std::move(current);
+    return oss.str();
+}
+
+void TickShaper::UpdateLatencyReport() {
+    std::vector<HistogramSnapshot> current = latency_tracker_->Collect();
+    
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    if (latency_baseline_.empty()) {
+        latency_baseline_.resize(kNumLatencyStages);
+        latency_previous_.resize(kNumLatencyStages);
+    }
+    
+    latency_report_.clear();
+    for (size_t stage = 0; stage < kNumLatencyStages; ++stage) {
+        LatencySummary summary;
+        summary.stage = LatencyStageName(static_cast<LatencyStage>(stage));
+        summary.interval = current[stage].Since(latency_previous_[stage]).Summarize();
+        summary.cumulative = current[stage].Since(latency_baseline_[stage]).Summarize();
+        
+        // The exact max holds while nothing has been reset
+        if (latency_baseline_[stage].GetCount() == 0) {
+            summary.cumulative.max = current[stage].GetMax();
+        }
+        latency_report_.push_back(summary);
+    }
+    latency_previous_ = std::move(current);
+}
+
+std::vector<LatencySummary> TickShaper::GetLatencyReport() const {
+    std::lock_guard<std::mutex> lock(latency_mutex_);
+    return latency_report_;
+}
+
+void TickShaper::SetTracing(bool enabled) {
+    trace_recorder_->SetEnabled(enabled);
+    std::cout << "Tracing " << (enabled ? "enabled" : "disabled") << std::endl;
+}
+
+bool TickShaper::DumpTrace(const std::string& path) const {
+    return trace_recorder_->WriteChromeTrace(path);
+}
+
+void TickShaper::SetLockProfiling(bool enabled) {
+    LockProfiler::SetEnabled(enabled);
+    std::cout << "Lock profiling " << (enabled ? "enabled" : "disabled") << std::endl;
+}
+
+std::vector<LockReport> TickShaper::GetLockReport() const {
+    return LockProfiler::GetReport();
+}
+
+std::vector<MicroburstEvent> TickShaper::GetRecentBursts() const {
+    return microburst_detector_->GetRecentEvents();
+}
+
+std::vector<SymbolBurst> TickShaper::GetBurstingSymbols() const {
+    return microburst_detector_->GetBurstingSymbols();
+}
+
+std::string FormatPerfSummary(const PerfSummary& summary) {
+    auto value = [](double v) { 
+        std::ostringstream oss;
+        if (v < 0) {
+            oss << "n/a";
+        } else {
+            oss << std::fixed << std::setprecision(v < 10.0 ? 3 : 0) << v;
+        }
+        return oss.str();
+    };
+    return "cycles=" + value(summary.cycles) + " IPC=" + value(summary.instructions_per_cycle) +
+           " cache_misses=" + value(summary.cache_misses) + " branch_misses=" + value(summary.branch_misses) +
+           " context_switches=" + value(summary.context_switches);
+}
+
+std::vector<PerfSummary> TickShaper::GetPerfReport() const {
+    std::vector<PerfSummary> report;
+    if (!perf_counters_->IsEnabled()) {
+        return report;
+    }
+    std::vector<PerfStageStats> current = perf_counters_->Collect();
+    uint32_t open_events = perf_counters_->GetOpenEvents();
+    
+    std::lock_guard<std::mutex> lock(perf_mutex_);
+    for (size_t stage = 0; stage < current.size(); ++stage) {
+        PerfStageStats delta = current[stage];
+        if (!perf_baseline_.empty()) {
+            delta.messages -= perf_baseline_[stage].messages;
+            for (size_t event = 0; event < kNumPerfEvents; ++event) {
+                delta.counts[event] -= perf_baseline_[stage].counts[event];
+            }
+        }
+        
+        auto per_message = [&](PerfEvent event) {
+            return (open_events & (1u << event)) ? delta.PerMessage(event) : -1.0;
+        };
+        PerfSummary summary;
+        summary.stage = delta.stage;
+        summary.samples = delta.messages;
+        summary.cycles = per_message(kPerfCycles);
+        summary.cache_misses = per_message(kPerfCacheMisses);
+        summary.branch_misses = per_message(kPerfBranchMisses);
+        summary.context_switches = per_message(kPerfContextSwitches);
+        summary.instructions_per_cycle = -1.0;
+        if ((open_events & (1u << kPerfInstructions)) && delta.counts[kPerfCycles] > 0) {
+            summary.instructions_per_cycle = static_cast<double>(delta.counts[kPerfInstructions]) / 
+                                             delta.counts[kPerfCycles];
+        }
+        report.push_back(summary);
+    }
+    return report;
+}
+
 bool TickShaper::LoadConfiguration(const std::string& config_file) {
     // Default configuration
     input_file_ = "data/sample.itch";
     symbols_file_ = "";
     zmq_endpoint_ = "tcp://*:5555";
+    enable_conflation_ = false;
+    publish_format_ = "binary";
+    publish_batch_size_ = 64;
+    publish_linger_us_ = 50;
+    publish_ring_capacity_ = 65536;
+    publish_sinks_.clear();
+    publish_shards_ = 1;
+    publish_shard_cores_.clear();
+    prune_unsubscribed_ = true;
+    publish_egress_stamp_ = false;
+    multicast_enabled_ = false;
+    multicast_group_ = "239.192.1.1";
+    multicast_port_ = 31001;
+    multicast_interface_ = "127.0.0.1";
+    multicast_ttl_ = 1;
+    mold_session_ = "TICKSHAPER";
+    retransmit_port_ = 31002;
+    retransmit_buffer_ = 262144;
+    snapshot_endpoint_ = "";
+    publish_all_symbols_ = false;
+    shaping_sessions_.clear();
+    replays_.clear();
+    max_message_age_us_ = 0;
+    output_mode_ = "ticks";
+    trace_enabled_ = false;
+    trace_buffer_events_ = TraceRecorder::DEFAULT_EVENTS_PER_THREAD;
+    trace_trigger_us_ = 0;
+    trace_dir_ = "/tmp";
+    perf_counters_enabled_ = false;
+    lock_profiling_ = false;
+    perf_sample_interval_ = PerfCounters::DEFAULT_SAMPLE_INTERVAL;
+    metrics_shm_name_ = "/tickshaper-metrics";
+    metrics_http_address_ = "0.0.0.0";
+    metrics_http_port_ = 0;
+    metrics_top_symbols_ = 10;
+    dashboard_address_ = "0.0.0.0";
+    dashboard_port_ = 0;
+    dashboard_interval_ms_ = 500;
+    sampling_enabled_ = false;
+    sample_interval_ms_ = 100;
+    sample_clock_ = "event";
     shared_memory_size_ = 1024 * 1024 * 1024; // 1GB
     worker_thread_count_ = std::thread::hardware_concurrency();
     enable_cpu_affinity_ = true;
     microburst_threshold_ = 50000;
+    microburst_end_threshold_ = 30000;
+    min_microburst_duration_ms_ = 100;
+    symbol_microburst_threshold_ = 5000;
+    symbol_microburst_end_threshold_ = 3000;
     log_level_ = "INFO";
     enable_monitoring_ = true;
     monitoring_interval_ = 1;
@@ -311,6 +1261,52 @@ bool TickShaper::LoadConfiguration(const std::string& config_file) {
                 if (key == "input_file") input_file_ = value;
                 else if (key == "symbols_file") symbols_file_ = value;
                 else if (key == "zmq_endpoint") zmq_endpoint_ = value;
+                else if (key == "enable_conflation") enable_conflation_ = (value == "true");
+                else if (key == "publish_format") publish_format_ = value;
+                else if (key == "publish_batch_size") publish_batch_size_ = std::stoull(value);
+                else if (key == "publish_linger_us") publish_linger_us_ = std::stoul(value);
+                else if (key == "publish_ring_capacity") publish_ring_capacity_ = std::stoull(value);
+                else if (key == "publish_sink") publish_sinks_.push_back(value);
+                else if (key == "publish_shards") publish_shards_ = std::max(1, std::stoi(value));
+                else if (key == "publish_shard_cores") {
+                    // Comma-separated, one core per shard; -1 leaves a shard unpinned
+                    std::istringstream cores(value);
+                    std::string core;
+                    while (std::getline(cores, core, ',')) {
+                        publish_shard_cores_.push_back(std::stoi(core));
+                    }
+                }
+                else if (key == "prune_unsubscribed") prune_unsubscribed_ = (value == "true");
+                else if (key == "publish_egress_stamp") publish_egress_stamp_ = (value == "true");
+                else if (key == "multicast_enabled") multicast_enabled_ = (value == "true");
+                else if (key == "multicast_group") multicast_group_ = value;
+                else if (key == "multicast_port") multicast_port_ = static_cast<uint16_t>(std::stoul(value));
+                else if (key == "multicast_interface") multicast_interface_ = value;
+                else if (key == "multicast_ttl") multicast_ttl_ = std::stoi(value);
+                else if (key == "mold_session") mold_session_ = value;
+                else if (key == "retransmit_port") retransmit_port_ = static_cast<uint16_t>(std::stoul(value));
+                else if (key == "retransmit_buffer") retransmit_buffer_ = std::stoull(value);
+                else if (key == "snapshot_endpoint") snapshot_endpoint_ = value;
+                else if (key == "shaping_session") shaping_sessions_.push_back(value);
+                else if (key == "replay") replays_.push_back(value);
+                else if (key == "max_message_age_us") max_message_age_us_ = std::stoull(value);
+                else if (key == "output_mode") output_mode_ = value;
+                else if (key == "trace_enabled") trace_enabled_ = (value == "true");
+                else if (key == "trace_buffer_events") trace_buffer_events_ = std::stoull(value);
+                else if (key == "trace_trigger_us") trace_trigger_us_ = std::stoull(value);
+                else if (key == "trace_dir") trace_dir_ = value;
+                else if (key == "perf_counters") perf_counters_enabled_ = (value == "true");
+                else if (key == "perf_sample_interval") perf_sample_interval_ = std::stoul(value);
+                else if (key == "lock_profiling") lock_profiling_ = (value == "true");
+                else if (key == "metrics_shm_name") metrics_shm_name_ = value;
+                else if (key == "metrics_http_address") metrics_http_address_ = value;
+                else if (key == "metrics_http_port") metrics_http_port_ = static_cast<uint16_t>(std::stoul(value));
+                else if (key == "metrics_top_symbols") metrics_top_symbols_ = std::stoul(value);
+                else if (key == "dashboard_address") dashboard_address_ = value;
+                else if (key == "dashboard_port") dashboard_port_ = static_cast<uint16_t>(std::stoul(value));
+                else if (key == "dashboard_interval_ms") dashboard_interval_ms_ = std::stoul(value);
+                else if (key == "sample_interval_ms") sample_interval_ms_ = std::stoull(value);
+                else if (key == "sample_clock") sample_clock_ = value;
                 else if (key == "shared_memory_size") shared_memory_size_ = std::stoull(value);
                 else if (key == "worker_threads") {
                     int threads = std::stoi(value);
@@ -320,6 +1316,10 @@ bool TickShaper::LoadConfiguration(const std::string& config_file) {
                 else if (key == "default_throttle_rate") throttle_rate_.store(std::stoul(value));
                 else if (key == "default_replay_speed") replay_speed_.store(std::stod(value));
                 else if (key == "microburst_threshold") microburst_threshold_ = std::stoul(value);
+                else if (key == "microburst_end_threshold") microburst_end_threshold_ = std::stoul(value);
+                else if (key == "min_microburst_duration_ms") min_microburst_duration_ms_ = std::stoull(value);
+                else if (key == "symbol_microburst_threshold") symbol_microburst_threshold_ = std::stoul(value);
+                else if (key == "symbol_microburst_end_threshold") symbol_microburst_end_threshold_ = std::stoul(value);
                 else if (key == "log_level") log_level_ = value;
                 else if (key == "enable_monitoring") enable_monitoring_ = (value == "true");
                 else if (key == "monitoring_interval") monitoring_interval_ = std::stoi(value);
@@ -355,13 +1355,18 @@ void TickShaper::UpdateSystemMetrics() {
             metrics_.cpu_usage.store(std::min(cpu_percent, 100.0));
         }
         
-        // Memory usage in bytes (RSS)
-        metrics_.memory_usage.store(usage.ru_maxrss * 1024);
-        
         last_user_time = user_time;
         last_sys_time = sys_time;
     }
     
+    // Memory usage in bytes: current RSS, where ru_maxrss would only give the peak
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size_pages = 0;
+    uint64_t resident_pages = 0;
+    if (statm >> size_pages >> resident_pages) {
+        metrics_.memory_usage.store(resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)));
+    }
+    
     last_cpu_time = current_time;
 }
 
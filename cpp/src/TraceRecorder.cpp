@@ -0,0 +1,196 @@
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace tickshaper {
+
+ThreadTrace::ThreadTrace(TraceRecorder& recorder, const std::string& name, uint32_t thread_id, size_t capacity)
+    : recorder_(recorder), name_(name), thread_id_(thread_id) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    mask_ = rounded - 1;
+    slots_ = std::make_unique<Slot[]>(rounded);
+}
+
+void ThreadTrace::Snapshot(std::vector<TraceEvent>& events) const {
+    uint64_t capacity = mask_ + 1;
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t first = head > capacity ? head - capacity : 0;
+    
+    size_t base = events.size();
+    for (uint64_t index = first; index < head; ++index) {
+        const Slot& slot = slots_[index & mask_];
+        uint64_t tagged_arg = slot.tagged_arg.load(std::memory_order_relaxed);
+        
+        TraceEvent event;
+        event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+        event.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+        event.arg = tagged_arg >> 8;
+        event.id = static_cast<TraceEventId>(tagged_arg & 0xFF);
+        events.push_back(event);
+    }
+    
+    // The writer may have lapped the copy: records it is writing or has
+    // rewritten since are at index head_now - capacity and above that
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t head_now = head_.load(std::memory_order_relaxed);
+    if (head_now >= capacity && head_now - capacity + 1 > first) {
+        size_t torn = static_cast<size_t>(std::min(head_now - capacity + 1, head) - first);
+        events.erase(events.begin() + base, events.begin() + base + torn);
+    }
+}
+
+TraceRecorder::TraceRecorder() : events_per_thread_(DEFAULT_EVENTS_PER_THREAD) {
+}
+
+ThreadTrace* TraceRecorder::RegisterThread(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t thread_id = static_cast<uint32_t>(threads_.size() + 1);
+    threads_.push_back(std::make_unique<ThreadTrace>(*this, name + " " + std::to_string(thread_id),
+                                                     thread_id, events_per_thread_));
+    return threads_.back().get();
+}
+
+void TraceRecorder::SetTrigger(uint64_t latency_ns, const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trigger_directory_ = directory;
+    trigger_ns_.store(latency_ns);
+}
+
+void TraceRecorder::Trigger(ThreadTrace& trace, uint64_t latency_ns, uint64_t now_ns) {
+    uint64_t last_ns = last_trigger_ns_.load(std::memory_order_relaxed);
+    if (last_ns != 0 && now_ns - last_ns < MIN_TRIGGER_INTERVAL_NS) {
+        return;
+    }
+    
+    bool expected = false;
+    if (!triggered_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+    
+    // Freeze every ring with the spike as its newest record
+    last_trigger_ns_.store(now_ns, std::memory_order_relaxed);
+    trace.Mark(kTraceTrigger, now_ns, latency_ns);
+    enabled_.store(false);
+}
+
+std::string TraceRecorder::FlushTriggered() {
+    if (!triggered_.load()) {
+        return "";
+    }
+    
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        directory = trigger_directory_;
+    }
+    std::string path = directory + "/tickshaper-trace-" + std::to_string(last_trigger_ns_.load()) + ".json";
+    bool written = WriteChromeTrace(path);
+    
+    enabled_.store(true);
+    triggered_.store(false);
+    return written ? path : "";
+}
+
+bool TraceRecorder::WriteChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Cannot write trace to " << path << std::endl;
+        return false;
+    }
+    
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    file << std::fixed << std::setprecision(3);
+    
+    bool first = true;
+    size_t total = 0;
+    std::vector<TraceEvent> events;
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    for (const auto& thread : threads_) {
+        if (!first) {
+            file << ",\n";
+        }
+        first = false;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->GetThreadId()
+             << ",\"args\":{\"name\":\"" << thread->GetName() << "\"}}";
+        
+        events.clear();
+        thread->Snapshot(events);
+        total += events.size();
+        
+        // Chrome trace times are microseconds
+        for (const TraceEvent& event : events) {
+            file << ",\n{\"name\":\"" << EventName(event.id) << "\",\"cat\":\"tickshaper\",\"pid\":1,\"tid\":"
+                 << thread->GetThreadId() << ",\"ts\":" << event.start_ns / 1000.0;
+            
+            switch (event.id) {
+                case kTraceQueueDepth:
+                    file << ",\"ph\":\"C\"";
+                    break;
+                case kTracePruned:
+                case kTraceShed:
+                case kTraceTrigger:
+                    file << ",\"ph\":\"i\",\"s\":\"t\"";
+                    break;
+                default:
+                    file << ",\"ph\":\"X\",\"dur\":" << event.duration_ns / 1000.0;
+                    break;
+            }
+            
+            const char* arg_name = ArgName(event.id);
+            if (arg_name) {
+                file << ",\"args\":{\"" << arg_name << "\":" << event.arg << "}";
+            }
+            file << "}";
+        }
+    }
+    
+    file << "\n]}\n";
+    if (!file) {
+        std::cerr << "Failed writing trace to " << path << std::endl;
+        return false;
+    }
+    
+    std::cout << "Trace of " << total << " events from " << threads_.size() << " threads written to "
+              << path << std::endl;
+    return true;
+}
+
+const char* TraceRecorder::EventName(TraceEventId id) {
+    switch (id) {
+        case kTraceFraming: return "framing";
+        case kTraceThrottle: return "throttle";
+        case kTraceDecode: return "decode";
+        case kTraceBook: return "book";
+        case kTracePruned: return "pruned";
+        case kTraceShed: return "shed";
+        case kTraceFlush: return "flush";
+        case kTraceSend: return "serialize_send";
+        case kTraceQueueDepth: return "publish_queue_depth";
+        case kTraceTrigger: return "latency_trigger";
+        default: return "unknown";
+    }
+}
+
+const char* TraceRecorder::ArgName(TraceEventId id) {
+    switch (id) {
+        case kTraceThrottle: return "admitted";
+        case kTraceDecode: return "message_type";
+        case kTraceBook: return "ticks_out";
+        case kTracePruned: return "ticks";
+        case kTraceShed: return "ticks";
+        case kTraceFlush: return "ticks";
+        case kTraceSend: return "stock_locate";
+        case kTraceQueueDepth: return "depth";
+        case kTraceTrigger: return "latency_ns";
+        default: return nullptr;
+    }
+}
+
+} // namespace tickshaper
\ No newline at end of file
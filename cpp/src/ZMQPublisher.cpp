@@ -1,128 +1,182 @@
 #include "ZMQPublisher.h"
+#include "LoadShedder.h"
 #include <iostream>
-#include <sstream>
-#include <iomanip>
 
 namespace tickshaper {
 
-ZMQPublisher::ZMQPublisher() : context_(1), publisher_(context_, ZMQ_PUB) {
+ZMQPublisher::ZMQPublisher() : load_shedder_(nullptr), last_values_(nullptr), latency_tracker_(nullptr), trace_recorder_(nullptr),
+                               perf_counters_(nullptr) {
 }
 
 ZMQPublisher::~ZMQPublisher() {
     Stop();
 }
 
-bool ZMQPublisher::Initialize(const std::string& endpoint) {
-    try {
-        // Set high water mark to prevent blocking
-        int hwm = 10000;
-        publisher_.setsockopt(ZMQ_SNDHWM, &hwm, sizeof(hwm));
-        
-        // Bind to endpoint
-        publisher_.bind(endpoint);
-        
-        running_.store(true);
-        publishing_thread_ = std::thread([this]() { PublishingLoop(); });
+std::string ZMQPublisher::ShardEndpoint(const std::string& endpoint, size_t shard_index) {
+    if (endpoint.compare(0, 6, "tcp://") == 0) {
+        size_t colon = endpoint.rfind(':');
+        if (colon != std::string::npos && colon > 5) {
+            try {
+                int port = std::stoi(endpoint.substr(colon + 1));
+                return endpoint.substr(0, colon + 1) + std::to_string(port + static_cast<int>(shard_index));
+            } catch (const std::exception&) {
+                // Wildcard port; every shard binds its own ephemeral port
+            }
+        }
+        return endpoint;
+    }
+    
+    return endpoint + "." + std::to_string(shard_index);
+}
+
+bool ZMQPublisher::Initialize(const PublisherOptions& options) {
+    size_t num_shards = std::max<size_t>(1, options.num_shards);
+    
+    for (size_t i = 0; i < num_shards; ++i) {
+        PublisherOptions shard_options = options;
+        if (num_shards > 1) {
+            shard_options.endpoint = ShardEndpoint(options.endpoint, i);
+            for (SinkOptions& sink : shard_options.extra_sinks) {
+                sink.endpoint = ShardEndpoint(sink.endpoint, i);
+            }
+        }
         
-        std::cout << "ZMQ Publisher initialized on " << endpoint << std::endl;
-        return true;
+        int cpu_core = (i < options.shard_cores.size()) ? options.shard_cores[i] : -1;
         
-    } catch (const zmq::error_t& e) {
-        std::cerr << "ZMQ Publisher initialization failed: " << e.what() << std::endl;
-        return false;
+        auto shard = std::make_unique<PublisherShard>();
+        shard->SetLoadShedder(load_shedder_);
+        shard->SetLastValueCache(last_values_);
+        shard->SetLatencyTracker(latency_tracker_);
+        shard->SetTraceRecorder(trace_recorder_);
+        shard->SetPerfCounters(perf_counters_);
+        if (!shard->Initialize(shard_options, i, cpu_core)) {
+            std::cerr << "ZMQ Publisher initialization failed" << std::endl;
+            return false;
+        }
+        shards_.push_back(std::move(shard));
     }
+    
+    std::cout << "ZMQ Publisher initialized with " << shards_.size() << " shard(s)"
+              << (shards_.size() > 1 ? ", shard = stock_locate % " + std::to_string(shards_.size()) : "")
+              << std::endl;
+    return true;
 }
 
 void ZMQPublisher::Publish(const TickData& tick_data) {
-    if (!running_.load()) {
+    if (shards_.empty()) {
         return;
     }
-    
-    std::unique_lock<std::mutex> lock(queue_mutex_);
-    
-    // Drop messages if queue is full (backpressure handling)
-    if (message_queue_.size() >= MAX_QUEUE_SIZE) {
-        message_queue_.pop();
+    shards_[GetShardForLocate(tick_data.stock_locate)]->Publish(tick_data);
+}
+
+void ZMQPublisher::PublishSnapshots(uint64_t sample_time, std::vector<L1Snapshot>&& snapshots) {
+    if (shards_.empty()) {
+        return;
+    }
+    if (shards_.size() == 1) {
+        shards_[0]->PublishSnapshots(sample_time, std::move(snapshots));
+        return;
     }
     
-    message_queue_.push(tick_data);
-    lock.unlock();
-    
-    queue_cv_.notify_one();
+    // Each shard publishes its own slice of the grid point
+    std::vector<std::vector<L1Snapshot>> per_shard(shards_.size());
+    for (const L1Snapshot& snapshot : snapshots) {
+        per_shard[GetShardForLocate(snapshot.stock_locate)].push_back(snapshot);
+    }
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!per_shard[i].empty()) {
+            shards_[i]->PublishSnapshots(sample_time, std::move(per_shard[i]));
+        }
+    }
 }
 
 void ZMQPublisher::Stop() {
-    if (!running_.load()) {
-        return;
+    for (auto& shard : shards_) {
+        shard->Stop();
     }
-    
-    running_.store(false);
-    queue_cv_.notify_all();
-    
-    if (publishing_thread_.joinable()) {
-        publishing_thread_.join();
+}
+
+uint64_t ZMQPublisher::GetPublishedCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->GetPublishedCount();
     }
-    
-    publisher_.close();
-    std::cout << "ZMQ Publisher stopped. Published " << published_count_.load() << " messages" << std::endl;
+    return total;
 }
 
-void ZMQPublisher::PublishingLoop() {
-    while (running_.load()) {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        
-        queue_cv_.wait(lock, [this]() {
-            return !message_queue_.empty() || !running_.load();
-        });
-        
-        if (!running_.load()) {
-            break;
-        }
-        
-        // Process batch of messages
-        std::vector<TickData> batch;
-        batch.reserve(std::min(message_queue_.size(), size_t(1000)));
-        
-        while (!message_queue_.empty() && batch.size() < 1000) {
-            batch.push_back(message_queue_.front());
-            message_queue_.pop();
-        }
-        
-        lock.unlock();
-        
-        // Publish batch
-        for (const auto& tick_data : batch) {
-            try {
-                std::string serialized = SerializeTickData(tick_data);
-                
-                zmq::message_t message(serialized.size());
-                memcpy(message.data(), serialized.c_str(), serialized.size());
-                
-                publisher_.send(message, zmq::send_flags::dontwait);
-                published_count_.fetch_add(1);
-                
-            } catch (const zmq::error_t& e) {
-                if (e.num() != EAGAIN) {
-                    std::cerr << "ZMQ send error: " << e.what() << std::endl;
-                }
-            }
-        }
+uint64_t ZMQPublisher::GetBatchCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->GetBatchCount();
     }
+    return total;
 }
 
-std::string ZMQPublisher::SerializeTickData(const TickData& tick_data) {
-    // Simple JSON serialization
-    std::ostringstream oss;
-    oss << "{"
-        << "\"timestamp\":" << tick_data.timestamp << ","
-        << "\"symbol_id\":" << tick_data.symbol_id << ","
-        << "\"price\":" << tick_data.price << ","
-        << "\"size\":" << tick_data.size << ","
-        << "\"side\":\"" << tick_data.side << "\","
-        << "\"message_type\":\"" << static_cast<char>(tick_data.message_type) << "\""
-        << "}";
-    
-    return oss.str();
+uint64_t ZMQPublisher::GetDroppedCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->GetDroppedCount();
+    }
+    return total;
+}
+
+uint64_t ZMQPublisher::GetPrunedCount() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->GetPrunedCount();
+    }
+    return total;
+}
+
+size_t ZMQPublisher::GetQueueDepth() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->GetQueueDepth();
+    }
+    return total;
+}
+
+bool ZMQPublisher::IsConflationEnabled() const {
+    return !shards_.empty() && shards_[0]->IsConflationEnabled();
+}
+
+std::vector<ConflationStats> ZMQPublisher::GetConflationStats() const {
+    // Shards own disjoint symbols, so their stats simply concatenate
+    std::vector<ConflationStats> stats;
+    for (const auto& shard : shards_) {
+        auto shard_stats = shard->GetConflationStats();
+        stats.insert(stats.end(), shard_stats.begin(), shard_stats.end());
+    }
+    return stats;
+}
+
+double ZMQPublisher::GetConflationRatio() const {
+    uint64_t updates_in = 0;
+    uint64_t updates_out = 0;
+    for (const auto& shard : shards_) {
+        updates_in += shard->GetConflatedIn();
+        updates_out += shard->GetConflatedOut();
+    }
+    return updates_out > 0 ? static_cast<double>(updates_in) / updates_out : 0.0;
+}
+
+std::vector<PublisherSinkStats> ZMQPublisher::GetSinkStats() const {
+    std::vector<PublisherSinkStats> stats;
+    for (const auto& shard : shards_) {
+        auto shard_stats = shard->GetSinkStats();
+        stats.insert(stats.end(), shard_stats.begin(), shard_stats.end());
+    }
+    return stats;
+}
+
+std::vector<EncoderStats> ZMQPublisher::GetEncoderStats() const {
+    std::vector<EncoderStats> stats;
+    for (const auto& shard : shards_) {
+        for (const EncoderStats& shard_stats : shard->GetEncoderStats()) {
+            MergeEncoderStats(stats, shard_stats);
+        }
+    }
+    return stats;
 }
 
 } // namespace tickshaper
\ No newline at end of file
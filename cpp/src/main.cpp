@@ -3,6 +3,8 @@
 #include <signal.h>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cstdio>
 
 using namespace tickshaper;
 
@@ -22,15 +24,44 @@ void PrintMetrics(const TickShaper& tickshaper) {
     std::cout << "\n=== TickShaper Metrics ===" << std::endl;
     std::cout << "Messages Processed: " << metrics.messages_processed.load() << std::endl;
     std::cout << "Messages Throttled: " << metrics.messages_throttled.load() << std::endl;
+    
+    if (metrics.messages_shed.load() > 0) {
+        LoadSheddingStats shed_stats = tickshaper.GetLoadSheddingStats();
+        std::cout << "Messages Shed: " << metrics.messages_shed.load()
+                  << " (processing " << shed_stats.shed[kHandoffProcessing]
+                  << ", conflation " << shed_stats.shed[kHandoffConflation]
+                  << ", publish " << shed_stats.shed[kHandoffPublish] << ")" << std::endl;
+    }
+    if (metrics.messages_suppressed.load() > 0) {
+        std::cout << "Messages Suppressed: " << metrics.messages_suppressed.load() << std::endl;
+    }
+    if (metrics.messages_pruned.load() > 0) {
+        std::cout << "Messages Pruned (unsubscribed): " << metrics.messages_pruned.load() << std::endl;
+    }
     std::cout << "Current Throughput: " << metrics.current_throughput.load() << " msg/s" << std::endl;
     std::cout << "Queue Depth: " << metrics.queue_depth.load() << std::endl;
     std::cout << "CPU Usage: " << metrics.cpu_usage.load() << "%" << std::endl;
     std::cout << "Memory Usage: " << (metrics.memory_usage.load() / 1024 / 1024) << " MB" << std::endl;
     
-    if (metrics.messages_processed.load() > 0) {
-        double avg_latency_ms = static_cast<double>(metrics.total_latency_ns.load()) / 
-                               metrics.messages_processed.load() / 1000000.0;
-        std::cout << "Average Latency: " << avg_latency_ms << " ms" << std::endl;
+    // Tails per stage over the last interval, then since start
+    for (const auto& stage : tickshaper.GetLatencyReport()) {
+        if (stage.cumulative.count == 0) {
+            continue;
+        }
+        std::cout << "Latency " << stage.stage << " (ns): interval p50=" << stage.interval.p50
+                  << " p99=" << stage.interval.p99 << " p99.9=" << stage.interval.p999
+                  << " p99.99=" << stage.interval.p9999 << " max=" << stage.interval.max
+                  << " | total p50=" << stage.cumulative.p50 << " p99=" << stage.cumulative.p99
+                  << " p99.9=" << stage.cumulative.p999 << " p99.99=" << stage.cumulative.p9999
+                  << " max=" << stage.cumulative.max << std::endl;
+    }
+    
+    // Hardware counters per message, since start (perf_counters=true)
+    for (const auto& stage : tickshaper.GetPerfReport()) {
+        if (stage.samples > 0) {
+            std::cout << "Perf " << stage.stage << ": " << FormatPerfSummary(stage) 
+                      << " (" << stage.samples << " sampled)" << std::endl;
+        }
     }
     
     if (metrics.microburst_detected.load()) {
@@ -40,6 +71,156 @@ void PrintMetrics(const TickShaper& tickshaper) {
     std::cout << "=========================" << std::endl;
 }
 
+void PrintConflationStats(const TickShaper& tickshaper) {
+    auto stats = tickshaper.GetConflationStats();
+    if (stats.empty()) {
+        std::cout << "No conflation statistics (enable_conflation=false or no traffic)" << std::endl;
+        return;
+    }
+    
+    // Most active symbols first
+    std::sort(stats.begin(), stats.end(), [](const ConflationStats& a, const ConflationStats& b) {
+        return a.updates_in > b.updates_in;
+    });
+    
+    std::cout << "\n=== Conflation (top " << std::min(stats.size(), size_t(20)) << " symbols) ===" << std::endl;
+    for (size_t i = 0; i < stats.size() && i < 20; ++i) {
+        std::cout << "Locate " << stats[i].stock_locate
+                  << ": in=" << stats[i].updates_in
+                  << " out=" << stats[i].updates_out
+                  << " ratio=" << stats[i].GetRatio() << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+void PrintSuppressionStats(const TickShaper& tickshaper) {
+    auto stats = tickshaper.GetSuppressionStats();
+    if (stats.empty()) {
+        std::cout << "No suppression statistics (output_mode=ticks or no traffic)" << std::endl;
+        return;
+    }
+    
+    std::sort(stats.begin(), stats.end(), [](const SuppressionStats& a, const SuppressionStats& b) {
+        return a.events_in > b.events_in;
+    });
+    
+    std::cout << "\n=== Top-of-book suppression (top " << std::min(stats.size(), size_t(20)) << " symbols) ===" << std::endl;
+    for (size_t i = 0; i < stats.size() && i < 20; ++i) {
+        std::cout << "Locate " << stats[i].stock_locate
+                  << ": events=" << stats[i].events_in
+                  << " published=" << stats[i].updates_out
+                  << " suppressed=" << (stats[i].GetSuppressedFraction() * 100.0) << "%" << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+void PrintSinkStats(const TickShaper& tickshaper) {
+    std::cout << "\n=== Publisher sinks ===" << std::endl;
+    for (const auto& sink : tickshaper.GetSinkStats()) {
+        std::cout << sink.endpoint << " (" << sink.format << ")"
+                  << ": messages=" << sink.messages_sent
+                  << " ticks=" << sink.ticks_sent
+                  << " queue=" << sink.queue_depth
+                  << " queue_drops=" << sink.queue_drops
+                  << " hwm_drops=" << sink.hwm_drops
+                  << " pruned=" << sink.pruned << std::endl;
+    }
+    for (const auto& encoder : tickshaper.GetEncoderStats()) {
+        std::cout << "encoder " << encoder.format
+                  << ": batches=" << encoder.batches
+                  << " ticks=" << encoder.ticks
+                  << " bytes=" << encoder.encoded_bytes
+                  << " ratio=" << encoder.GetCompressionRatio() << "x"
+                  << " cost=" << encoder.GetNanosPerBatch() << "ns/batch"
+                  << " pooled=" << encoder.pooled_frames
+                  << " copied=" << encoder.copied_frames << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+void PrintSessionStats(const TickShaper& tickshaper) {
+    std::cout << "\n=== Shaping sessions ===" << std::endl;
+    for (const auto& session : tickshaper.GetSessionStats()) {
+        std::cout << session.name << " " << session.endpoint << " (" << session.format
+                  << (session.conflated ? "/conflated" : "") << ")"
+                  << ": symbols=" << (session.symbol_count ? std::to_string(session.symbol_count) : std::string("all"))
+                  << " rate=" << (session.rate ? std::to_string(session.rate) : std::string("unlimited"))
+                  << " in=" << session.ticks_in
+                  << " sent=" << session.ticks_sent
+                  << " throttled=" << session.throttled
+                  << " conflated=" << session.conflated_away
+                  << " pruned=" << session.pruned
+                  << " ring_drops=" << session.ring_drops
+                  << " queue_drops=" << session.queue_drops
+                  << " hwm_drops=" << session.hwm_drops << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+void PrintReplayStats(const TickShaper& tickshaper) {
+    std::cout << "\n=== Replays ===" << std::endl;
+    for (const auto& replay : tickshaper.GetReplayStats()) {
+        double progress = replay.total_messages > 0 ? 
+            100.0 * static_cast<double>(replay.position) / replay.total_messages : 0.0;
+        std::cout << replay.name << " " << replay.endpoint
+                  << ": speed=" << (replay.speed > 0.0 ? std::to_string(replay.speed) + "x" : std::string("max"))
+                  << " progress=" << progress << "%"
+                  << " itch_time=" << replay.itch_time
+                  << " ticks=" << replay.ticks_out
+                  << " sent=" << replay.ticks_sent
+                  << " throttled=" << replay.throttled
+                  << (replay.finished ? " (finished)" : "") << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+void PrintLockStats(const TickShaper& tickshaper) {
+    std::cout << "\n=== Locks (by total wait) ===" << std::endl;
+    for (const auto& lock : tickshaper.GetLockReport()) {
+        if (lock.acquisitions == 0) {
+            continue;
+        }
+        double contended_percent = 100.0 * static_cast<double>(lock.contended) / lock.acquisitions;
+        std::cout << lock.name << " x" << lock.instances
+                  << ": acquisitions=" << lock.acquisitions
+                  << " contended=" << contended_percent << "%"
+                  << " total_wait=" << lock.total_wait_ns / 1000 << "us"
+                  << " wait p50/p99/max=" << lock.wait.p50 << "/" << lock.wait.p99 << "/" << lock.wait.max << "ns"
+                  << " hold p50/p99/max=" << lock.hold.p50 << "/" << lock.hold.p99 << "/" << lock.hold.max << "ns"
+                  << std::endl;
+    }
+    std::cout << "=========================" << std::endl;
+}
+
+void PrintBurstStats(const TickShaper& tickshaper) {
+    // Event time of day, as the feed stamps it
+    auto time_of_day = [](uint64_t time_ns) {
+        uint64_t ms = time_ns / 1000000;
+        char text[16];
+        snprintf(text, sizeof(text), "%02u:%02u:%02u.%03u", static_cast<unsigned>(ms / 3600000 % 24),
+                 static_cast<unsigned>(ms / 60000 % 60), static_cast<unsigned>(ms / 1000 % 60),
+                 static_cast<unsigned>(ms % 1000));
+        return std::string(text);
+    };
+    
+    std::cout << "\n=== Microbursts (event time) ===" << std::endl;
+    for (const auto& burst : tickshaper.GetBurstingSymbols()) {
+        std::cout << "Bursting locate " << burst.stock_locate
+                  << ": since " << time_of_day(burst.start_time_ns)
+                  << " rate=" << burst.rate << " peak=" << burst.peak_rate << " msg/s" << std::endl;
+    }
+    for (const auto& burst : tickshaper.GetRecentBursts()) {
+        std::cout << (burst.stock_locate == 0 ? std::string("All symbols") 
+                                              : "Locate " + std::to_string(burst.stock_locate))
+                  << ": " << time_of_day(burst.start_time_ns)
+                  << " for " << (burst.end_time_ns - burst.start_time_ns) / 1000000 << "ms"
+                  << " peak=" << burst.peak_rate << " msg/s"
+                  << " messages=" << burst.total_messages
+                  << " severity=" << burst.severity << std::endl;
+    }
+    std::cout << "================================" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     std::cout << "TickShaper - Real-Time Market Data Throttler" << std::endl;
     std::cout << "=============================================" << std::endl;
@@ -75,7 +256,10 @@ int main(int argc, char* argv[]) {
     
     // Interactive command loop
     std::string command;
-    std::cout << "\nCommands: speed <multiplier>, throttle <rate>, reset, quit" << std::endl;
+    std::cout << "\nCommands: speed <multiplier>, throttle <rate>, reset, deadline <us>, metrics, conflation, bbo, sinks,"
+              << " session add <name> <endpoint> [options], session remove <name>, sessions,"
+              << " replay add <name> <endpoint> [options], replay remove <name>, replays,"
+              << " trace on|off, trace dump [file], locks [on|off], bursts, quit" << std::endl;
     std::cout << "> ";
     
     while (std::getline(std::cin, command)) {
@@ -95,11 +279,51 @@ int main(int argc, char* argv[]) {
             } catch (const std::exception& e) {
                 std::cout << "Invalid throttle rate" << std::endl;
             }
+        } else if (command.substr(0, 8) == "deadline") {
+            try {
+                uint64_t max_age_us = std::stoull(command.substr(9));
+                g_tickshaper->SetMaxMessageAge(max_age_us);
+            } catch (const std::exception& e) {
+                std::cout << "Invalid deadline value" << std::endl;
+            }
         } else if (command == "reset") {
             g_tickshaper->ResetCounters();
             std::cout << "Counters reset" << std::endl;
         } else if (command == "metrics") {
             PrintMetrics(*g_tickshaper);
+        } else if (command == "conflation") {
+            PrintConflationStats(*g_tickshaper);
+        } else if (command == "bbo") {
+            PrintSuppressionStats(*g_tickshaper);
+        } else if (command == "sinks") {
+            PrintSinkStats(*g_tickshaper);
+        } else if (command.substr(0, 12) == "session add ") {
+            g_tickshaper->AddSession(command.substr(12));
+        } else if (command.substr(0, 15) == "session remove ") {
+            g_tickshaper->RemoveSession(command.substr(15));
+        } else if (command == "sessions") {
+            PrintSessionStats(*g_tickshaper);
+        } else if (command.substr(0, 11) == "replay add ") {
+            g_tickshaper->AddReplay(command.substr(11));
+        } else if (command.substr(0, 14) == "replay remove ") {
+            g_tickshaper->RemoveReplay(command.substr(14));
+        } else if (command == "replays") {
+            PrintReplayStats(*g_tickshaper);
+        } else if (command == "trace on") {
+            g_tickshaper->SetTracing(true);
+        } else if (command == "trace off") {
+            g_tickshaper->SetTracing(false);
+        } else if (command.substr(0, 10) == "trace dump") {
+            std::string path = command.size() > 11 ? command.substr(11) : "tickshaper-trace.json";
+            g_tickshaper->DumpTrace(path);
+        } else if (command == "locks") {
+            PrintLockStats(*g_tickshaper);
+        } else if (command == "bursts") {
+            PrintBurstStats(*g_tickshaper);
+        } else if (command == "locks on") {
+            g_tickshaper->SetLockProfiling(true);
+        } else if (command == "locks off") {
+            g_tickshaper->SetLockProfiling(false);
         } else if (!command.empty()) {
             std::cout << "Unknown command: " << command << std::endl;
         }
@@ -4,8 +4,37 @@
 #include "../include/MessageProcessor.h"
 #include "../include/ThrottleController.h"
 #include "../include/MicroburstDetector.h"
+#include "../include/Conflator.h"
+#include "../include/LoadShedder.h"
+#include "../include/SnapshotSampler.h"
+#include "../include/ZMQPublisher.h"
+#include "../include/WireFormat.h"
+#include "../include/MPSCRing.h"
+#include "../include/BufferPool.h"
+#include "../include/SubscriptionTracker.h"
+#include "../include/PublisherSink.h"
+#include "../include/MulticastPublisher.h"
+#include "../include/LastValueCache.h"
+#include "../include/SnapshotService.h"
+#include "../include/CompactFormat.h"
+#include "../include/SessionManager.h"
+#include "../include/ReplayManager.h"
+#include "../include/LatencyHistogram.h"
+#include "../include/CounterRegistry.h"
+#include "../include/FastClock.h"
+#include "../include/TraceRecorder.h"
+#include "../include/PerfCounters.h"
+#include "../include/LockProfiler.h"
+#include "../include/MetricsSegment.h"
+#include "../include/MetricsExporter.h"
+#include "../include/DashboardStream.h"
+#include <fstream>
 #include <chrono>
 #include <thread>
+#include <cstring>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using namespace tickshaper;
 
@@ -79,6 +108,22 @@ TEST_F(TickShaperTest, ThrottleRateTest) {
     tickshaper->SetThrottleRate(2000000);
 }
 
+// Writes one length-framed ITCH message: locate, tracking, 6-byte timestamp, rest
+static void WriteITCHMessage(std::ofstream& out, uint8_t type, uint16_t stock_locate, uint64_t timestamp,
+                             const std::vector<uint8_t>& rest) {
+    std::vector<uint8_t> body(10, 0);
+    *reinterpret_cast<uint16_t*>(body.data()) = htons(stock_locate);
+    for (int i = 0; i < 6; ++i) {
+        body[4 + i] = static_cast<uint8_t>(timestamp >> (40 - 8 * i));
+    }
+    body.insert(body.end(), rest.begin(), rest.end());
+    
+    uint16_t length = htons(static_cast<uint16_t>(body.size() + 1));
+    out.write(reinterpret_cast<const char*>(&length), 2);
+    out.put(static_cast<char>(type));
+    out.write(reinterpret_cast<const char*>(body.data()), body.size());
+}
+
 class ITCHParserTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -131,6 +176,146 @@ TEST_F(MessageProcessorTest, ProcessingTest) {
     EXPECT_EQ(tick_data.message_type, 'A');
 }
 
+class TopOfBookTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        processor = std::make_unique<MessageProcessor>();
+        metrics = std::make_unique<SystemMetrics>();
+        processor->Initialize(&shm, metrics.get());
+        processor->SetOutputMode(OutputMode::kTopOfBook);
+    }
+    
+    RawMessage MakeAddOrder(uint16_t stock_locate, uint64_t order_ref, char side, uint32_t shares, uint32_t price) {
+        std::vector<uint8_t> data(35, 0);
+        *reinterpret_cast<uint16_t*>(data.data()) = htons(stock_locate);
+        *reinterpret_cast<uint64_t*>(data.data() + 10) = htobe64(order_ref);
+        data[18] = side;
+        *reinterpret_cast<uint32_t*>(data.data() + 19) = htonl(shares);
+        memcpy(data.data() + 23, "TEST    ", 8);
+        *reinterpret_cast<uint32_t*>(data.data() + 31) = htonl(price);
+        return RawMessage('A', 1000, data.data(), data.size());
+    }
+    
+    RawMessage MakeDelete(uint16_t stock_locate, uint64_t order_ref) {
+        std::vector<uint8_t> data(18, 0);
+        *reinterpret_cast<uint16_t*>(data.data()) = htons(stock_locate);
+        *reinterpret_cast<uint64_t*>(data.data() + 10) = htobe64(order_ref);
+        return RawMessage('D', 2000, data.data(), data.size());
+    }
+    
+    RawMessage MakeReplace(uint16_t stock_locate, uint64_t order_ref, uint64_t new_ref, uint32_t shares, 
+                           uint32_t price) {
+        std::vector<uint8_t> data(34, 0);
+        *reinterpret_cast<uint16_t*>(data.data()) = htons(stock_locate);
+        *reinterpret_cast<uint64_t*>(data.data() + 10) = htobe64(order_ref);
+        *reinterpret_cast<uint64_t*>(data.data() + 18) = htobe64(new_ref);
+        *reinterpret_cast<uint32_t*>(data.data() + 26) = htonl(shares);
+        *reinterpret_cast<uint32_t*>(data.data() + 30) = htonl(price);
+        return RawMessage('U', 3000, data.data(), data.size());
+    }
+    
+    RawMessage MakeExecutedWithPrice(uint16_t stock_locate, uint64_t order_ref, uint32_t shares, uint32_t price) {
+        std::vector<uint8_t> data(35, 0);
+        *reinterpret_cast<uint16_t*>(data.data()) = htons(stock_locate);
+        *reinterpret_cast<uint64_t*>(data.data() + 10) = htobe64(order_ref);
+        *reinterpret_cast<uint32_t*>(data.data() + 18) = htonl(shares);
+        data[30] = 'Y';
+        *reinterpret_cast<uint32_t*>(data.data() + 31) = htonl(price);
+        return RawMessage('C', 4000, data.data(), data.size());
+    }
+    
+    SharedMemoryManager shm;
+    std::unique_ptr<MessageProcessor> processor;
+    std::unique_ptr<SystemMetrics> metrics;
+};
+
+TEST_F(TopOfBookTest, PublishesOnlyInsideQuoteChangesTest) {
+    ProcessorOutput output;
+    
+    // New best bid
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(5, 1, 'B', 100, 1000000), output));
+    ASSERT_EQ(output.count, 1);
+    EXPECT_EQ(output.ticks[0].message_type, kMsgTypeQuoteUpdate);
+    EXPECT_EQ(output.ticks[0].side, 'B');
+    EXPECT_EQ(output.ticks[0].price, 10000);
+    EXPECT_EQ(output.ticks[0].size, 100);
+    
+    // Deeper bid does not touch the inside quote
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(5, 2, 'B', 300, 990000), output));
+    EXPECT_EQ(output.count, 0);
+    EXPECT_EQ(processor->GetCounter(kCounterSuppressed), 1);
+    
+    // Removing the best bid exposes the deeper level
+    ASSERT_TRUE(processor->ProcessMessage(MakeDelete(5, 1), output));
+    ASSERT_EQ(output.count, 1);
+    EXPECT_EQ(output.ticks[0].price, 9900);
+    EXPECT_EQ(output.ticks[0].size, 300);
+    
+    auto stats = processor->GetSuppressionStats();
+    ASSERT_EQ(stats.size(), 1);
+    EXPECT_EQ(stats[0].events_in, 3);
+    EXPECT_EQ(stats[0].updates_out, 2);
+}
+
+TEST_F(TopOfBookTest, ReplaceAndPricedExecutionTest) {
+    ProcessorOutput output;
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(5, 1, 'B', 100, 1000000), output));
+    
+    // Replace moves the whole order to a new price and size
+    ASSERT_TRUE(processor->ProcessMessage(MakeReplace(5, 1, 2, 250, 1010000), output));
+    ASSERT_EQ(output.count, 1);
+    EXPECT_EQ(output.ticks[0].side, 'B');
+    EXPECT_EQ(output.ticks[0].price, 10100);
+    EXPECT_EQ(output.ticks[0].size, 250);
+    EXPECT_EQ(processor->GetActiveOrderCount(), 1);
+    
+    // A priced execution against the new reference reduces the resting size
+    ASSERT_TRUE(processor->ProcessMessage(MakeExecutedWithPrice(5, 2, 50, 1005000), output));
+    ASSERT_EQ(output.count, 2);
+    EXPECT_EQ(output.ticks[0].message_type, 'C');
+    EXPECT_EQ(output.ticks[0].price, 10050);
+    EXPECT_EQ(output.ticks[0].size, 50);
+    EXPECT_EQ(output.ticks[1].message_type, kMsgTypeQuoteUpdate);
+    EXPECT_EQ(output.ticks[1].price, 10100);
+    EXPECT_EQ(output.ticks[1].size, 200);
+    
+    TopOfBook tob = processor->GetTopOfBook(5);
+    EXPECT_EQ(tob.bid_price, 10100);
+    EXPECT_EQ(tob.bid_size, 200);
+}
+
+TEST_F(TopOfBookTest, PublishesEverySideThatMovedTest) {
+    // Build both sides without publishing, as if other workers had moved them
+    processor->SetOutputMode(OutputMode::kSampled);
+    ProcessorOutput output;
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(5, 1, 'B', 100, 1000000), output));
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(5, 2, 'S', 200, 1010000), output));
+    
+    processor->SetOutputMode(OutputMode::kTopOfBook);
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(5, 3, 'B', 100, 990000), output));
+    ASSERT_EQ(output.count, 2);
+    EXPECT_EQ(output.ticks[0].side, 'B');
+    EXPECT_EQ(output.ticks[0].price, 10000);
+    EXPECT_EQ(output.ticks[1].side, 'S');
+    EXPECT_EQ(output.ticks[1].price, 10100);
+    EXPECT_EQ(output.ticks[1].size, 200);
+}
+
+TEST_F(TopOfBookTest, SampledModeSnapshotTest) {
+    processor->SetOutputMode(OutputMode::kSampled);
+    
+    ProcessorOutput output;
+    ASSERT_TRUE(processor->ProcessMessage(MakeAddOrder(9, 1, 'S', 200, 1010000), output));
+    EXPECT_EQ(output.count, 0);
+    
+    std::vector<TopOfBook> quotes;
+    processor->GetTopOfBooks({9, 10}, quotes);
+    ASSERT_EQ(quotes.size(), 2);
+    EXPECT_EQ(quotes[0].ask_price, 10100);
+    EXPECT_EQ(quotes[0].ask_size, 200);
+    EXPECT_EQ(quotes[1].ask_price, 0);
+}
+
 class ThrottleControllerTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -202,7 +387,922 @@ TEST_F(MicroburstDetectorTest, DetectionTest) {
     // Note: Actual detection depends on timing and thresholds
 }
 
+TEST_F(MicroburstDetectorTest, EventTimeSymbolBurstTest) {
+    // Aggregate 1000 msg/s, per symbol 200 msg/s, ends below half of each
+    MicroburstDetector event_detector(1000, 500, 100, 200, 100);
+    event_detector.Initialize(metrics.get());
+    
+    // Locate 1 ticks over at 100 msg/s throughout; locate 7 sends 10000 msg/s
+    // for half a second from 09:30:00. Nothing here depends on the wall clock
+    const uint64_t open_ns = 34200ULL * 1000000000;
+    const uint64_t burst_ns = 500000000;
+    auto feed = [&](uint64_t from_ns, uint64_t to_ns) {
+        for (uint64_t t = from_ns; t < to_ns; t += 100000) {
+            if (t % 10000000 == 0) {
+                event_detector.CheckMessage(TickData(t, 1, 10000, 100, 'B', 'A', 1));
+            }
+            if (t >= open_ns && t < open_ns + burst_ns) {
+                event_detector.CheckMessage(TickData(t, 7, 10000, 100, 'B', 'A', 7));
+            }
+        }
+    };
+    
+    feed(open_ns - 2000000000ULL, open_ns + 250000000);
+    EXPECT_TRUE(event_detector.IsCurrentlyInMicroburst());
+    auto bursting = event_detector.GetBurstingSymbols();
+    ASSERT_EQ(bursting.size(), 1);
+    EXPECT_EQ(bursting[0].stock_locate, 7);
+    EXPECT_EQ(bursting[0].start_time_ns, open_ns);
+    EXPECT_EQ(bursting[0].rate, 10000);
+    
+    feed(open_ns + 250000000, open_ns + 3000000000ULL);
+    EXPECT_FALSE(event_detector.IsCurrentlyInMicroburst());
+    EXPECT_TRUE(event_detector.GetBurstingSymbols().empty());
+    
+    auto events = event_detector.GetRecentEvents();
+    auto symbol_burst = std::find_if(events.begin(), events.end(), 
+                                     [](const MicroburstEvent& e) { return e.stock_locate == 7; });
+    ASSERT_NE(symbol_burst, events.end());
+    EXPECT_EQ(symbol_burst->start_time_ns, open_ns);
+    EXPECT_EQ(symbol_burst->end_time_ns, open_ns + burst_ns);
+    EXPECT_EQ(symbol_burst->total_messages, 5000);
+    EXPECT_EQ(symbol_burst->severity, "high");
+    
+    auto aggregate_burst = std::find_if(events.begin(), events.end(), 
+                                        [](const MicroburstEvent& e) { return e.stock_locate == 0; });
+    ASSERT_NE(aggregate_burst, events.end());
+    EXPECT_GE(aggregate_burst->start_time_ns, open_ns);
+    EXPECT_LT(aggregate_burst->start_time_ns, open_ns + 200000000);
+    EXPECT_GT(aggregate_burst->peak_rate, 5000);
+    
+    // The quiet symbol never burst
+    EXPECT_EQ(std::count_if(events.begin(), events.end(), 
+                            [](const MicroburstEvent& e) { return e.stock_locate == 1; }), 0);
+}
+
+TEST_F(MicroburstDetectorTest, ParsedFileTimestampsTest) {
+    // A real file opens with system event and directory messages; their ITCH
+    // time, not the wall clock, must anchor the windows
+    const std::string path = "/tmp/tickshaper_microburst_test.itch";
+    const uint64_t second = 1000000000ULL;
+    const uint64_t open_ns = 34200 * second;
+    const uint64_t burst_ns = 500000000;
+    uint64_t count = 0;
+    {
+        std::ofstream out(path, std::ios::binary);
+        WriteITCHMessage(out, 'S', 0, open_ns - 2 * second, {'Q'});
+        std::vector<uint8_t> directory(28, ' ');
+        memcpy(directory.data(), "MSFT", 4);
+        WriteITCHMessage(out, 'R', 7, open_ns - second, directory);
+        count = 2;
+        
+        // 10000 msg/s for half a second, then one message long after
+        std::vector<uint8_t> add(25, 0);
+        add[8] = 'B';
+        memcpy(add.data() + 13, "MSFT    ", 8);
+        for (uint64_t t = open_ns; t < open_ns + burst_ns; t += 100000) {
+            WriteITCHMessage(out, 'A', 7, t, add);
+            ++count;
+        }
+        WriteITCHMessage(out, 'A', 7, open_ns + 3 * second, add);
+        ++count;
+    }
+    
+    ITCHParser parser;
+    ASSERT_TRUE(parser.Initialize(path));
+    MicroburstDetector event_detector(1000, 500, 100, 200, 100);
+    event_detector.Initialize(metrics.get());
+    for (uint64_t i = 0; i < count; ++i) {
+        auto message = parser.GetNextMessage();
+        ASSERT_NE(message, nullptr);
+        uint16_t locate = ntohs(*reinterpret_cast<const uint16_t*>(message->data.data()));
+        event_detector.CheckMessage(TickData(message->timestamp, locate, 10000, 100, 'B', message->message_type, 
+                                             locate));
+        if (i == 0) {
+            EXPECT_EQ(message->timestamp, open_ns - 2 * second);
+        }
+    }
+    std::remove(path.c_str());
+    
+    EXPECT_FALSE(event_detector.IsCurrentlyInMicroburst());
+    auto events = event_detector.GetRecentEvents();
+    auto aggregate_burst = std::find_if(events.begin(), events.end(), 
+                                        [](const MicroburstEvent& e) { return e.stock_locate == 0; });
+    ASSERT_NE(aggregate_burst, events.end());
+    EXPECT_GE(aggregate_burst->start_time_ns, open_ns);
+    EXPECT_LT(aggregate_burst->start_time_ns, open_ns + 200000000);
+    auto symbol_burst = std::find_if(events.begin(), events.end(), 
+                                     [](const MicroburstEvent& e) { return e.stock_locate == 7; });
+    ASSERT_NE(symbol_burst, events.end());
+    EXPECT_EQ(symbol_burst->start_time_ns, open_ns);
+    EXPECT_EQ(symbol_burst->end_time_ns, open_ns + burst_ns);
+}
+
+class ConflatorTest : public ::testing::Test {
+protected:
+    TickData MakeTick(uint16_t stock_locate, uint8_t message_type, uint64_t price) {
+        return TickData(1000, stock_locate, price, 100, 'B', message_type, stock_locate);
+    }
+    
+    Conflator conflator;
+};
+
+TEST_F(ConflatorTest, LatestValueWinsTest) {
+    conflator.Update(MakeTick(7, 'A', 100));
+    conflator.Update(MakeTick(7, 'A', 101));
+    conflator.Update(MakeTick(7, 'A', 102));
+    
+    EXPECT_EQ(conflator.GetPendingCount(), 1);
+    
+    std::vector<TickData> out;
+    EXPECT_EQ(conflator.Drain(out, 10), 1);
+    EXPECT_EQ(out[0].price, 102);
+    EXPECT_EQ(conflator.GetPendingCount(), 0);
+    
+    auto stats = conflator.GetSymbolStats();
+    ASSERT_EQ(stats.size(), 1);
+    EXPECT_EQ(stats[0].stock_locate, 7);
+    EXPECT_DOUBLE_EQ(stats[0].GetRatio(), 3.0);
+}
+
+TEST_F(ConflatorTest, ArrivalOrderAndUpdateClassTest) {
+    conflator.Update(MakeTick(3, 'A', 100));
+    conflator.Update(MakeTick(1, 'A', 200));
+    conflator.Update(MakeTick(3, 'P', 101));  // Trades keep their own slot
+    conflator.Update(MakeTick(3, 'X', 102));  // Overwrites the quote slot in place
+    
+    std::vector<TickData> out;
+    EXPECT_EQ(conflator.Drain(out, 2), 2);
+    EXPECT_EQ(conflator.Drain(out, 10), 1);
+    
+    ASSERT_EQ(out.size(), 3);
+    EXPECT_EQ(out[0].stock_locate, 3);
+    EXPECT_EQ(out[0].price, 102);
+    EXPECT_EQ(out[1].stock_locate, 1);
+    EXPECT_EQ(out[2].message_type, 'P');
+}
+
+class LoadShedderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        shedder.Initialize(500); // 500 μs deadline
+    }
+    
+    LoadShedder shedder;
+};
+
+TEST_F(LoadShedderTest, DeadlineTest) {
+    uint64_t ingest_ns = 1000000;
+    
+    EXPECT_TRUE(shedder.Admit(kHandoffProcessing, ingest_ns, ingest_ns + 100000));
+    EXPECT_FALSE(shedder.Admit(kHandoffPublish, ingest_ns, ingest_ns + 600000));
+    
+    // Unstamped messages are never shed
+    EXPECT_TRUE(shedder.Admit(kHandoffPublish, 0, ingest_ns));
+    
+    LoadSheddingStats stats = shedder.GetStats();
+    EXPECT_EQ(stats.checked[kHandoffProcessing], 1);
+    EXPECT_EQ(stats.shed[kHandoffProcessing], 0);
+    EXPECT_EQ(stats.checked[kHandoffPublish], 2);
+    EXPECT_EQ(stats.shed[kHandoffPublish], 1);
+}
+
+TEST_F(LoadShedderTest, DisabledTest) {
+    shedder.SetMaxAge(0);
+    EXPECT_FALSE(shedder.IsEnabled());
+    EXPECT_TRUE(shedder.Admit(kHandoffConflation, 1, 1000000000));
+    EXPECT_EQ(shedder.GetStats().checked[kHandoffConflation], 0);
+}
+
+TEST(SnapshotSamplerTest, EventTimeGridTest) {
+    MessageProcessor processor;
+    SystemMetrics metrics;
+    SharedMemoryManager shm;
+    processor.Initialize(&shm, &metrics);
+    processor.SetOutputMode(OutputMode::kSampled);
+    
+    ZMQPublisher publisher;
+    SnapshotSampler sampler;
+    sampler.Initialize(&processor, &publisher, 10, SampleClock::kEventTime);
+    
+    // Grid anchors on the first event, one sample per crossed boundary
+    sampler.AdvanceTo(5000000);
+    sampler.MarkDirty(1, 1);
+    sampler.MarkDirty(2, 2);
+    sampler.MarkDirty(1, 1);
+    sampler.AdvanceTo(9000000);
+    EXPECT_EQ(sampler.GetSampleCount(), 0);
+    
+    sampler.AdvanceTo(10000000);
+    EXPECT_EQ(sampler.GetSampleCount(), 1);
+    EXPECT_EQ(sampler.GetSnapshotCount(), 2);
+    
+    // Nothing dirty: the grid advances without emitting
+    sampler.AdvanceTo(35000000);
+    EXPECT_EQ(sampler.GetSampleCount(), 1);
+}
+
+TEST(WireFormatTest, TickRoundTripTest) {
+    TickData tick(34200000000000ULL, 42, 15025, 300, 'S', 'A', 17);
+    
+    uint8_t buffer[sizeof(wire::MessageHeader) + sizeof(wire::TickRecord)];
+    uint8_t* cursor = wire::EncodeHeader(buffer, wire::kTickBatch, 1, sizeof(wire::TickRecord), 99);
+    wire::EncodeTick(cursor, tick);
+    
+    wire::MessageHeader header;
+    ASSERT_TRUE(wire::DecodeHeader(buffer, sizeof(buffer), header));
+    EXPECT_EQ(header.kind, wire::kTickBatch);
+    EXPECT_EQ(header.count, 1);
+    EXPECT_EQ(header.sequence, 99);
+    
+    wire::TickRecord record = wire::DecodeTick(buffer + sizeof(wire::MessageHeader));
+    EXPECT_EQ(record.timestamp, tick.timestamp);
+    EXPECT_EQ(record.symbol_id, 42);
+    EXPECT_EQ(record.price, 15025);
+    EXPECT_EQ(record.size, 300);
+    EXPECT_EQ(record.side, 'S');
+    EXPECT_EQ(record.message_type, 'A');
+    EXPECT_EQ(record.stock_locate, 17);
+    
+    // Truncated or foreign payloads are rejected
+    EXPECT_FALSE(wire::DecodeHeader(buffer, sizeof(buffer) - 1, header));
+    const char* json = "{\"timestamp\":1,\"symbol_id\":2}";
+    EXPECT_FALSE(wire::DecodeHeader(reinterpret_cast<const uint8_t*>(json), strlen(json), header));
+}
+
 // Performance benchmark test
+TEST(SubscriptionTrackerTest, PrefixSubscriptionTest) {
+    SubscriptionTracker tracker;
+    EXPECT_FALSE(tracker.IsSubscribed(wire::kTopicTicks, 42));
+    
+    // XPUB message: 1 = subscribe, 0 = unsubscribe, then the topic prefix
+    uint8_t message[1 + wire::kTopicSize];
+    message[0] = 1;
+    wire::EncodeTopic(message + 1, wire::kTopicTicks, 42);
+    ASSERT_TRUE(tracker.Apply(message, sizeof(message)));
+    
+    EXPECT_TRUE(tracker.IsSubscribed(wire::kTopicTicks, 42));
+    EXPECT_FALSE(tracker.IsSubscribed(wire::kTopicTicks, 43));
+    EXPECT_FALSE(tracker.IsSubscribed(wire::kTopicSnapshots, 42));
+    EXPECT_EQ(tracker.GetSubscribedSymbolCount(wire::kTopicTicks), 1u);
+    
+    // Class + high byte covers a block of 256 locates
+    uint8_t block[3] = {1, wire::kTopicTicks, 0x01};
+    ASSERT_TRUE(tracker.Apply(block, sizeof(block)));
+    EXPECT_TRUE(tracker.IsSubscribed(wire::kTopicTicks, 0x0100));
+    EXPECT_TRUE(tracker.IsSubscribed(wire::kTopicTicks, 0x01FF));
+    EXPECT_FALSE(tracker.IsSubscribed(wire::kTopicTicks, 0x0200));
+    
+    message[0] = 0;
+    ASSERT_TRUE(tracker.Apply(message, sizeof(message)));
+    EXPECT_FALSE(tracker.IsSubscribed(wire::kTopicTicks, 42));
+    
+    // Empty prefix subscribes to everything
+    uint8_t everything[1] = {1};
+    ASSERT_TRUE(tracker.Apply(everything, sizeof(everything)));
+    EXPECT_TRUE(tracker.IsSubscribed(wire::kTopicSnapshots, 7));
+    everything[0] = 0;
+    ASSERT_TRUE(tracker.Apply(everything, sizeof(everything)));
+    EXPECT_FALSE(tracker.IsSubscribed(wire::kTopicSnapshots, 7));
+    
+    uint8_t invalid[1] = {5};
+    EXPECT_FALSE(tracker.Apply(invalid, sizeof(invalid)));
+}
+
+TEST(WireFormatTest, TopicRoundTripTest) {
+    uint8_t topic[wire::kTopicSize];
+    wire::EncodeTopic(topic, wire::kTopicTicks, 0x1234);
+    
+    // Big-endian locate so prefix subscriptions group neighbouring locates
+    EXPECT_EQ(topic[0], 'T');
+    EXPECT_EQ(topic[1], 0x12);
+    EXPECT_EQ(topic[2], 0x34);
+    
+    uint8_t topic_class;
+    uint16_t stock_locate;
+    ASSERT_TRUE(wire::DecodeTopic(topic, sizeof(topic), topic_class, stock_locate));
+    EXPECT_EQ(topic_class, wire::kTopicTicks);
+    EXPECT_EQ(stock_locate, 0x1234);
+    EXPECT_FALSE(wire::DecodeTopic(topic, 2, topic_class, stock_locate));
+}
+
+TEST(FrameEncoderTest, SharedFramesTest) {
+    FrameEncoder encoder(WireFormat::kBinary);
+    std::vector<TickData> ticks;
+    for (int i = 0; i < 3; ++i) {
+        ticks.emplace_back(1000 + i, 1, 100 + i, 10, 'B', 'A', 7);
+    }
+    
+    std::vector<SinkFrame> frames;
+    encoder.EncodeTicks(ticks.data(), ticks.size(), frames);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_TRUE(frames[0].more);
+    EXPECT_FALSE(frames[1].more);
+    EXPECT_EQ(frames[1].tick_count, 3);
+    
+    uint8_t topic_class;
+    uint16_t stock_locate;
+    ASSERT_TRUE(wire::DecodeTopic(static_cast<const uint8_t*>(frames[0].message.data()),
+                                  frames[0].message.size(), topic_class, stock_locate));
+    EXPECT_EQ(stock_locate, 7);
+    
+    // A second sink gets a reference to the same payload
+    zmq::message_t shared;
+    shared.copy(frames[1].message);
+    wire::MessageHeader header;
+    ASSERT_TRUE(wire::DecodeHeader(static_cast<const uint8_t*>(shared.data()), shared.size(), header));
+    EXPECT_EQ(header.count, 3);
+    EXPECT_EQ(header.sequence, 1u);
+    
+    // Sequence runs per symbol within the stream
+    frames.clear();
+    encoder.EncodeTicks(ticks.data(), 1, frames);
+    ASSERT_TRUE(wire::DecodeHeader(static_cast<const uint8_t*>(frames[1].message.data()),
+                                   frames[1].message.size(), header));
+    EXPECT_EQ(header.sequence, 2u);
+    
+    FrameEncoder json_encoder(WireFormat::kJson);
+    frames.clear();
+    json_encoder.EncodeTicks(ticks.data(), ticks.size(), frames);
+    ASSERT_EQ(frames.size(), 4u);
+    EXPECT_TRUE(frames[2].more);
+    EXPECT_FALSE(frames[3].more);
+}
+
+TEST(ShardingTest, ShardMappingTest) {
+    EXPECT_EQ(ZMQPublisher::ShardEndpoint("tcp://*:5555", 0), "tcp://*:5555");
+    EXPECT_EQ(ZMQPublisher::ShardEndpoint("tcp://*:5555", 3), "tcp://*:5558");
+    EXPECT_EQ(ZMQPublisher::ShardEndpoint("ipc:///tmp/ticks.ipc", 2), "ipc:///tmp/ticks.ipc.2");
+    EXPECT_EQ(ZMQPublisher::ShardEndpoint("inproc://analytics", 1), "inproc://analytics.1");
+    EXPECT_EQ(ZMQPublisher::ShardEndpoint("tcp://*:*", 2), "tcp://*:*");
+    EXPECT_EQ(ZMQPublisher::ShardEndpoint("tcp://127.0.0.1:*", 1), "tcp://127.0.0.1:*");
+    
+    PublisherOptions options;
+    options.endpoint = "tcp://*:15555";
+    options.num_shards = 4;
+    options.prune_unsubscribed = false;
+    
+    ZMQPublisher publisher;
+    ASSERT_TRUE(publisher.Initialize(options));
+    EXPECT_EQ(publisher.GetShardCount(), 4u);
+    EXPECT_EQ(publisher.GetShardForLocate(42), 2u);
+    EXPECT_EQ(publisher.GetShardForLocate(43), 3u);
+    
+    for (uint16_t locate = 1; locate <= 8; ++locate) {
+        publisher.Publish(TickData(1000, locate, 100, 10, 'B', 'A', locate));
+    }
+    publisher.Stop();
+    EXPECT_EQ(publisher.GetPublishedCount(), 8u);
+    EXPECT_EQ(publisher.GetSinkStats().size(), 4u);
+}
+
+TEST(MPSCRingTest, BoundedFifoTest) {
+    MPSCRing<uint64_t> ring(5);
+    EXPECT_EQ(ring.Capacity(), 8u);
+    
+    for (uint64_t i = 0; i < 8; ++i) {
+        EXPECT_TRUE(ring.TryPush(i));
+    }
+    EXPECT_FALSE(ring.TryPush(99));
+    EXPECT_EQ(ring.SizeApprox(), 8u);
+    
+    uint64_t value;
+    for (uint64_t i = 0; i < 8; ++i) {
+        ASSERT_TRUE(ring.TryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.TryPop(value));
+}
+
+TEST(MPSCRingTest, MultiProducerTest) {
+    const int num_producers = 4;
+    const uint64_t per_producer = 20000;
+    MPSCRing<uint64_t> ring(1024);
+    
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&ring, p, per_producer]() {
+            for (uint64_t i = 0; i < per_producer; ++i) {
+                uint64_t value = (static_cast<uint64_t>(p) << 32) | i;
+                while (!ring.TryPush(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    
+    // Each producer's values must come out in the order it pushed them
+    std::vector<uint64_t> next(num_producers, 0);
+    uint64_t received = 0;
+    uint64_t value;
+    while (received < num_producers * per_producer) {
+        if (ring.TryPop(value)) {
+            int p = static_cast<int>(value >> 32);
+            EXPECT_EQ(value & 0xFFFFFFFF, next[p]);
+            next[p]++;
+            received++;
+        }
+    }
+    
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_FALSE(ring.TryPop(value));
+}
+
+TEST(BufferPoolTest, ReuseAndExhaustionTest) {
+    BufferPool pool(2);
+    
+    uint8_t* first = pool.Acquire();
+    uint8_t* second = pool.Acquire();
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(pool.Acquire(), nullptr);
+    
+    // The ZMQ free callback hands the buffer back for reuse
+    BufferPool::Release(first, &pool);
+    EXPECT_EQ(pool.Acquire(), first);
+    EXPECT_EQ(pool.GetAllocatedCount(), 2u);
+    
+    BufferPool::Release(first, &pool);
+    BufferPool::Release(second, &pool);
+}
+
+TEST(MulticastPublisherTest, LoopbackRetransmitTest) {
+    // Unicast loopback stands in for the group; framing and sequencing are the same
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(address);
+    ASSERT_EQ(bind(receiver, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    ASSERT_EQ(getsockname(receiver, reinterpret_cast<sockaddr*>(&address), &address_length), 0);
+    timeval timeout{2, 0};
+    setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    MulticastOptions options;
+    options.group = "127.0.0.1";
+    options.port = ntohs(address.sin_port);
+    options.session = "TEST";
+    options.retransmit_port = 0;
+    options.retransmit_capacity = 1024;
+    
+    MulticastPublisher publisher;
+    ASSERT_TRUE(publisher.Initialize(options));
+    
+    // 100 ticks take three 1400-byte packets
+    for (uint32_t i = 0; i < 100; ++i) {
+        publisher.Publish(TickData(1000 + i, i, 150000 + i, 100, 'B', 'A', 7));
+    }
+    
+    uint8_t packet[2048];
+    uint64_t next_sequence = 1;
+    while (next_sequence <= 100) {
+        ssize_t size = recv(receiver, packet, sizeof(packet), 0);
+        ASSERT_GT(size, 0);
+        EXPECT_LE(static_cast<size_t>(size), mold::kMaxPacketSize);
+        
+        mold::PacketHeader header;
+        ASSERT_TRUE(mold::DecodeHeader(packet, static_cast<size_t>(size), header));
+        EXPECT_EQ(std::string(header.session, mold::kSessionSize), "TEST      ");
+        if (header.count == mold::kHeartbeatCount) {
+            continue;
+        }
+        EXPECT_EQ(header.sequence, next_sequence);
+        EXPECT_EQ(static_cast<size_t>(size), mold::kHeaderSize + header.count * (2 + mold::kTickMessageSize));
+        next_sequence += header.count;
+    }
+    EXPECT_EQ(publisher.GetNextSequence(), 101u);
+    
+    // Ask for messages 10..14 as if they had been lost
+    uint8_t request[mold::kHeaderSize];
+    char session[mold::kSessionSize];
+    mold::PadSession("TEST", session);
+    mold::EncodeHeader(request, session, 10, 5);
+    
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server.sin_port = htons(publisher.GetRetransmitPort());
+    ASSERT_EQ(sendto(receiver, request, sizeof(request), 0, reinterpret_cast<sockaddr*>(&server), sizeof(server)),
+              static_cast<ssize_t>(sizeof(request)));
+    
+    // The answer comes back to the requester; skip any heartbeat on the feed
+    mold::PacketHeader header{};
+    ssize_t size;
+    do {
+        size = recv(receiver, packet, sizeof(packet), 0);
+        ASSERT_GT(size, 0);
+        ASSERT_TRUE(mold::DecodeHeader(packet, static_cast<size_t>(size), header));
+    } while (header.count == mold::kHeartbeatCount);
+    
+    EXPECT_EQ(header.sequence, 10u);
+    ASSERT_EQ(header.count, 5);
+    const uint8_t* message = packet + mold::kHeaderSize;
+    EXPECT_EQ((message[0] << 8) | message[1], static_cast<int>(mold::kTickMessageSize));
+    EXPECT_EQ(message[2], wire::kTopicTicks);
+    wire::TickRecord tick = wire::DecodeTick(message + 3);
+    EXPECT_EQ(tick.symbol_id, 9u);
+    EXPECT_EQ(tick.price, 150009u);
+    EXPECT_EQ(publisher.GetRetransmitRequests(), 1u);
+    
+    publisher.Stop();
+    close(receiver);
+}
+
+TEST(LastValueCacheTest, SnapshotReplyTest) {
+    LastValueCache cache;
+    LastValue value;
+    EXPECT_FALSE(cache.Read(42, value));
+    
+    // Top-of-book output: a trade, then one quote update per side
+    TickData run[3] = {
+        TickData(1000, 7, 1500000, 200, 'B', 'E', 42),
+        TickData(1001, 7, 1499900, 300, 'B', kMsgTypeQuoteUpdate, 42),
+        TickData(1002, 7, 1500100, 100, 'S', kMsgTypeQuoteUpdate, 42)
+    };
+    cache.ApplyTicks(run, 3, 17);
+    
+    ASSERT_TRUE(cache.Read(42, value));
+    EXPECT_EQ(value.tick_sequence, 17u);
+    EXPECT_EQ(value.flags, LastValue::kHasTick | LastValue::kHasQuote);
+    EXPECT_EQ(value.last_tick.price, 1500000u);
+    EXPECT_EQ(value.quote.bid_price, 1499900u);
+    EXPECT_EQ(value.quote.ask_size, 100u);
+    EXPECT_EQ(value.quote_time, 1002u);
+    
+    // One cached symbol and one never published
+    SnapshotService service;
+    service.Initialize("inproc://lvc-test", &cache);
+    uint8_t request[] = {0, 42, 0, 43};
+    std::vector<zmq::message_t> parts;
+    ASSERT_TRUE(service.BuildReply(request, sizeof(request), parts));
+    ASSERT_EQ(parts.size(), 1u);
+    
+    const uint8_t* data = static_cast<const uint8_t*>(parts[0].data());
+    wire::MessageHeader header;
+    ASSERT_TRUE(wire::DecodeHeader(data, parts[0].size(), header));
+    EXPECT_EQ(header.kind, wire::kLastValueBatch);
+    ASSERT_EQ(header.count, 2);
+    
+    wire::LastValueRecord first = wire::DecodeLastValue(data + sizeof(wire::MessageHeader));
+    wire::LastValueRecord second = wire::DecodeLastValue(data + sizeof(wire::MessageHeader) + header.record_size);
+    EXPECT_EQ(first.stock_locate, 42);
+    EXPECT_EQ(first.tick_sequence, 17u);
+    EXPECT_EQ(first.symbol_id, 7u);
+    EXPECT_EQ(first.last_tick.size, 200u);
+    EXPECT_EQ(first.ask_price, 1500100u);
+    EXPECT_EQ(second.stock_locate, 43);
+    EXPECT_EQ(second.flags, 0);
+    EXPECT_EQ(second.tick_sequence, 0u);
+    
+    // Odd-sized bodies are rejected
+    EXPECT_FALSE(service.BuildReply(request, 3, parts));
+    service.Stop();
+}
+
+TEST(LastValueCacheTest, ConsistentUnderConcurrentWritesTest) {
+    LastValueCache cache;
+    std::atomic<bool> done{false};
+    
+    // Every write keeps price, size and sequence in lockstep
+    std::thread writer([&]() {
+        for (uint64_t sequence = 1; sequence <= 200000; ++sequence) {
+            TickData tick(sequence, 1, sequence * 10, static_cast<uint32_t>(sequence), 'B', 'A', 5);
+            cache.ApplyTicks(&tick, 1, sequence);
+        }
+        done.store(true);
+    });
+    
+    uint64_t last_seen = 0;
+    LastValue value;
+    while (!done.load()) {
+        if (cache.Read(5, value)) {
+            ASSERT_EQ(value.last_tick.price, value.tick_sequence * 10);
+            ASSERT_EQ(value.last_tick.size, value.tick_sequence);
+            ASSERT_GE(value.tick_sequence, last_seen);
+            last_seen = value.tick_sequence;
+        }
+    }
+    writer.join();
+    
+    ASSERT_TRUE(cache.Read(5, value));
+    EXPECT_EQ(value.tick_sequence, 200000u);
+}
+
+TEST(CompactFormatTest, DeltaRoundTripTest) {
+    EXPECT_EQ(wire::UnZigZag(wire::ZigZag(-1)), -1);
+    EXPECT_EQ(wire::ZigZag(-1), 1u);
+    EXPECT_EQ(wire::ZigZag(1), 2u);
+    
+    // Clustered prices, climbing timestamps, one tick out of order, odd sides
+    std::vector<TickData> ticks;
+    uint64_t timestamp = 34200000000000ULL;
+    for (uint32_t i = 0; i < 64; ++i) {
+        timestamp += 1500 + (i % 7) * 100;
+        uint64_t price = 1500000 + (i % 5) * 100 - (i % 3) * 100;
+        ticks.push_back(TickData(timestamp, 7, price, 100 * (1 + i % 4), (i % 2) ? 'S' : 'B', 'A', 42));
+    }
+    ticks[10].timestamp -= 5000;
+    ticks[20].side = 'X';
+    ticks[30].message_type = 'E';
+    ticks[31].symbol_id = 8;
+    
+    FrameEncoder encoder(WireFormat::kCompact);
+    std::vector<SinkFrame> frames;
+    encoder.EncodeTicks(ticks.data(), ticks.size(), frames);
+    ASSERT_EQ(frames.size(), 2u);
+    
+    const uint8_t* data = static_cast<const uint8_t*>(frames[1].message.data());
+    size_t size = frames[1].message.size();
+    wire::MessageHeader header;
+    ASSERT_TRUE(wire::DecodeHeader(data, size, header));
+    EXPECT_EQ(header.kind, wire::kCompactTickBatch);
+    EXPECT_EQ(header.sequence, 1u);
+    
+    std::vector<wire::TickRecord> decoded;
+    ASSERT_TRUE(wire::DecodeCompactTicks(data, size, header, decoded));
+    ASSERT_EQ(decoded.size(), ticks.size());
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        EXPECT_EQ(decoded[i].timestamp, ticks[i].timestamp);
+        EXPECT_EQ(decoded[i].price, ticks[i].price);
+        EXPECT_EQ(decoded[i].size, ticks[i].size);
+        EXPECT_EQ(decoded[i].symbol_id, ticks[i].symbol_id);
+        EXPECT_EQ(decoded[i].side, static_cast<uint8_t>(ticks[i].side));
+        EXPECT_EQ(decoded[i].message_type, ticks[i].message_type);
+        EXPECT_EQ(decoded[i].stock_locate, 42);
+    }
+    
+    // Truncated bodies are rejected instead of read past the end
+    EXPECT_FALSE(wire::DecodeCompactTicks(data, size - 1, header, decoded));
+    
+    EncoderStats stats = encoder.GetStats();
+    EXPECT_EQ(stats.batches, 1u);
+    EXPECT_EQ(stats.ticks, 64u);
+    EXPECT_EQ(stats.encoded_bytes, size);
+    EXPECT_GT(stats.GetCompressionRatio(), 3.0);
+    EXPECT_EQ(stats.copied_frames, 1u);
+    
+    // A one-tick binary batch is already past what ZMQ keeps inline, so it is pooled
+    FrameEncoder binary(WireFormat::kBinary);
+    std::vector<SinkFrame> binary_frames;
+    binary.EncodeTicks(ticks.data(), 1, binary_frames);
+    EXPECT_EQ(binary.GetStats().pooled_frames, 1u);
+    EXPECT_EQ(binary.GetStats().copied_frames, 0u);
+}
+
+TEST(WireFormatTest, EgressStampTest) {
+    FastClock::Calibrate();
+    uint64_t ingest_ns = FastClock::NowNanos();
+    std::vector<TickData> ticks;
+    for (int i = 0; i < 3; ++i) {
+        ticks.emplace_back(1000 + i, 1, 100 + i, 10, 'B', 'A', 7);
+        ticks.back().ingest_time_ns = ingest_ns + (2 - i) * 1000;
+    }
+    ticks[2].ingest_time_ns = 0;  // Never went through a worker
+    
+    for (WireFormat format : {WireFormat::kBinary, WireFormat::kCompact}) {
+        FrameEncoder encoder(format);
+        encoder.SetEgressStamp(true);
+        std::vector<SinkFrame> frames;
+        encoder.EncodeTicks(ticks.data(), ticks.size(), frames);
+        ASSERT_EQ(frames.size(), 2u);
+        
+        const uint8_t* data = static_cast<const uint8_t*>(frames[1].message.data());
+        size_t size = frames[1].message.size();
+        wire::MessageHeader header;
+        ASSERT_TRUE(wire::DecodeHeader(data, size, header));
+        EXPECT_TRUE(header.kind & wire::kEgressStamped);
+        
+        wire::EgressStamp stamp;
+        ASSERT_TRUE(wire::TakeEgressStamp(data, size, header, stamp));
+        EXPECT_EQ(size, frames[1].message.size() - sizeof(wire::EgressStamp));
+        EXPECT_EQ(stamp.ingest_ns, FastClock::ToRealtime(ingest_ns + 1000));
+        EXPECT_GE(stamp.egress_ns, stamp.ingest_ns);
+        EXPECT_FALSE(wire::TakeEgressStamp(data, size, header, stamp));
+        
+        // The body still decodes once the trailer is gone
+        if (format == WireFormat::kCompact) {
+            EXPECT_EQ(header.kind, wire::kCompactTickBatch);
+            std::vector<wire::TickRecord> decoded;
+            ASSERT_TRUE(wire::DecodeCompactTicks(data, size, header, decoded));
+            EXPECT_EQ(decoded.size(), 3u);
+        } else {
+            EXPECT_EQ(header.kind, wire::kTickBatch);
+            EXPECT_EQ(size, sizeof(wire::MessageHeader) + 3 * sizeof(wire::TickRecord));
+            EXPECT_EQ(wire::DecodeTick(data + sizeof(wire::MessageHeader)).price, 100u);
+        }
+    }
+    
+    FrameEncoder json_encoder(WireFormat::kJson);
+    json_encoder.SetEgressStamp(true);
+    std::vector<SinkFrame> frames;
+    json_encoder.EncodeTicks(ticks.data(), 1, frames);
+    ASSERT_EQ(frames.size(), 2u);
+    std::string json(static_cast<const char*>(frames[1].message.data()), frames[1].message.size());
+    EXPECT_NE(json.find("\"ingest_ns\":" + std::to_string(FastClock::ToRealtime(ticks[0].ingest_time_ns))),
+              std::string::npos);
+    EXPECT_NE(json.find("\"egress_ns\":"), std::string::npos);
+}
+
+TEST(SessionManagerTest, FilterAndLifecycleTest) {
+    SessionOptions narrow;
+    std::string error;
+    ASSERT_TRUE(ParseSessionSpec("narrow inproc://session-narrow compact rate=100 symbols=2,1,2", narrow, error));
+    EXPECT_EQ(narrow.format, WireFormat::kCompact);
+    EXPECT_EQ(narrow.rate, 100u);
+    EXPECT_EQ(narrow.stock_locates, (std::vector<uint16_t>{1, 2}));
+    EXPECT_FALSE(narrow.conflate);
+    
+    SessionOptions wide;
+    EXPECT_FALSE(ParseSessionSpec("wide", wide, error));
+    EXPECT_FALSE(ParseSessionSpec("wide inproc://session-wide symbols=70000", wide, error));
+    ASSERT_TRUE(ParseSessionSpec("wide inproc://session-wide conflate", wide, error));
+    
+    SessionManager manager;
+    EXPECT_FALSE(manager.IsWanted(1));
+    ASSERT_TRUE(manager.CreateSession(narrow, error));
+    EXPECT_FALSE(manager.CreateSession(narrow, error));  // Names are unique
+    EXPECT_TRUE(manager.IsWanted(1));
+    EXPECT_FALSE(manager.IsWanted(3));
+    ASSERT_TRUE(manager.CreateSession(wide, error));
+    EXPECT_TRUE(manager.IsWanted(3));
+    
+    // Each session only sees its own symbols
+    for (uint16_t stock_locate = 1; stock_locate <= 4; ++stock_locate) {
+        manager.Publish(TickData(1000, stock_locate, 1500000, 100, 'B', 'A', stock_locate));
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    std::vector<SessionStats> stats;
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = manager.GetSessionStats();
+    } while ((stats[0].ticks_in < 2 || stats[1].ticks_in < 4) && std::chrono::steady_clock::now() < deadline);
+    
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].name, "narrow");
+    EXPECT_EQ(stats[0].ticks_in, 2u);
+    EXPECT_EQ(stats[0].symbol_count, 2u);
+    EXPECT_EQ(stats[1].ticks_in, 4u);
+    EXPECT_TRUE(stats[1].conflated);
+    
+    // Removal takes effect for the workers immediately
+    EXPECT_TRUE(manager.RemoveSession("wide"));
+    EXPECT_FALSE(manager.RemoveSession("wide"));
+    EXPECT_FALSE(manager.IsWanted(3));
+    EXPECT_EQ(manager.GetSessionStats().size(), 1u);
+}
+
+TEST(SessionManagerTest, RemoveWhilePublishingTest) {
+    SessionManager manager;
+    std::atomic<bool> running{true};
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 2; ++w) {
+        workers.emplace_back([&]() {
+            while (running.load()) {
+                for (uint16_t stock_locate = 1; stock_locate <= 8; ++stock_locate) {
+                    manager.Publish(TickData(1000, stock_locate, 1500000, 100, 'B', 'A', stock_locate));
+                }
+            }
+        });
+    }
+    
+    // Each removal frees its session while workers keep offering ticks to the slot
+    std::string error;
+    for (int i = 0; i < 20; ++i) {
+        SessionOptions options;
+        ASSERT_TRUE(ParseSessionSpec("churn inproc://session-churn-" + std::to_string(i) + " symbols=1,5", 
+                                     options, error));
+        ASSERT_TRUE(manager.CreateSession(options, error));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        EXPECT_TRUE(manager.RemoveSession("churn"));
+    }
+    
+    running.store(false);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    EXPECT_FALSE(manager.HasSessions());
+}
+
+TEST(ReplayTest, SharedFileCursorsTest) {
+    const std::string path = "/tmp/tickshaper_replay_test.itch";
+    const uint64_t second = 1000000000ULL;
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::vector<uint8_t> directory(8, ' ');
+        memcpy(directory.data(), "MSFT", 4);
+        WriteITCHMessage(out, 'R', 7, 1 * second, directory);
+        
+        // 3000 add orders, one per millisecond from 10s
+        for (uint64_t i = 0; i < 3000; ++i) {
+            std::vector<uint8_t> add(25, 0);
+            *reinterpret_cast<uint64_t*>(add.data()) = htobe64(i + 1);
+            add[8] = (i % 2) ? 'S' : 'B';
+            *reinterpret_cast<uint32_t*>(add.data() + 9) = htonl(100);
+            memcpy(add.data() + 13, "MSFT    ", 8);
+            *reinterpret_cast<uint32_t*>(add.data() + 21) = htonl(1000000);
+            WriteITCHMessage(out, 'A', 7, 10 * second + i * 1000000ULL, add);
+        }
+    }
+    
+    ReplayFile file;
+    ASSERT_TRUE(file.Open(path));
+    EXPECT_EQ(file.GetMessageCount(), 3001u);
+    EXPECT_EQ(file.GetFirstTime(), 1 * second);
+    EXPECT_EQ(file.GetLastTime(), 10 * second + 2999 * 1000000ULL);
+    EXPECT_EQ(file.GetSymbolTable()->GetSymbol(1), "MSFT");
+    
+    // The index lands on the exact message, across checkpoints
+    uint64_t index = 0;
+    uint64_t offset = file.Seek(12 * second, index);
+    EXPECT_EQ(index, 2001u);
+    MappedMessage message;
+    ASSERT_TRUE(file.ReadAt(offset, message));
+    EXPECT_EQ(message.timestamp, 12 * second);
+    EXPECT_EQ(message.message_type, 'A');
+    
+    ReplayOptions full;
+    std::string error;
+    ASSERT_TRUE(ParseReplaySpec("full inproc://replay-full speed=max", full, error));
+    EXPECT_EQ(full.speed, 0.0);
+    
+    ReplayOptions late;
+    ASSERT_TRUE(ParseReplaySpec("late inproc://replay-late compact speed=max start=00:00:12.5 cold", late, error));
+    EXPECT_EQ(late.start_time, 12 * second + second / 2);
+    EXPECT_FALSE(late.warmup);
+    ReplayOptions bad;
+    EXPECT_FALSE(ParseReplaySpec("bad inproc://replay-bad start=noon", bad, error));
+    
+    // Two cursors over one mapping, each at its own position
+    SharedMemoryManager shm;
+    ReplayManager replays;
+    replays.Initialize(path, &shm);
+    ASSERT_TRUE(replays.CreateReplay(full, error));
+    ASSERT_TRUE(replays.CreateReplay(late, error));
+    EXPECT_FALSE(replays.CreateReplay(late, error));
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    std::vector<ReplayStats> stats;
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = replays.GetReplayStats();
+    } while (!(stats[0].finished && stats[1].finished) && std::chrono::steady_clock::now() < deadline);
+    
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_TRUE(stats[0].finished);
+    EXPECT_EQ(stats[0].position, 3001u);
+    EXPECT_EQ(stats[0].ticks_out, 3001u);
+    EXPECT_TRUE(stats[1].finished);
+    EXPECT_EQ(stats[1].position, 3001u);
+    EXPECT_EQ(stats[1].ticks_out, 500u);  // Sought straight past the first 2501
+    EXPECT_EQ(stats[1].itch_time, 10 * second + 2999 * 1000000ULL);
+    
+    EXPECT_TRUE(replays.RemoveReplay("full"));
+    EXPECT_EQ(replays.GetReplayStats().size(), 1u);
+    replays.StopAll();
+    std::remove(path.c_str());
+}
+
+TEST(LatencyHistogramTest, PercentilesAndMergeTest) {
+    // Bucket bounds: exact below 64 ns, then within 1/32 of the value
+    for (uint64_t value : {0ULL, 63ULL, 64ULL, 1000ULL, 123456789ULL}) {
+        size_t index = LatencyHistogram::BucketIndex(value);
+        uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / 32);
+    }
+    EXPECT_EQ(LatencyHistogram::BucketIndex(~0ULL), LatencyHistogram::NUM_BUCKETS - 1);
+    
+    // Two threads' slots, 1..10000 ns split between them, merged on read
+    LatencyTracker tracker;
+    ThreadLatency* first = tracker.RegisterThread();
+    ThreadLatency* second = tracker.RegisterThread();
+    for (uint64_t value = 1; value <= 10000; ++value) {
+        (value % 2 ? first : second)->Record(kStageDecode, value);
+    }
+    
+    std::vector<HistogramSnapshot> merged = tracker.Collect();
+    LatencyPercentiles decode = merged[kStageDecode].Summarize();
+    EXPECT_EQ(decode.count, 10000u);
+    EXPECT_NEAR(static_cast<double>(decode.p50), 5000.0, 5000.0 / 32);
+    EXPECT_NEAR(static_cast<double>(decode.p99), 9900.0, 9900.0 / 32);
+    EXPECT_NEAR(static_cast<double>(decode.p9999), 9999.0, 9999.0 / 32);
+    EXPECT_EQ(decode.max, 10000u);
+    EXPECT_DOUBLE_EQ(decode.mean, 5000.5);
+    EXPECT_EQ(merged[kStageBook].Summarize().count, 0u);
+    
+    // An interval only sees what was recorded since the previous snapshot
+    first->Record(kStageDecode, 1000000);
+    HistogramSnapshot interval = tracker.Collect()[kStageDecode].Since(merged[kStageDecode]);
+    LatencyPercentiles spike = interval.Summarize();
+    EXPECT_EQ(spike.count, 1u);
+    EXPECT_NEAR(static_cast<double>(spike.p50), 1000000.0, 1000000.0 / 32);
+    EXPECT_EQ(spike.max, spike.p50);
+
+}
+
 TEST(PerformanceTest, ThroughputBenchmark) {
     auto start = std::chrono::high_resolution_clock::now();
     
@@ -239,6 +1339,527 @@ TEST(PerformanceTest, ThroughputBenchmark) {
     EXPECT_GT(messages_per_second, 10000);
 }
 
+TEST(CounterRegistryTest, PerThreadSlotsTest) {
+    CounterRegistry registry;
+    
+    // Neighbouring slots never share a cache line
+    ThreadCounters* first = registry.RegisterThread();
+    ThreadCounters* second = registry.RegisterThread();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % 64, 0u);
+    EXPECT_EQ(sizeof(ThreadCounters) % 64, 0u);
+    EXPECT_NE(first, second);
+    
+    const int threads = 4;
+    const int adds = 100000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&registry]() {
+            ThreadCounters* counters = registry.RegisterThread();
+            for (int i = 0; i < adds; ++i) {
+                counters->Add(kCounterProcessed);
+                registry.Local().Add(kCounterPruned, 2);
+            }
+            
+            // Balanced raises and lowers leave nothing in flight
+            registry.Local().Add(kCounterInFlight);
+            registry.Local().Sub(kCounterInFlight);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    std::vector<uint64_t> totals = registry.Collect();
+    ASSERT_EQ(totals.size(), kNumCounters);
+    EXPECT_EQ(totals[kCounterProcessed], static_cast<uint64_t>(threads) * adds);
+    EXPECT_EQ(totals[kCounterPruned], static_cast<uint64_t>(threads) * adds * 2);
+    EXPECT_EQ(registry.Get(kCounterInFlight), 0u);
+    
+    // A thread reuses its slot, and keeps separate slots per registry
+    CounterRegistry other;
+    registry.Local().Add(kCounterTrades);
+    registry.Local().Add(kCounterTrades);
+    other.Local().Add(kCounterTrades);
+    EXPECT_EQ(&registry.Local(), &registry.Local());
+    EXPECT_NE(&registry.Local(), &other.Local());
+    EXPECT_EQ(registry.Get(kCounterTrades), 2u);
+    EXPECT_EQ(other.Get(kCounterTrades), 1u);
+}
+
+TEST(FastClockTest, TracksMonotonicClockTest) {
+    FastClock::Calibrate();
+    if (FastClock::UsesTsc()) {
+        EXPECT_GT(FastClock::GetTicksPerNano(), 0.1);
+    }
+    
+    // Never steps backwards, including across a recalibration
+    uint64_t previous = FastClock::NowNanos();
+    for (int i = 0; i < 100000; ++i) {
+        if (i == 50000) {
+            FastClock::Recalibrate();
+        }
+        uint64_t now = FastClock::NowNanos();
+        ASSERT_GE(now, previous);
+        previous = now;
+    }
+    
+    // Stays on the CLOCK_MONOTONIC timeline
+    uint64_t fast = FastClock::NowNanos();
+    uint64_t mono = FastClock::MonotonicNanos();
+    uint64_t skew = fast > mono ? fast - mono : mono - fast;
+    EXPECT_LT(skew, 1000000u);
+    
+    // And measures intervals at the right rate
+    uint64_t start = FastClock::NowNanos();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t elapsed = FastClock::NowNanos() - start;
+    EXPECT_GE(elapsed, 19000000u);
+    EXPECT_LT(elapsed, 200000000u);
+}
+
+TEST(PerfCountersTest, SampledStagesTest) {
+    // Disabled: nothing is opened and no pass is ever sampled
+    PerfCounters disabled;
+    ThreadPerf* closed = disabled.RegisterThread();
+    EXPECT_FALSE(closed->IsOpen());
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_FALSE(closed->Sample());
+    }
+    
+    PerfCounters counters;
+    counters.SetEnabled(true);
+    counters.SetSampleInterval(4);
+    ThreadPerf* perf = counters.RegisterThread();
+    if (!perf->IsOpen()) {
+        GTEST_SKIP() << "perf_event_open is not permitted here";
+    }
+    
+    // One call in four samples
+    int sampled = 0;
+    for (int i = 0; i < 16; ++i) {
+        sampled += perf->Sample();
+    }
+    EXPECT_EQ(sampled, 4);
+    
+    // Sleeping gives up the CPU, so it is charged one context switch at least
+    perf->Begin();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    perf->End(kPerfFraming);
+    volatile uint64_t sum = 0;
+    for (int i = 0; i < 100000; ++i) {
+        sum = sum + i;
+    }
+    perf->End(kPerfSend, 8);
+    
+    std::vector<PerfStageStats> stats = counters.Collect();
+    ASSERT_EQ(stats.size(), static_cast<size_t>(kNumPerfStages));
+    EXPECT_EQ(stats[kPerfFraming].stage, "framing");
+    EXPECT_EQ(stats[kPerfFraming].messages, 1u);
+    EXPECT_EQ(stats[kPerfSend].messages, 8u);
+    EXPECT_EQ(stats[kPerfThrottle].messages, 0u);
+    if (perf->GetOpenEvents() & (1u << kPerfContextSwitches)) {
+        EXPECT_GE(stats[kPerfFraming].counts[kPerfContextSwitches], 1u);
+    }
+    if (perf->GetOpenEvents() & (1u << kPerfInstructions)) {
+        EXPECT_GT(stats[kPerfSend].PerMessage(kPerfInstructions), 10000.0);
+    }
+}
+
+TEST(LockProfilerTest, ContentionRankingTest) {
+    LockProfiler::SetEnabled(true);
+    LockProfiler::Reset();
+    
+    auto find = [](const std::string& name) {
+        for (const LockReport& lock : LockProfiler::GetReport()) {
+            if (lock.name == name) {
+                return lock;
+            }
+        }
+        return LockReport{};
+    };
+    
+    {
+        InstrumentedMutex busy("test_busy");
+        InstrumentedMutex idle("test_idle");
+        
+        // The second thread finds busy held and has to wait for it
+        std::unique_lock<InstrumentedMutex> held(busy);
+        std::thread waiter([&]() {
+            std::lock_guard<InstrumentedMutex> lock(busy);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        held.unlock();
+        waiter.join();
+        
+        for (int i = 0; i < 100; ++i) {
+            std::lock_guard<InstrumentedMutex> lock(idle);
+        }
+        EXPECT_TRUE(idle.try_lock());
+        idle.unlock();
+        
+        LockReport report = find("test_busy");
+        EXPECT_EQ(report.instances, 1u);
+        EXPECT_EQ(report.acquisitions, 2u);
+        EXPECT_EQ(report.contended, 1u);
+        EXPECT_EQ(report.wait.count, 1u);
+        EXPECT_GE(report.total_wait_ns, 1000000u);
+        EXPECT_EQ(report.hold.count, 2u);
+        EXPECT_GE(report.hold.max, 19000000u);
+        
+        report = find("test_idle");
+        EXPECT_EQ(report.acquisitions, 101u);
+        EXPECT_EQ(report.contended, 0u);
+        EXPECT_EQ(report.total_wait_ns, 0u);
+        
+        // Ranked by total wait
+        std::vector<LockReport> ranked = LockProfiler::GetReport();
+        ASSERT_FALSE(ranked.empty());
+        EXPECT_EQ(ranked.front().name, "test_busy");
+    }
+    
+    // A new lock of the same name carries on the totals; off means not counted
+    InstrumentedMutex again("test_busy");
+    EXPECT_EQ(find("test_busy").acquisitions, 2u);
+    LockProfiler::SetEnabled(false);
+    {
+        std::lock_guard<InstrumentedMutex> lock(again);
+    }
+    EXPECT_EQ(find("test_busy").acquisitions, 2u);
+    EXPECT_EQ(find("test_busy").hold.count, 2u);
+    
+    LockProfiler::Reset();
+    EXPECT_EQ(find("test_busy").acquisitions, 0u);
+    EXPECT_EQ(find("test_busy").wait.count, 0u);
+}
+
+TEST(MetricsSegmentTest, ConsistentReadTest) {
+    std::string name = "/tickshaper-test-" + std::to_string(getpid());
+    MetricsSegmentReader missing;
+    std::string error;
+    EXPECT_FALSE(missing.Open(name, error));
+    
+    MetricsSegment segment;
+    ASSERT_TRUE(segment.Create(name, 1000));
+    int processed = segment.AddValue("processed", metrics_shm::kCounter);
+    int total = segment.AddValue("total", metrics_shm::kCounter);
+    int cpu = segment.AddValue("cpu", metrics_shm::kGauge, 2);
+    int latency = segment.AddHistogram("latency_total");
+    EXPECT_EQ(processed, 0);
+    EXPECT_EQ(latency, 0);
+    
+    MetricsSegmentReader reader;
+    ASSERT_TRUE(reader.Open(name, error)) << error;
+    
+    // The writer keeps processed == total; a torn read would see them differ
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (uint64_t i = 1; i <= 20000; ++i) {
+            segment.BeginUpdate();
+            segment.SetValue(processed, i);
+            segment.SetValue(cpu, 4250);
+            segment.SetValue(total, i);
+            segment.SetHistogram(latency, i, i * 10, 100, 200, 300, 400, 500);
+            segment.EndUpdate();
+        }
+        done.store(true);
+    });
+    
+    // At least one pass runs after the writer is done, however the threads are scheduled
+    uint64_t reads = 0;
+    uint64_t last = 0;
+    bool finished = false;
+    while (!finished) {
+        finished = done.load();
+        MetricsSample sample;
+        if (reader.Read(sample) && sample.update_count > 0) {
+            ASSERT_EQ(sample.values.size(), 3u);
+            EXPECT_EQ(sample.values[0].value, sample.values[1].value);
+            EXPECT_EQ(sample.histograms[0].count, sample.values[0].value);
+            EXPECT_GE(sample.values[0].value, last);
+            last = sample.values[0].value;
+            ++reads;
+        }
+    }
+    writer.join();
+    EXPECT_GT(reads, 0u);
+    
+    MetricsSample sample;
+    ASSERT_TRUE(reader.Read(sample));
+    EXPECT_EQ(sample.pid, getpid());
+    EXPECT_EQ(sample.update_count, 20000u);
+    ASSERT_NE(sample.FindValue("cpu"), nullptr);
+    EXPECT_EQ(sample.FindValue("cpu")->kind, metrics_shm::kGauge);
+    EXPECT_DOUBLE_EQ(sample.FindValue("cpu")->Scaled(), 42.5);
+    ASSERT_NE(sample.FindHistogram("latency_total"), nullptr);
+    EXPECT_EQ(sample.FindHistogram("latency_total")->sum_ns, 200000u);
+    EXPECT_EQ(sample.FindHistogram("latency_total")->p999, 300u);
+    EXPECT_EQ(sample.FindValue("missing"), nullptr);
+}
+
+TEST(MetricsExporterTest, ScrapeTest) {
+    LatencyHistogram histogram;
+    histogram.Record(800);       // 1 us bucket
+    histogram.Record(20000);     // 25 us
+    histogram.Record(3000000);   // 5 ms
+    HistogramSnapshot snapshot;
+    snapshot.Add(histogram);
+    EXPECT_EQ(snapshot.CountAtOrBelow(1000), 1u);
+    EXPECT_EQ(snapshot.CountAtOrBelow(25000), 2u);
+    EXPECT_EQ(snapshot.CountAtOrBelow(2000000), 2u);
+    
+    PrometheusPage page;
+    page.Declare("test_messages_total", "counter", "Messages");
+    page.Sample("test_messages_total", "", uint64_t{42});
+    page.Declare("test_latency_seconds", "histogram", "Latency");
+    page.Histogram("test_latency_seconds", "stage=\"total\"", snapshot);
+    
+    MetricsExporter exporter;
+    ASSERT_TRUE(exporter.Initialize("127.0.0.1", 0));
+    ASSERT_NE(exporter.GetPort(), 0);
+    exporter.SetPage(page.Take());
+    
+    auto get = [&](const std::string& path) {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(exporter.GetPort());
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        std::string response;
+        if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            send(client, request.data(), request.size(), 0);
+            char buffer[4096];
+            ssize_t received;
+            while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0) {
+                response.append(buffer, static_cast<size_t>(received));
+            }
+        }
+        close(client);
+        return response;
+    };
+    
+    std::string response = get("/metrics");
+    EXPECT_EQ(response.rfind("HTTP/1.0 200 OK\r\n", 0), 0u);
+    EXPECT_NE(response.find("text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(response.find("# TYPE test_messages_total counter\ntest_messages_total 42\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_bucket{stage=\"total\",le=\"1e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_bucket{stage=\"total\",le=\"0.005\"} 3\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_bucket{stage=\"total\",le=\"+Inf\"} 3\n"), std::string::npos);
+    EXPECT_NE(response.find("test_latency_seconds_count{stage=\"total\"} 3\n"), std::string::npos);
+    
+    EXPECT_EQ(get("/other").rfind("HTTP/1.0 404", 0), 0u);
+    EXPECT_EQ(exporter.GetScrapeCount(), 1u);
+    exporter.Stop();
+}
+
+TEST(DashboardStreamTest, HandshakeAndPushTest) {
+    // The example from RFC 6455 section 1.3
+    EXPECT_EQ(DashboardStream::AcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    
+    std::string frame = DashboardStream::EncodeTextFrame("hi");
+    EXPECT_EQ(frame, std::string("\x81\x02hi", 4));
+    frame = DashboardStream::EncodeTextFrame(std::string(300, 'x'));
+    EXPECT_EQ(static_cast<uint8_t>(frame[1]), 126);
+    EXPECT_EQ((static_cast<uint8_t>(frame[2]) << 8) | static_cast<uint8_t>(frame[3]), 300);
+    EXPECT_EQ(frame.size(), 304u);
+    
+    std::atomic<int> renders{0};
+    DashboardStream stream;
+    ASSERT_TRUE(stream.Initialize("127.0.0.1", 0, 20, [&]() {
+        return "{\"n\":" + std::to_string(++renders) + "}";
+    }));
+    
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(stream.GetPort());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    ASSERT_EQ(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    timeval timeout{2, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    std::string request = "GET /stream HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+                          "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    send(client, request.data(), request.size(), 0);
+    
+    // Handshake reply, then at least one pushed frame
+    std::string received;
+    char buffer[4096];
+    while (received.find("\r\n\r\n") == std::string::npos || 
+           received.size() < received.find("\r\n\r\n") + 4 + 2 + 7) {
+        ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        received.append(buffer, static_cast<size_t>(n));
+    }
+    EXPECT_EQ(received.rfind("HTTP/1.1 101 Switching Protocols\r\n", 0), 0u);
+    EXPECT_NE(received.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"), std::string::npos);
+    
+    std::string frames = received.substr(received.find("\r\n\r\n") + 4);
+    ASSERT_GE(frames.size(), 2u);
+    EXPECT_EQ(static_cast<uint8_t>(frames[0]), 0x81);
+    size_t length = static_cast<uint8_t>(frames[1]);
+    ASSERT_GE(frames.size(), 2 + length);
+    EXPECT_EQ(frames.substr(2, 5), "{\"n\":");
+    EXPECT_EQ(stream.GetClientCount(), 1u);
+    
+    // Nothing is rendered without an open connection
+    close(client);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(stream.GetClientCount(), 0u);
+    int rendered = renders.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(renders.load(), rendered);
+    stream.Stop();
+}
+
+TEST(TraceRecorderTest, RingsAndChromeExportTest) {
+    TraceRecorder recorder;
+    recorder.SetCapacity(1000);
+    ThreadTrace* trace = recorder.RegisterThread("worker");
+    std::vector<TraceEvent> events;
+    
+    // Off by default: nothing is kept
+    trace->Span(kTraceDecode, 100, 200, 'A');
+    trace->Snapshot(events);
+    EXPECT_TRUE(events.empty());
+    
+    // Capacity rounds up to 1024 and the newest records win; the slot the
+    // writer would fill next is never read
+    recorder.SetEnabled(true);
+    for (uint64_t i = 1; i <= 3000; ++i) {
+        trace->Span(kTraceDecode, i * 10, i * 10 + 5, i);
+    }
+    trace->Snapshot(events);
+    ASSERT_EQ(events.size(), 1023u);
+    EXPECT_EQ(events.front().arg, 3000u - 1022);
+    EXPECT_EQ(events.back().arg, 3000u);
+    EXPECT_EQ(events.back().start_ns, 30000u);
+    EXPECT_EQ(events.back().duration_ns, 5u);
+    EXPECT_EQ(events.back().id, kTraceDecode);
+    
+    // A reader racing the writer never sees a record that was half overwritten
+    ThreadTrace* busy = recorder.RegisterThread("publisher");
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (uint64_t i = 1; i <= 2000000; ++i) {
+            busy->Span(kTraceSend, i, i * 2, i);
+        }
+        done.store(true);
+    });
+    size_t snapshots = 0;
+    bool consistent = true;
+    while (!done.load() || snapshots == 0) {
+        events.clear();
+        busy->Snapshot(events);
+        for (size_t i = 0; i < events.size(); ++i) {
+            consistent &= events[i].start_ns == events[i].arg && events[i].duration_ns == events[i].arg;
+            consistent &= i == 0 || events[i].arg == events[i - 1].arg + 1;
+        }
+        snapshots++;
+    }
+    writer.join();
+    EXPECT_TRUE(consistent);
+    
+    // The latency trigger freezes every ring once, until the dump is taken
+    std::string directory = "/tmp";
+    recorder.SetTrigger(1000, directory);
+    trace->CheckLatency(999, 50000);
+    EXPECT_TRUE(recorder.IsEnabled());
+    trace->CheckLatency(5000, 60000);
+    EXPECT_FALSE(recorder.IsEnabled());
+    trace->Span(kTraceDecode, 70000, 70010, 1);
+    
+    events.clear();
+    trace->Snapshot(events);
+    EXPECT_EQ(events.back().id, kTraceTrigger);
+    EXPECT_EQ(events.back().arg, 5000u);
+    
+    std::string dump = recorder.FlushTriggered();
+    EXPECT_EQ(dump, "/tmp/tickshaper-trace-60000.json");
+    EXPECT_TRUE(recorder.IsEnabled());
+    EXPECT_EQ(recorder.FlushTriggered(), "");
+    
+    // Chrome trace JSON: thread names, complete events in microseconds, instants
+    std::ifstream file(dump);
+    std::stringstream json;
+    json << file.rdbuf();
+    std::string text = json.str();
+    EXPECT_EQ(text.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(text.find("\"args\":{\"name\":\"worker 1\"}"), std::string::npos);
+    EXPECT_NE(text.find("\"args\":{\"name\":\"publisher 2\"}"), std::string::npos);
+    EXPECT_NE(text.find("\"name\":\"decode\",\"cat\":\"tickshaper\",\"pid\":1,\"tid\":1,\"ts\":30.000,"
+                        "\"ph\":\"X\",\"dur\":0.005,\"args\":{\"message_type\":3000}"), std::string::npos);
+    EXPECT_NE(text.find("\"name\":\"latency_trigger\""), std::string::npos);
+    EXPECT_EQ(text.substr(text.size() - 4), "\n]}\n");
+    std::remove(dump.c_str());
+}
+
+TEST(PerformanceTest, HistogramRecordBenchmark) {
+    LatencyHistogram histogram;
+    const int records = 10000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < records; ++i) {
+        histogram.Record((static_cast<uint64_t>(i) * 2654435761u) & 0xFFFFF);
+    }
+    double ns_per_record = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / records;
+    
+    std::cout << "Histogram record: " << ns_per_record << " ns" << std::endl;
+#ifdef NDEBUG
+    EXPECT_LT(ns_per_record, 10.0);  // Unoptimized sanitizer builds are an order of magnitude slower
+#endif
+}
+
+TEST(PerformanceTest, CounterAddBenchmark) {
+    CounterRegistry registry;
+    ThreadCounters* counters = registry.RegisterThread();
+    const int adds = 10000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < adds; ++i) {
+        counters->Add(static_cast<CounterId>(i & 3));
+    }
+    double ns_per_add = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / adds;
+    
+    std::cout << "Counter add: " << ns_per_add << " ns" << std::endl;
+    EXPECT_EQ(registry.Get(kCounterProcessed), static_cast<uint64_t>(adds) / 4);
+#ifdef NDEBUG
+    EXPECT_LT(ns_per_add, 3.0);
+#endif
+}
+
+TEST(PerformanceTest, ClockReadBenchmark) {
+    FastClock::Calibrate();
+    const int reads = 10000000;
+    uint64_t sink = 0;
+    
+    uint64_t start = FastClock::MonotonicNanos();
+    for (int i = 0; i < reads; ++i) {
+        sink += FastClock::NowNanos();
+    }
+    double fast_ns = static_cast<double>(FastClock::MonotonicNanos() - start) / reads;
+    
+    start = FastClock::MonotonicNanos();
+    for (int i = 0; i < reads; ++i) {
+        sink += std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    }
+    double chrono_ns = static_cast<double>(FastClock::MonotonicNanos() - start) / reads;
+    
+    std::cout << "Clock read: " << fast_ns << " ns (" << (FastClock::UsesTsc() ? "TSC" : "CLOCK_MONOTONIC")
+              << "), high_resolution_clock " << chrono_ns << " ns" << std::endl;
+    EXPECT_NE(sink, 0u);
+#ifdef NDEBUG
+    // rdtsc itself costs anywhere from a few ns on bare metal to ~20 ns under
+    // some hypervisors, so only the comparison is portable
+    if (FastClock::UsesTsc()) {
+        EXPECT_LT(fast_ns, chrono_ns);
+    }
+#endif
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
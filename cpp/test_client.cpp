@@ -3,30 +3,70 @@
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <vector>
+#include <string>
+#include <deque>
+#include <algorithm>
+#include <fstream>
+#include <time.h>
 #include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 #include <json/json.h>
+#include "WireFormat.h"
+#include "MoldUDP64.h"
+#include "CompactFormat.h"
+#include "LatencyHistogram.h"
+
+using namespace tickshaper;
 
 // Simple ZeroMQ client to test TickShaper output
 class TickShaperClient {
 public:
-    TickShaperClient() : context_(1), subscriber_(context_, ZMQ_SUB), running_(true) {
+    TickShaperClient(const std::vector<uint16_t>& stock_locates, const std::string& snapshot_endpoint)
+        : context_(1), subscriber_(context_, ZMQ_SUB), running_(true),
+          last_sequence_(65536, 0), current_locate_(0), sequence_gaps_(0), lost_messages_(0), tick_count_(0),
+          stale_skipped_(0), byte_count_(0), receive_ns_(0) {
         // Connect to TickShaper
         subscriber_.connect("tcp://localhost:5555");
         
-        // Subscribe to all messages
-        subscriber_.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+        if (stock_locates.empty()) {
+            // Subscribe to all messages
+            subscriber_.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+        } else {
+            // Ticks and snapshots for the requested symbols only
+            uint8_t topic[wire::kTopicSize];
+            for (uint16_t locate : stock_locates) {
+                wire::EncodeTopic(topic, wire::kTopicTicks, locate);
+                subscriber_.setsockopt(ZMQ_SUBSCRIBE, topic, sizeof(topic));
+                wire::EncodeTopic(topic, wire::kTopicSnapshots, locate);
+                subscriber_.setsockopt(ZMQ_SUBSCRIBE, topic, sizeof(topic));
+            }
+            std::cout << "Subscribed to " << stock_locates.size() << " symbols" << std::endl;
+        }
         
         // Set receive timeout
         int timeout = 1000; // 1 second
         subscriber_.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
         
         std::cout << "Connected to TickShaper on tcp://localhost:5555" << std::endl;
+        
+        // Late join: subscribed first, so nothing falls between the snapshot and the feed
+        if (!snapshot_endpoint.empty()) {
+            RequestSnapshot(snapshot_endpoint, stock_locates);
+        }
     }
     
     void Run() {
         auto start_time = std::chrono::steady_clock::now();
         uint64_t message_count = 0;
         uint64_t last_count = 0;
+        uint64_t last_ticks = 0;
+        uint64_t last_bytes = 0;
+        HistogramSnapshot last_transit;
+        HistogramSnapshot last_end_to_end;
         auto last_time = start_time;
         
         while (running_.load()) {
@@ -35,11 +75,25 @@ public:
             try {
                 auto result = subscriber_.recv(message, zmq::recv_flags::none);
                 if (result) {
+                    receive_ns_ = RealtimeNanos();
+                    const uint8_t* bytes = static_cast<const uint8_t*>(message.data());
+                    
+                    // Topic frame leads each message; the payload parts follow
+                    uint8_t topic_class;
+                    if (message.more() && wire::DecodeTopic(bytes, message.size(), topic_class, current_locate_)) {
+                        continue;
+                    }
                     message_count++;
+                    byte_count_ += message.size();
                     
                     // Parse and display message
-                    std::string data(static_cast<char*>(message.data()), message.size());
-                    ProcessMessage(data);
+                    wire::MessageHeader header;
+                    if (wire::DecodeHeader(bytes, message.size(), header)) {
+                        ProcessBinaryMessage(header, bytes, message.size());
+                    } else {
+                        std::string data(static_cast<char*>(message.data()), message.size());
+                        ProcessMessage(data);
+                    }
                     
                     // Print statistics every 5 seconds
                     auto now = std::chrono::steady_clock::now();
@@ -51,10 +105,25 @@ public:
                         
                         std::cout << "\n=== Statistics ===" << std::endl;
                         std::cout << "Total messages: " << message_count << std::endl;
-                        std::cout << "Rate: " << rate << " msg/s" << std::endl;
+                        std::cout << "Total ticks: " << tick_count_ << std::endl;
+                        std::cout << "Rate: " << rate << " msg/s, " 
+                                  << static_cast<double>(tick_count_ - last_ticks) / elapsed << " ticks/s, "
+                                  << static_cast<double>(byte_count_ - last_bytes) / elapsed << " bytes/s" << std::endl;
+                        std::cout << "Sequence gaps: " << sequence_gaps_ << " (" << lost_messages_ << " messages lost)" << std::endl;
+                        std::cout << "Covered by snapshot: " << stale_skipped_ << std::endl;
+                        
+                        // Only stamped feeds (publish_egress_stamp=true) fill these
+                        HistogramSnapshot transit = Snapshot(transit_latency_);
+                        HistogramSnapshot end_to_end = Snapshot(end_to_end_latency_);
+                        PrintLatency("Transit", transit.Since(last_transit).Summarize());
+                        PrintLatency("End-to-end", end_to_end.Since(last_end_to_end).Summarize());
                         std::cout << "=================" << std::endl;
                         
                         last_count = message_count;
+                        last_ticks = tick_count_;
+                        last_bytes = byte_count_;
+                        last_transit = transit;
+                        last_end_to_end = end_to_end;
                         last_time = now;
                     }
                 }
@@ -74,23 +143,162 @@ public:
         
         std::cout << "\nFinal Statistics:" << std::endl;
         std::cout << "Total messages: " << message_count << std::endl;
+        std::cout << "Total ticks: " << tick_count_ << std::endl;
         std::cout << "Total time: " << total_time << " seconds" << std::endl;
         if (total_time > 0) {
-            std::cout << "Average rate: " << (message_count / total_time) << " msg/s" << std::endl;
+            std::cout << "Average rate: " << (message_count / total_time) << " msg/s, "
+                      << (tick_count_ / total_time) << " ticks/s, " << (byte_count_ / total_time) << " bytes/s" << std::endl;
+        }
+        std::cout << "Sequence gaps: " << sequence_gaps_ << " (" << lost_messages_ << " messages lost)" << std::endl;
+        PrintLatency("Transit", Snapshot(transit_latency_).Summarize());
+        PrintLatency("End-to-end", Snapshot(end_to_end_latency_).Summarize());
+        
+        if (!report_file_.empty()) {
+            double seconds = std::chrono::duration<double>(end_time - start_time).count();
+            WriteReport(message_count, seconds);
         }
     }
     
+    // Written when Run returns, for comparing runs
+    void SetReportFile(const std::string& path) {
+        report_file_ = path;
+    }
+    
     void Stop() {
         running_.store(false);
     }
     
 private:
+    void RequestSnapshot(const std::string& endpoint, const std::vector<uint16_t>& stock_locates) {
+        zmq::socket_t requester(context_, ZMQ_REQ);
+        int timeout = 5000;
+        requester.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+        requester.connect(endpoint);
+        
+        // Big-endian locates; empty asks for every symbol
+        std::vector<uint8_t> request;
+        for (uint16_t locate : stock_locates) {
+            request.push_back(static_cast<uint8_t>(locate >> 8));
+            request.push_back(static_cast<uint8_t>(locate));
+        }
+        zmq::message_t request_message(request.data(), request.size());
+        requester.send(request_message, zmq::send_flags::none);
+        
+        size_t records = 0;
+        bool more = true;
+        while (more) {
+            zmq::message_t reply;
+            if (!requester.recv(reply, zmq::recv_flags::none)) {
+                std::cerr << "No snapshot from " << endpoint << std::endl;
+                return;
+            }
+            more = reply.more();
+            
+            const uint8_t* data = static_cast<const uint8_t*>(reply.data());
+            wire::MessageHeader header;
+            if (!wire::DecodeHeader(data, reply.size(), header) || header.kind != wire::kLastValueBatch) {
+                continue;
+            }
+            
+            const uint8_t* record = data + sizeof(wire::MessageHeader);
+            for (uint16_t i = 0; i < header.count; ++i, record += header.record_size) {
+                wire::LastValueRecord value = wire::DecodeLastValue(record);
+                
+                // Only one of the two advances in a given output mode
+                last_sequence_[value.stock_locate] = std::max(value.tick_sequence, value.snapshot_sequence);
+                if (records++ < 5 && value.flags != 0) {
+                    std::cout << "  Locate=" << value.stock_locate
+                              << " Seq=" << last_sequence_[value.stock_locate]
+                              << " Bid=" << value.bid_price << "x" << value.bid_size
+                              << " Ask=" << value.ask_price << "x" << value.ask_size
+                              << " Last=" << value.last_tick.price << "x" << value.last_tick.size << std::endl;
+                }
+            }
+        }
+        std::cout << "Snapshot of " << records << " symbols from " << endpoint << std::endl;
+    }
+    
+    void ProcessBinaryMessage(wire::MessageHeader& header, const uint8_t* bytes, size_t size) {
+        wire::EgressStamp stamp;
+        if (wire::TakeEgressStamp(bytes, size, header, stamp)) {
+            RecordLatency(stamp.ingest_ns, stamp.egress_ns);
+        }
+        
+        // Sequences run per symbol, so gaps stay meaningful under topic filtering
+        uint64_t& last_sequence = last_sequence_[current_locate_];
+        if (header.sequence <= last_sequence) {
+            // Queued before the snapshot was taken, already part of it
+            stale_skipped_++;
+            return;
+        }
+        if (last_sequence != 0 && header.sequence != last_sequence + 1) {
+            sequence_gaps_++;
+            lost_messages_ += header.sequence - last_sequence - 1;
+        }
+        last_sequence = header.sequence;
+        
+        const uint8_t* record = bytes + sizeof(wire::MessageHeader);
+        static int display_count = 0;
+        
+        if (header.kind == wire::kTickBatch) {
+            tick_count_ += header.count;
+            for (uint16_t i = 0; i < header.count; ++i, record += header.record_size) {
+                wire::TickRecord tick = wire::DecodeTick(record);
+                if (display_count++ % 1000 == 0) { // Display every 1000th tick
+                    std::cout << "Tick #" << header.sequence
+                              << ": Locate=" << tick.stock_locate
+                              << " Symbol=" << tick.symbol_id
+                              << " Price=" << tick.price
+                              << " Size=" << tick.size
+                              << " Side=" << static_cast<char>(tick.side)
+                              << " Type=" << static_cast<char>(tick.message_type) << std::endl;
+                }
+            }
+        } else if (header.kind == wire::kCompactTickBatch) {
+            if (!wire::DecodeCompactTicks(bytes, size, header, compact_ticks_)) {
+                std::cerr << "Malformed compact batch #" << header.sequence << std::endl;
+                return;
+            }
+            tick_count_ += compact_ticks_.size();
+            for (const wire::TickRecord& tick : compact_ticks_) {
+                if (display_count++ % 1000 == 0) {
+                    std::cout << "Tick #" << header.sequence
+                              << ": Locate=" << tick.stock_locate
+                              << " Symbol=" << tick.symbol_id
+                              << " Price=" << tick.price
+                              << " Size=" << tick.size
+                              << " Side=" << static_cast<char>(tick.side)
+                              << " Type=" << static_cast<char>(tick.message_type) << std::endl;
+                }
+            }
+        } else if (header.kind == wire::kSnapshotBatch) {
+            uint64_t sample_time;
+            memcpy(&sample_time, record, sizeof(sample_time));
+            sample_time = le64toh(sample_time);
+            record += sizeof(sample_time);
+            
+            std::cout << "Snapshot @" << sample_time << ": " << header.count << " symbols" << std::endl;
+            for (uint16_t i = 0; i < header.count && i < 5; ++i, record += header.record_size) {
+                wire::SnapshotRecord snapshot = wire::DecodeSnapshot(record);
+                std::cout << "  Locate=" << snapshot.stock_locate
+                          << " Bid=" << snapshot.bid_price << "x" << snapshot.bid_size
+                          << " Ask=" << snapshot.ask_price << "x" << snapshot.ask_size << std::endl;
+            }
+        }
+    }
+    
     void ProcessMessage(const std::string& data) {
         // Try to parse as JSON
         Json::Value root;
         Json::Reader reader;
         
         if (reader.parse(data, root)) {
+            // JSON batches arrive as multipart messages, one tick per part
+            tick_count_++;
+            if (root.isMember("egress_ns")) {
+                RecordLatency(root["ingest_ns"].asUInt64(), root["egress_ns"].asUInt64());
+            }
+            
             // Display parsed message
             static int display_count = 0;
             if (display_count++ % 1000 == 0) { // Display every 1000th message
@@ -110,21 +318,331 @@ private:
         }
     }
     
+    // Stamps are CLOCK_REALTIME, so across hosts this includes their clock offset
+    void RecordLatency(uint64_t ingest_ns, uint64_t egress_ns) {
+        if (egress_ns != 0 && receive_ns_ >= egress_ns) {
+            transit_latency_.Record(receive_ns_ - egress_ns);
+        }
+        if (ingest_ns != 0 && receive_ns_ >= ingest_ns) {
+            end_to_end_latency_.Record(receive_ns_ - ingest_ns);
+        }
+    }
+    
+    static uint64_t RealtimeNanos() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+    
+    static HistogramSnapshot Snapshot(const LatencyHistogram& histogram) {
+        HistogramSnapshot snapshot;
+        snapshot.Add(histogram);
+        return snapshot;
+    }
+    
+    static void PrintLatency(const char* name, const LatencyPercentiles& latency) {
+        if (latency.count == 0) {
+            return;
+        }
+        std::cout << name << " latency: p50 " << latency.p50 << " ns, p99 " << latency.p99 
+                  << " ns, p99.9 " << latency.p999 << " ns, max " << latency.max << " ns (" 
+                  << latency.count << " samples)" << std::endl;
+    }
+    
+    static Json::Value LatencyJson(const LatencyPercentiles& latency) {
+        Json::Value value;
+        value["count"] = Json::UInt64(latency.count);
+        value["mean_ns"] = latency.mean;
+        value["p50_ns"] = Json::UInt64(latency.p50);
+        value["p99_ns"] = Json::UInt64(latency.p99);
+        value["p999_ns"] = Json::UInt64(latency.p999);
+        value["p9999_ns"] = Json::UInt64(latency.p9999);
+        value["max_ns"] = Json::UInt64(latency.max);
+        return value;
+    }
+    
+    void WriteReport(uint64_t message_count, double seconds) {
+        Json::Value report;
+        report["duration_s"] = seconds;
+        report["messages"] = Json::UInt64(message_count);
+        report["ticks"] = Json::UInt64(tick_count_);
+        report["bytes"] = Json::UInt64(byte_count_);
+        if (seconds > 0) {
+            report["messages_per_s"] = message_count / seconds;
+            report["ticks_per_s"] = tick_count_ / seconds;
+            report["bytes_per_s"] = byte_count_ / seconds;
+        }
+        report["sequence_gaps"] = Json::UInt64(sequence_gaps_);
+        report["messages_lost"] = Json::UInt64(lost_messages_);
+        report["covered_by_snapshot"] = Json::UInt64(stale_skipped_);
+        report["transit_latency"] = LatencyJson(Snapshot(transit_latency_).Summarize());
+        report["end_to_end_latency"] = LatencyJson(Snapshot(end_to_end_latency_).Summarize());
+        
+        std::ofstream file(report_file_);
+        if (!file) {
+            std::cerr << "Cannot write report to " << report_file_ << std::endl;
+            return;
+        }
+        Json::StreamWriterBuilder builder;
+        file << Json::writeString(builder, report) << std::endl;
+        std::cout << "Report written to " << report_file_ << std::endl;
+    }
+    
     zmq::context_t context_;
     zmq::socket_t subscriber_;
     std::atomic<bool> running_;
+    
+    std::vector<uint64_t> last_sequence_;  // Per stock_locate
+    uint16_t current_locate_;
+    uint64_t sequence_gaps_;
+    uint64_t lost_messages_;   // Sum of the sequence numbers skipped by gaps
+    uint64_t tick_count_;
+    uint64_t stale_skipped_;
+    uint64_t byte_count_;
+    std::vector<wire::TickRecord> compact_ticks_;
+    
+    // Receive time of the current message, CLOCK_REALTIME ns
+    uint64_t receive_ns_;
+    LatencyHistogram transit_latency_;     // Publisher encode to receive
+    LatencyHistogram end_to_end_latency_;  // Pipeline entry to receive
+    std::string report_file_;
+};
+
+// MoldUDP64 multicast receiver: tracks the message sequence across packets and
+// asks the retransmission server for any gap it sees
+class MoldClient {
+public:
+    MoldClient(const std::string& group, uint16_t port, const std::string& retransmit_endpoint,
+               const std::string& interface_address)
+        : feed_socket_(-1), request_socket_(-1), running_(true), have_session_(false), expected_sequence_(0),
+          packet_count_(0), tick_count_(0), snapshot_count_(0), heartbeat_count_(0), gap_count_(0),
+          missing_messages_(0), recovered_messages_(0) {
+        feed_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+        int reuse = 1;
+        setsockopt(feed_socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        
+        sockaddr_in feed_address{};
+        feed_address.sin_family = AF_INET;
+        feed_address.sin_addr.s_addr = htonl(INADDR_ANY);
+        feed_address.sin_port = htons(port);
+        if (bind(feed_socket_, reinterpret_cast<sockaddr*>(&feed_address), sizeof(feed_address)) < 0) {
+            throw std::runtime_error("cannot bind UDP port " + std::to_string(port));
+        }
+        
+        in_addr group_address{};
+        inet_pton(AF_INET, group.c_str(), &group_address);
+        if (IN_MULTICAST(ntohl(group_address.s_addr))) {
+            ip_mreq membership{};
+            membership.imr_multiaddr = group_address;
+            inet_pton(AF_INET, interface_address.c_str(), &membership.imr_interface);
+            if (setsockopt(feed_socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+                throw std::runtime_error("cannot join multicast group " + group);
+            }
+        }
+        
+        // Requests go out and answers come back on a separate unicast socket
+        if (!retransmit_endpoint.empty()) {
+            size_t colon = retransmit_endpoint.rfind(':');
+            retransmit_address_ = sockaddr_in{};
+            retransmit_address_.sin_family = AF_INET;
+            retransmit_address_.sin_port = htons(static_cast<uint16_t>(std::stoul(retransmit_endpoint.substr(colon + 1))));
+            inet_pton(AF_INET, retransmit_endpoint.substr(0, colon).c_str(), &retransmit_address_.sin_addr);
+            request_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+        }
+        
+        std::cout << "Joined " << group << ":" << port << " via " << interface_address
+                  << (retransmit_endpoint.empty() ? ", no retransmission" : ", retransmit from " + retransmit_endpoint)
+                  << std::endl;
+    }
+    
+    ~MoldClient() {
+        if (feed_socket_ >= 0) {
+            close(feed_socket_);
+        }
+        if (request_socket_ >= 0) {
+            close(request_socket_);
+        }
+    }
+    
+    void Run() {
+        uint8_t packet[65536];
+        auto last_time = std::chrono::steady_clock::now();
+        
+        while (running_.load()) {
+            pollfd sockets[2] = {{feed_socket_, POLLIN, 0}, {request_socket_, POLLIN, 0}};
+            if (poll(sockets, request_socket_ >= 0 ? 2 : 1, 1000) <= 0) {
+                continue;
+            }
+            
+            if (sockets[0].revents & POLLIN) {
+                ssize_t size = recv(feed_socket_, packet, sizeof(packet), 0);
+                if (size > 0) {
+                    HandleFeedPacket(packet, static_cast<size_t>(size));
+                }
+            }
+            if (request_socket_ >= 0 && (sockets[1].revents & POLLIN)) {
+                ssize_t size = recv(request_socket_, packet, sizeof(packet), 0);
+                if (size > 0) {
+                    HandleRetransmission(packet, static_cast<size_t>(size));
+                }
+            }
+            
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_time >= std::chrono::seconds(5)) {
+                PrintStatistics("Statistics");
+                last_time = now;
+            }
+        }
+        
+        PrintStatistics("Final Statistics");
+    }
+    
+    void Stop() {
+        running_.store(false);
+    }
+    
+private:
+    void HandleFeedPacket(const uint8_t* packet, size_t size) {
+        mold::PacketHeader header;
+        if (!mold::DecodeHeader(packet, size, header)) {
+            return;
+        }
+        
+        // Lock onto the first session seen
+        if (!have_session_) {
+            memcpy(session_, header.session, sizeof(session_));
+            expected_sequence_ = header.sequence;
+            have_session_ = true;
+        } else if (memcmp(session_, header.session, sizeof(session_)) != 0) {
+            return;
+        }
+        packet_count_++;
+        
+        if (header.count == mold::kEndOfSessionCount) {
+            std::cout << "End of session at sequence " << header.sequence << std::endl;
+            running_.store(false);
+            return;
+        }
+        if (header.count == mold::kHeartbeatCount) {
+            heartbeat_count_++;
+        }
+        
+        // Heartbeats carry the next sequence, so they reveal tail losses too
+        if (header.sequence > expected_sequence_) {
+            gap_count_++;
+            missing_messages_ += header.sequence - expected_sequence_;
+            if (request_socket_ >= 0) {
+                pending_gaps_.push_back({expected_sequence_, header.sequence});
+                if (pending_gaps_.size() == 1) {
+                    RequestRetransmit();
+                }
+            }
+        }
+        
+        if (header.sequence + header.count > expected_sequence_) {
+            expected_sequence_ = header.sequence + header.count;
+        }
+        ProcessMessages(packet, size, header.count);
+    }
+    
+    void HandleRetransmission(const uint8_t* packet, size_t size) {
+        mold::PacketHeader header;
+        if (pending_gaps_.empty() || !mold::DecodeHeader(packet, size, header) ||
+            header.sequence != pending_gaps_.front().first) {
+            return;
+        }
+        
+        recovered_messages_ += header.count;
+        ProcessMessages(packet, size, header.count);
+        
+        // One packet per answer; keep asking until the gap is filled
+        pending_gaps_.front().first += header.count;
+        if (pending_gaps_.front().first >= pending_gaps_.front().second) {
+            pending_gaps_.pop_front();
+        }
+        if (!pending_gaps_.empty()) {
+            RequestRetransmit();
+        }
+    }
+    
+    void RequestRetransmit() {
+        uint64_t first = pending_gaps_.front().first;
+        uint64_t remaining = pending_gaps_.front().second - first;
+        uint8_t request[mold::kHeaderSize];
+        mold::EncodeHeader(request, session_, first, static_cast<uint16_t>(std::min<uint64_t>(remaining, 0xFFFE)));
+        sendto(request_socket_, request, sizeof(request), 0, 
+               reinterpret_cast<sockaddr*>(&retransmit_address_), sizeof(retransmit_address_));
+    }
+    
+    void ProcessMessages(const uint8_t* packet, size_t size, uint16_t count) {
+        size_t offset = mold::kHeaderSize;
+        for (uint16_t i = 0; i < count && offset + sizeof(uint16_t) <= size; ++i) {
+            uint16_t length = static_cast<uint16_t>((packet[offset] << 8) | packet[offset + 1]);
+            const uint8_t* message = packet + offset + sizeof(uint16_t);
+            offset += sizeof(uint16_t) + length;
+            if (offset > size || length == 0) {
+                break;
+            }
+            
+            if (message[0] == wire::kTopicTicks && length == mold::kTickMessageSize) {
+                wire::TickRecord tick = wire::DecodeTick(message + 1);
+                if (tick_count_++ % 1000 == 0) { // Display every 1000th tick
+                    std::cout << "Tick: Locate=" << tick.stock_locate
+                              << " Symbol=" << tick.symbol_id
+                              << " Price=" << tick.price
+                              << " Size=" << tick.size
+                              << " Side=" << static_cast<char>(tick.side)
+                              << " Type=" << static_cast<char>(tick.message_type) << std::endl;
+                }
+            } else if (message[0] == wire::kTopicSnapshots && length == mold::kSnapshotMessageSize) {
+                snapshot_count_++;
+            }
+        }
+    }
+    
+    void PrintStatistics(const char* title) {
+        std::cout << "\n=== " << title << " ===" << std::endl;
+        std::cout << "Packets: " << packet_count_ << " (" << heartbeat_count_ << " heartbeats)" << std::endl;
+        std::cout << "Ticks: " << tick_count_ << ", snapshots: " << snapshot_count_ << std::endl;
+        std::cout << "Next sequence: " << expected_sequence_ << std::endl;
+        std::cout << "Gaps: " << gap_count_ << " (" << missing_messages_ << " messages), recovered: "
+                  << recovered_messages_ << std::endl;
+        std::cout << "=================" << std::endl;
+    }
+    
+    int feed_socket_;
+    int request_socket_;
+    sockaddr_in retransmit_address_{};
+    std::atomic<bool> running_;
+    
+    char session_[mold::kSessionSize];
+    bool have_session_;
+    uint64_t expected_sequence_;
+    std::deque<std::pair<uint64_t, uint64_t>> pending_gaps_;  // [first, end) still missing
+    
+    uint64_t packet_count_;
+    uint64_t tick_count_;
+    uint64_t snapshot_count_;
+    uint64_t heartbeat_count_;
+    uint64_t gap_count_;
+    uint64_t missing_messages_;
+    uint64_t recovered_messages_;
 };
 
 std::unique_ptr<TickShaperClient> g_client;
+std::unique_ptr<MoldClient> g_mold_client;
 
 void SignalHandler(int signal) {
     std::cout << "\nReceived signal " << signal << ", shutting down..." << std::endl;
     if (g_client) {
         g_client->Stop();
     }
+    if (g_mold_client) {
+        g_mold_client->Stop();
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
     std::cout << "TickShaper Test Client" << std::endl;
     std::cout << "=====================" << std::endl;
     
@@ -133,7 +651,34 @@ int main() {
     signal(SIGTERM, SignalHandler);
     
     try {
-        g_client = std::make_unique<TickShaperClient>();
+        // --mold <group> <port> [retransmit_host:port] [interface] reads the multicast feed
+        if (argc >= 4 && std::string(argv[1]) == "--mold") {
+            g_mold_client = std::make_unique<MoldClient>(argv[2], static_cast<uint16_t>(std::stoul(argv[3])),
+                                                         argc >= 5 ? argv[4] : "",
+                                                         argc >= 6 ? argv[5] : "127.0.0.1");
+            g_mold_client->Run();
+            return 0;
+        }
+        
+        // [--snapshot <endpoint>] [--report <file>] then optional stock_locate
+        // codes to subscribe to; none means everything
+        std::string snapshot_endpoint;
+        std::string report_file;
+        std::vector<uint16_t> stock_locates;
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--snapshot" && i + 1 < argc) {
+                snapshot_endpoint = argv[++i];
+                continue;
+            }
+            if (std::string(argv[i]) == "--report" && i + 1 < argc) {
+                report_file = argv[++i];
+                continue;
+            }
+            stock_locates.push_back(static_cast<uint16_t>(std::stoul(argv[i])));
+        }
+        
+        g_client = std::make_unique<TickShaperClient>(stock_locates, snapshot_endpoint);
+        g_client->SetReportFile(report_file);
         g_client->Run();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
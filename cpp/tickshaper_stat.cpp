@@ -0,0 +1,184 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include "MetricsSegment.h"
+
+using namespace tickshaper;
+
+// vmstat-style view of a running TickShaper, read from its metrics segment.
+// Needs no socket or signal round trip, so it still reports the last values
+// of a process that is wedged or gone.
+//
+//   tickshaper-stat [-n <segment>] [-l] [interval_s] [count]
+//
+// Rates are per second over the interval; latencies are the process's own
+// last-interval percentiles of the total pipeline stage, in microseconds.
+
+static volatile sig_atomic_t g_running = 1;
+
+static void SignalHandler(int) {
+    g_running = 0;
+}
+
+static uint64_t RealtimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t ValueOf(const MetricsSample& sample, const char* name) {
+    const MetricsSample::Value* value = sample.FindValue(name);
+    return value ? value->value : 0;
+}
+
+// Counter delta per second between two samples of the same writer
+static double RateOf(const MetricsSample& current, const MetricsSample& previous, const char* name, double seconds) {
+    uint64_t now = ValueOf(current, name);
+    uint64_t before = ValueOf(previous, name);
+    return (seconds > 0 && now >= before) ? (now - before) / seconds : 0.0;
+}
+
+static std::string Status(const MetricsSample& sample) {
+    if (kill(sample.pid, 0) == -1 && errno == ESRCH) {
+        return "exited";
+    }
+    uint64_t age_ns = RealtimeNs() - sample.update_time_ns;
+    if (sample.update_count == 0 || age_ns > 3ULL * sample.update_interval_ms * 1000000ULL) {
+        return "stale";
+    }
+    return "";
+}
+
+static void PrintList(const MetricsSample& sample) {
+    std::cout << "pid " << sample.pid << ", update " << sample.update_count << " every "
+              << sample.update_interval_ms << " ms";
+    std::string status = Status(sample);
+    if (!status.empty()) {
+        std::cout << " (" << status << ")";
+    }
+    std::cout << std::endl;
+    
+    for (const MetricsSample::Value& value : sample.values) {
+        std::cout << "  " << std::left << std::setw(24) << value.name << std::right
+                  << std::setw(8) << (value.kind == metrics_shm::kCounter ? "counter" : "gauge") << "  ";
+        if (value.decimals > 0) {
+            std::cout << std::fixed << std::setprecision(value.decimals) << value.Scaled() << std::endl;
+        } else {
+            std::cout << value.value << std::endl;
+        }
+    }
+    
+    std::cout << "  Latency (ns, last interval)      count        p50        p99      p99.9     p99.99        max" << std::endl;
+    for (const MetricsSample::Histogram& histogram : sample.histograms) {
+        std::cout << "  " << std::left << std::setw(24) << histogram.name << std::right
+                  << std::setw(15) << histogram.count << std::setw(11) << histogram.p50
+                  << std::setw(11) << histogram.p99 << std::setw(11) << histogram.p999
+                  << std::setw(11) << histogram.p9999 << std::setw(11) << histogram.max << std::endl;
+    }
+}
+
+static void PrintHeader() {
+    std::cout << "     msg/s   thrtl/s    shed/s     pub/s   drops/s  qdepth   cpu%  rss_MB"
+              << "  p50_us  p99_us p999_us" << std::endl;
+}
+
+static void PrintRow(const MetricsSample& current, const MetricsSample& previous) {
+    double seconds = (current.update_time_ns - previous.update_time_ns) / 1e9;
+    double shed = RateOf(current, previous, "shed_processing", seconds) +
+                  RateOf(current, previous, "shed_conflation", seconds) +
+                  RateOf(current, previous, "shed_publish", seconds);
+    const MetricsSample::Value* cpu = current.FindValue("cpu_usage");
+    const MetricsSample::Histogram* total = current.FindHistogram("latency_total");
+    
+    std::cout << std::fixed << std::setprecision(0)
+              << std::setw(10) << RateOf(current, previous, "messages_processed", seconds)
+              << std::setw(10) << RateOf(current, previous, "messages_throttled", seconds)
+              << std::setw(10) << shed
+              << std::setw(10) << RateOf(current, previous, "published", seconds)
+              << std::setw(10) << RateOf(current, previous, "publish_dropped", seconds)
+              << std::setw(8) << ValueOf(current, "queue_depth")
+              << std::setprecision(1) << std::setw(7) << (cpu ? cpu->Scaled() : 0.0)
+              << std::setw(8) << ValueOf(current, "memory_usage") / (1024.0 * 1024.0)
+              << std::setw(8) << (total ? total->p50 / 1000.0 : 0.0)
+              << std::setw(8) << (total ? total->p99 / 1000.0 : 0.0)
+              << std::setw(8) << (total ? total->p999 / 1000.0 : 0.0);
+    
+    std::string status = Status(current);
+    if (!status.empty()) {
+        std::cout << "  " << status;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string segment_name = "/tickshaper-metrics";
+    bool list = false;
+    int interval = 1;
+    long count = -1;
+    
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            segment_name = argv[++i];
+        } else if (arg == "-l") {
+            list = true;
+        } else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [-n <segment>] [-l] [interval_s] [count]" << std::endl;
+            return 0;
+        } else if (positional == 0) {
+            interval = std::max(1, std::stoi(arg));
+            ++positional;
+        } else {
+            count = std::stol(arg);
+            ++positional;
+        }
+    }
+    
+    signal(SIGINT, SignalHandler);
+    signal(SIGTERM, SignalHandler);
+    
+    MetricsSegmentReader reader;
+    std::string error;
+    if (!reader.Open(segment_name, error)) {
+        std::cerr << "tickshaper-stat: " << error << std::endl;
+        return 1;
+    }
+    
+    MetricsSample previous;
+    if (!reader.Read(previous)) {
+        std::cerr << "tickshaper-stat: segment is being rewritten continuously" << std::endl;
+        return 1;
+    }
+    if (list) {
+        PrintList(previous);
+        return 0;
+    }
+    
+    // The first row covers the next interval, as vmstat's later rows do
+    PrintHeader();
+    for (long row = 0; g_running && (count < 0 || row < count); ++row) {
+        std::this_thread::sleep_for(std::chrono::seconds(interval));
+        if (!g_running) {
+            break;
+        }
+        
+        MetricsSample current;
+        if (!reader.Read(current)) {
+            continue;
+        }
+        if (row > 0 && row % 20 == 0) {
+            PrintHeader();
+        }
+        PrintRow(current, previous);
+        previous = std::move(current);
+    }
+    return 0;
+}
\ No newline at end of file
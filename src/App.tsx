@@ -4,41 +4,76 @@ import { MetricsCard } from './components/MetricsCard';
 import { RealtimeChart } from './components/RealtimeChart';
 import { ControlPanel } from './components/ControlPanel';
 import { MicroburstDetector } from './components/MicroburstDetector';
+import { SymbolRates } from './components/SymbolRates';
 import { TechnicalSpecs } from './components/TechnicalSpecs';
+import { useTickShaperStream, Snapshot } from './hooks/useTickShaperStream';
+
+const formatCount = (value: number) => {
+  if (value >= 1e6) return `${(value / 1e6).toFixed(1)}M`;
+  if (value >= 1e3) return `${(value / 1e3).toFixed(1)}K`;
+  return value.toString();
+};
+
+const formatBytes = (value: number) => {
+  if (value >= 1 << 30) return `${(value / (1 << 30)).toFixed(1)}GB`;
+  if (value >= 1 << 20) return `${(value / (1 << 20)).toFixed(1)}MB`;
+  return `${(value / (1 << 10)).toFixed(1)}KB`;
+};
+
+const formatLatency = (ns: number) => {
+  if (ns >= 1e6) return `${(ns / 1e6).toFixed(2)}ms`;
+  return `${(ns / 1e3).toFixed(1)}us`;
+};
+
+// Direction of the last change, for the card arrows
+const trendOf = (history: Snapshot[], pick: (snapshot: Snapshot) => number): 'up' | 'down' | 'neutral' => {
+  if (history.length < 2) return 'neutral';
+  const now = pick(history[history.length - 1]);
+  const before = pick(history[history.length - 2]);
+  return now > before ? 'up' : now < before ? 'down' : 'neutral';
+};
 
 function App() {
+  const { status, history, latest } = useTickShaperStream();
+
+  const series = (pick: (snapshot: Snapshot) => number) =>
+    history.map(snapshot => ({
+      time: new Date(snapshot.time_ms).toLocaleTimeString(),
+      value: pick(snapshot)
+    }));
+
   return (
     <div className="min-h-screen bg-gray-900">
-      <Header />
+      <Header status={status} uptimeSeconds={latest?.uptime_s} />
       
       <main className="p-6 space-y-6">
         {/* Key Metrics Row */}
         <div className="grid grid-cols-1 md:grid-cols-2 lg:grid-cols-4 gap-4">
           <MetricsCard
             title="Message Throughput"
-            value="127.5K"
+            value={latest ? formatCount(latest.throughput) : '--'}
             subtitle="messages/second"
-            trend="up"
+            trend={trendOf(history, s => s.throughput)}
             color="green"
           />
           <MetricsCard
-            title="Average Latency"
-            value="0.7ms"
+            title="P99 Latency"
+            value={latest ? formatLatency(latest.latency_ns.p99) : '--'}
             subtitle="end-to-end processing"
-            trend="down"
+            trend={trendOf(history, s => s.latency_ns.p99)}
             color="blue"
           />
           <MetricsCard
             title="Queue Depth"
-            value="2.1K"
+            value={latest ? formatCount(latest.queue_depth) : '--'}
             subtitle="pending messages"
-            trend="neutral"
+            trend={trendOf(history, s => s.queue_depth)}
             color="amber"
           />
           <MetricsCard
             title="Memory Usage"
-            value="1.2GB"
-            subtitle="shared memory pool"
+            value={latest ? formatBytes(latest.memory_bytes) : '--'}
+            subtitle="resident set"
             trend="neutral"
             color="blue"
           />
@@ -49,27 +84,36 @@ function App() {
           <RealtimeChart
             title="Message Throughput"
             color="#10B981"
+            data={series(s => s.throughput)}
             maxValue={150000}
             unit=" msg/s"
           />
           <RealtimeChart
-            title="Processing Latency"
+            title="P99 Processing Latency"
             color="#3B82F6"
-            maxValue={5}
-            unit="ms"
+            data={series(s => s.latency_ns.p99 / 1e3)}
+            maxValue={100}
+            unit="us"
           />
           <RealtimeChart
             title="CPU Utilization"
             color="#F59E0B"
+            data={series(s => s.cpu)}
             maxValue={100}
             unit="%"
           />
         </div>
 
         {/* Control and Detection Row */}
-        <div className="grid grid-cols-1 lg:grid-cols-2 gap-6">
+        <div className="grid grid-cols-1 lg:grid-cols-3 gap-6">
           <ControlPanel />
-          <MicroburstDetector />
+          <MicroburstDetector
+            currentBurstRate={latest?.microburst.rate ?? 0}
+            active={latest?.microburst.active ?? false}
+            bursting={latest?.microburst.symbols ?? []}
+            events={latest?.bursts ?? []}
+          />
+          <SymbolRates symbols={latest?.symbols ?? []} />
         </div>
 
         {/* Technical Specifications */}
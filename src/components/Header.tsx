@@ -1,7 +1,28 @@
 import React from 'react';
 import { Activity, Zap, Database } from 'lucide-react';
+import type { StreamStatus } from '../hooks/useTickShaperStream';
+
+interface HeaderProps {
+  status: StreamStatus;
+  uptimeSeconds?: number;
+}
+
+const statusStyles: Record<StreamStatus, { dot: string; text: string; label: string }> = {
+  live: { dot: 'bg-green-500 animate-pulse', text: 'text-green-400', label: 'LIVE' },
+  connecting: { dot: 'bg-amber-500', text: 'text-amber-400', label: 'CONNECTING' },
+  offline: { dot: 'bg-red-500', text: 'text-red-400', label: 'OFFLINE' }
+};
+
+const formatUptime = (seconds: number) => {
+  const days = Math.floor(seconds / 86400);
+  const hours = Math.floor((seconds % 86400) / 3600);
+  const minutes = Math.floor((seconds % 3600) / 60);
+  return `${days}d ${hours}h ${minutes}m`;
+};
+
+export const Header: React.FC<HeaderProps> = ({ status, uptimeSeconds }) => {
+  const style = statusStyles[status];
 
-export const Header: React.FC = () => {
   return (
     <header className="bg-gray-900 border-b border-gray-700 px-6 py-4">
       <div className="flex items-center justify-between">
@@ -15,14 +36,16 @@ export const Header: React.FC = () => {
         
         <div className="flex items-center space-x-6">
           <div className="flex items-center space-x-2">
-            <div className="w-2 h-2 bg-green-500 rounded-full animate-pulse"></div>
-            <span className="text-green-400 text-sm font-medium">LIVE</span>
+            <div className={`w-2 h-2 rounded-full ${style.dot}`}></div>
+            <span className={`text-sm font-medium ${style.text}`}>{style.label}</span>
           </div>
           
           <div className="flex items-center space-x-4 text-sm">
             <div className="flex items-center space-x-1">
               <Activity className="h-4 w-4 text-blue-400" />
-              <span className="text-gray-300">Uptime: 15d 4h 23m</span>
+              <span className="text-gray-300">
+                Uptime: {uptimeSeconds !== undefined ? formatUptime(uptimeSeconds) : '--'}
+              </span>
             </div>
             <div className="flex items-center space-x-1">
               <Database className="h-4 w-4 text-green-400" />
@@ -1,42 +1,29 @@
-import React, { useState, useEffect } from 'react';
+import React from 'react';
 import { AlertTriangle, TrendingUp } from 'lucide-react';
+import type { BurstEvent, SymbolBurst } from '../hooks/useTickShaperStream';
 
-interface MicroburstEvent {
-  id: string;
-  timestamp: string;
-  peakRate: number;
-  duration: number;
-  severity: 'low' | 'medium' | 'high';
+interface MicroburstDetectorProps {
+  currentBurstRate: number;
+  active: boolean;
+  bursting: SymbolBurst[];
+  events: BurstEvent[];
 }
 
-export const MicroburstDetector: React.FC = () => {
-  const [events, setEvents] = useState<MicroburstEvent[]>([]);
-  const [currentBurstRate, setCurrentBurstRate] = useState(0);
+// Feed event time of day, from milliseconds since midnight
+const formatEventTime = (ms: number) => {
+  const pad = (value: number, width = 2) => value.toString().padStart(width, '0');
+  return `${pad(Math.floor(ms / 3600000) % 24)}:${pad(Math.floor(ms / 60000) % 60)}:` +
+    `${pad(Math.floor(ms / 1000) % 60)}.${pad(ms % 1000, 3)}`;
+};
 
-  useEffect(() => {
-    const interval = setInterval(() => {
-      // Simulate microburst detection
-      const burstRate = Math.random() * 200000 + 50000;
-      setCurrentBurstRate(burstRate);
-
-      // Occasionally generate a microburst event
-      if (Math.random() < 0.1) {
-        const severity = burstRate > 180000 ? 'high' : burstRate > 120000 ? 'medium' : 'low';
-        const newEvent: MicroburstEvent = {
-          id: Math.random().toString(36).substr(2, 9),
-          timestamp: new Date().toLocaleTimeString(),
-          peakRate: Math.floor(burstRate),
-          duration: Math.floor(Math.random() * 500) + 100,
-          severity
-        };
-
-        setEvents(prev => [newEvent, ...prev.slice(0, 4)]);
-      }
-    }, 2000);
-
-    return () => clearInterval(interval);
-  }, []);
+const burstSource = (stockLocate: number) => (stockLocate === 0 ? 'ALL SYMBOLS' : `LOCATE ${stockLocate}`);
 
+export const MicroburstDetector: React.FC<MicroburstDetectorProps> = ({
+  currentBurstRate,
+  active,
+  bursting,
+  events
+}) => {
   const getSeverityColor = (severity: string) => {
     switch (severity) {
       case 'high': return 'text-red-400 bg-red-900/20 border-red-700';
@@ -57,7 +44,11 @@ export const MicroburstDetector: React.FC = () => {
       <div className="mb-6 p-4 bg-gray-900 rounded-lg border border-gray-600">
         <div className="flex items-center justify-between mb-2">
           <span className="text-gray-300 text-sm">Current Burst Rate</span>
-          <TrendingUp className="h-4 w-4 text-blue-400" />
+          {active ? (
+            <span className="text-red-400 text-xs font-medium uppercase">In burst</span>
+          ) : (
+            <TrendingUp className="h-4 w-4 text-blue-400" />
+          )}
         </div>
         <div className="text-2xl font-mono text-blue-400 font-bold">
           {currentBurstRate.toLocaleString()} msg/s
@@ -70,6 +61,23 @@ export const MicroburstDetector: React.FC = () => {
         </div>
       </div>
 
+      {/* Symbols Bursting Now */}
+      {bursting.length > 0 && (
+        <div className="mb-6">
+          <h4 className="text-gray-300 text-sm font-medium mb-3">Bursting Now</h4>
+          <div className="flex flex-wrap gap-2">
+            {bursting.map(symbol => (
+              <span
+                key={symbol.stock_locate}
+                className="px-2 py-1 rounded text-xs font-mono text-red-400 bg-red-900/20 border border-red-700"
+              >
+                {symbol.stock_locate}: {symbol.rate.toLocaleString()} msg/s
+              </span>
+            ))}
+          </div>
+        </div>
+      )}
+
       {/* Recent Events */}
       <div>
         <h4 className="text-gray-300 text-sm font-medium mb-3">Recent Events</h4>
@@ -79,16 +87,18 @@ export const MicroburstDetector: React.FC = () => {
           ) : (
             events.map(event => (
               <div 
-                key={event.id}
+                key={`${event.stock_locate}-${event.start_ms}`}
                 className={`p-3 rounded-lg border text-sm ${getSeverityColor(event.severity)}`}
               >
                 <div className="flex items-center justify-between mb-1">
-                  <span className="font-medium uppercase text-xs">{event.severity} SEVERITY</span>
-                  <span className="text-xs opacity-75">{event.timestamp}</span>
+                  <span className="font-medium uppercase text-xs">
+                    {event.severity} SEVERITY · {burstSource(event.stock_locate)}
+                  </span>
+                  <span className="text-xs opacity-75">{formatEventTime(event.start_ms)}</span>
                 </div>
                 <div className="space-y-1">
-                  <div>Peak: <span className="font-mono">{event.peakRate.toLocaleString()}</span> msg/s</div>
-                  <div>Duration: <span className="font-mono">{event.duration}ms</span></div>
+                  <div>Peak: <span className="font-mono">{event.peak_rate.toLocaleString()}</span> msg/s</div>
+                  <div>Duration: <span className="font-mono">{event.duration_ms}ms</span></div>
                 </div>
               </div>
             ))
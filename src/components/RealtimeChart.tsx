@@ -1,6 +1,6 @@
-import React, { useState, useEffect } from 'react';
+import React from 'react';
 
-interface DataPoint {
+export interface DataPoint {
   time: string;
   value: number;
 }
@@ -8,6 +8,7 @@ interface DataPoint {
 interface RealtimeChartProps {
   title: string;
   color: string;
+  data: DataPoint[];
   maxValue?: number;
   unit?: string;
 }
@@ -15,26 +16,10 @@ interface RealtimeChartProps {
 export const RealtimeChart: React.FC<RealtimeChartProps> = ({ 
   title, 
   color, 
+  data,
   maxValue = 100000,
   unit = ''
 }) => {
-  const [data, setData] = useState<DataPoint[]>([]);
-
-  useEffect(() => {
-    const interval = setInterval(() => {
-      const now = new Date();
-      const timeStr = now.toLocaleTimeString();
-      const value = Math.floor(Math.random() * maxValue * 0.8) + maxValue * 0.2;
-      
-      setData(prev => {
-        const newData = [...prev, { time: timeStr, value }];
-        return newData.slice(-20); // Keep last 20 points
-      });
-    }, 1000);
-
-    return () => clearInterval(interval);
-  }, [maxValue]);
-
   const maxDataValue = Math.max(...data.map(d => d.value), maxValue);
 
   return (
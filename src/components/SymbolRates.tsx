@@ -0,0 +1,41 @@
+import React from 'react';
+import { BarChart3 } from 'lucide-react';
+import type { SymbolRate } from '../hooks/useTickShaperStream';
+
+interface SymbolRatesProps {
+  symbols: SymbolRate[];
+}
+
+export const SymbolRates: React.FC<SymbolRatesProps> = ({ symbols }) => {
+  const busiest = symbols.length > 0 ? symbols[0].rate : 0;
+
+  return (
+    <div className="bg-gray-800 rounded-lg border border-gray-700 p-6">
+      <div className="flex items-center space-x-2 mb-6">
+        <BarChart3 className="h-5 w-5 text-green-400" />
+        <h3 className="text-white font-medium">Busiest Symbols</h3>
+      </div>
+
+      <div className="space-y-3">
+        {symbols.length === 0 ? (
+          <div className="text-gray-500 text-sm italic p-2">No symbol traffic</div>
+        ) : (
+          symbols.map(symbol => (
+            <div key={symbol.stock_locate}>
+              <div className="flex items-center justify-between text-sm mb-1">
+                <span className="text-gray-300">Locate {symbol.stock_locate}</span>
+                <span className="font-mono text-green-400">{symbol.rate.toLocaleString()} msg/s</span>
+              </div>
+              <div className="w-full bg-gray-700 rounded-full h-2">
+                <div
+                  className="bg-green-500 h-2 rounded-full transition-all duration-500"
+                  style={{ width: `${busiest > 0 ? (symbol.rate / busiest) * 100 : 0}%` }}
+                />
+              </div>
+            </div>
+          ))
+        )}
+      </div>
+    </div>
+  );
+};
\ No newline at end of file
@@ -0,0 +1,103 @@
+import { useEffect, useState } from 'react';
+
+// One snapshot pushed by the engine's dashboard stream (dashboard_port).
+// Rates are per second over interval_ms; aggregation happens on the server.
+// Burst times are feed event time, milliseconds since midnight.
+export interface BurstEvent {
+  stock_locate: number; // 0 for the aggregate rate
+  start_ms: number;
+  duration_ms: number;
+  peak_rate: number;
+  messages: number;
+  severity: 'low' | 'medium' | 'high';
+}
+
+export interface SymbolBurst {
+  stock_locate: number;
+  start_ms: number;
+  rate: number;
+  peak_rate: number;
+}
+
+export interface SymbolRate {
+  stock_locate: number;
+  rate: number;
+}
+
+export interface Snapshot {
+  type: 'snapshot';
+  time_ms: number;
+  interval_ms: number;
+  throughput: number;
+  throttled: number;
+  pruned: number;
+  published: number;
+  shed: number;
+  queue_depth: number;
+  throttle_rate: number;
+  cpu: number;
+  memory_bytes: number;
+  uptime_s: number;
+  latency_ns: {
+    count: number;
+    p50: number;
+    p99: number;
+    p999: number;
+    max: number;
+  };
+  microburst: {
+    active: boolean;
+    rate: number;
+    symbols: SymbolBurst[];
+  };
+  bursts: BurstEvent[];
+  symbols: SymbolRate[];
+}
+
+export type StreamStatus = 'connecting' | 'live' | 'offline';
+
+const HISTORY_SIZE = 60;
+const RECONNECT_MS = 2000;
+
+export const STREAM_URL: string =
+  import.meta.env.VITE_TICKSHAPER_WS ?? `ws://${window.location.hostname}:8765`;
+
+export function useTickShaperStream(url: string = STREAM_URL) {
+  const [status, setStatus] = useState<StreamStatus>('connecting');
+  const [history, setHistory] = useState<Snapshot[]>([]);
+
+  useEffect(() => {
+    let socket: WebSocket | null = null;
+    let retry: ReturnType<typeof setTimeout> | undefined;
+    let closed = false;
+
+    const connect = () => {
+      setStatus('connecting');
+      socket = new WebSocket(url);
+      socket.onopen = () => setStatus('live');
+      socket.onmessage = (message: MessageEvent<string>) => {
+        const snapshot = JSON.parse(message.data) as Snapshot;
+        if (snapshot.type !== 'snapshot') {
+          return;
+        }
+        setHistory(prev => [...prev, snapshot].slice(-HISTORY_SIZE));
+      };
+      socket.onclose = () => {
+        setStatus('offline');
+        if (!closed) {
+          retry = setTimeout(connect, RECONNECT_MS);
+        }
+      };
+    };
+
+    connect();
+    return () => {
+      closed = true;
+      clearTimeout(retry);
+      socket?.close();
+    };
+  }, [url]);
+
+  const latest = history.length > 0 ? history[history.length - 1] : null;
+  return { status, history, latest };
+}
\ No newline at end of file